@@ -12,3 +12,4 @@ int rockchip_cpuid_from_efuse(const u32 cpuid_offset,
 int rockchip_cpuid_set(const u8 *cpuid, const u32 cpuid_length);
 int rockchip_setup_macaddr(void);
 void rockchip_capsule_update_board_setup(void);
+int rockchip_mmc_tuning_cache_flush(void);
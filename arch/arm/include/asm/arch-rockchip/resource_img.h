@@ -14,15 +14,17 @@
 #define DTB_SUFFIX			".dtb"
 
 struct resource_file {
-	char		name[MAX_FILE_NAME_LEN];
 	char		hash[MAX_HASH_LEN];
 	uint32_t	hash_size;
 	uint32_t	f_offset;	/* Sector offset */
 	uint32_t	f_size;		/* Bytes */
 	struct list_head link;
+	struct hlist_node hnode;	/* Name index, unhashed if duplicated */
 	/* Sector base of resource when ram=false, byte base when ram=true */
 	uint32_t	rsce_base;
 	bool		ram;
+	void		*data;		/* File content, cached on first read */
+	char		name[];		/* Allocated to fit */
 };
 
 extern struct list_head entrys_head;
@@ -58,6 +60,26 @@ int resource_create_ram_list(struct blk_desc *dev_desc, void *rsce_hdr);
  */
 int rockchip_read_resource_file(void *buf, const char *name, int offset, int len);
 
+/*
+ * rockchip_get_resource_file_size() - get the size of a file
+ *
+ * @name: file name
+ *
+ * return the file size in bytes, -ENOENT if there is no such file
+ */
+int rockchip_get_resource_file_size(const char *name);
+
+/*
+ * rockchip_get_resource_file_hash() - get the hash recorded for a file
+ *
+ * @name: file name
+ * @hash: set to the hash, SHA1 or SHA256 of the file as stored
+ *
+ * return the hash size in bytes, 0 if the file has none (e.g. it comes
+ * from the logo partition), -ENOENT if there is no such file
+ */
+int rockchip_get_resource_file_hash(const char *name, char **hash);
+
 /*
  * rockchip_read_resource_dtb() - read dtb file
  *
@@ -25,6 +25,7 @@
 #define LAN_RGMII_DL_ID			16
 #define EINK_VCOM_ID			17
 #define FIRMWARE_VER_ID			18
+#define MMC_TUNING_ID			19
 
 struct vendor_item {
 	u16  id;
@@ -34,8 +35,11 @@ struct vendor_item {
 };
 
 int vendor_storage_test(void);
+int vendor_storage_init(void);
+int vendor_storage_init_dev(struct blk_desc *dev_desc);
 int vendor_storage_read(u16 id, void *pbuf, u16 size);
 int vendor_storage_write(u16 id, void *pbuf, u16 size);
+bool vendor_storage_ready(void);
 int flash_vendor_dev_ops_register(int (*read)(struct blk_desc *dev_desc,
 					      u32 sec,
 					      u32 n_sec,
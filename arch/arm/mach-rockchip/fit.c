@@ -4,6 +4,8 @@
  * SPDX-License-Identifier:     GPL-2.0+
  */
 #include <common.h>
+#include <blk.h>
+#include <bootstage.h>
 #include <boot_rkimg.h>
 #include <image.h>
 #include <malloc.h>
@@ -20,6 +22,9 @@ DECLARE_GLOBAL_DATA_PTR;
  */
 #define FIT_FDT_MAX_SIZE		SZ_4K
 
+/* Images are read in pieces of this size so hashing overlaps the reads */
+#define FIT_HASH_CHUNK_SIZE		SZ_512K
+
 static int fit_is_ext_type(const void *fit)
 {
 	return fdt_totalsize(fit) < FIT_FDT_MAX_SIZE;
@@ -292,11 +297,49 @@ static int fit_image_get_subnode(const void *fit, int noffset, const char *name)
 	return -ENOENT;
 }
 
+struct fit_read_hashed {
+	struct blk_chunk_range range;
+	struct fit_hash_ctx *hc;
+};
+
+static int fit_image_hash_chunk(void *priv, const struct blk_chunk *chunk)
+{
+	struct fit_read_hashed *rh = priv;
+
+	return fit_hash_update(rh->hc, chunk->buf, chunk->len);
+}
+
+/*
+ * Read an image and hash it piece by piece: while one piece is hashed, the
+ * next one is already being read.
+ */
+static int fit_image_read_hashed(struct blk_desc *dev_desc, lbaint_t start,
+				 void *data, int size,
+				 struct fit_hash_ctx *hc)
+{
+	struct fit_read_hashed rh = {
+		.range = {
+			.desc = dev_desc,
+			.start = start,
+			.size = size,
+			.buf = data,
+			.chunk = FIT_HASH_CHUNK_SIZE,
+		},
+		.hc = hc,
+	};
+
+	return blk_read_chunks(dev_desc, blk_chunk_plan_range,
+			       fit_image_hash_chunk, &rh);
+}
+
 static int fit_image_load_one(const void *fit, struct blk_desc *dev_desc,
 			      disk_partition_t *part, char *prop_name,
 			      void *data, int check_hash)
 {
+	struct fit_hash_ctx hc;
+	int hash_noffset = -1;
 	u32 blk_num, blk_off;
+	uint32_t start_us;
 	int offset, size;
 	int noffset, ret;
 	char *msg = "";
@@ -307,12 +350,8 @@ static int fit_image_load_one(const void *fit, struct blk_desc *dev_desc,
 
 	blk_off = (FIT_ALIGN(fdt_totalsize(fit)) + offset) / dev_desc->blksz;
 	blk_num = DIV_ROUND_UP(size, dev_desc->blksz);
-	if (blk_dread(dev_desc, part->start + blk_off, blk_num, data) != blk_num)
-		return -EIO;
 
 	if (check_hash) {
-		int hash_noffset;
-
 		noffset = fit_default_conf_get_node(fit, prop_name);
 		if (noffset < 0)
 			return noffset;
@@ -323,16 +362,230 @@ static int fit_image_load_one(const void *fit, struct blk_desc *dev_desc,
 			return hash_noffset;
 
 		printf("%s: ", fdt_get_name(fit, noffset, NULL));
-		ret = fit_image_check_hash(fit, hash_noffset, data, size, &msg);
-		if (ret)
+		ret = fit_image_hash_init(fit, hash_noffset, &hc, size, &msg);
+		if (ret < 0)
 			return ret;
+		if (ret)
+			hash_noffset = -1;	/* hash node is ignored */
+	}
+
+	if (hash_noffset < 0) {
+		if (blk_dread(dev_desc, part->start + blk_off,
+			      blk_num, data) != blk_num)
+			return -EIO;
 
-		puts("+\n");
+		if (check_hash)
+			puts("+\n");
+
+		return 0;
+	}
+
+	start_us = timer_get_boot_us();
+	ret = fit_image_read_hashed(dev_desc, part->start + blk_off, data,
+				    size, &hc);
+	if (ret) {
+		fit_hash_abort(&hc);
+		return ret;
 	}
 
+	ret = fit_image_hash_check(fit, hash_noffset, &hc, &msg);
+	bootstage_accum_name(prop_name, start_us);
+	if (ret)
+		return ret;
+
+	puts("+\n");
+
 	return 0;
 }
 
+/**
+ * struct fit_bootable - an image that is loaded to its own address
+ *
+ * @prop:	Image property in the default configuration
+ * @addr_name:	Environment variable holding the load address
+ * @mem:	sysmem region the image is placed in
+ */
+struct fit_bootable {
+	const char *prop;
+	const char *addr_name;
+	enum memblk_id mem;
+};
+
+static const struct fit_bootable fit_bootables[] = {
+	{ FIT_FDT_PROP,     "fdt_addr_r",     MEM_FDT },
+	{ FIT_KERNEL_PROP,  "kernel_addr_r",  MEM_KERNEL },
+	{ FIT_RAMDISK_PROP, "ramdisk_addr_r", MEM_RAMDISK },
+};
+
+/**
+ * struct fit_direct - an image read straight to its load address
+ *
+ * @noffset:	Image node offset, 0 if the image is read with the FIT blob
+ * @pos:	Byte offset of the data from the start of the partition
+ * @size:	Data size
+ * @old_load:	Load address found in the image node
+ * @load:	Load address the data is read to
+ */
+struct fit_direct {
+	int noffset;
+	ulong pos;
+	ulong size;
+	ulong old_load;
+	ulong load;
+};
+
+/*
+ * Decide which images are read straight to their load address and return
+ * how much has to be read along with the FIT blob.
+ *
+ * That needs the data to start on a block and the load address to be
+ * usable for DMA; the image must also end up where fit_image_pre_process()
+ * reserves it. Verified boot keeps the classic path since the image nodes
+ * are not to be touched then.
+ */
+static ulong fit_image_plan_direct(const void *fit, ulong blksz,
+				   struct fit_direct *plan)
+{
+	ulong staged = FIT_ALIGN(fdt_totalsize(fit));
+	bool allowed = !fit_sig_require_conf(fit, gd_fdt_blob());
+	const struct fit_bootable *b;
+	const void *data;
+	ulong load, addr, pos;
+	size_t size;
+	int i, noffset;
+
+	memset(plan, 0, sizeof(*plan) * ARRAY_SIZE(fit_bootables));
+	for (i = 0; i < ARRAY_SIZE(fit_bootables); i++) {
+		b = &fit_bootables[i];
+		noffset = fit_default_conf_get_node(fit, b->prop);
+		if (noffset < 0 || fit_image_get_data(fit, noffset, &data, &size) ||
+		    !size)
+			continue;
+
+		pos = (ulong)data - (ulong)fit;
+		addr = env_get_ulong(b->addr_name, 16, 0);
+		if (allowed && addr && pos >= fdt_totalsize(fit) &&
+		    !fit_image_get_load(fit, noffset, &load) &&
+		    (load == addr || fit_image_addr_is_placeholder(load)) &&
+		    IS_ALIGNED(pos, blksz) &&
+		    IS_ALIGNED(addr, ARCH_DMA_MINALIGN)) {
+			plan[i].noffset = noffset;
+			plan[i].pos = pos;
+			plan[i].size = size;
+			plan[i].old_load = load;
+			plan[i].load = addr;
+			continue;
+		}
+
+		staged = max(staged, pos + FIT_ALIGN(size));
+	}
+
+	return staged;
+}
+
+/*
+ * The address the data property of @noffset is relative to, for the FIT
+ * @fit read to @base. @fit and @base differ while the FIT is still a copy
+ * of its header that has not been read to @base yet.
+ */
+static ulong fit_image_data_base(const void *fit, ulong base, int noffset,
+				 const char **prop)
+{
+	int offset;
+
+	if (!fit_image_get_data_offset(fit, noffset, &offset)) {
+		*prop = FIT_DATA_OFFSET_PROP;
+		return base + FIT_ALIGN(fdt_totalsize(fit));
+	}
+
+	*prop = FIT_DATA_POSITION_PROP;
+
+	return base;
+}
+
+/* The data properties are 32-bit, check they can reach every load address */
+static bool fit_image_direct_reachable(const void *fit, ulong base,
+				       const struct fit_direct *plan)
+{
+	const char *prop;
+	long delta;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(fit_bootables); i++) {
+		if (!plan[i].noffset)
+			continue;
+
+		delta = (long)(plan[i].load -
+			       fit_image_data_base(fit, base, plan[i].noffset,
+						   &prop));
+		if (delta != (int)delta)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Read the data to its load address and point the image node at it, so
+ * bootm finds it in place instead of copying it out of the FIT buffer. The
+ * partial block at the end goes through a bounce buffer to leave whatever
+ * follows the image untouched.
+ */
+static int fit_image_load_direct(void *fit, struct blk_desc *dev_desc,
+				 disk_partition_t *part,
+				 const struct fit_bootable *b,
+				 const struct fit_direct *d)
+{
+	lbaint_t start = part->start + d->pos / dev_desc->blksz;
+	u32 blk_num = d->size / dev_desc->blksz;
+	u32 tail = d->size % dev_desc->blksz;
+	const char *prop;
+	void *bounce;
+	ulong base;
+	int ret;
+
+	if (!sysmem_alloc_base(b->mem, (phys_addr_t)d->load,
+			       ALIGN(d->size, RK_BLK_SIZE)))
+		return -ENOMEM;
+
+	ret = fix_image_set_addr(fit, b->prop, d->old_load, d->load);
+	if (ret)
+		goto err;
+
+	if (blk_num && blk_dread(dev_desc, start, blk_num,
+				 (void *)d->load) != blk_num) {
+		ret = -EIO;
+		goto err;
+	}
+
+	if (tail) {
+		bounce = memalign(ARCH_DMA_MINALIGN, dev_desc->blksz);
+		if (!bounce) {
+			ret = -ENOMEM;
+			goto err;
+		}
+
+		if (blk_dread(dev_desc, start + blk_num, 1, bounce) == 1)
+			memcpy((void *)d->load + blk_num * dev_desc->blksz,
+			       bounce, tail);
+		else
+			ret = -EIO;
+		free(bounce);
+		if (ret)
+			goto err;
+	}
+
+	base = fit_image_data_base(fit, (ulong)fit, d->noffset, &prop);
+	ret = fdt_setprop_inplace_u32(fit, d->noffset, prop,
+				      (u32)(d->load - base));
+	if (!ret)
+		return 0;
+err:
+	sysmem_free((phys_addr_t)d->load);
+
+	return ret;
+}
+
 /* Calculate what we really need */
 ulong fit_image_get_bootables_size(const void *fit)
 {
@@ -362,38 +615,73 @@ ulong fit_image_get_bootables_size(const void *fit)
 
 void *fit_image_load_bootables(ulong *size)
 {
+	struct fit_direct plan[ARRAY_SIZE(fit_bootables)];
 	struct blk_desc *dev_desc;
 	disk_partition_t part;
+	void *blob, *fit;
+	ulong staged;
 	int blk_num;
-	void *fit;
+	int i, ret;
 
 	dev_desc = rockchip_get_bootdev();
 	if (!dev_desc)
 		return NULL;
 
-	fit = fit_get_blob(dev_desc, &part, false);
-	if (!fit) {
+	blob = fit_get_blob(dev_desc, &part, false);
+	if (!blob) {
 		FIT_I("No fit blob\n");
 		return NULL;
 	}
 
-	*size = fit_image_get_bootables_size(fit);
+	*size = fit_image_get_bootables_size(blob);
 	if (*size == 0) {
 		FIT_I("No bootable image\n");
+		free(blob);
 		return NULL;
 	}
 
-	blk_num = DIV_ROUND_UP(*size, dev_desc->blksz);
+	staged = fit_image_plan_direct(blob, dev_desc->blksz, plan);
+	blk_num = DIV_ROUND_UP(staged, dev_desc->blksz);
 	fit = sysmem_alloc(MEM_FIT, blk_num * dev_desc->blksz);
+	/* @fit is not read yet, look at the header in @blob instead */
+	if (fit && !fit_image_direct_reachable(blob, (ulong)fit, plan)) {
+		sysmem_free((phys_addr_t)fit);
+		memset(plan, 0, sizeof(plan));
+		blk_num = DIV_ROUND_UP(*size, dev_desc->blksz);
+		fit = sysmem_alloc(MEM_FIT, blk_num * dev_desc->blksz);
+	}
+	free(blob);
 	if (!fit)
 		return NULL;
 
 	if (blk_dread(dev_desc, part.start, blk_num, fit) != blk_num) {
 		FIT_I("Failed to load bootable images\n");
-		return NULL;
+		goto err;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(fit_bootables); i++) {
+		if (!plan[i].noffset)
+			continue;
+
+		ret = fit_image_load_direct(fit, dev_desc, &part,
+					    &fit_bootables[i], &plan[i]);
+		if (ret) {
+			FIT_I("Failed to load %s, ret=%d\n",
+			      fit_bootables[i].prop, ret);
+			/* Release what the images before this one reserved */
+			while (--i >= 0) {
+				if (plan[i].noffset)
+					sysmem_free((phys_addr_t)plan[i].load);
+			}
+			goto err;
+		}
 	}
 
 	return fit;
+err:
+	sysmem_free((phys_addr_t)fit);
+
+	return NULL;
 }
 
 static void fit_msg(const void *fit)
@@ -358,6 +358,13 @@ dtb_embed:
 	}
 
 dtb_okay:
+	/*
+	 * Nodes still pending stay valid in the live tree, which is kept in
+	 * gd->of_root_f, and bind when first used. Flat tree offsets do not
+	 * survive the swap, so bind those now.
+	 */
+	if (!of_live_active())
+		dm_lazy_bind_all();
 	gd->fdt_blob = (void *)fdt_addr;
 	hotkey_run(HK_FDT);
 
@@ -0,0 +1,166 @@
+/*
+ * (C) Copyright 2026 Rockchip Electronics Co., Ltd
+ *
+ * SPDX-License-Identifier:     GPL-2.0+
+ */
+
+#include <common.h>
+#include <mmc.h>
+#include <asm/arch/rk_atags.h>
+#include <asm/arch/vendor.h>
+#include <asm/arch-rockchip/misc.h>
+
+/* Cards with a record, the most recently brought up first */
+#define MMC_TUNING_CARDS	2
+
+static struct mmc_tuning_cache mmc_tuning[MMC_TUNING_CARDS];
+static bool mmc_tuning_loaded;
+static bool mmc_tuning_dirty;
+
+/*
+ * Record of a card brought up before vendor storage was read in, and which
+ * could not read it in itself. Its saved record was not tried, so this only
+ * fills in a missing one.
+ */
+static struct mmc_tuning_cache mmc_tuning_pending;
+
+static void mmc_tuning_store(const struct mmc_tuning_cache *rec, bool failed)
+{
+	int i;
+
+	for (i = 0; i < MMC_TUNING_CARDS - 1; i++) {
+		if (!memcmp(mmc_tuning[i].cid, rec->cid, sizeof(rec->cid)))
+			break;
+	}
+
+	/*
+	 * Tuning finds a slightly different point at each boot. Keep a
+	 * record that was not shown to fail, rather than write vendor
+	 * storage at every boot.
+	 */
+	if (!failed && mmc_tuning[i].magic == MMC_TUNING_CACHE_MAGIC &&
+	    !memcmp(mmc_tuning[i].cid, rec->cid, sizeof(rec->cid)))
+		return;
+	if (!i && !memcmp(&mmc_tuning[0], rec, sizeof(*rec)))
+		return;
+
+	memmove(&mmc_tuning[1], &mmc_tuning[0], i * sizeof(*rec));
+	mmc_tuning[0] = *rec;
+	mmc_tuning_dirty = true;
+}
+
+/*
+ * Read the records in, once vendor storage itself is. Until then, the card
+ * it lives on may be the one being brought up, so it must not be touched.
+ */
+static int mmc_tuning_load(void)
+{
+	int ret;
+
+	if (mmc_tuning_loaded)
+		return 0;
+	if (!vendor_storage_ready())
+		return -EAGAIN;
+
+	ret = vendor_storage_read(MMC_TUNING_ID, mmc_tuning,
+				  sizeof(mmc_tuning));
+	if (ret != sizeof(mmc_tuning))
+		memset(mmc_tuning, 0, sizeof(mmc_tuning));
+	mmc_tuning_loaded = true;
+
+	if (mmc_tuning_pending.magic) {
+		mmc_tuning_store(&mmc_tuning_pending, false);
+		mmc_tuning_pending.magic = 0;
+	}
+
+	return 0;
+}
+
+int rockchip_mmc_tuning_cache_flush(void)
+{
+	int ret;
+
+	if (!mmc_tuning_loaded && !mmc_tuning_pending.magic)
+		return 0;
+
+	if (!vendor_storage_ready()) {
+		ret = vendor_storage_init();
+		if (ret)
+			return ret;
+	}
+
+	ret = mmc_tuning_load();
+	if (ret || !mmc_tuning_dirty)
+		return ret;
+
+	ret = vendor_storage_write(MMC_TUNING_ID, mmc_tuning,
+				   sizeof(mmc_tuning));
+	if (ret != sizeof(mmc_tuning)) {
+		printf("MMC: failed to save tuning, ret=%d\n", ret);
+		return ret < 0 ? ret : -EIO;
+	}
+	mmc_tuning_dirty = false;
+
+	return 0;
+}
+
+/*
+ * Whether vendor storage lives on @mmc: the eMMC the boot device is set to,
+ * or, if none is set, the eMMC the preloader booted from.
+ */
+static bool mmc_tuning_on_card(struct mmc *mmc)
+{
+	const char *bootdev = CONFIG_ROCKCHIP_BOOTDEV;
+#ifdef CONFIG_ROCKCHIP_PRELOADER_ATAGS
+	struct tag *t;
+#endif
+
+	if (IS_SD(mmc) || mmc_get_blk_desc(mmc)->devnum)
+		return false;
+	if (strchr(bootdev, ' '))
+		return !strcmp(bootdev, "mmc 0");
+#ifdef CONFIG_ROCKCHIP_PRELOADER_ATAGS
+	t = atags_get_tag(ATAG_BOOTDEV);
+
+	return t && t->u.bootdev.devtype == BOOT_TYPE_EMMC;
+#else
+	return false;
+#endif
+}
+
+int board_mmc_tuning_cache_load(struct mmc *mmc, struct mmc_tuning_cache *rec,
+				bool card_ready)
+{
+	int i, ret;
+
+	ret = mmc_tuning_load();
+	/* Read vendor storage in from the card it lives on, before tuning */
+	if (ret == -EAGAIN && card_ready && mmc_tuning_on_card(mmc) &&
+	    !vendor_storage_init_dev(mmc_get_blk_desc(mmc)))
+		ret = mmc_tuning_load();
+	if (ret)
+		return ret;
+
+	for (i = 0; i < MMC_TUNING_CARDS; i++) {
+		if (mmc_tuning[i].magic == MMC_TUNING_CACHE_MAGIC &&
+		    !memcmp(mmc_tuning[i].cid, mmc->cid, sizeof(mmc->cid))) {
+			*rec = mmc_tuning[i];
+			return 0;
+		}
+	}
+
+	return -ENOENT;
+}
+
+void board_mmc_tuning_cache_save(struct mmc *mmc,
+				 const struct mmc_tuning_cache *rec,
+				 bool failed)
+{
+	if (mmc_tuning_load()) {
+		mmc_tuning_pending = *rec;
+		return;
+	}
+
+	mmc_tuning_store(rec, failed);
+	rockchip_mmc_tuning_cache_flush();
+}
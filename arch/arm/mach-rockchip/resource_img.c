@@ -31,6 +31,7 @@ DECLARE_GLOBAL_DATA_PTR;
 #define MAX_FILE_NAME_LEN		220
 #define MAX_HASH_LEN			32
 #define DEFAULT_DTB_FILE		"rk-kernel.dtb"
+#define RESOURCE_HASH_BUCKETS		64	/* power of 2 */
 
 /*
  *         resource image structure
@@ -101,6 +102,8 @@ struct resource_entry {
 };
 
 LIST_HEAD(entrys_head);
+static struct hlist_head entrys_hash[RESOURCE_HASH_BUCKETS];
+static ulong cache_size;
 
 int resource_image_check_header(void *rsce_hdr)
 {
@@ -126,29 +129,92 @@ int resource_image_check_header(void *rsce_hdr)
 	return ret;
 }
 
+static struct hlist_head *resource_hash_bucket(const char *name)
+{
+	u32 hash = 5381;
+
+	while (*name)
+		hash = hash * 33 + *name++;
+
+	return &entrys_hash[hash & (RESOURCE_HASH_BUCKETS - 1)];
+}
+
+static struct resource_file *resource_lookup(const char *name)
+{
+	struct resource_file *file;
+	struct hlist_node *node;
+
+	hlist_for_each_entry(file, node, resource_hash_bucket(name), hnode) {
+		if (!strcmp(file->name, name))
+			return file;
+	}
+
+	return NULL;
+}
+
+static void resource_drop_cache(struct resource_file *file)
+{
+	if (!file->data)
+		return;
+
+	cache_size -= ALIGN(file->f_size, RK_BLK_SIZE);
+	free(file->data);
+	file->data = NULL;
+}
+
+/*
+ * The files are still referenced by callers (e.g. DTB hash), so only the
+ * index and the cached contents are dropped.
+ */
+static void resource_reset_list(void)
+{
+	struct resource_file *file;
+	struct list_head *node;
+	int i;
+
+	list_for_each(node, &entrys_head) {
+		file = list_entry(node, struct resource_file, link);
+		resource_drop_cache(file);
+	}
+
+	list_del_init(&entrys_head);
+	for (i = 0; i < RESOURCE_HASH_BUCKETS; i++)
+		INIT_HLIST_HEAD(&entrys_hash[i]);
+}
+
 static int add_file_to_list(struct resource_entry *entry, int rsce_base, bool ram)
 {
 	struct resource_file *file;
+	int len;
 
 	if (memcmp(entry->tag, ENTRY_TAG, ENTRY_TAG_SIZE)) {
 		debug("invalid entry tag\n");
 		return -ENOENT;
 	}
 
-	file = malloc(sizeof(*file));
+	len = strnlen(entry->name, MAX_FILE_NAME_LEN - 1);
+	file = malloc(sizeof(*file) + len + 1);
 	if (!file) {
 		debug("out of memory\n");
 		return -ENOMEM;
 	}
 
-	strcpy(file->name, entry->name);
+	memcpy(file->name, entry->name, len);
+	file->name[len] = '\0';
 	file->rsce_base = rsce_base;
 	file->f_offset = entry->f_offset;
 	file->f_size = entry->f_size;
-	file->hash_size = entry->hash_size;
+	file->hash_size = min_t(uint32_t, entry->hash_size, MAX_HASH_LEN);
 	file->ram = ram;
-	memcpy(file->hash, entry->hash, entry->hash_size);
+	file->data = NULL;
+	memcpy(file->hash, entry->hash, file->hash_size);
 	list_add_tail(&file->link, &entrys_head);
+
+	/* The first one of duplicated names wins, as the list order */
+	INIT_HLIST_NODE(&file->hnode);
+	if (!resource_lookup(file->name))
+		hlist_add_head(&file->hnode, resource_hash_bucket(file->name));
+
 	debug("ENTRY: addr: %p, name: %18s, base: 0x%08x, offset: 0x%08x, size: 0x%08x\n",
 	      entry, file->name, file->rsce_base, file->f_offset, file->f_size);
 
@@ -160,7 +226,6 @@ int resource_replace_entry(const char *f_name, uint32_t base,
 {
 	struct resource_entry *entry;
 	struct resource_file *file;
-	struct list_head *node;
 
 	if (!f_name || !f_size)
 		return -EINVAL;
@@ -176,13 +241,12 @@ int resource_replace_entry(const char *f_name, uint32_t base,
 	entry->hash_size = 0;
 
 	/* Delete exist entry, then add this new */
-	list_for_each(node, &entrys_head) {
-		file = list_entry(node, struct resource_file, link);
-		if (!strcmp(file->name, entry->name)) {
-			list_del(&file->link);
-			free(file);
-			break;
-		}
+	file = resource_lookup(entry->name);
+	if (file) {
+		resource_drop_cache(file);
+		hlist_del(&file->hnode);
+		list_del(&file->link);
+		free(file);
 	}
 
 	add_file_to_list(entry, base, false);
@@ -204,7 +268,7 @@ int resource_create_ram_list(struct blk_desc *dev_desc, void *rsce_hdr)
 		goto out;
 	}
 
-	list_del_init(&entrys_head);
+	resource_reset_list();
 	data = (void *)((ulong)hdr + hdr->c_offset * dev_desc->blksz);
 	for (e_num = 0; e_num < hdr->e_nums; e_num++) {
 		size = e_num * hdr->e_blks * dev_desc->blksz;
@@ -441,21 +505,61 @@ int resource_is_empty(void)
 
 static struct resource_file *get_file_info(const char *name)
 {
-	struct resource_file *file;
-	struct list_head *node;
-
 	if (list_empty(&entrys_head)) {
 		if (resource_init_list())
 			return NULL;
 	}
 
-	list_for_each(node, &entrys_head) {
-		file = list_entry(node, struct resource_file, link);
-		if (!strcmp(file->name, name))
-			return file;
+	return resource_lookup(name);
+}
+
+int rockchip_get_resource_file_size(const char *name)
+{
+	struct resource_file *file;
+
+	file = get_file_info(name);
+	if (!file)
+		return -ENOENT;
+
+	return file->f_size;
+}
+
+int rockchip_get_resource_file_hash(const char *name, char **hash)
+{
+	struct resource_file *file;
+
+	file = get_file_info(name);
+	if (!file)
+		return -ENOENT;
+
+	*hash = file->hash;
+
+	return file->hash_size;
+}
+
+/* Read the whole file into memory on first access, if budget allows */
+static void resource_cache_file(struct blk_desc *dev_desc,
+				struct resource_file *file)
+{
+	ulong size = ALIGN(file->f_size, RK_BLK_SIZE);
+	int blks = size / dev_desc->blksz;
+
+	if (dev_desc->blksz != RK_BLK_SIZE ||
+	    cache_size + size > CONFIG_ROCKCHIP_RESOURCE_CACHE_SIZE)
+		return;
+
+	file->data = memalign(ARCH_DMA_MINALIGN, size);
+	if (!file->data)
+		return;
+
+	if (blk_dread(dev_desc, file->rsce_base + file->f_offset,
+		      blks, file->data) != blks) {
+		free(file->data);
+		file->data = NULL;
+		return;
 	}
 
-	return NULL;
+	cache_size += size;
 }
 
 /*
@@ -488,11 +592,21 @@ int rockchip_read_resource_file(void *buf, const char *name, int offset, int len
 	if (len <= 0 || len > file->f_size)
 		len = file->f_size;
 
+	if (!file->ram && !file->data)
+		resource_cache_file(dev_desc, file);
+
 	if (file->ram) {
 		src = file->rsce_base +
 			(file->f_offset + offset) * dev_desc->blksz;
 		memcpy(buf, (char *)src, len);
 		ret = len;
+	} else if (file->data) {
+		src = offset * dev_desc->blksz;
+		if (src >= file->f_size)
+			return -EINVAL;
+		len = min_t(ulong, len, file->f_size - src);
+		memcpy(buf, file->data + src, len);
+		ret = len;
 	} else {
 		blks = DIV_ROUND_UP(len, dev_desc->blksz);
 		ret = blk_dread(dev_desc,
@@ -560,8 +674,9 @@ static int do_dump_resource(cmd_tbl_t *cmdtp, int flag,
 	printf("Resources:\n");
 	list_for_each(node, &entrys_head) {
 		file = list_entry(node, struct resource_file, link);
-		printf("	%s: 0x%08x(sector), 0x%08x(bytes)\n",
-		       file->name, file->rsce_base + file->f_offset, file->f_size);
+		printf("	%s: 0x%08x(sector), 0x%08x(bytes)%s\n",
+		       file->name, file->rsce_base + file->f_offset, file->f_size,
+		       file->data ? ", cached" : "");
 	}
 
 	return 0;
@@ -126,6 +126,8 @@ struct mtd_flash_info {
 static struct vendor_info vendor_info;
 /* The storage type of the device */
 static int bootdev_type;
+/* The device, when given by vendor_storage_init_dev() */
+static struct blk_desc *vendor_dev_desc;
 
 #ifdef CONFIG_MTD_BLK
 static struct mtd_flash_info s_flash_info;
@@ -312,7 +314,9 @@ static int vendor_ops(u8 *buffer, u32 addr, u32 n_sec, int write)
 	unsigned int lba = 0;
 	int ret = 0;
 
-	dev_desc = rockchip_get_bootdev();
+	dev_desc = vendor_dev_desc;
+	if (!dev_desc)
+		dev_desc = rockchip_get_bootdev();
 	if (!dev_desc) {
 		printf("%s: dev_desc is NULL!\n", __func__);
 		return -ENODEV;
@@ -429,7 +433,9 @@ int vendor_storage_init(void)
 	u16 version2_offset, part_size;
 	struct blk_desc *dev_desc;
 
-	dev_desc = rockchip_get_bootdev();
+	dev_desc = vendor_dev_desc;
+	if (!dev_desc)
+		dev_desc = rockchip_get_bootdev();
 	if (!dev_desc) {
 		printf("[Vendor ERROR]:Invalid boot device type(%d)\n",
 		       bootdev_type);
@@ -566,6 +572,34 @@ out:
 	return ret;
 }
 
+/*
+ * Read vendor storage in from @dev_desc, the boot device, while it is still
+ * being brought up and so cannot be looked up by rockchip_get_bootdev().
+ * It is used for all later accesses.
+ *
+ * return: 0 on success, other fail;
+ */
+int vendor_storage_init_dev(struct blk_desc *dev_desc)
+{
+	int ret;
+
+	vendor_dev_desc = dev_desc;
+	ret = vendor_storage_init();
+	if (ret)
+		vendor_dev_desc = NULL;
+
+	return ret;
+}
+
+/*
+ * return: true if vendor storage has been read in, so that reading an item
+ * does not access the boot device;
+ */
+bool vendor_storage_ready(void)
+{
+	return bootdev_type != 0;
+}
+
 /*
  * @id: item id, first 4 id is occupied:
  *	VENDOR_SN_ID
@@ -10,8 +10,25 @@
 #ifndef __ETH_H
 #define __ETH_H
 
+struct udevice;
+
 void sandbox_eth_disable_response(int index, bool disable);
 
 void sandbox_eth_skip_timeout(void);
 
+/*
+ * sandbox_eth_tx_hand_f - Mock a host on the network
+ *
+ * dev - The device the packet was sent on
+ * packet, length - The packet, starting with the Ethernet header
+ * Return true if the packet was dealt with, false for the default responses
+ */
+typedef bool sandbox_eth_tx_hand_f(struct udevice *dev, void *packet,
+				   int length);
+
+void sandbox_eth_set_tx_handler(int index, sandbox_eth_tx_hand_f *handler);
+
+int sandbox_eth_recv_packet(struct udevice *dev, const void *packet,
+			    int length);
+
 #endif /* __ETH_H */
@@ -110,4 +110,25 @@ int sandbox_pwm_get_config(struct udevice *dev, uint channel, uint *period_nsp,
  */
 void sandbox_sf_set_block_protect(struct udevice *dev, int bp_mask);
 
+/**
+ * sandbox_serial_tx_capture() - Capture the output of a sandbox UART
+ *
+ * The UART then takes no output until sandbox_serial_tx_room() makes room,
+ * as if its TX FIFO were full.
+ *
+ * @dev: Device to update
+ * @buf: Buffer for the output, NULL to write it to stdout again
+ * @size: Size of @buf
+ */
+void sandbox_serial_tx_capture(struct udevice *dev, char *buf, int size);
+
+/**
+ * sandbox_serial_tx_room() - Let a sandbox UART take more output
+ *
+ * @dev: Device to update
+ * @room: Number of characters it takes before it is full again, -1 for all
+ * @return number of characters captured so far
+ */
+int sandbox_serial_tx_room(struct udevice *dev, int room);
+
 #endif
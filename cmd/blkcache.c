@@ -10,34 +10,61 @@
 #include <malloc.h>
 #include <part.h>
 
+static unsigned blkc_percent(unsigned hits, unsigned partial,
+			     unsigned misses)
+{
+	unsigned total = hits + partial + misses;
+
+	return total ? (hits * 100 + total / 2) / total : 0;
+}
+
 static int blkc_show(cmd_tbl_t *cmdtp, int flag,
 		     int argc, char * const argv[])
 {
+	struct block_cache_dev_stats dev;
 	struct block_cache_stats stats;
+	int i;
+
+	for (i = 0; !blkcache_dev_stats(i, &dev); i++)
+		printf("%s %d: hits %u, partial %u, misses %u (%u%% hit)\n",
+		       blk_get_if_type_name(dev.iftype), dev.devnum,
+		       dev.hits, dev.partial_hits, dev.misses,
+		       blkc_percent(dev.hits, dev.partial_hits, dev.misses));
+
 	blkcache_stats(&stats);
 
 	printf("hits: %u\n"
+	       "partial hits: %u\n"
 	       "misses: %u\n"
+	       "hit rate: %u%%\n"
+	       "evictions: %u\n"
 	       "entries: %u\n"
+	       "cached bytes: %lu\n"
+	       "slab bytes: %lu\n"
 	       "max blocks/entry: %u\n"
-	       "max cache entries: %u\n",
-	       stats.hits, stats.misses, stats.entries,
-	       stats.max_blocks_per_entry, stats.max_entries);
+	       "max cache bytes: %lu\n",
+	       stats.hits, stats.partial_hits, stats.misses,
+	       blkc_percent(stats.hits, stats.partial_hits, stats.misses),
+	       stats.evictions, stats.entries, stats.bytes,
+	       stats.slab_bytes, stats.max_blocks_per_entry,
+	       stats.max_bytes);
 	return 0;
 }
 
 static int blkc_configure(cmd_tbl_t *cmdtp, int flag,
 			  int argc, char * const argv[])
 {
-	unsigned blocks_per_entry, max_entries;
+	unsigned blocks_per_entry;
+	unsigned long max_bytes;
+
 	if (argc != 3)
 		return CMD_RET_USAGE;
 
 	blocks_per_entry = simple_strtoul(argv[1], 0, 0);
-	max_entries = simple_strtoul(argv[2], 0, 0);
-	blkcache_configure(blocks_per_entry, max_entries);
-	printf("changed to max of %u entries of %u blocks each\n",
-	       max_entries, blocks_per_entry);
+	max_bytes = simple_strtoul(argv[2], 0, 0);
+	blkcache_configure(blocks_per_entry, max_bytes);
+	printf("changed to max of %lu bytes, caching reads of up to %u "
+	       "blocks\n", max_bytes, blocks_per_entry);
 	return 0;
 }
 
@@ -83,5 +110,5 @@ U_BOOT_CMD(
 	blkcache, 4, 0, do_blkcache,
 	"block cache diagnostics and control",
 	"show - show and reset statistics\n"
-	"blkcache configure blocks entries\n"
+	"blkcache configure blocks bytes\n"
 );
@@ -14,6 +14,20 @@ static int do_bootstage_report(cmd_tbl_t *cmdtp, int flag, int argc,
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(BOOTSTAGE_PROFILE)
+static int do_bootstage_profile(cmd_tbl_t *cmdtp, int flag, int argc,
+				char * const argv[])
+{
+	ulong min_us = 0;
+
+	if (argc > 1)
+		min_us = simple_strtoul(argv[1], NULL, 10);
+	bootstage_prof_report(min_us);
+
+	return 0;
+}
+#endif
+
 static int get_base_size(int argc, char * const argv[], ulong *basep,
 			 ulong *sizep)
 {
@@ -60,6 +74,9 @@ static int do_bootstage_stash(cmd_tbl_t *cmdtp, int flag, int argc,
 
 static cmd_tbl_t cmd_bootstage_sub[] = {
 	U_BOOT_CMD_MKENT(report, 2, 1, do_bootstage_report, "", ""),
+#if CONFIG_IS_ENABLED(BOOTSTAGE_PROFILE)
+	U_BOOT_CMD_MKENT(profile, 2, 1, do_bootstage_profile, "", ""),
+#endif
 	U_BOOT_CMD_MKENT(stash, 4, 0, do_bootstage_stash, "", ""),
 	U_BOOT_CMD_MKENT(unstash, 4, 0, do_bootstage_stash, "", ""),
 };
@@ -90,6 +107,9 @@ U_BOOT_CMD(bootstage, 4, 1, do_boostage,
 	"Boot stage command",
 	" - check boot progress and timing\n"
 	"report                      - Print a report\n"
+#if CONFIG_IS_ENABLED(BOOTSTAGE_PROFILE)
+	"profile [<min_us>]          - Print initcall and probe times\n"
+#endif
 	"stash [<start> [<size>]]    - Stash data into memory\n"
 	"unstash [<start> [<size>]]  - Unstash data from memory"
 );
@@ -22,7 +22,9 @@
 #include <mapmem.h>
 #include <watchdog.h>
 #include <asm/io.h>
+#include <div64.h>
 #include <linux/compiler.h>
+#include <u-boot/crc.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -1061,6 +1063,59 @@ mod_mem(cmd_tbl_t *cmdtp, int incrflag, int flag, int argc, char * const argv[])
 
 #ifdef CONFIG_CMD_CRC32
 
+#ifdef CONFIG_CRC32_BENCHMARK
+/* How long each CRC is run for */
+#define CRC32_BENCH_US		500000
+
+static const struct {
+	const char *name;
+	uint32_t (*fn)(uint32_t crc, const unsigned char *p, uint len);
+} crc32_bench_algos[] = {
+	{ "crc32", crc32 },
+	{ "crc32c", crc32c },
+};
+
+static int do_mem_crc_bench(int argc, char * const argv[])
+{
+	ulong addr, len, us, start;
+	const unsigned char *buf;
+	uint32_t crc;
+	int i, n;
+
+	if (argc != 3)
+		return CMD_RET_USAGE;
+
+	addr = simple_strtoul(argv[1], NULL, 16);
+	len = simple_strtoul(argv[2], NULL, 16);
+	if (!len)
+		return CMD_RET_USAGE;
+
+	buf = map_sysmem(addr, len);
+	for (i = 0; i < ARRAY_SIZE(crc32_bench_algos); i++) {
+		n = 0;
+		start = timer_get_us();
+		do {
+			crc = crc32_bench_algos[i].fn(0, buf, len);
+			n++;
+			WATCHDOG_RESET();
+			us = timer_get_us() - start;
+		} while (us < CRC32_BENCH_US);
+
+		/* A byte per microsecond is a MB/s */
+		printf("%-7s %08x  %llu MB/s\n", crc32_bench_algos[i].name, crc,
+		       (unsigned long long)lldiv((u64)len * n, us));
+	}
+	unmap_sysmem(buf);
+
+	return 0;
+}
+
+#define CRC32_BENCH_HELP \
+	"\n-b address count\n    - report the speed of CRC32 and CRC32C"
+#else
+#define CRC32_BENCH_HELP
+#endif
+
 static int do_mem_crc(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	int flags = 0;
@@ -1072,6 +1127,10 @@ static int do_mem_crc(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 
 	av = argv + 1;
 	ac = argc - 1;
+#ifdef CONFIG_CRC32_BENCHMARK
+	if (strcmp(*av, "-b") == 0)
+		return do_mem_crc_bench(ac, av);
+#endif
 #ifdef CONFIG_CRC32_VERIFY
 	if (strcmp(*av, "-v") == 0) {
 		flags |= HASH_FLAG_VERIFY | HASH_FLAG_ENV;
@@ -1156,6 +1215,7 @@ U_BOOT_CMD(
 	crc32,	4,	1,	do_mem_crc,
 	"checksum calculation",
 	"address count [addr]\n    - compute CRC32 checksum [save at addr]"
+	CRC32_BENCH_HELP
 );
 
 #else	/* CONFIG_CRC32_VERIFY */
@@ -1165,6 +1225,7 @@ U_BOOT_CMD(
 	"checksum calculation",
 	"address count [addr]\n    - compute CRC32 checksum [save at addr]\n"
 	"-v address count crc\n    - verify crc of memory area"
+	CRC32_BENCH_HELP
 );
 
 #endif	/* CONFIG_CRC32_VERIFY */
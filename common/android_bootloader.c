@@ -462,73 +462,85 @@ static void slot_set_unbootable(AvbABSlotData* slot)
 	slot->successful_boot = 0;
 }
 
-static char *join_str(const char *a, const char *b)
+static int avb_image_segs_prepare(struct preloaded_partition *preload_info,
+				  struct andr_img_hdr *hdr, ulong load_addr,
+				  const char *partition, size_t hdr_size)
 {
-	size_t len = strlen(a) + strlen(b) + 1 /* null term */;
-	char *ret = (char *)malloc(len);
+	void *hdr_buf = NULL;
+	int ret;
 
-	if (!ret) {
-		debug("failed to alloc %zu\n", len);
-		return NULL;
+	if (hdr_size) {
+		hdr_buf = malloc(hdr_size);
+		if (!hdr_buf)
+			return -ENOMEM;
 	}
-	strcpy(ret, a);
-	strcat(ret, b);
 
-	return ret;
+	ret = android_image_get_segs(hdr, load_addr, partition, hdr_buf,
+				     preload_info->segs);
+	if (ret < 0) {
+		free(hdr_buf);
+		return ret;
+	}
+	preload_info->addr = hdr_buf ? hdr_buf : (void *)load_addr;
+	preload_info->num_segs = ret;
+
+	return 0;
 }
 
-static size_t get_partition_size(AvbOps *ops, char *name,
-				 const char *slot_suffix)
+/* Free the vendor_boot and init_boot headers once they have been used */
+static void avb_image_segs_free(AvbOps *ops)
 {
-	char *partition_name = join_str(name, slot_suffix);
-	uint64_t size = 0;
-	AvbIOResult res;
-
-	if (partition_name == NULL)
-		goto bail;
-
-	res = ops->get_size_of_partition(ops, partition_name, &size);
-	if (res != AVB_IO_RESULT_OK && res != AVB_IO_RESULT_ERROR_NO_SUCH_PARTITION)
-		size = 0;
-bail:
-	if (partition_name)
-		free(partition_name);
+	struct AvbOpsData *data = (struct AvbOpsData *)(ops->user_data);
 
-	return size;
+	if (data->vendor_boot.num_segs)
+		free(data->vendor_boot.addr);
+	if (data->init_boot.num_segs)
+		free(data->init_boot.addr);
+	data->vendor_boot.num_segs = 0;
+	data->init_boot.num_segs = 0;
 }
 
-static int avb_image_distribute_prepare(AvbSlotVerifyData *slot_data,
-					AvbOps *ops, char *slot_suffix)
+/*
+ * With verification enforced, the images are read and hashed straight to
+ * where they are booted from, the same places android_image_load() uses.
+ */
+static int avb_image_distribute_prepare(struct andr_img_hdr *hdr,
+					AvbOps *ops, char *boot_partname,
+					unsigned long load_address)
 {
 	struct AvbOpsData *data = (struct AvbOpsData *)(ops->user_data);
-	size_t vendor_boot_size;
-	size_t init_boot_size;
-	size_t boot_size;
-	void *image_buf;
-
-	boot_size = max(get_partition_size(ops, ANDROID_PARTITION_BOOT, slot_suffix),
-		get_partition_size(ops, ANDROID_PARTITION_RECOVERY, slot_suffix));
-	init_boot_size = get_partition_size(ops,
-				ANDROID_PARTITION_INIT_BOOT, slot_suffix);
-	vendor_boot_size = get_partition_size(ops,
-				ANDROID_PARTITION_VENDOR_BOOT, slot_suffix);
-	image_buf = sysmem_alloc(MEM_AVB_ANDROID,
-				 boot_size + init_boot_size + vendor_boot_size);
-	if (!image_buf) {
-		printf("avb: sysmem alloc failed\n");
-		return -1;
+	u32 andr_version = (hdr->os_version >> 25) & 0x7f;
+	struct blk_desc *dev_desc;
+	disk_partition_t part_info;
+	ulong load_addr;
+	int ret;
+
+	dev_desc = rockchip_get_bootdev();
+	if (!dev_desc)
+		return -ENODEV;
+
+	if (part_get_info_by_name(dev_desc, boot_partname, &part_info) < 0)
+		return -ENOENT;
+
+	load_addr = android_image_prepare_separate(dev_desc, &part_info, hdr,
+						   load_address);
+	if (!load_addr) {
+		printf("avb: no memory for android image\n");
+		return -ENOMEM;
 	}
 
-	data = (struct AvbOpsData *)(ops->user_data);
-	data->slot_suffix = slot_suffix;
-	data->boot.addr = image_buf;
-	data->boot.size = 0;
-	data->vendor_boot.addr = data->boot.addr + boot_size;
-	data->vendor_boot.size = 0;
-	data->init_boot.addr = data->vendor_boot.addr + vendor_boot_size;
-	data->init_boot.size = 0;
+	ret = avb_image_segs_prepare(&data->boot, hdr, load_addr,
+				     ANDROID_PARTITION_BOOT, 0);
+	if (!ret && hdr->header_version >= 3)
+		ret = avb_image_segs_prepare(&data->vendor_boot, hdr, load_addr,
+				ANDROID_PARTITION_VENDOR_BOOT,
+				sizeof(struct vendor_boot_img_hdr_v34));
+	if (!ret && hdr->header_version >= 4 && andr_version >= 13)
+		ret = avb_image_segs_prepare(&data->init_boot, hdr, load_addr,
+				ANDROID_PARTITION_INIT_BOOT,
+				sizeof(struct boot_img_hdr_v34));
 
-	return 0;
+	return ret;
 }
 
 static int avb_image_distribute_finish(AvbSlotVerifyData *slot_data,
@@ -556,41 +568,48 @@ static int avb_image_distribute_finish(AvbSlotVerifyData *slot_data,
 	}
 
 	/*
-	 *		populate boot_img_hdr_v34
-	 *
 	 * If allow verification error: the images are loaded by
 	 * ops->get_preloaded_partition() which auto populates
-	 * boot_img_hdr_v34.
-	 *
-	 * If not allow verification error: the images are full loaded
-	 * by ops->read_from_partition() which doesn't populate
-	 * boot_img_hdr_v34, we need to fix it here for bootm and
+	 * boot_img_hdr_v34 and distributes them.
 	 */
-
 	hdr = boot_hdr;
-	if (hdr->header_version >= 3 &&
-	    !(flags & AVB_SLOT_VERIFY_FLAGS_ALLOW_VERIFICATION_ERROR)) {
+	if (flags & AVB_SLOT_VERIFY_FLAGS_ALLOW_VERIFICATION_ERROR) {
+		load_addr -= hdr->page_size;
+		if (android_image_memcpy_separate(boot_hdr, &load_addr)) {
+			printf("Failed to separate copy android image\n");
+			return AVB_SLOT_VERIFY_RESULT_ERROR_IO;
+		}
+		*load_address = load_addr;
+
+		return 0;
+	}
+
+	/*
+	 * If not allow verification error: the images have been read in
+	 * place, the boot header in front of the kernel. Populate
+	 * boot_img_hdr_v34 for bootm from the three headers.
+	 */
+	if (hdr->header_version >= 3) {
 		hdr = malloc(sizeof(struct andr_img_hdr));
 		if (!hdr)
 			return -1;
 
 		ret = populate_boot_info(boot_hdr, vendor_boot_hdr,
-					 init_boot_hdr, hdr, true);
+					 init_boot_hdr, hdr, false);
 		if (ret < 0) {
 			printf("avb: populate boot info failed, ret=%d\n", ret);
 			return -1;
 		}
-		memcpy(boot_hdr, hdr, sizeof(*hdr));
 	}
 
-	/* distribute ! */
-	load_addr -= hdr->page_size;
-	if (android_image_memcpy_separate(boot_hdr, &load_addr)) {
-		printf("Failed to separate copy android image\n");
+	ret = android_image_finish_separate(hdr, (ulong)boot_hdr);
+	if (hdr != boot_hdr)
+		free(hdr);
+	if (ret) {
+		printf("Failed to distribute android image\n");
 		return AVB_SLOT_VERIFY_RESULT_ERROR_IO;
 	}
-
-	*load_address = load_addr;
+	*load_address = (ulong)boot_hdr;
 
 	return 0;
 }
@@ -612,16 +631,14 @@ static int avb_image_distribute_finish(AvbSlotVerifyData *slot_data,
  * == avb with lock:
  * Process hash verify.
  * Go pre-loaded path: Loading full vendor_boot, init_boot and
- * boot/recovery one by one to verify, and distributing them to
- * where they should be by memcpy at last.
- *
- * The three images share a large memory buffer that allocated
- * by sysmem_alloc(), it locate at high memory address that
- * just lower than SP bottom. The boot message tells like:
+ * boot/recovery one by one to verify, with each part of them read
+ * directly to where it should be and hashed on the way. Only the
+ * parts that are not kept go through a small bounce buffer.
+ * The boot message tells like:
  * ···
- * preloaded: full image from 'boot_a' at 0xe47f90c0 - 0xe7a4b0c0
- * preloaded: full image from 'init_boot_a' at 0xeaff90c0 - 0xeb2950c0
- * preloaded: full image from 'vendor_boot_a' at 0xe87f90c0 - 0xe9f6e0c0
+ * preloaded: distribute image from 'boot_a'
+ * preloaded: distribute image from 'init_boot_a'
+ * preloaded: distribute image from 'vendor_boot_a'
  * ···
  */
 static AvbSlotVerifyResult android_slot_verify(char *boot_partname,
@@ -702,11 +719,16 @@ static AvbSlotVerifyResult android_slot_verify(char *boot_partname,
 	if (strcmp(boot_partname, ANDROID_PARTITION_RECOVERY) == 0)
 		flags |= AVB_SLOT_VERIFY_FLAGS_NO_VBMETA_PARTITION;
 
-	/* prepare image buffer */
-	ret = avb_image_distribute_prepare(slot_data, ops, slot_suffix);
-	if (ret < 0) {
-		printf("avb image distribute prepare failed %d\n", ret);
-		return -1;
+	/* prepare where the images are read to */
+	((struct AvbOpsData *)ops->user_data)->slot_suffix = slot_suffix;
+	if (!(flags & AVB_SLOT_VERIFY_FLAGS_ALLOW_VERIFICATION_ERROR)) {
+		ret = avb_image_distribute_prepare(hdr, ops, boot_partname,
+						   load_address);
+		if (ret < 0) {
+			printf("avb image distribute prepare failed %d\n", ret);
+			avb_image_segs_free(ops);
+			return -1;
+		}
 	}
 
 retry_verify:
@@ -796,6 +818,7 @@ retry_verify:
 
 		/* if need, distribute full image to where they should be */
 		ret = avb_image_distribute_finish(slot_data, flags, &load_address);
+		avb_image_segs_free(ops);
 		if (ret < 0) {
 			printf("avb image distribute finish failed %d\n", ret);
 			return -1;
@@ -806,6 +829,7 @@ retry_verify:
 	}
 
 out:
+	avb_image_segs_free(ops);
 	env_update("bootargs", verify_state);
 	if (save_metadata_if_changed(ops->ab_ops, &ab_data, &ab_data_orig)) {
 		printf("Can not save metadata\n");
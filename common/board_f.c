@@ -659,8 +659,7 @@ static int reloc_bootstage(void)
 
 		debug("Copying bootstage from %p to %p, size %x\n",
 		      gd->bootstage, gd->new_bootstage, size);
-		memcpy(gd->new_bootstage, gd->bootstage, size);
-		gd->bootstage = gd->new_bootstage;
+		bootstage_move(gd->new_bootstage);
 	}
 #endif
 
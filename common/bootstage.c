@@ -11,6 +11,8 @@
  */
 
 #include <common.h>
+#include <dm.h>
+#include <dm/lists.h>
 #include <linux/libfdt.h>
 #include <malloc.h>
 #include <linux/compiler.h>
@@ -19,6 +21,10 @@ DECLARE_GLOBAL_DATA_PTR;
 
 enum {
 	RECORD_COUNT = CONFIG_BOOTSTAGE_RECORD_COUNT,
+#if CONFIG_IS_ENABLED(BOOTSTAGE_PROFILE)
+	PROF_COUNT = CONFIG_BOOTSTAGE_PROFILE_COUNT,
+	PROF_COUNT_F = CONFIG_BOOTSTAGE_PROFILE_COUNT_F,
+#endif
 };
 
 struct bootstage_record {
@@ -33,6 +39,13 @@ struct bootstage_data {
 	uint rec_count;
 	uint next_id;
 	struct bootstage_record record[RECORD_COUNT];
+#if CONFIG_IS_ENABLED(BOOTSTAGE_PROFILE)
+	uint prof_count;	/* Calls timed, may exceed prof_size */
+	uint prof_lost;		/* Calls not recorded as prof[] was full */
+	uint prof_size;		/* Number of entries that fit in prof[] */
+	uint prof_depth;	/* Calls currently being timed */
+	struct bootstage_prof prof[];	/* Must be last, see bootstage_move() */
+#endif
 };
 
 enum {
@@ -61,6 +74,16 @@ int bootstage_relocate(void)
 	for (i = 0; i < data->rec_count; i++)
 		data->record[i].name = strdup(data->record[i].name);
 
+#if CONFIG_IS_ENABLED(BOOTSTAGE_PROFILE)
+	/*
+	 * This runs as an initcall of board_init_r(), so it is the only call
+	 * still being timed: board_init_f() has finished, whether it returned
+	 * before relocate_code() (ARM, sandbox) or its last initcall jumped to
+	 * the relocated code and never got to end its record.
+	 */
+	data->prof_depth = 1;
+#endif
+
 	return 0;
 }
 
@@ -196,6 +219,30 @@ uint32_t bootstage_accum(enum bootstage_id id)
 	return duration;
 }
 
+uint32_t bootstage_accum_name(const char *name, uint32_t start_us)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_record *rec;
+	uint32_t duration;
+
+	duration = (uint32_t)timer_get_boot_us() - start_us;
+	if (data->rec_count >= RECORD_COUNT)
+		return duration;
+
+	name = strdup(name);
+	if (!name)
+		return duration;
+
+	rec = &data->record[data->rec_count++];
+	rec->id = data->next_id++;
+	rec->name = name;
+	rec->flags = BOOTSTAGEF_ALLOC;
+	rec->start_us = start_us ? start_us : 1;
+	rec->time_us = duration;
+
+	return duration;
+}
+
 /**
  * Get a record name as a printable string
  *
@@ -240,6 +287,146 @@ static int h_compare_record(const void *r1, const void *r2)
 	return rec1->time_us > rec2->time_us ? 1 : -1;
 }
 
+#if CONFIG_IS_ENABLED(BOOTSTAGE_PROFILE)
+int bootstage_prof_start(const char *name, uint uclass)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_prof *prof;
+	int handle;
+
+	if (!data)
+		return -1;
+
+	handle = data->prof_count++;
+	if (handle < data->prof_size) {
+		prof = &data->prof[handle];
+		strlcpy(prof->name, name, sizeof(prof->name));
+		prof->uclass = uclass;
+		prof->depth = min(data->prof_depth, 255U);
+		prof->pad = 0;
+		prof->time_us = 0;
+		prof->start_us = timer_get_boot_us();
+	} else {
+		data->prof_lost++;
+	}
+	data->prof_depth++;
+
+	return handle;
+}
+
+void bootstage_prof_end(int handle)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_prof *prof;
+
+	if (!data || handle < 0)
+		return;
+
+	if (handle < data->prof_size) {
+		prof = &data->prof[handle];
+		prof->time_us = (uint32_t)timer_get_boot_us() - prof->start_us;
+	}
+	if (data->prof_depth)
+		data->prof_depth--;
+}
+
+const struct bootstage_prof *bootstage_prof_get(int handle)
+{
+	struct bootstage_data *data = gd->bootstage;
+
+	if (!data || handle < 0 || handle >= data->prof_size ||
+	    !data->prof[handle].name[0])
+		return NULL;
+
+	return &data->prof[handle];
+}
+
+static const char *get_prof_uclass_name(const struct bootstage_prof *prof)
+{
+	struct uclass_driver *uc_drv = NULL;
+
+	if (prof->uclass == BOOTSTAGE_PROF_INITCALL)
+		return "initcall";
+	if (CONFIG_IS_ENABLED(DM))
+		uc_drv = lists_uclass_lookup(prof->uclass);
+
+	return uc_drv ? uc_drv->name : "?";
+}
+
+void bootstage_prof_report(uint min_us)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_prof *prof;
+	uint count = min(data->prof_count, data->prof_size);
+	int i;
+
+	printf("Initcall and probe times in microseconds (%d records):\n",
+	       data->prof_count);
+	printf("%11s%11s  %-12s %s\n", "Start", "Elapsed", "Uclass", "Name");
+	for (i = 0, prof = data->prof; i < count; i++, prof++) {
+		/* Left empty when the pre-relocation table was full */
+		if (!prof->name[0] || prof->time_us < min_us)
+			continue;
+		print_grouped_ull(prof->start_us, BOOTSTAGE_DIGITS);
+		print_grouped_ull(prof->time_us, BOOTSTAGE_DIGITS);
+		printf("  %-12s %*s%s\n", get_prof_uclass_name(prof),
+		       prof->depth * 2, "", prof->name);
+	}
+	if (data->prof_lost)
+		printf("Overflowed profile table by %d entries\n"
+		       "- please increase CONFIG_BOOTSTAGE_PROFILE_COUNT%s\n",
+		       data->prof_lost, data->prof_size < PROF_COUNT ? "_F" : "");
+}
+
+#ifdef CONFIG_OF_LIBFDT
+/**
+ * Add the initcall and device probe timings to a device tree
+ *
+ * @param blob		Device tree blob
+ * @param bootstage	Offset of the bootstage node
+ * @return 0 on success, != 0 on failure.
+ */
+static int add_prof_devicetree(struct fdt_header *blob, int bootstage)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_prof *prof;
+	int profile;
+	int i;
+
+	profile = fdt_add_subnode(blob, bootstage, "profile");
+	if (profile < 0)
+		return -EINVAL;
+
+	/* Added in reverse, as for the records, so they read in call order */
+	i = min(data->prof_count, data->prof_size);
+	for (prof = data->prof + i - 1; i > 0; i--, prof--) {
+		int node;
+
+		if (!prof->name[0])
+			continue;
+		node = fdt_add_subnode(blob, profile, simple_itoa(i - 1));
+		if (node < 0)
+			break;
+
+		if (fdt_setprop_string(blob, node, "name", prof->name) ||
+		    fdt_setprop_string(blob, node, "uclass",
+				       get_prof_uclass_name(prof)) ||
+		    fdt_setprop_cell(blob, node, "start", prof->start_us) ||
+		    fdt_setprop_cell(blob, node, "time", prof->time_us) ||
+		    fdt_setprop_cell(blob, node, "depth", prof->depth))
+			return -EINVAL;
+	}
+
+	return 0;
+}
+#endif
+#else
+static inline int add_prof_devicetree(struct fdt_header *blob, int bootstage)
+{
+	return 0;
+}
+#endif
+
 #ifdef CONFIG_OF_LIBFDT
 /**
  * Add all bootstage timings to a device tree.
@@ -293,7 +480,7 @@ static int add_bootstages_devicetree(struct fdt_header *blob)
 			return -EINVAL;
 	}
 
-	return 0;
+	return add_prof_devicetree(blob, bootstage);
 }
 
 int bootstage_fdt_add_report(void)
@@ -401,6 +588,13 @@ int bootstage_stash(void *base, int size)
 		append_data(&ptr, end, name, strlen(name) + 1);
 	}
 
+	/* Then the profile, if any, as a count followed by the entries */
+#if CONFIG_IS_ENABLED(BOOTSTAGE_PROFILE)
+	count = min(data->prof_count, data->prof_size);
+	append_data(&ptr, end, &count, sizeof(count));
+	append_data(&ptr, end, data->prof, count * sizeof(*data->prof));
+#endif
+
 	/* Check for buffer overflow */
 	if (ptr > end) {
 		debug("%s: Not enough space for bootstage stash\n", __func__);
@@ -477,6 +671,24 @@ int bootstage_unstash(const void *base, int size)
 		ptr += strlen(ptr) + 1;
 	}
 
+#if CONFIG_IS_ENABLED(BOOTSTAGE_PROFILE)
+	/* The profile is optional and is not necessarily aligned */
+	if (ptr + sizeof(uint32_t) <= (char *)base + hdr->size) {
+		uint32_t count;
+
+		memcpy(&count, ptr, sizeof(count));
+		ptr += sizeof(count);
+		count = min(count, data->prof_size - min(data->prof_count,
+							 data->prof_size));
+		if (ptr + count * sizeof(*data->prof) <=
+		    (char *)base + hdr->size) {
+			memcpy(data->prof + data->prof_count, ptr,
+			       count * sizeof(*data->prof));
+			data->prof_count += count;
+		}
+	}
+#endif
+
 	/* Mark the records as read */
 	data->rec_count += hdr->count;
 	debug("Unstashed %d records\n", hdr->count);
@@ -484,21 +696,71 @@ int bootstage_unstash(const void *base, int size)
 	return 0;
 }
 
-int bootstage_get_size(void)
+/* Size of the bootstage data with room for @prof_size profile entries */
+static int bootstage_data_size(uint prof_size)
 {
+#if CONFIG_IS_ENABLED(BOOTSTAGE_PROFILE)
+	return sizeof(struct bootstage_data) +
+		prof_size * sizeof(struct bootstage_prof);
+#else
 	return sizeof(struct bootstage_data);
+#endif
+}
+
+int bootstage_get_size(void)
+{
+#if CONFIG_IS_ENABLED(BOOTSTAGE_PROFILE)
+	return bootstage_data_size(PROF_COUNT);
+#else
+	return bootstage_data_size(0);
+#endif
+}
+
+void bootstage_move(void *to)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_data *new_data = to;
+	uint prof_size = 0;
+
+#if CONFIG_IS_ENABLED(BOOTSTAGE_PROFILE)
+	prof_size = min(data->prof_size, (uint)PROF_COUNT);
+#endif
+	memcpy(new_data, data, bootstage_data_size(prof_size));
+#if CONFIG_IS_ENABLED(BOOTSTAGE_PROFILE)
+	/*
+	 * Calls that did not fit in the old table keep their handles, so
+	 * their entries are left empty rather than reused.
+	 */
+	memset(new_data->prof + prof_size, '\0',
+	       (PROF_COUNT - prof_size) * sizeof(struct bootstage_prof));
+	new_data->prof_size = PROF_COUNT;
+#endif
+	gd->bootstage = new_data;
 }
 
 int bootstage_init(bool first)
 {
 	struct bootstage_data *data;
-	int size = sizeof(struct bootstage_data);
+	int size;
 
+	/*
+	 * This runs before relocation, so there is only room for a few
+	 * profile entries until bootstage_move() gives the table its full
+	 * size.
+	 */
+#if CONFIG_IS_ENABLED(BOOTSTAGE_PROFILE)
+	size = bootstage_data_size(PROF_COUNT_F);
+#else
+	size = bootstage_data_size(0);
+#endif
 	gd->bootstage = (struct bootstage_data *)malloc(size);
 	if (!gd->bootstage)
 		return -ENOMEM;
 	data = gd->bootstage;
 	memset(data, '\0', size);
+#if CONFIG_IS_ENABLED(BOOTSTAGE_PROFILE)
+	data->prof_size = PROF_COUNT_F;
+#endif
 	if (first) {
 		data->next_id = BOOTSTAGE_ID_USER;
 		bootstage_add_record(BOOTSTAGE_ID_AWAKE, "reset", 0, 0);
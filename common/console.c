@@ -460,7 +460,14 @@ int tstc(void)
 
 void flushc(void)
 {
-	if (!gd || gd->flags & GD_FLG_DISABLE_CONSOLE)
+	if (!gd)
+		return;
+
+#if CONFIG_IS_ENABLED(SERIAL_TX_BUFFER)
+	/* This may hold output from before the console was disabled */
+	serial_flush();
+#endif
+	if (gd->flags & GD_FLG_DISABLE_CONSOLE)
 		return;
 
 #ifdef CONFIG_DEBUG_UART_NS16550
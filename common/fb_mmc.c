@@ -100,6 +100,45 @@ static lbaint_t fb_mmc_sparse_reserve(struct sparse_storage *info,
 	return blkcnt;
 }
 
+#ifdef CONFIG_FASTBOOT_FLASH_SPARSE_DISCARD
+/*
+ * Only eMMC TRIM is used: it works on single write blocks and leaves
+ * ERASED_MEM_CONT behind, whereas a plain erase is rounded out to whole
+ * erase groups and would hit neighbouring data.
+ */
+static lbaint_t fb_mmc_sparse_erase(struct sparse_storage *info,
+		lbaint_t blk, lbaint_t blkcnt)
+{
+	struct fb_mmc_sparse *sparse = info->priv;
+	struct blk_desc *dev_desc = sparse->dev_desc;
+	struct mmc *mmc = find_mmc_device(dev_desc->devnum);
+	lbaint_t done, cur_blkcnt;
+	ulong ret;
+
+	if (!mmc || IS_SD(mmc) || !mmc->esr.mmc_can_trim ||
+	    mmc->esr.erased_byte)
+		return 0;
+
+	for (done = 0; done < blkcnt; done += cur_blkcnt) {
+		cur_blkcnt = min_t(lbaint_t, blkcnt - done,
+				   FASTBOOT_MAX_BLK_WRITE);
+		timed_send_info(&timer, "erasing");
+		ret = blk_derase(dev_desc, blk + done, cur_blkcnt);
+		/*
+		 * Errors come back as -ENOSYS, -1 or a -ve error number cast
+		 * to ulong. Report nothing erased, so the caller writes the
+		 * fill instead.
+		 */
+		if ((long)ret < 0 || ret != cur_blkcnt)
+			return 0;
+	}
+
+	return blkcnt;
+}
+#else
+#define fb_mmc_sparse_erase	NULL
+#endif
+
 static void write_raw_image(struct blk_desc *dev_desc, disk_partition_t *info,
 		const char *part_name, void *buffer,
 		unsigned int download_bytes, char *response)
@@ -290,20 +329,15 @@ static int fb_mmc_update_zimage(struct blk_desc *dev_desc,
 }
 #endif
 
-void fb_mmc_flash_write(const char *cmd, void *download_buffer,
-			unsigned int download_bytes, char *response)
+static struct blk_desc *fb_mmc_get_dev(char *response)
 {
 	struct blk_desc *dev_desc;
-	disk_partition_t info;
-#if CONFIG_IS_ENABLED(EFI_PARTITION)
-	u64 disksize = 0;
-	char reason[128] = {0};
-#endif
+
 #ifdef CONFIG_RKIMG_BOOTLOADER
 	dev_desc = rockchip_get_bootdev();
 	if (!dev_desc) {
 		printf("%s: dev_desc is NULL!\n", __func__);
-		return;
+		return NULL;
 	}
 #else
 	dev_desc = blk_get_dev("mmc", CONFIG_FASTBOOT_FLASH_MMC_DEV);
@@ -311,9 +345,26 @@ void fb_mmc_flash_write(const char *cmd, void *download_buffer,
 	if (!dev_desc || dev_desc->type == DEV_TYPE_UNKNOWN) {
 		pr_err("invalid mmc device\n");
 		fastboot_fail("invalid mmc device", response);
-		return;
+		return NULL;
 	}
 
+	return dev_desc;
+}
+
+void fb_mmc_flash_write(const char *cmd, void *download_buffer,
+			unsigned int download_bytes, char *response)
+{
+	struct blk_desc *dev_desc;
+	disk_partition_t info;
+#if CONFIG_IS_ENABLED(EFI_PARTITION)
+	u64 disksize = 0;
+	char reason[128] = {0};
+#endif
+
+	dev_desc = fb_mmc_get_dev(response);
+	if (!dev_desc)
+		return;
+
 #if CONFIG_IS_ENABLED(EFI_PARTITION)
 	if (strcmp(cmd, CONFIG_FASTBOOT_GPT_NAME) == 0) {
 		printf("%s: updating MBR, Primary and Backup GPT(s)\n",
@@ -387,6 +438,7 @@ void fb_mmc_flash_write(const char *cmd, void *download_buffer,
 		sparse.size = info.size;
 		sparse.write = fb_mmc_sparse_write;
 		sparse.reserve = fb_mmc_sparse_reserve;
+		sparse.erase = fb_mmc_sparse_erase;
 
 		printf("Flashing sparse image at offset " LBAFU "\n",
 		       sparse.start);
@@ -400,6 +452,80 @@ void fb_mmc_flash_write(const char *cmd, void *download_buffer,
 	}
 }
 
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+static struct fb_mmc_sparse stream_priv;
+static struct sparse_storage stream_storage;
+static struct sparse_stream stream;
+static bool stream_open;
+
+int fb_mmc_stream_start(const char *cmd, char *response)
+{
+	struct blk_desc *dev_desc;
+	disk_partition_t info;
+
+	fb_mmc_stream_abort();
+
+	dev_desc = fb_mmc_get_dev(response);
+	if (!dev_desc)
+		return -ENODEV;
+
+	if (part_get_info_by_name_or_alias(dev_desc, cmd, &info) < 0) {
+		pr_err("cannot find partition: '%s'\n", cmd);
+		fastboot_fail("cannot find partition", response);
+		return -ENOENT;
+	}
+
+	stream_priv.dev_desc = dev_desc;
+	stream_storage.blksz = info.blksz;
+	stream_storage.start = info.start;
+	stream_storage.size = info.size;
+	stream_storage.write = fb_mmc_sparse_write;
+	stream_storage.reserve = fb_mmc_sparse_reserve;
+	stream_storage.erase = fb_mmc_sparse_erase;
+	stream_storage.priv = &stream_priv;
+
+	if (sparse_stream_init(&stream, &stream_storage)) {
+		fastboot_fail("Malloc failed for sparse stream", response);
+		return -ENOMEM;
+	}
+
+	printf("Streaming image to '%s' at offset " LBAFU "\n", cmd,
+	       stream_storage.start);
+	stream_open = true;
+
+	return 0;
+}
+
+int fb_mmc_stream_write(const void *data, unsigned int len)
+{
+	if (!stream_open)
+		return -EINVAL;
+
+	return sparse_stream_write(&stream, data, len);
+}
+
+void fb_mmc_stream_abort(void)
+{
+	if (!stream_open)
+		return;
+
+	stream_open = false;
+	sparse_stream_abort(&stream);
+}
+
+int fb_mmc_stream_finish(const char *cmd, char *response)
+{
+	if (!stream_open) {
+		fastboot_fail("no image streamed", response);
+		return -EINVAL;
+	}
+
+	stream_open = false;
+
+	return sparse_stream_finish(&stream, cmd, response);
+}
+#endif
+
 void fb_mmc_erase(const char *cmd, char *response)
 {
 	int ret;
@@ -339,7 +339,7 @@ static sha1_context sha1_ctx;
 
 static int image_load(img_t img, struct andr_img_hdr *hdr,
 		      ulong blkstart, void *ram_base,
-		      struct udevice *crypto)
+		      struct crypto_hash *crypto)
 {
 	struct blk_desc *desc = rockchip_get_bootdev();
 	disk_partition_t part_vendor_boot;
@@ -572,8 +572,8 @@ crypto_calc:
 	if (hdr->header_version < 3) {
 #ifdef CONFIG_ANDROID_BOOT_IMAGE_HASH
 #ifdef CONFIG_DM_CRYPTO
-		crypto_sha_update(crypto, (u32 *)buffer, length);
-		crypto_sha_update(crypto, (u32 *)&length, typesz);
+		crypto_hash_update(crypto, (void *)buffer, length);
+		crypto_hash_update(crypto, &length, typesz);
 #else
 		sha1_update(&sha1_ctx, (void *)buffer, length);
 		sha1_update(&sha1_ctx, (void *)&length, typesz);
@@ -588,7 +588,7 @@ crypto_calc:
 }
 
 static int images_load_verify(struct andr_img_hdr *hdr, ulong part_start,
-			      void *ram_base, struct udevice *crypto)
+			      void *ram_base, struct crypto_hash *crypto)
 {
 	/* load, never change order ! */
 	if (image_load(IMG_KERNEL, hdr, part_start, ram_base, crypto))
@@ -641,38 +641,38 @@ static int android_image_separate(struct andr_img_hdr *hdr,
 
 #ifdef CONFIG_ANDROID_BOOT_IMAGE_HASH
 	if (hdr->header_version < 3) {
-		struct udevice *dev = NULL;
+		struct crypto_hash *crypto = NULL;
 		uchar hash[20];
 #ifdef CONFIG_DM_CRYPTO
-		sha_context ctx;
-
-		ctx.length = 0;
-		ctx.algo = CRYPTO_SHA1;
-		dev = crypto_get_device(ctx.algo);
-		if (!dev) {
-			printf("Can't find crypto device for SHA1\n");
-			return -ENODEV;
-		}
+		u32 length;
 
 		/* v1 & v2: requires total length before sha init */
-		ctx.length += hdr->kernel_size + sizeof(hdr->kernel_size) +
-			      hdr->ramdisk_size + sizeof(hdr->ramdisk_size) +
-			      hdr->second_size + sizeof(hdr->second_size);
+		length = hdr->kernel_size + sizeof(hdr->kernel_size) +
+			 hdr->ramdisk_size + sizeof(hdr->ramdisk_size) +
+			 hdr->second_size + sizeof(hdr->second_size);
 		if (hdr->header_version > 0)
-			ctx.length += hdr->recovery_dtbo_size +
-						sizeof(hdr->recovery_dtbo_size);
+			length += hdr->recovery_dtbo_size +
+					sizeof(hdr->recovery_dtbo_size);
 		if (hdr->header_version > 1)
-			ctx.length += hdr->dtb_size + sizeof(hdr->dtb_size);
-		crypto_sha_init(dev, &ctx);
+			length += hdr->dtb_size + sizeof(hdr->dtb_size);
+		crypto = crypto_hash_alloc(CRYPTO_SHA1, length);
+		if (!crypto) {
+			printf("Can't start SHA1\n");
+			return -ENODEV;
+		}
 #else
 		sha1_starts(&sha1_ctx);
 #endif
-		ret = images_load_verify(hdr, bstart, ram_base, dev);
-		if (ret)
+		ret = images_load_verify(hdr, bstart, ram_base, crypto);
+		if (ret) {
+#ifdef CONFIG_DM_CRYPTO
+			crypto_hash_free(crypto);
+#endif
 			return ret;
+		}
 
 #ifdef CONFIG_DM_CRYPTO
-		crypto_sha_final(dev, &ctx, hash);
+		crypto_hash_final(crypto, hash);
 #else
 		sha1_finish(&sha1_ctx, hash);
 #endif
@@ -864,6 +864,150 @@ int android_image_memcpy_separate(struct andr_img_hdr *hdr, ulong *load_addr)
 	return 0;
 }
 
+ulong android_image_prepare_separate(struct blk_desc *dev_desc,
+				     const disk_partition_t *part_info,
+				     struct andr_img_hdr *hdr,
+				     ulong load_address)
+{
+	ulong blksz = dev_desc->blksz;
+	ulong ramdisk_addr_r;
+	ulong comp_addr;
+	ulong size;
+	void *buf;
+	int comp;
+
+	/* The kernel follows the header page, its first block tells the compression */
+	buf = malloc(blksz);
+	if (!buf)
+		return 0;
+	if (blk_dread(dev_desc, part_info->start + BLK_CNT(hdr->page_size, blksz),
+		      1, buf) != 1) {
+		free(buf);
+		return 0;
+	}
+	comp = bootm_parse_comp(buf);
+	free(buf);
+
+	comp_addr = android_image_get_comp_addr(hdr, comp);
+	if (comp_addr)
+		load_address = comp_addr;
+	else
+		load_address -= hdr->page_size;
+
+	/* Reserve what image_load() would for the parts that are kept */
+	if (!sysmem_alloc_base(MEM_KERNEL, (phys_addr_t)load_address,
+			       ALIGN(hdr->page_size + hdr->kernel_size, blksz)))
+		return 0;
+
+	size = ALIGN(hdr->ramdisk_size, blksz);
+	if (hdr->header_version >= 3)
+		size += ALIGN(hdr->vendor_ramdisk_size, blksz) + blksz;
+	if (hdr->header_version >= 4)
+		size += ALIGN(hdr->vendor_bootconfig_size, blksz) +
+			ANDROID_ADDITION_BOOTCONFIG_PARAMS_MAX_SIZE;
+	ramdisk_addr_r = env_get_ulong("ramdisk_addr_r", 16, 0);
+	if (hdr->ramdisk_size || hdr->vendor_ramdisk_size) {
+		if (!ramdisk_addr_r) {
+			printf("No Found Ramdisk Load Address.\n");
+			return 0;
+		}
+		if (!sysmem_alloc_base(MEM_RAMDISK, (phys_addr_t)ramdisk_addr_r,
+				       size))
+			return 0;
+	}
+
+	return load_address;
+}
+
+static void android_image_add_seg(struct android_image_seg *segs, int *count,
+				  ulong offset, ulong size, ulong dst)
+{
+	if (!size)
+		return;
+
+	segs[*count].offset = offset;
+	segs[*count].size = size;
+	segs[*count].dst = (void *)dst;
+	(*count)++;
+}
+
+int android_image_get_segs(const struct andr_img_hdr *hdr, ulong load_address,
+			   const char *partition, void *hdr_buf,
+			   struct android_image_seg *segs)
+{
+	u32 andr_version = (hdr->os_version >> 25) & 0x7f;
+	ulong ramdisk_addr_r = env_get_ulong("ramdisk_addr_r", 16, 0);
+	ulong pgsz = hdr->page_size;
+	ulong vpgsz = hdr->vendor_page_size;
+	int count = 0;
+
+	/* Same places as image_load(), see the ramdisk_addr_r layout there */
+	if (!strcmp(partition, ANDROID_PARTITION_VENDOR_BOOT)) {
+		if (hdr->header_version < 3)
+			return -EINVAL;
+		android_image_add_seg(segs, &count, 0,
+				      sizeof(struct vendor_boot_img_hdr_v34),
+				      (ulong)hdr_buf);
+		android_image_add_seg(segs, &count,
+				      ALIGN(VENDOR_BOOT_HDRv3_SIZE, vpgsz),
+				      hdr->vendor_ramdisk_size, ramdisk_addr_r);
+		if (hdr->header_version >= 4)
+			android_image_add_seg(segs, &count,
+					      ALIGN(VENDOR_BOOT_HDRv4_SIZE, vpgsz) +
+					      ALIGN(hdr->vendor_ramdisk_size, vpgsz) +
+					      ALIGN(hdr->dtb_size, vpgsz) +
+					      ALIGN(hdr->vendor_ramdisk_table_size, vpgsz),
+					      hdr->vendor_bootconfig_size,
+					      ramdisk_addr_r +
+					      hdr->vendor_ramdisk_size +
+					      hdr->ramdisk_size);
+	} else if (!strcmp(partition, ANDROID_PARTITION_INIT_BOOT)) {
+		if (hdr->header_version < 4 || andr_version < 13)
+			return -EINVAL;
+		android_image_add_seg(segs, &count, 0,
+				      sizeof(struct boot_img_hdr_v34),
+				      (ulong)hdr_buf);
+		android_image_add_seg(segs, &count, pgsz, hdr->ramdisk_size,
+				      ramdisk_addr_r + hdr->vendor_ramdisk_size);
+	} else {
+		/* The header page stays in front of the kernel, as in IMG_KERNEL */
+		android_image_add_seg(segs, &count, 0, pgsz + hdr->kernel_size,
+				      load_address);
+		if (hdr->header_version < 4 || andr_version < 13)
+			android_image_add_seg(segs, &count,
+					      pgsz + ALIGN(hdr->kernel_size, pgsz),
+					      hdr->ramdisk_size, ramdisk_addr_r +
+					      (hdr->header_version >= 3 ?
+					       hdr->vendor_ramdisk_size : 0));
+	}
+
+	return count;
+}
+
+int android_image_finish_separate(struct andr_img_hdr *hdr, ulong load_address)
+{
+	struct andr_img_hdr *load_hdr = (struct andr_img_hdr *)load_address;
+
+	if (android_image_check_header(hdr)) {
+		printf("Bad android image header\n");
+		return -EINVAL;
+	}
+
+	/* As android_image_separate_v34(), the kernel follows the populated hdr */
+	if (hdr->header_version >= 3)
+		memcpy(load_hdr, hdr, sizeof(*hdr));
+
+	env_set_hex("android_addr_r", load_address);
+	if (image_load(IMG_RK_DTB, load_hdr, 0, NULL, NULL))
+		return -1;
+	env_set("bootm-no-reloc", "y");
+
+	android_image_set_decomp(load_hdr,
+			bootm_parse_comp((void *)load_address + hdr->page_size));
+
+	return 0;
+}
+
 long android_image_load(struct blk_desc *dev_desc,
 			const disk_partition_t *part_info,
 			unsigned long load_address,
@@ -21,6 +21,7 @@
 #include <asm/io.h>
 #include <malloc.h>
 #include <crypto.h>
+#include <watchdog.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 #endif /* !USE_HOSTCC*/
@@ -900,8 +901,8 @@ int fit_image_set_entry(const void *fit, int noffset, ulong entry)
 int fit_image_get_data(const void *fit, int noffset,
 		const void **data, size_t *size)
 {
-	ulong data_off = 0;
-	ulong data_pos = 0;
+	int data_off;
+	int data_pos;
 	int len;
 
 	/* data */
@@ -915,17 +916,20 @@ int fit_image_get_data(const void *fit, int noffset,
 	if (fit_image_get_data_size(fit, noffset, &len))
 		return -ENOENT;
 
-	/* data-offset */
-	if (!fit_image_get_data_offset(fit, noffset, (int *)&data_off)) {
-		data_off += (ulong)fit + FIT_ALIGN(fdt_totalsize(fit));
-		*data = (void *)data_off;
+	/*
+	 * data-offset and data-position are signed, a loader that placed the
+	 * data elsewhere may point them below the FIT blob.
+	 */
+	if (!fit_image_get_data_offset(fit, noffset, &data_off)) {
+		*data = (void *)((ulong)fit + FIT_ALIGN(fdt_totalsize(fit)) +
+				 data_off);
 		*size = len;
 		return 0;
 	}
 
 	/* data-position */
-	if (!fit_image_get_data_position(fit, noffset, (int *)&data_pos)) {
-		*data = (void *)(data_pos + (ulong)fit);
+	if (!fit_image_get_data_position(fit, noffset, &data_pos)) {
+		*data = (void *)((ulong)fit + data_pos);
 		*size = len;
 		return 0;
 	}
@@ -1214,48 +1218,185 @@ int fit_calculate_hash(const void *data, int data_len,
 
 #ifndef USE_HOSTCC
 #if CONFIG_IS_ENABLED(FIT_HW_CRYPTO)
-static int crypto_csum(u32 cap, const char *data, int len, u8 *output)
-{
-	struct udevice *dev;
-	sha_context csha_ctx;
+#define FIT_HASH_ENABLE_HW
+#endif
+#endif
 
-	dev = crypto_get_device(cap);
-	if (!dev) {
-		printf("Can't find expected crypto device\n");
-		return -ENODEV;
-	}
+enum {
+	FIT_HASH_CRC32,
+	FIT_HASH_MD5,
+	FIT_HASH_SHA1,
+	FIT_HASH_SHA256,
+};
 
-	csha_ctx.algo = cap;
-	csha_ctx.length = len;
+#ifdef FIT_HASH_ENABLE_HW
+static u32 fit_hash_crypto_cap(const char *algo)
+{
+	if (IMAGE_ENABLE_SHA1 && strcmp(algo, "sha1") == 0)
+		return CRYPTO_SHA1;
+	else if (IMAGE_ENABLE_SHA256 && strcmp(algo, "sha256") == 0)
+		return CRYPTO_SHA256;
+	else if (IMAGE_ENABLE_MD5 && strcmp(algo, "md5") == 0)
+		return CRYPTO_MD5;
 
-	return crypto_sha_csum(dev, &csha_ctx, (char *)data, len, output);
+	return 0;
 }
+#endif
 
-static int hw_fit_calculate_hash(const void *data, int data_len,
-				 const char *algo, uint8_t *value,
-				 int *value_len)
+int fit_hash_init(struct fit_hash_ctx *hc, const char *algo, uint32_t length)
 {
-	int ret = 0;
+#ifdef FIT_HASH_ENABLE_HW
+	u32 cap;
+#endif
+
+	memset(hc, 0, sizeof(*hc));
+	hc->algo = algo;
+	hc->length = length;
+
+#ifdef FIT_HASH_ENABLE_HW
+	cap = fit_hash_crypto_cap(algo);
+	if (cap)
+		hc->hw = crypto_hash_alloc(cap, length);
+	if (hc->hw) {
+		hc->value_len = BITS2BYTE(crypto_algo_nbits(cap));
+		return 0;
+	}
+#endif
 
 	if (IMAGE_ENABLE_CRC32 && strcmp(algo, "crc32") == 0) {
-		*((uint32_t *)value) = crc32_wd(0, data, data_len,
-							CHUNKSZ_CRC32);
-		*((uint32_t *)value) = cpu_to_uimage(*((uint32_t *)value));
-		*value_len = 4;
+		hc->type = FIT_HASH_CRC32;
+		hc->sw.crc32 = 0;
+		hc->value_len = 4;
+#ifdef CONFIG_SHA1
 	} else if (IMAGE_ENABLE_SHA1 && strcmp(algo, "sha1") == 0) {
-		ret = crypto_csum(CRYPTO_SHA1, data, data_len, value);
-		*value_len = 20;
+		hc->type = FIT_HASH_SHA1;
+		sha1_starts(&hc->sw.sha1);
+		hc->value_len = 20;
+#endif
+#ifdef CONFIG_SHA256
 	} else if (IMAGE_ENABLE_SHA256 && strcmp(algo, "sha256") == 0) {
-		ret = crypto_csum(CRYPTO_SHA256, data, data_len, value);
-		*value_len = SHA256_SUM_LEN;
+		hc->type = FIT_HASH_SHA256;
+		sha256_starts(&hc->sw.sha256);
+		hc->value_len = SHA256_SUM_LEN;
+#endif
+#ifdef CONFIG_MD5
 	} else if (IMAGE_ENABLE_MD5 && strcmp(algo, "md5") == 0) {
-		ret = crypto_csum(CRYPTO_MD5, data, data_len, value);
-		*value_len = 16;
+		hc->type = FIT_HASH_MD5;
+		MD5Init(&hc->sw.md5);
+		hc->value_len = 16;
+#endif
 	} else {
 		debug("Unsupported hash alogrithm\n");
 		return -1;
 	}
 
+	return 0;
+}
+
+int fit_hash_update(struct fit_hash_ctx *hc, const void *data, uint32_t len)
+{
+	const unsigned char *p = data;
+	uint32_t chunk;
+
+#ifdef FIT_HASH_ENABLE_HW
+	if (hc->hw)
+		return crypto_hash_update(hc->hw, data, len);
+#endif
+
+	/* Software hashing is slow, keep the watchdog happy */
+	while (len) {
+		chunk = len < CHUNKSZ ? len : CHUNKSZ;
+
+		switch (hc->type) {
+		case FIT_HASH_CRC32:
+			hc->sw.crc32 = crc32(hc->sw.crc32, p, chunk);
+			break;
+#ifdef CONFIG_SHA1
+		case FIT_HASH_SHA1:
+			sha1_update(&hc->sw.sha1, p, chunk);
+			break;
+#endif
+#ifdef CONFIG_SHA256
+		case FIT_HASH_SHA256:
+			sha256_update(&hc->sw.sha256, p, chunk);
+			break;
+#endif
+#ifdef CONFIG_MD5
+		case FIT_HASH_MD5:
+			MD5Update(&hc->sw.md5, p, chunk);
+			break;
+#endif
+		}
+
+		p += chunk;
+		len -= chunk;
+#ifndef USE_HOSTCC
+		WATCHDOG_RESET();
+#endif
+	}
+
+	return 0;
+}
+
+int fit_hash_final(struct fit_hash_ctx *hc, uint8_t *value, int *value_len)
+{
+	*value_len = hc->value_len;
+
+#ifdef FIT_HASH_ENABLE_HW
+	if (hc->hw)
+		return crypto_hash_final(hc->hw, value);
+#endif
+
+	switch (hc->type) {
+	case FIT_HASH_CRC32:
+		*((uint32_t *)value) = cpu_to_uimage(hc->sw.crc32);
+		break;
+#ifdef CONFIG_SHA1
+	case FIT_HASH_SHA1:
+		sha1_finish(&hc->sw.sha1, value);
+		break;
+#endif
+#ifdef CONFIG_SHA256
+	case FIT_HASH_SHA256:
+		sha256_finish(&hc->sw.sha256, value);
+		break;
+#endif
+#ifdef CONFIG_MD5
+	case FIT_HASH_MD5:
+		MD5Final(value, &hc->sw.md5);
+		break;
+#endif
+	}
+
+	return 0;
+}
+
+void fit_hash_abort(struct fit_hash_ctx *hc)
+{
+#ifdef FIT_HASH_ENABLE_HW
+	crypto_hash_free(hc->hw);
+	hc->hw = NULL;
+#endif
+}
+
+#ifndef USE_HOSTCC
+#if CONFIG_IS_ENABLED(FIT_HW_CRYPTO)
+static int hw_fit_calculate_hash(const void *data, int data_len,
+				 const char *algo, uint8_t *value,
+				 int *value_len)
+{
+	struct fit_hash_ctx hc;
+	int ret;
+
+	ret = fit_hash_init(&hc, algo, data_len);
+	if (ret)
+		return ret;
+
+	ret = fit_hash_update(&hc, data, data_len);
+	if (!ret)
+		ret = fit_hash_final(&hc, value, value_len);
+	else
+		fit_hash_abort(&hc);
 	if (ret)
 		printf("%s: algo %s failed, ret=%d\n", __func__, algo, ret);
 
@@ -1296,16 +1437,11 @@ int calculate_hash(const void *data, int data_len, const char *algo,
 #endif
 }
 
-int fit_image_check_hash(const void *fit, int noffset, const void *data,
-			 size_t size, char **err_msgp)
+int fit_image_hash_init(const void *fit, int noffset, struct fit_hash_ctx *hc,
+			size_t size, char **err_msgp)
 {
-	uint8_t value[FIT_MAX_HASH_LEN];
-	int value_len;
 	char *algo;
-	uint8_t *fit_value;
-	int fit_value_len;
 	int ignore;
-	int i;
 
 	*err_msgp = NULL;
 
@@ -1319,18 +1455,36 @@ int fit_image_check_hash(const void *fit, int noffset, const void *data,
 		fit_image_hash_get_ignore(fit, noffset, &ignore);
 		if (ignore) {
 			printf("-skipped ");
-			return 0;
+			return 1;
 		}
 	}
 
+	if (fit_hash_init(hc, algo, size)) {
+		*err_msgp = "Unsupported hash algorithm";
+		return -1;
+	}
+
+	return 0;
+}
+
+int fit_image_hash_check(const void *fit, int noffset, struct fit_hash_ctx *hc,
+			 char **err_msgp)
+{
+	uint8_t value[FIT_MAX_HASH_LEN];
+	int value_len;
+	uint8_t *fit_value;
+	int fit_value_len;
+	int i;
+
 	if (fit_image_hash_get_value(fit, noffset, &fit_value,
 				     &fit_value_len)) {
 		*err_msgp = "Can't get hash value property";
+		fit_hash_abort(hc);
 		return -1;
 	}
 
-	if (calculate_hash(data, size, algo, value, &value_len)) {
-		*err_msgp = "Unsupported hash algorithm";
+	if (fit_hash_final(hc, value, &value_len)) {
+		*err_msgp = "Hash calculation failed";
 		return -1;
 	}
 
@@ -1357,14 +1511,57 @@ int fit_image_check_hash(const void *fit, int noffset, const void *data,
 	return 0;
 }
 
+int fit_image_check_hash(const void *fit, int noffset, const void *data,
+			 size_t size, char **err_msgp)
+{
+	struct fit_hash_ctx hc;
+	int ret;
+
+	ret = fit_image_hash_init(fit, noffset, &hc, size, err_msgp);
+	if (ret)
+		return ret < 0 ? ret : 0;
+
+	if (fit_hash_update(&hc, data, size)) {
+		*err_msgp = "Hash calculation failed";
+		fit_hash_abort(&hc);
+		return -1;
+	}
+
+	return fit_image_hash_check(fit, noffset, &hc, err_msgp);
+}
+
+#ifndef USE_HOSTCC
+#define FIT_IMAGE_ENABLE_TIMING	CONFIG_IS_ENABLED(BOOTSTAGE)
+#else
+#define FIT_IMAGE_ENABLE_TIMING	0
+#endif
+
+/* Give each verified image its own entry in the bootstage report */
+static void fit_image_verify_time(const void *fit, int image_noffset,
+				  uint32_t start_us)
+{
+	char name[40];
+
+	if (!FIT_IMAGE_ENABLE_TIMING)
+		return;
+
+	snprintf(name, sizeof(name), "hash %s",
+		 fit_get_name(fit, image_noffset, NULL));
+	bootstage_accum_name(name, start_us);
+}
+
 int fit_image_verify_with_data(const void *fit, int image_noffset,
 			       const void *data, size_t size)
 {
 	int		noffset = 0;
 	char		*err_msg = "";
 	int verify_all = 1;
+	uint32_t start_us = 0;
 	int ret;
 
+	if (FIT_IMAGE_ENABLE_TIMING)
+		start_us = timer_get_boot_us();
+
 	/* Verify all required signatures */
 	if (IMAGE_ENABLE_VERIFY &&
 	    fit_image_verify_required_sigs(fit, image_noffset, data, size,
@@ -1412,6 +1609,8 @@ int fit_image_verify_with_data(const void *fit, int image_noffset,
 		goto error;
 	}
 
+	fit_image_verify_time(fit, image_noffset, start_us);
+
 	return 1; /* success */
 
 error:
@@ -2264,7 +2463,9 @@ int fit_image_load_index(bootm_headers_t *images, ulong addr,
 		       prop_name, data, load);
 
 		dst = map_sysmem(load, len);
-		memmove(dst, buf, len);
+		/* The data may have been read straight to its load address */
+		if (dst != buf)
+			memmove(dst, buf, len);
 		data = load;
 	}
 	bootstage_mark(bootstage_id + BOOTSTAGE_SUB_LOAD);
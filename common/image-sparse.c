@@ -49,40 +49,227 @@
 #define CONFIG_FASTBOOT_FLASH_FILLBUF_SIZE (1024 * 512)
 #endif
 
-void write_sparse_image(
-		struct sparse_storage *info, const char *part_name,
-		void *data, unsigned sz, char *response)
+#ifndef CONFIG_FASTBOOT_FLASH_STREAM_BUF_SIZE
+#define CONFIG_FASTBOOT_FLASH_STREAM_BUF_SIZE (1024 * 1024)
+#endif
+
+enum {
+	SPARSE_STREAM_FILE_HDR,		/* collecting the sparse header */
+	SPARSE_STREAM_CHUNK_HDR,	/* collecting a chunk header */
+	SPARSE_STREAM_SKIP,		/* skipping bytes, then ->next */
+	SPARSE_STREAM_RAW,		/* payload of a RAW chunk */
+	SPARSE_STREAM_FILL,		/* collecting a FILL value */
+	SPARSE_STREAM_IMAGE,		/* not sparse, written as-is */
+	SPARSE_STREAM_DONE,		/* all chunks seen */
+	SPARSE_STREAM_ERROR,
+	SPARSE_STREAM_CHUNK_END,	/* not a state: end of chunk */
+};
+
+static int sparse_stream_fail(struct sparse_stream *ss, const char *error)
 {
-	lbaint_t blk;
-	lbaint_t blkcnt;
+	printf("%s: %s\n", __func__, error);
+	ss->error = error;
+	ss->state = SPARSE_STREAM_ERROR;
+
+	return -EINVAL;
+}
+
+/* Write whole blocks at the current position */
+static int sparse_stream_write_blocks(struct sparse_stream *ss,
+				      const void *data, lbaint_t blkcnt)
+{
+	struct sparse_storage *info = ss->info;
 	lbaint_t blks;
-	uint32_t bytes_written = 0;
-	unsigned int chunk;
-	unsigned int offset;
-	unsigned int chunk_data_sz;
-	uint32_t *fill_buf = NULL;
-	uint32_t fill_val;
-	sparse_header_t *sparse_header;
-	chunk_header_t *chunk_header;
-	uint32_t total_blocks = 0;
-	int fill_buf_num_blks;
-	int i;
-	int j;
+
+	if (ss->blk + blkcnt > info->start + info->size)
+		return sparse_stream_fail(ss,
+					  "Request would exceed partition size!");
+
+	blks = info->write(info, ss->blk, blkcnt, data);
+	/* blks might be > blkcnt (eg. NAND bad-blocks) */
+	if (blks < blkcnt) {
+		printf("%s: %s" LBAFU " [" LBAFU "]\n",
+		       __func__, "Write failed, block #", ss->blk, blks);
+		return sparse_stream_fail(ss, "flash write failure");
+	}
+	ss->blk += blks;
+	ss->bytes_written += blkcnt * info->blksz;
+
+	return 0;
+}
+
+/* Write out whatever RAW data is staged, padding a partial block */
+static int sparse_stream_flush(struct sparse_stream *ss)
+{
+	lbaint_t blksz = ss->info->blksz;
+	unsigned int len = ss->buf_len;
+
+	if (!len)
+		return 0;
+
+	ss->buf_len = 0;
+	if (len % blksz) {
+		memset(ss->buf + len, 0, blksz - len % blksz);
+		len += blksz - len % blksz;
+	}
+
+	return sparse_stream_write_blocks(ss, ss->buf, len / blksz);
+}
+
+/*
+ * Consume RAW data. Large runs are written straight from the caller's
+ * buffer; anything else is staged so that the storage sees large writes
+ * even when data trickles in a USB packet at a time.
+ */
+static int sparse_stream_data(struct sparse_stream *ss, const char *data,
+			      unsigned int len)
+{
+	lbaint_t blksz = ss->info->blksz;
+	lbaint_t blkcnt;
+	unsigned int n;
+	int ret;
+
+	while (len) {
+		if (!ss->buf_len && len >= ss->buf_size) {
+			blkcnt = len / blksz;
+			ret = sparse_stream_write_blocks(ss, data, blkcnt);
+			if (ret)
+				return ret;
+			data += blkcnt * blksz;
+			len -= blkcnt * blksz;
+			continue;
+		}
+
+		n = min(len, ss->buf_size - ss->buf_len);
+		memcpy(ss->buf + ss->buf_len, data, n);
+		ss->buf_len += n;
+		data += n;
+		len -= n;
+
+		if (ss->buf_len == ss->buf_size) {
+			ret = sparse_stream_flush(ss);
+			if (ret)
+				return ret;
+		}
+	}
+
+	return 0;
+}
+
+/* Discard blocks which must read as zero, if the storage can do that */
+static bool sparse_stream_erase(struct sparse_stream *ss, lbaint_t blkcnt)
+{
+	struct sparse_storage *info = ss->info;
+
+	if (!info->erase || !blkcnt ||
+	    ss->blk + blkcnt > info->start + info->size)
+		return false;
+
+	if (info->erase(info, ss->blk, blkcnt) < blkcnt)
+		return false;
+
+	ss->blk += blkcnt;
+
+	return true;
+}
+
+static int sparse_stream_fill(struct sparse_stream *ss, uint32_t fill_val,
+			      lbaint_t blkcnt)
+{
+	struct sparse_storage *info = ss->info;
+	lbaint_t fill_buf_num_blks;
+	lbaint_t i, j;
+	int ret;
+
+	if (!fill_val && sparse_stream_erase(ss, blkcnt)) {
+		ss->bytes_written += blkcnt * info->blksz;
+		return 0;
+	}
 
 	fill_buf_num_blks = CONFIG_FASTBOOT_FLASH_FILLBUF_SIZE / info->blksz;
+	if (!ss->fill_buf) {
+		ss->fill_buf = (uint32_t *)
+			       memalign(ARCH_DMA_MINALIGN,
+					ROUNDUP(info->blksz * fill_buf_num_blks,
+						ARCH_DMA_MINALIGN));
+		if (!ss->fill_buf)
+			return sparse_stream_fail(ss,
+					"Malloc failed for: CHUNK_TYPE_FILL");
+		ss->fill_val = ~fill_val;
+	}
 
-	/* Read and skip over sparse image header */
-	sparse_header = (sparse_header_t *)data;
+	if (ss->fill_val != fill_val) {
+		for (i = 0;
+		     i < (info->blksz * fill_buf_num_blks / sizeof(fill_val));
+		     i++)
+			ss->fill_buf[i] = fill_val;
+		ss->fill_val = fill_val;
+	}
 
-	data += sparse_header->file_hdr_sz;
-	if (sparse_header->file_hdr_sz > sizeof(sparse_header_t)) {
-		/*
-		 * Skip the remaining bytes in a header that is longer than
-		 * we expected.
-		 */
-		data += (sparse_header->file_hdr_sz - sizeof(sparse_header_t));
+	for (i = 0; i < blkcnt; i += j) {
+		j = min(blkcnt - i, fill_buf_num_blks);
+		ret = sparse_stream_write_blocks(ss, ss->fill_buf, j);
+		if (ret)
+			return ret;
 	}
 
+	return 0;
+}
+
+/* Collect up to @size header bytes; returns true once all are there */
+static bool sparse_stream_collect(struct sparse_stream *ss,
+				  const char **data, unsigned int *len,
+				  unsigned int size)
+{
+	unsigned int n = min(*len, size - ss->hdr_len);
+
+	memcpy(ss->hdr + ss->hdr_len, *data, n);
+	ss->hdr_len += n;
+	*data += n;
+	*len -= n;
+	if (ss->hdr_len < size)
+		return false;
+
+	ss->hdr_len = 0;
+	return true;
+}
+
+/* Called once all of a chunk (header and payload) has been consumed */
+static void sparse_stream_chunk_done(struct sparse_stream *ss)
+{
+	if (++ss->chunk == ss->sparse_header.total_chunks)
+		ss->state = SPARSE_STREAM_DONE;
+	else
+		ss->state = SPARSE_STREAM_CHUNK_HDR;
+}
+
+static void sparse_stream_enter(struct sparse_stream *ss, int state)
+{
+	if (state == SPARSE_STREAM_CHUNK_END)
+		sparse_stream_chunk_done(ss);
+	else
+		ss->state = state;
+}
+
+/* Skip @skip bytes of input, then move to state @next */
+static void sparse_stream_skip(struct sparse_stream *ss, unsigned int skip,
+			       int next)
+{
+	ss->skip = skip;
+	ss->next = next;
+	if (skip)
+		ss->state = SPARSE_STREAM_SKIP;
+	else
+		sparse_stream_enter(ss, next);
+}
+
+static int sparse_stream_file_header(struct sparse_stream *ss)
+{
+	sparse_header_t *sparse_header = &ss->sparse_header;
+	unsigned int offset;
+
+	memcpy(sparse_header, ss->hdr, sizeof(*sparse_header));
+
 	debug("=== Sparse Image Header ===\n");
 	debug("magic: 0x%x\n", sparse_header->magic);
 	debug("major_version: 0x%x\n", sparse_header->major_version);
@@ -93,172 +280,282 @@ void write_sparse_image(
 	debug("total_blks: %d\n", sparse_header->total_blks);
 	debug("total_chunks: %d\n", sparse_header->total_chunks);
 
+	if (sparse_header->file_hdr_sz < sizeof(sparse_header_t) ||
+	    sparse_header->chunk_hdr_sz < sizeof(chunk_header_t))
+		return sparse_stream_fail(ss, "sparse image header issue");
+
 	/*
 	 * Verify that the sparse block size is a multiple of our
 	 * storage backend block size
 	 */
-	div_u64_rem(sparse_header->blk_sz, info->blksz, &offset);
-	if (offset) {
+	div_u64_rem(sparse_header->blk_sz, ss->info->blksz, &offset);
+	if (!sparse_header->blk_sz || offset) {
 		printf("%s: Sparse image block size issue [%u]\n",
 		       __func__, sparse_header->blk_sz);
-		fastboot_fail("sparse image block size issue", response);
-		return;
+		return sparse_stream_fail(ss, "sparse image block size issue");
 	}
 
 	puts("Flashing Sparse Image\n");
 
-	/* Start processing chunks */
-	blk = info->start;
-	for (chunk = 0; chunk < sparse_header->total_chunks; chunk++) {
-		/* Read and skip over chunk header */
-		chunk_header = (chunk_header_t *)data;
-		data += sizeof(chunk_header_t);
-
-		if (chunk_header->chunk_type != CHUNK_TYPE_RAW) {
-			debug("=== Chunk Header ===\n");
-			debug("chunk_type: 0x%x\n", chunk_header->chunk_type);
-			debug("chunk_data_sz: 0x%x\n", chunk_header->chunk_sz);
-			debug("total_size: 0x%x\n", chunk_header->total_sz);
-		}
+	/*
+	 * Skip the remaining bytes in a header that is longer than
+	 * we expected.
+	 */
+	sparse_stream_skip(ss, sparse_header->file_hdr_sz -
+			   sizeof(sparse_header_t),
+			   sparse_header->total_chunks ?
+			   SPARSE_STREAM_CHUNK_HDR : SPARSE_STREAM_DONE);
 
-		if (sparse_header->chunk_hdr_sz > sizeof(chunk_header_t)) {
-			/*
-			 * Skip the remaining bytes in a header that is longer
-			 * than we expected.
-			 */
-			data += (sparse_header->chunk_hdr_sz -
-				 sizeof(chunk_header_t));
-		}
+	return 0;
+}
 
-		chunk_data_sz = sparse_header->blk_sz * chunk_header->chunk_sz;
-		blkcnt = chunk_data_sz / info->blksz;
-		switch (chunk_header->chunk_type) {
-		case CHUNK_TYPE_RAW:
-			if (chunk_header->total_sz !=
-			    (sparse_header->chunk_hdr_sz + chunk_data_sz)) {
-				fastboot_fail(
-					"Bogus chunk size for chunk type Raw", response);
-				return;
-			}
+static int sparse_stream_chunk_header(struct sparse_stream *ss)
+{
+	sparse_header_t *sparse_header = &ss->sparse_header;
+	chunk_header_t *chunk_header = &ss->chunk_header;
+	struct sparse_storage *info = ss->info;
+	unsigned int hdr_skip;
+	u64 chunk_data_sz;
+	lbaint_t blkcnt;
+	int ret;
 
-			if (blk + blkcnt > info->start + info->size) {
-				printf(
-				    "%s: Request would exceed partition size!\n",
-				    __func__);
-				fastboot_fail(
-				    "Request would exceed partition size!", response);
-				return;
-			}
+	memcpy(chunk_header, ss->hdr, sizeof(*chunk_header));
+	hdr_skip = sparse_header->chunk_hdr_sz - sizeof(chunk_header_t);
+
+	if (chunk_header->chunk_type != CHUNK_TYPE_RAW) {
+		debug("=== Chunk Header ===\n");
+		debug("chunk_type: 0x%x\n", chunk_header->chunk_type);
+		debug("chunk_data_sz: 0x%x\n", chunk_header->chunk_sz);
+		debug("total_size: 0x%x\n", chunk_header->total_sz);
+	}
+
+	chunk_data_sz = (u64)sparse_header->blk_sz * chunk_header->chunk_sz;
+	blkcnt = lldiv(chunk_data_sz, info->blksz);
+
+	switch (chunk_header->chunk_type) {
+	case CHUNK_TYPE_RAW:
+		if (chunk_header->total_sz !=
+		    (sparse_header->chunk_hdr_sz + chunk_data_sz))
+			return sparse_stream_fail(ss,
+					"Bogus chunk size for chunk type Raw");
 
-			blks = info->write(info, blk, blkcnt, data);
-			/* blks might be > blkcnt (eg. NAND bad-blocks) */
-			if (blks < blkcnt) {
-				printf("%s: %s" LBAFU " [" LBAFU "]\n",
-				       __func__, "Write failed, block #",
-				       blk, blks);
-				fastboot_fail(
-					      "flash write failure", response);
-				return;
+		ss->chunk_left = chunk_data_sz;
+		ss->total_blocks += chunk_header->chunk_sz;
+		sparse_stream_skip(ss, hdr_skip, chunk_data_sz ?
+				   SPARSE_STREAM_RAW : SPARSE_STREAM_CHUNK_END);
+		break;
+
+	case CHUNK_TYPE_FILL:
+		if (chunk_header->total_sz !=
+		    (sparse_header->chunk_hdr_sz + sizeof(uint32_t)))
+			return sparse_stream_fail(ss,
+					"Bogus chunk size for chunk type FILL");
+
+		sparse_stream_skip(ss, hdr_skip, SPARSE_STREAM_FILL);
+		break;
+
+	case CHUNK_TYPE_DONT_CARE:
+		if (chunk_header->total_sz < sparse_header->chunk_hdr_sz)
+			return sparse_stream_fail(ss,
+				"Bogus chunk size for chunk type Dont Care");
+
+		ret = sparse_stream_flush(ss);
+		if (ret)
+			return ret;
+		if (!sparse_stream_erase(ss, blkcnt))
+			ss->blk += info->reserve(info, ss->blk, blkcnt);
+		ss->total_blocks += chunk_header->chunk_sz;
+		sparse_stream_skip(ss, chunk_header->total_sz -
+				   sizeof(chunk_header_t),
+				   SPARSE_STREAM_CHUNK_END);
+		break;
+
+	case CHUNK_TYPE_CRC32:
+		if (chunk_header->total_sz < sparse_header->chunk_hdr_sz)
+			return sparse_stream_fail(ss,
+				"Bogus chunk size for chunk type CRC32");
+
+		/* the CRC itself, if present, is skipped */
+		ss->total_blocks += chunk_header->chunk_sz;
+		sparse_stream_skip(ss, chunk_header->total_sz -
+				   sizeof(chunk_header_t),
+				   SPARSE_STREAM_CHUNK_END);
+		break;
+
+	default:
+		printf("%s: Unknown chunk type: %x\n", __func__,
+		       chunk_header->chunk_type);
+		return sparse_stream_fail(ss, "Unknown chunk type");
+	}
+
+	return 0;
+}
+
+int sparse_stream_init(struct sparse_stream *ss, struct sparse_storage *info)
+{
+	memset(ss, 0, sizeof(*ss));
+	ss->info = info;
+	ss->blk = info->start;
+	ss->state = SPARSE_STREAM_FILE_HDR;
+	ss->buf_size = ROUNDUP(CONFIG_FASTBOOT_FLASH_STREAM_BUF_SIZE,
+			       info->blksz);
+	ss->buf = memalign(ARCH_DMA_MINALIGN,
+			   ROUNDUP(ss->buf_size, ARCH_DMA_MINALIGN));
+	if (!ss->buf)
+		return -ENOMEM;
+
+	return 0;
+}
+
+int sparse_stream_write(struct sparse_stream *ss, const void *data,
+			unsigned int len)
+{
+	const char *p = data;
+	unsigned int n;
+	int ret = 0;
+
+	while (len && !ret) {
+		switch (ss->state) {
+		case SPARSE_STREAM_FILE_HDR:
+			if (!sparse_stream_collect(ss, &p, &len,
+						   sizeof(sparse_header_t)))
+				break;
+			if (!is_sparse_image(ss->hdr)) {
+				/* Plain image: write everything as-is */
+				ss->state = SPARSE_STREAM_IMAGE;
+				ret = sparse_stream_data(ss, (char *)ss->hdr,
+							 sizeof(sparse_header_t));
+				break;
 			}
-			blk += blks;
-			bytes_written += blkcnt * info->blksz;
-			total_blocks += chunk_header->chunk_sz;
-			data += chunk_data_sz;
+			ret = sparse_stream_file_header(ss);
 			break;
 
-		case CHUNK_TYPE_FILL:
-			if (chunk_header->total_sz !=
-			    (sparse_header->chunk_hdr_sz + sizeof(uint32_t))) {
-				fastboot_fail(
-					"Bogus chunk size for chunk type FILL", response);
-				return;
-			}
+		case SPARSE_STREAM_CHUNK_HDR:
+			if (!sparse_stream_collect(ss, &p, &len,
+						   sizeof(chunk_header_t)))
+				break;
+			ret = sparse_stream_chunk_header(ss);
+			break;
 
-			fill_buf = (uint32_t *)
-				   memalign(ARCH_DMA_MINALIGN,
-					    ROUNDUP(
-						info->blksz * fill_buf_num_blks,
-						ARCH_DMA_MINALIGN));
-			if (!fill_buf) {
-				fastboot_fail(
-					"Malloc failed for: CHUNK_TYPE_FILL", response);
-				return;
-			}
+		case SPARSE_STREAM_SKIP:
+			n = min(len, ss->skip);
+			p += n;
+			len -= n;
+			ss->skip -= n;
+			if (!ss->skip)
+				sparse_stream_enter(ss, ss->next);
+			break;
 
-			fill_val = *(uint32_t *)data;
-			data = (char *)data + sizeof(uint32_t);
-
-			for (i = 0;
-			     i < (info->blksz * fill_buf_num_blks /
-				  sizeof(fill_val));
-			     i++)
-				fill_buf[i] = fill_val;
-
-			if (blk + blkcnt > info->start + info->size) {
-				printf(
-				    "%s: Request would exceed partition size!\n",
-				    __func__);
-				fastboot_fail(
-				    "Request would exceed partition size!", response);
-				return;
-			}
+		case SPARSE_STREAM_RAW:
+			n = min_t(u64, len, ss->chunk_left);
+			ret = sparse_stream_data(ss, p, n);
+			if (ret)
+				break;
+			p += n;
+			len -= n;
+			ss->chunk_left -= n;
+			if (!ss->chunk_left)
+				sparse_stream_chunk_done(ss);
+			break;
 
-			for (i = 0; i < blkcnt;) {
-				j = blkcnt - i;
-				if (j > fill_buf_num_blks)
-					j = fill_buf_num_blks;
-				blks = info->write(info, blk, j, fill_buf);
-				/* blks might be > j (eg. NAND bad-blocks) */
-				if (blks < j) {
-					printf("%s: %s " LBAFU " [%d]\n",
-					       __func__,
-					       "Write failed, block #",
-					       blk, j);
-					fastboot_fail(
-						      "flash write failure", response);
-					free(fill_buf);
-					return;
-				}
-				blk += blks;
-				i += j;
-			}
-			bytes_written += blkcnt * info->blksz;
-			total_blocks += chunk_data_sz / sparse_header->blk_sz;
-			free(fill_buf);
+		case SPARSE_STREAM_FILL:
+			if (!sparse_stream_collect(ss, &p, &len,
+						   sizeof(uint32_t)))
+				break;
+			ret = sparse_stream_flush(ss);
+			if (ret)
+				break;
+			ret = sparse_stream_fill(ss, *(uint32_t *)ss->hdr,
+					lldiv((u64)ss->sparse_header.blk_sz *
+					      ss->chunk_header.chunk_sz,
+					      ss->info->blksz));
+			if (ret)
+				break;
+			ss->total_blocks += ss->chunk_header.chunk_sz;
+			sparse_stream_chunk_done(ss);
 			break;
 
-		case CHUNK_TYPE_DONT_CARE:
-			blk += info->reserve(info, blk, blkcnt);
-			total_blocks += chunk_header->chunk_sz;
+		case SPARSE_STREAM_IMAGE:
+			ret = sparse_stream_data(ss, p, len);
+			len = 0;
 			break;
 
-		case CHUNK_TYPE_CRC32:
-			if (chunk_header->total_sz !=
-			    sparse_header->chunk_hdr_sz) {
-				fastboot_fail(
-					"Bogus chunk size for chunk type Dont Care", response);
-				return;
-			}
-			total_blocks += chunk_header->chunk_sz;
-			data += chunk_data_sz;
+		case SPARSE_STREAM_DONE:
+			/* ignore trailing data */
+			len = 0;
 			break;
 
 		default:
-			printf("%s: Unknown chunk type: %x\n", __func__,
-			       chunk_header->chunk_type);
-			fastboot_fail("Unknown chunk type", response);
-			return;
+			return -EINVAL;
+		}
+	}
+
+	return ret;
+}
+
+void sparse_stream_abort(struct sparse_stream *ss)
+{
+	free(ss->buf);
+	free(ss->fill_buf);
+	ss->buf = NULL;
+	ss->fill_buf = NULL;
+}
+
+int sparse_stream_finish(struct sparse_stream *ss, const char *part_name,
+			 char *response)
+{
+	int ret;
+
+	if (ss->state != SPARSE_STREAM_ERROR) {
+		if (ss->state == SPARSE_STREAM_FILE_HDR && ss->hdr_len) {
+			/* short plain image */
+			ss->state = SPARSE_STREAM_IMAGE;
+			sparse_stream_data(ss, (char *)ss->hdr, ss->hdr_len);
 		}
+		sparse_stream_flush(ss);
+	}
+	sparse_stream_abort(ss);
+
+	if (ss->state == SPARSE_STREAM_ERROR) {
+		fastboot_fail(ss->error, response);
+		return -EIO;
+	}
+
+	if (ss->state == SPARSE_STREAM_IMAGE) {
+		printf("........ wrote %llu bytes to '%s'\n",
+		       ss->bytes_written, part_name);
+		fastboot_okay("", response);
+		return 0;
 	}
 
 	debug("Wrote %d blocks, expected to write %d blocks\n",
-	      total_blocks, sparse_header->total_blks);
-	printf("........ wrote %u bytes to '%s'\n", bytes_written, part_name);
+	      ss->total_blocks, ss->sparse_header.total_blks);
+	printf("........ wrote %llu bytes to '%s'\n", ss->bytes_written,
+	       part_name);
 
-	if (total_blocks != sparse_header->total_blks)
+	ret = 0;
+	if (ss->state != SPARSE_STREAM_DONE ||
+	    ss->total_blocks != ss->sparse_header.total_blks) {
 		fastboot_fail("sparse image write failure", response);
-	else
+		ret = -EIO;
+	} else {
 		fastboot_okay("", response);
+	}
+
+	return ret;
+}
+
+void write_sparse_image(
+		struct sparse_storage *info, const char *part_name,
+		void *data, unsigned sz, char *response)
+{
+	struct sparse_stream ss;
+
+	if (sparse_stream_init(&ss, info)) {
+		fastboot_fail("Malloc failed for sparse stream", response);
+		return;
+	}
 
-	return;
+	sparse_stream_write(&ss, data, sz);
+	sparse_stream_finish(&ss, part_name, response);
 }
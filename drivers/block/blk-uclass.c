@@ -446,25 +446,160 @@ int blk_get_device(int if_type, int devnum, struct udevice **devp)
 	return device_probe(*devp);
 }
 
+#if CONFIG_IS_ENABLED(BLK_ASYNC)
+#define BLK_ASYNC_DEPTH		CONFIG_BLK_ASYNC_QUEUE_DEPTH
+
+struct blk_async_req {
+	lbaint_t start;
+	lbaint_t blkcnt;
+	void *buffer;
+	long ret;		/* blocks read, or -ve error */
+};
+
+/*
+ * Per-device queue of reads from blk_dread_async(). Requests move through
+ * the queue in order: queued (issued..tail), started on the device
+ * (done..issued), finished but not yet waited for (head..done).
+ */
+struct blk_async_queue {
+	struct blk_async_req req[BLK_ASYNC_DEPTH];
+	int head;
+	int done;
+	int issued;
+	int tail;
+};
+
+static struct blk_async_req *blk_async_slot(struct blk_async_queue *q,
+					    int seq)
+{
+	return &q->req[seq % BLK_ASYNC_DEPTH];
+}
+
+/* Hand as many queued requests as the driver will take to the device */
+static void blk_async_issue(struct udevice *dev, struct blk_async_queue *q)
+{
+	const struct blk_ops *ops = blk_get_ops(dev);
+	struct blk_async_req *req;
+	int ret;
+
+	while (q->issued != q->tail) {
+		req = blk_async_slot(q, q->issued);
+		ret = -ENOSYS;
+		if (ops->read_async)
+			ret = ops->read_async(dev, req->start, req->blkcnt,
+					      req->buffer);
+		if (ret && q->done != q->issued)
+			return;	/* retry once the device is idle */
+		if (ret) {
+			debug("%s: sync read " LBAF "+" LBAFU ", ret=%d\n",
+			      __func__, req->start, req->blkcnt, ret);
+			req->ret = ops->read(dev, req->start, req->blkcnt,
+					     req->buffer);
+			q->done++;
+		}
+		q->issued++;
+	}
+}
+
+/* Complete started requests, up to (but not including) sequence @until */
+static void blk_async_reap(struct udevice *dev, struct blk_async_queue *q,
+			   int until)
+{
+	const struct blk_ops *ops = blk_get_ops(dev);
+	struct blk_async_req *req;
+
+	blk_async_issue(dev, q);
+	while (q->done < until) {
+		req = blk_async_slot(q, q->done);
+		req->ret = ops->read_complete(dev, true);
+		q->done++;
+		blk_async_issue(dev, q);
+	}
+}
+
+static void blk_async_drain(struct udevice *dev)
+{
+	struct blk_async_queue *q = dev_get_uclass_priv(dev);
+
+	if (q->done != q->tail)
+		blk_async_reap(dev, q, q->tail);
+}
+
+int blk_dread_async(struct blk_desc *block_dev, lbaint_t start,
+		    lbaint_t blkcnt, void *buffer)
+{
+	struct udevice *dev = block_dev->bdev;
+	const struct blk_ops *ops = blk_get_ops(dev);
+	struct blk_async_queue *q = dev_get_uclass_priv(dev);
+	struct blk_async_req *req;
+	int tag;
+
+	if (!ops->read)
+		return -ENOSYS;
+	if (q->tail - q->head >= BLK_ASYNC_DEPTH)
+		return -EBUSY;
+	if (q->head == q->tail)
+		q->head = q->done = q->issued = q->tail = 0;
+
+	tag = q->tail++;
+	req = blk_async_slot(q, tag);
+	req->start = start;
+	req->blkcnt = blkcnt;
+	req->buffer = buffer;
+	req->ret = 0;
+	blk_async_issue(dev, q);
+
+	return tag;
+}
+
+int blk_wait(struct blk_desc *block_dev, int tag)
+{
+	struct udevice *dev = block_dev->bdev;
+	struct blk_async_queue *q = dev_get_uclass_priv(dev);
+	struct blk_async_req *req;
+	int until = tag < 0 ? q->tail : tag + 1;
+	int ret = 0;
+
+	if (tag >= q->tail || (tag >= 0 && tag < q->head))
+		return -EINVAL;
+
+	blk_async_reap(dev, q, until);
+	for (; q->head < until; q->head++) {
+		req = blk_async_slot(q, q->head);
+		if (!ret && req->ret != req->blkcnt)
+			ret = IS_ERR_VALUE(req->ret) ? req->ret : -EIO;
+	}
+
+	return ret;
+}
+#else
+static inline void blk_async_drain(struct udevice *dev) {}
+#endif
+
 unsigned long blk_dread(struct blk_desc *block_dev, lbaint_t start,
 			lbaint_t blkcnt, void *buffer)
 {
 	struct udevice *dev = block_dev->bdev;
 	const struct blk_ops *ops = blk_get_ops(dev);
+	lbaint_t rd_start = start, rd_cnt = blkcnt;
+	void *rd_buf = buffer;
 	ulong blks_read;
 
 	if (!ops->read)
 		return -ENOSYS;
 
-	if (blkcache_read(block_dev->if_type, block_dev->devnum,
-			  start, blkcnt, block_dev->blksz, buffer))
+	blk_async_drain(dev);
+	if (blkcache_read_range(block_dev->if_type, block_dev->devnum,
+				&rd_start, &rd_cnt, block_dev->blksz, &rd_buf))
 		return blkcnt;
-	blks_read = ops->read(dev, start, blkcnt, buffer);
-	if (blks_read == blkcnt)
-		blkcache_fill(block_dev->if_type, block_dev->devnum,
-			      start, blkcnt, block_dev->blksz, buffer);
+	blks_read = ops->read(dev, rd_start, rd_cnt, rd_buf);
+	if (blks_read != rd_cnt)
+		return blks_read;
 
-	return blks_read;
+	blkcache_fill(block_dev->if_type, block_dev->devnum,
+		      rd_start, rd_cnt, block_dev->blksz, rd_buf);
+
+	return blkcnt;
 }
 
 unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
@@ -476,7 +611,10 @@ unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 	if (!ops->write)
 		return -ENOSYS;
 
-	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	blk_async_drain(dev);
+	blkcache_invalidate_range(block_dev->if_type, block_dev->devnum,
+				  start, blkcnt);
+	block_dev->write_seq++;
 	return ops->write(dev, start, blkcnt, buffer);
 }
 
@@ -489,7 +627,10 @@ unsigned long blk_derase(struct blk_desc *block_dev, lbaint_t start,
 	if (!ops->erase)
 		return -ENOSYS;
 
-	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	blk_async_drain(dev);
+	blkcache_invalidate_range(block_dev->if_type, block_dev->devnum,
+				  start, blkcnt);
+	block_dev->write_seq++;
 	return ops->erase(dev, start, blkcnt);
 }
 
@@ -680,4 +821,7 @@ UCLASS_DRIVER(blk) = {
 	.id		= UCLASS_BLK,
 	.name		= "blk",
 	.per_device_platdata_auto_alloc_size = sizeof(struct blk_desc),
+#if CONFIG_IS_ENABLED(BLK_ASYNC)
+	.per_device_auto_alloc_size = sizeof(struct blk_async_queue),
+#endif
 };
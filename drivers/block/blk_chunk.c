@@ -0,0 +1,119 @@
+/*
+ * (C) Copyright 2026 Rockchip Electronics Co., Ltd
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <malloc.h>
+
+/* Blocks of @c which are read straight into its buffer */
+static lbaint_t blk_chunk_whole(struct blk_desc *desc,
+				const struct blk_chunk *c)
+{
+	return c->len / desc->blksz;
+}
+
+/*
+ * Read the partial block at the end of @c, if any, through @bounce so that
+ * nothing past @c->len is written. @bounce is allocated on first use.
+ */
+static int blk_chunk_read_tail(struct blk_desc *desc,
+			       const struct blk_chunk *c, void **bounce)
+{
+	lbaint_t whole = blk_chunk_whole(desc, c);
+	ulong done = whole * desc->blksz;
+
+	if (done == c->len)
+		return 0;
+
+	if (!*bounce) {
+		*bounce = memalign(ARCH_DMA_MINALIGN, desc->blksz);
+		if (!*bounce)
+			return -ENOMEM;
+	}
+	if (blk_dread(desc, c->start + whole, 1, *bounce) != 1)
+		return -EIO;
+	memcpy(c->buf + done, *bounce, c->len - done);
+
+	return 0;
+}
+
+static int blk_chunk_read(struct blk_desc *desc, const struct blk_chunk *c,
+			  void **bounce)
+{
+	lbaint_t whole = blk_chunk_whole(desc, c);
+
+	if (whole && blk_dread(desc, c->start, whole, c->buf) != whole)
+		return -EIO;
+
+	return blk_chunk_read_tail(desc, c, bounce);
+}
+
+int blk_read_chunks(struct blk_desc *block_dev,
+		    int (*plan)(void *priv, const struct blk_chunk *prev,
+				struct blk_chunk *next),
+		    int (*done)(void *priv, const struct blk_chunk *chunk),
+		    void *priv)
+{
+	struct blk_chunk cur, next;
+	void *bounce = NULL;
+	lbaint_t whole;
+	int tag, ret;
+
+	ret = plan(priv, NULL, &cur);
+	if (!ret && cur.blkcnt)
+		ret = blk_chunk_read(block_dev, &cur, &bounce);
+
+	while (!ret && cur.blkcnt) {
+		ret = plan(priv, &cur, &next);
+		if (ret)
+			break;
+
+		tag = -1;
+		whole = next.blkcnt ? blk_chunk_whole(block_dev, &next) : 0;
+		if (whole)
+			tag = blk_dread_async(block_dev, next.start, whole,
+					      next.buf);
+
+		ret = done(priv, &cur);
+		if (ret) {
+			if (tag >= 0)
+				blk_wait(block_dev, tag);
+			break;
+		}
+
+		/*
+		 * Wait for the queued blocks, then read the partial one. If
+		 * the queue was full or cannot be used, read it all now.
+		 */
+		if (next.blkcnt) {
+			if (tag >= 0)
+				ret = blk_wait(block_dev, tag) ?:
+				      blk_chunk_read_tail(block_dev, &next,
+							  &bounce);
+			else
+				ret = blk_chunk_read(block_dev, &next, &bounce);
+		}
+		cur = next;
+	}
+	free(bounce);
+
+	return ret;
+}
+
+int blk_chunk_plan_range(void *priv, const struct blk_chunk *prev,
+			 struct blk_chunk *next)
+{
+	struct blk_chunk_range *r = priv;
+	ulong blksz = r->desc->blksz;
+	ulong pos = prev ? (prev->start - r->start) * blksz + prev->len : 0;
+
+	next->start = r->start + pos / blksz;
+	next->buf = r->buf + pos;
+	next->len = min(r->chunk, r->size - pos);
+	next->blkcnt = DIV_ROUND_UP(next->len, blksz);
+
+	return 0;
+}
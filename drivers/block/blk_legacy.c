@@ -247,6 +247,7 @@ ulong blk_write_devnum(enum if_type if_type, int devnum, lbaint_t start,
 	ret = get_desc(drv, devnum, &desc);
 	if (ret)
 		return ret;
+	desc->write_seq++;
 	return desc->block_write(desc, start, blkcnt, buffer);
 }
 
@@ -7,40 +7,115 @@
  */
 #include <config.h>
 #include <common.h>
+#include <errno.h>
 #include <malloc.h>
+#include <memalign.h>
 #include <part.h>
 #include <linux/ctype.h>
 #include <linux/list.h>
 
+/*
+ * The cache is organised in lines of BLKCACHE_LINE_BLOCKS blocks, aligned
+ * on the line size. Each line keeps a bitmap of the blocks it holds, so a
+ * read that only partly overlaps cached data can still be served from the
+ * cache for its leading and trailing blocks.
+ *
+ * Lines are found through a hash of (device, line LBA) and are evicted in
+ * LRU order once the cached data exceeds the configured byte budget.
+ * Evicted lines are kept on a slab free list and recycled by later fills
+ * with the same line size, instead of going back to malloc every time.
+ */
+#define BLKCACHE_LINE_SHIFT	3
+#define BLKCACHE_LINE_BLOCKS	(1 << BLKCACHE_LINE_SHIFT)
+#define BLKCACHE_LINE_MASK	(BLKCACHE_LINE_BLOCKS - 1)
+#define BLKCACHE_LINE_FULL	((1U << BLKCACHE_LINE_BLOCKS) - 1)
+#define BLKCACHE_HASH_BITS	6
+#define BLKCACHE_HASH_SIZE	(1 << BLKCACHE_HASH_BITS)
+
 struct block_cache_node {
-	struct list_head lh;
+	struct list_head lh;		/* LRU list, or slab free list */
+	struct list_head hash;		/* hash bucket chain */
 	int iftype;
 	int devnum;
-	lbaint_t start;
-	lbaint_t blkcnt;
+	lbaint_t start;			/* first block of the line */
 	unsigned long blksz;
+	unsigned int valid;		/* bitmap of valid blocks */
 	char *cache;
 };
 
+struct block_cache_dev {
+	struct list_head lh;
+	struct block_cache_dev_stats stats;
+};
+
 static LIST_HEAD(block_cache);
+static LIST_HEAD(block_cache_free);
+static LIST_HEAD(block_cache_devs);
+static struct list_head block_cache_hash[BLKCACHE_HASH_SIZE];
+static bool block_cache_ready;
 
 static struct block_cache_stats _stats = {
-	.max_blocks_per_entry = 2,
-	.max_entries = 32
+	.max_blocks_per_entry = CONFIG_BLOCK_CACHE_MAX_BLOCKS,
+	.max_bytes = CONFIG_BLOCK_CACHE_SIZE,
 };
 
+static void cache_init(void)
+{
+	int i;
+
+	if (block_cache_ready)
+		return;
+
+	for (i = 0; i < BLKCACHE_HASH_SIZE; i++)
+		INIT_LIST_HEAD(&block_cache_hash[i]);
+	block_cache_ready = true;
+}
+
+static inline unsigned int cache_hash(int iftype, int devnum, lbaint_t start)
+{
+	ulong key = (ulong)(start >> BLKCACHE_LINE_SHIFT);
+
+	key ^= (ulong)devnum * 0x9e3779b1UL;
+	key ^= (ulong)iftype << 16;
+	key ^= key >> BLKCACHE_HASH_BITS;
+	key ^= key >> (2 * BLKCACHE_HASH_BITS);
+
+	return key & (BLKCACHE_HASH_SIZE - 1);
+}
+
+static struct block_cache_dev_stats *cache_dev_stats(int iftype, int devnum)
+{
+	struct block_cache_dev *dev;
+
+	list_for_each_entry(dev, &block_cache_devs, lh)
+		if (dev->stats.iftype == iftype && dev->stats.devnum == devnum)
+			return &dev->stats;
+
+	dev = calloc(1, sizeof(*dev));
+	if (!dev)
+		return NULL;
+
+	dev->stats.iftype = iftype;
+	dev->stats.devnum = devnum;
+	list_add_tail(&dev->lh, &block_cache_devs);
+
+	return &dev->stats;
+}
+
 static struct block_cache_node *cache_find(int iftype, int devnum,
-					   lbaint_t start, lbaint_t blkcnt,
-					   unsigned long blksz)
+					   lbaint_t start, unsigned long blksz)
 {
 	struct block_cache_node *node;
+	struct list_head *bucket;
 
-	list_for_each_entry(node, &block_cache, lh)
-		if ((node->iftype == iftype) &&
+	start &= ~(lbaint_t)BLKCACHE_LINE_MASK;
+	bucket = &block_cache_hash[cache_hash(iftype, devnum, start)];
+
+	list_for_each_entry(node, bucket, hash)
+		if ((node->start == start) &&
 		    (node->devnum == devnum) &&
-		    (node->blksz == blksz) &&
-		    (node->start <= start) &&
-		    (node->start + node->blkcnt >= start + blkcnt)) {
+		    (node->iftype == iftype) &&
+		    (node->blksz == blksz)) {
 			if (block_cache.next != &node->lh) {
 				/* maintain MRU ordering */
 				list_del(&node->lh);
@@ -48,126 +123,305 @@ static struct block_cache_node *cache_find(int iftype, int devnum,
 			}
 			return node;
 		}
-	return 0;
+	return NULL;
 }
 
-int blkcache_read(int iftype, int devnum,
-		  lbaint_t start, lbaint_t blkcnt,
-		  unsigned long blksz, void *buffer)
+/* Release one line back to the slab free list */
+static void cache_drop(struct block_cache_node *node)
+{
+	list_del(&node->hash);
+	list_del(&node->lh);
+	list_add(&node->lh, &block_cache_free);
+	_stats.entries--;
+	_stats.bytes -= node->blksz << BLKCACHE_LINE_SHIFT;
+	_stats.slab_bytes += node->blksz << BLKCACHE_LINE_SHIFT;
+}
+
+/* Hand free-list lines back to malloc until we are within @budget */
+static void cache_shrink_free(unsigned long budget)
+{
+	struct block_cache_node *node;
+
+	while (!list_empty(&block_cache_free) &&
+	       _stats.bytes + _stats.slab_bytes > budget) {
+		node = list_last_entry(&block_cache_free,
+				       struct block_cache_node, lh);
+		list_del(&node->lh);
+		_stats.slab_bytes -= node->blksz << BLKCACHE_LINE_SHIFT;
+		free(node->cache);
+		free(node);
+	}
+}
+
+static struct block_cache_node *cache_alloc(unsigned long blksz)
+{
+	unsigned long bytes = blksz << BLKCACHE_LINE_SHIFT;
+	struct block_cache_node *node;
+
+	if (bytes > _stats.max_bytes)
+		return NULL;
+
+	/* pop LRU lines until the new line fits in the budget */
+	while (_stats.bytes + bytes > _stats.max_bytes &&
+	       !list_empty(&block_cache)) {
+		node = list_last_entry(&block_cache, struct block_cache_node,
+				       lh);
+		debug("drop: start " LBAF ", valid %x\n",
+		      node->start, node->valid);
+		cache_drop(node);
+		_stats.evictions++;
+	}
+
+	/* recycle a line of the same size from the slab */
+	list_for_each_entry(node, &block_cache_free, lh)
+		if (node->blksz == blksz) {
+			list_del(&node->lh);
+			_stats.slab_bytes -= bytes;
+			goto out;
+		}
+
+	cache_shrink_free(_stats.max_bytes - bytes);
+
+	node = malloc(sizeof(*node));
+	if (!node)
+		return NULL;
+	node->cache = malloc_cache_aligned(bytes);
+	if (!node->cache) {
+		free(node);
+		return NULL;
+	}
+	node->blksz = blksz;
+out:
+	_stats.bytes += bytes;
+	_stats.entries++;
+
+	return node;
+}
+
+/*
+ * Copy the run of valid blocks at the head (@tail == false) or the tail
+ * (@tail == true) of the range out of the cache. Returns the number of
+ * blocks copied.
+ */
+static lbaint_t cache_copy_run(int iftype, int devnum, lbaint_t start,
+			       lbaint_t blkcnt, unsigned long blksz,
+			       char *buffer, bool tail)
 {
-	struct block_cache_node *node = cache_find(iftype, devnum, start,
-						   blkcnt, blksz);
-	if (node) {
-		const char *src = node->cache + (start - node->start) * blksz;
-		memcpy(buffer, src, blksz * blkcnt);
+	struct block_cache_node *node = NULL;
+	lbaint_t done = 0;
+	lbaint_t blk;
+	unsigned int bit;
+
+	while (done < blkcnt) {
+		blk = tail ? start + blkcnt - 1 - done : start + done;
+		if (!node ||
+		    node->start != (blk & ~(lbaint_t)BLKCACHE_LINE_MASK))
+			node = cache_find(iftype, devnum, blk, blksz);
+		if (!node)
+			break;
+
+		bit = blk & BLKCACHE_LINE_MASK;
+		if (!(node->valid & (1U << bit)))
+			break;
+
+		memcpy(buffer + (blk - start) * blksz,
+		       node->cache + bit * blksz, blksz);
+		done++;
+	}
+
+	return done;
+}
+
+int blkcache_read_range(int iftype, int devnum,
+			lbaint_t *start, lbaint_t *blkcnt,
+			unsigned long blksz, void **buffer)
+{
+	struct block_cache_dev_stats *dev;
+	lbaint_t head, tail;
+
+	if (!block_cache_ready || !_stats.entries)
+		goto miss;
+
+	head = cache_copy_run(iftype, devnum, *start, *blkcnt, blksz,
+			      *buffer, false);
+	if (head == *blkcnt) {
 		debug("hit: start " LBAF ", count " LBAFU "\n",
-		      start, blkcnt);
+		      *start, *blkcnt);
 		++_stats.hits;
+		dev = cache_dev_stats(iftype, devnum);
+		if (dev)
+			++dev->hits;
+		*blkcnt = 0;
 		return 1;
 	}
 
+	tail = cache_copy_run(iftype, devnum, *start + head, *blkcnt - head,
+			      blksz, (char *)*buffer + head * blksz, true);
+	if (head || tail) {
+		debug("partial: start " LBAF ", count " LBAFU
+		      ", head " LBAFU ", tail " LBAFU "\n",
+		      *start, *blkcnt, head, tail);
+		++_stats.partial_hits;
+		dev = cache_dev_stats(iftype, devnum);
+		if (dev)
+			++dev->partial_hits;
+		*start += head;
+		*blkcnt -= head + tail;
+		*buffer = (char *)*buffer + head * blksz;
+		return 0;
+	}
+
+miss:
 	debug("miss: start " LBAF ", count " LBAFU "\n",
-	      start, blkcnt);
+	      *start, *blkcnt);
 	++_stats.misses;
+	dev = cache_dev_stats(iftype, devnum);
+	if (dev)
+		++dev->misses;
 	return 0;
 }
 
+int blkcache_read(int iftype, int devnum,
+		  lbaint_t start, lbaint_t blkcnt,
+		  unsigned long blksz, void *buffer)
+{
+	void *buf = buffer;
+
+	return blkcache_read_range(iftype, devnum, &start, &blkcnt, blksz,
+				   &buf);
+}
+
 void blkcache_fill(int iftype, int devnum,
 		   lbaint_t start, lbaint_t blkcnt,
 		   unsigned long blksz, void const *buffer)
 {
-	lbaint_t bytes;
 	struct block_cache_node *node;
+	const char *src = buffer;
+	lbaint_t line, end;
+	unsigned int first, last, mask;
 
 	/* don't cache big stuff */
 	if (blkcnt > _stats.max_blocks_per_entry)
 		return;
 
-	if (_stats.max_entries == 0)
+	if (!_stats.max_bytes || !blkcnt)
 		return;
 
-	bytes = blksz * blkcnt;
-	if (_stats.max_entries <= _stats.entries) {
-		/* pop LRU */
-		node = (struct block_cache_node *)block_cache.prev;
-		list_del(&node->lh);
-		_stats.entries--;
-		debug("drop: start " LBAF ", count " LBAFU "\n",
-		      node->start, node->blkcnt);
-		if (node->blkcnt * node->blksz < bytes) {
-			free(node->cache);
-			node->cache = 0;
-		}
-	} else {
-		node = malloc(sizeof(*node));
-		if (!node)
-			return;
-		node->cache = 0;
-	}
-
-	if (!node->cache) {
-		node->cache = malloc(bytes);
-		if (!node->cache) {
-			free(node);
-			return;
-		}
-	}
+	cache_init();
 
 	debug("fill: start " LBAF ", count " LBAFU "\n",
 	      start, blkcnt);
 
-	node->iftype = iftype;
-	node->devnum = devnum;
-	node->start = start;
-	node->blkcnt = blkcnt;
-	node->blksz = blksz;
-	memcpy(node->cache, buffer, bytes);
-	list_add(&node->lh, &block_cache);
-	_stats.entries++;
+	end = start + blkcnt;
+	for (line = start & ~(lbaint_t)BLKCACHE_LINE_MASK; line < end;
+	     line += BLKCACHE_LINE_BLOCKS) {
+		first = max(start, line) - line;
+		last = min(end, line + BLKCACHE_LINE_BLOCKS) - line;
+		mask = (BLKCACHE_LINE_FULL >> (BLKCACHE_LINE_BLOCKS - last)) &
+		       ~((1U << first) - 1);
+
+		node = cache_find(iftype, devnum, line, blksz);
+		if (!node) {
+			node = cache_alloc(blksz);
+			if (!node)
+				return;
+			node->iftype = iftype;
+			node->devnum = devnum;
+			node->start = line;
+			node->valid = 0;
+			list_add(&node->lh, &block_cache);
+			list_add(&node->hash,
+				 &block_cache_hash[cache_hash(iftype, devnum,
+							      line)]);
+		}
+
+		memcpy(node->cache + first * blksz,
+		       src + (line + first - start) * blksz,
+		       (last - first) * blksz);
+		node->valid |= mask;
+	}
 }
 
 void blkcache_invalidate(int iftype, int devnum)
 {
-	struct list_head *entry, *n;
-	struct block_cache_node *node;
+	struct block_cache_node *node, *n;
 
-	list_for_each_safe(entry, n, &block_cache) {
-		node = (struct block_cache_node *)entry;
+	list_for_each_entry_safe(node, n, &block_cache, lh)
 		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum)) {
-			list_del(entry);
-			free(node->cache);
-			free(node);
-			--_stats.entries;
-		}
-	}
+		    (node->devnum == devnum))
+			cache_drop(node);
 }
 
-void blkcache_configure(unsigned blocks, unsigned entries)
+void blkcache_invalidate_range(int iftype, int devnum,
+			       lbaint_t start, lbaint_t blkcnt)
+{
+	struct block_cache_node *node, *n;
+	lbaint_t end = start + blkcnt;
+
+	list_for_each_entry_safe(node, n, &block_cache, lh)
+		if ((node->iftype == iftype) &&
+		    (node->devnum == devnum) &&
+		    (node->start < end) &&
+		    (node->start + BLKCACHE_LINE_BLOCKS > start))
+			cache_drop(node);
+}
+
+void blkcache_configure(unsigned blocks, unsigned long max_bytes)
 {
 	struct block_cache_node *node;
+	struct block_cache_dev *dev, *n;
+
 	if ((blocks != _stats.max_blocks_per_entry) ||
-	    (entries != _stats.max_entries)) {
+	    (max_bytes != _stats.max_bytes)) {
 		/* invalidate cache */
 		while (!list_empty(&block_cache)) {
-			node = (struct block_cache_node *)block_cache.next;
-			list_del(&node->lh);
-			free(node->cache);
-			free(node);
+			node = list_first_entry(&block_cache,
+						struct block_cache_node, lh);
+			cache_drop(node);
 		}
-		_stats.entries = 0;
+		cache_shrink_free(0);
 	}
 
 	_stats.max_blocks_per_entry = blocks;
-	_stats.max_entries = entries;
+	_stats.max_bytes = max_bytes;
 
 	_stats.hits = 0;
+	_stats.partial_hits = 0;
 	_stats.misses = 0;
+	_stats.evictions = 0;
+
+	list_for_each_entry_safe(dev, n, &block_cache_devs, lh) {
+		list_del(&dev->lh);
+		free(dev);
+	}
 }
 
 void blkcache_stats(struct block_cache_stats *stats)
 {
+	struct block_cache_dev *dev;
+
 	memcpy(stats, &_stats, sizeof(*stats));
 	_stats.hits = 0;
+	_stats.partial_hits = 0;
 	_stats.misses = 0;
+	_stats.evictions = 0;
+
+	list_for_each_entry(dev, &block_cache_devs, lh) {
+		dev->stats.hits = 0;
+		dev->stats.partial_hits = 0;
+		dev->stats.misses = 0;
+	}
+}
+
+int blkcache_dev_stats(int idx, struct block_cache_dev_stats *stats)
+{
+	struct block_cache_dev *dev;
+
+	list_for_each_entry(dev, &block_cache_devs, lh)
+		if (!idx--) {
+			memcpy(stats, &dev->stats, sizeof(*stats));
+			return 0;
+		}
+
+	return -ENOENT;
 }
@@ -217,10 +217,55 @@ int host_get_dev_err(int devnum, struct blk_desc **blk_devp)
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(BLK_ASYNC)
+/*
+ * Emulate a controller with a two-entry command queue: reads are queued
+ * here and only transferred from the backing file when they complete.
+ */
+static int host_block_read_async(struct udevice *dev, lbaint_t start,
+				 lbaint_t blkcnt, void *buffer)
+{
+	struct host_block_dev *host_dev = dev_get_priv(dev);
+	struct host_block_req *req;
+
+	if (host_dev->req_count == ARRAY_SIZE(host_dev->req))
+		return -EBUSY;
+
+	req = &host_dev->req[(host_dev->req_head + host_dev->req_count) %
+			     ARRAY_SIZE(host_dev->req)];
+	req->start = start;
+	req->blkcnt = blkcnt;
+	req->buffer = buffer;
+	host_dev->req_count++;
+
+	return 0;
+}
+
+static long host_block_read_complete(struct udevice *dev, bool wait)
+{
+	struct host_block_dev *host_dev = dev_get_priv(dev);
+	struct host_block_req *req;
+
+	if (!host_dev->req_count)
+		return -ENOENT;
+
+	req = &host_dev->req[host_dev->req_head];
+	host_dev->req_head = (host_dev->req_head + 1) %
+			     ARRAY_SIZE(host_dev->req);
+	host_dev->req_count--;
+
+	return host_block_read(dev, req->start, req->blkcnt, req->buffer);
+}
+#endif
+
 #ifdef CONFIG_BLK
 static const struct blk_ops sandbox_host_blk_ops = {
 	.read	= host_block_read,
 	.write	= host_block_write,
+#if CONFIG_IS_ENABLED(BLK_ASYNC)
+	.read_async	= host_block_read_async,
+	.read_complete	= host_block_read_complete,
+#endif
 };
 
 U_BOOT_DRIVER(sandbox_host_blk) = {
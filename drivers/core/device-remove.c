@@ -14,6 +14,7 @@
 #include <malloc.h>
 #include <dm/device.h>
 #include <dm/device-internal.h>
+#include <dm/root.h>
 #include <dm/uclass.h>
 #include <dm/uclass-internal.h>
 #include <dm/util.h>
@@ -92,6 +93,8 @@ int device_unbind(struct udevice *dev)
 	if (ret)
 		return ret;
 
+	dm_lazy_drop(dev);
+
 	if (dev->flags & DM_FLAG_ALLOC_PDATA) {
 		free(dev->platdata);
 		dev->platdata = NULL;
@@ -22,6 +22,7 @@
 #include <dm/pinctrl.h>
 #include <dm/platdata.h>
 #include <dm/read.h>
+#include <dm/root.h>
 #include <dm/uclass.h>
 #include <dm/uclass-internal.h>
 #include <dm/util.h>
@@ -45,7 +46,7 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 	if (!name)
 		return -EINVAL;
 
-	ret = uclass_get(drv->id, &uc);
+	ret = uclass_get_nolazy(drv->id, &uc);
 	if (ret) {
 		debug("Missing uclass for driver %s\n", drv->name);
 		return ret;
@@ -77,7 +78,7 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 					 * everything seems fine with or without
 					 * this. Maybe removed in the future.
 					 */
-					dev->node = node;
+					dev_set_ofnode(dev, node);
 					return 0;
 				}
 			}
@@ -101,6 +102,7 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 					/* stay in dm tree, in order to handle exclusion */
 				} else {
 					list_del_init(&dev->uclass_node);
+					dm_node_index_del(dev);
 				}
 			}
 		}
@@ -359,6 +361,15 @@ int device_bind_by_name(struct udevice *parent, bool pre_reloc_only,
 			devp);
 }
 
+#if CONFIG_IS_ENABLED(DM_NODE_INDEX)
+void dev_set_ofnode(struct udevice *dev, ofnode node)
+{
+	dm_node_index_del(dev);
+	dev->node = node;
+	dm_node_index_add(dev);
+}
+#endif
+
 static void *alloc_priv(int size, uint flags)
 {
 	void *priv;
@@ -403,22 +414,18 @@ static void *alloc_priv(int size, uint flags)
 	return priv;
 }
 
-int device_probe(struct udevice *dev)
+static int device_do_probe(struct udevice *dev)
 {
 	const struct driver *drv;
 	int size = 0;
 	int ret;
 	int seq;
 
-	if (!dev)
-		return -EINVAL;
-
-	if (dev->flags & DM_FLAG_ACTIVATED)
-		return 0;
-
 	drv = dev->driver;
 	assert(drv);
 
+	dm_lazy_bind_children(dev);
+
 	/* Allocate private data if requested and not reentered */
 	if (drv->priv_auto_alloc_size && !dev->priv) {
 		dev->priv = alloc_priv(drv->priv_auto_alloc_size, drv->flags);
@@ -530,6 +537,24 @@ fail:
 	return ret;
 }
 
+int device_probe(struct udevice *dev)
+{
+	int prof;
+	int ret;
+
+	if (!dev)
+		return -EINVAL;
+
+	if (dev->flags & DM_FLAG_ACTIVATED)
+		return 0;
+
+	prof = bootstage_prof_start(dev->name, device_get_uclass_id(dev));
+	ret = device_do_probe(dev);
+	bootstage_prof_end(prof);
+
+	return ret;
+}
+
 void *dev_get_platdata(struct udevice *dev)
 {
 	if (!dev) {
@@ -609,6 +634,7 @@ int device_get_child(struct udevice *parent, int index, struct udevice **devp)
 {
 	struct udevice *dev;
 
+	dm_lazy_bind_children(parent);
 	list_for_each_entry(dev, &parent->child_head, sibling_node) {
 		if (!index--)
 			return device_get_device_tail(dev, 0, devp);
@@ -626,6 +652,7 @@ int device_find_child_by_seq(struct udevice *parent, int seq_or_req_seq,
 	if (seq_or_req_seq == -1)
 		return -ENODEV;
 
+	dm_lazy_bind_children(parent);
 	list_for_each_entry(dev, &parent->child_head, sibling_node) {
 		if ((find_req_seq ? dev->req_seq : dev->seq) ==
 				seq_or_req_seq) {
@@ -662,6 +689,7 @@ int device_find_child_by_of_offset(struct udevice *parent, int of_offset,
 
 	*devp = NULL;
 
+	dm_lazy_bind_children(parent);
 	list_for_each_entry(dev, &parent->child_head, sibling_node) {
 		if (dev_of_offset(dev) == of_offset) {
 			*devp = dev;
@@ -691,6 +719,7 @@ static struct udevice *_device_find_global_by_of_offset(struct udevice *parent,
 	if (dev_of_offset(parent) == of_offset)
 		return parent;
 
+	dm_lazy_bind_children(parent);
 	list_for_each_entry(dev, &parent->child_head, sibling_node) {
 		found = _device_find_global_by_of_offset(dev, of_offset);
 		if (found)
@@ -710,6 +739,8 @@ int device_get_global_by_of_offset(int of_offset, struct udevice **devp)
 
 int device_find_first_child(struct udevice *parent, struct udevice **devp)
 {
+	/* With DM_LAZY_BIND, children not bound yet are still children */
+	dm_lazy_bind_children(parent);
 	if (list_empty(&parent->child_head)) {
 		*devp = NULL;
 	} else {
@@ -768,6 +799,8 @@ const char *dev_get_uclass_name(struct udevice *dev)
 
 bool device_has_children(struct udevice *dev)
 {
+	dm_lazy_bind_children(dev);
+
 	return !list_empty(&dev->child_head);
 }
 
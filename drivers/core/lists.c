@@ -16,7 +16,11 @@
 #include <dm/uclass.h>
 #include <dm/util.h>
 #include <fdtdec.h>
+#include <malloc.h>
 #include <linux/compiler.h>
+#include <linux/log2.h>
+
+DECLARE_GLOBAL_DATA_PTR;
 
 struct driver *lists_driver_lookup_name(const char *name)
 {
@@ -123,11 +127,234 @@ static int driver_check_compatible(const struct udevice_id *of_match,
 	return -ENOENT;
 }
 
+#if CONFIG_IS_ENABLED(DM_COMPAT_INDEX)
+/**
+ * struct compat_entry - one compatible string of a driver
+ *
+ * @hash:	Hash of the string
+ * @drv:	Index of the driver in the driver linker list
+ * @id:		Index of the string in the driver's of_match table
+ * @next:	Next entry in the same bucket, -1 at the end
+ */
+struct compat_entry {
+	u32 hash;
+	u16 drv;
+	u16 id;
+	int next;
+};
+
+/**
+ * struct compat_index - hash table of all driver compatible strings
+ *
+ * Each bucket lists its entries in linker list order, so the first match
+ * is the driver a scan over all drivers would have found.
+ *
+ * @drivers:	Driver linker list the index was built from
+ * @early:	true if allocated before the full malloc() was up, so that it
+ *		must not be freed
+ * @mask:	Number of buckets - 1
+ * @bucket:	First entry of each bucket, -1 if empty
+ * @entry:	All compatible strings
+ */
+struct compat_index {
+	struct driver *drivers;
+	bool early;
+	u32 mask;
+	int *bucket;
+	struct compat_entry entry[];
+};
+
+/* Set before relocation too, when BSS is not available */
+static struct compat_index *compat_index __attribute__((section(".data")));
+
+static u32 compat_hash(const char *str)
+{
+	u32 hash = 5381;
+
+	while (*str)
+		hash = hash * 33 + (unsigned char)*str++;
+
+	return hash;
+}
+
+/*
+ * Before the full malloc() is up, the index comes from the early malloc()
+ * heap, which is never given back. Only take it from there if it leaves
+ * most of that heap to the devices.
+ */
+static bool compat_index_fits_early(size_t size)
+{
+#if CONFIG_VAL(SYS_MALLOC_F_LEN)
+	return size <= (gd->malloc_limit - gd->malloc_ptr) / 4;
+#else
+	return false;
+#endif
+}
+
+/*
+ * The index is built on first use, and again if the driver list has moved
+ * since (i.e. after relocation). If there is no memory for it, binding
+ * falls back to the linear scan.
+ */
+static struct compat_index *compat_index_get(struct driver *driver,
+					     int n_ents)
+{
+	const struct udevice_id *of_match;
+	struct compat_index *idx;
+	struct compat_entry *ent;
+	struct driver *entry;
+	int count = 0, n, j;
+	u32 buckets, b;
+	size_t size;
+	bool early;
+
+	if (n_ents > U16_MAX)
+		return NULL;
+
+	if (compat_index && compat_index->drivers == driver)
+		return compat_index;
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (of_match = entry->of_match;
+		     of_match && of_match->compatible; of_match++)
+			count++;
+	}
+
+	buckets = roundup_pow_of_two(max(count, 1));
+	size = sizeof(*idx) + count * sizeof(*ent) + buckets * sizeof(int);
+	early = !(gd->flags & GD_FLG_FULL_MALLOC_INIT);
+	if (early && !compat_index_fits_early(size))
+		return NULL;
+
+	idx = malloc(size);
+	if (!idx)
+		return NULL;
+
+	idx->drivers = driver;
+	idx->early = early;
+	idx->mask = buckets - 1;
+	idx->bucket = (int *)&idx->entry[count];
+	for (b = 0; b < buckets; b++)
+		idx->bucket[b] = -1;
+
+	/* Fill backwards and push to the front to keep linker list order */
+	n = count;
+	for (entry = driver + n_ents; entry != driver;) {
+		of_match = (--entry)->of_match;
+		if (!of_match)
+			continue;
+
+		for (j = 0; of_match[j].compatible; j++)
+			;
+		while (--j >= 0) {
+			ent = &idx->entry[--n];
+			ent->hash = compat_hash(of_match[j].compatible);
+			ent->drv = entry - driver;
+			ent->id = j;
+			b = ent->hash & idx->mask;
+			ent->next = idx->bucket[b];
+			idx->bucket[b] = n;
+		}
+	}
+
+	if (compat_index && !compat_index->early)
+		free(compat_index);
+	compat_index = idx;
+	pr_debug("compat index: %d strings, %u buckets\n", count, buckets);
+
+	return idx;
+}
+
+static struct driver *compat_index_find(struct compat_index *idx,
+					const char *compat,
+					const struct udevice_id **of_idp)
+{
+	const struct udevice_id *id;
+	struct compat_entry *ent;
+	u32 hash = compat_hash(compat);
+	int i;
+
+	for (i = idx->bucket[hash & idx->mask]; i >= 0; i = ent->next) {
+		ent = &idx->entry[i];
+		if (ent->hash != hash)
+			continue;
+
+		id = &idx->drivers[ent->drv].of_match[ent->id];
+		if (!strcmp(id->compatible, compat)) {
+			*of_idp = id;
+			return &idx->drivers[ent->drv];
+		}
+	}
+
+	return NULL;
+}
+#else
+static inline struct compat_index *compat_index_get(struct driver *driver,
+						    int n_ents)
+{
+	return NULL;
+}
+
+static inline struct driver *compat_index_find(struct compat_index *idx,
+					       const char *compat,
+					       const struct udevice_id **of_idp)
+{
+	return NULL;
+}
+#endif
+
+/* Find the driver matching one compatible string, via the index if any */
+static struct driver *lists_match_compat(struct compat_index *index,
+					 struct driver *driver, int n_ents,
+					 const char *compat,
+					 const struct udevice_id **idp)
+{
+	struct driver *entry;
+
+	if (index)
+		return compat_index_find(index, compat, idp);
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		if (!driver_check_compatible(entry->of_match, idp, compat))
+			return entry;
+	}
+
+	return NULL;
+}
+
+int lists_fdt_uclass(ofnode node, enum uclass_id *idp)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *id;
+	struct compat_index *index;
+	struct driver *entry;
+	const char *compat_list, *compat;
+	int compat_length, i;
+
+	compat_list = ofnode_get_property(node, "compatible", &compat_length);
+	if (!compat_list)
+		return -ENOENT;
+
+	index = compat_index_get(driver, n_ents);
+	for (i = 0; i < compat_length; i += strlen(compat) + 1) {
+		compat = compat_list + i;
+		entry = lists_match_compat(index, driver, n_ents, compat, &id);
+		if (entry) {
+			*idp = entry->id;
+			return 0;
+		}
+	}
+
+	return -ENOENT;
+}
+
 int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp)
 {
 	struct driver *driver = ll_entry_start(struct driver, driver);
 	const int n_ents = ll_entry_count(struct driver, driver);
 	const struct udevice_id *id;
+	struct compat_index *index;
 	struct driver *entry;
 	struct udevice *dev;
 	bool found = false;
@@ -153,6 +380,8 @@ int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp)
 		return compat_length;
 	}
 
+	index = compat_index_get(driver, n_ents);
+
 	/*
 	 * Walk through the compatible string list, attempting to match each
 	 * compatible string in order such that we match in order of priority
@@ -163,13 +392,9 @@ int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp)
 		pr_debug("   - attempt to match compatible string '%s'\n",
 			 compat);
 
-		for (entry = driver; entry != driver + n_ents; entry++) {
-			ret = driver_check_compatible(entry->of_match, &id,
-						      compat);
-			if (!ret)
-				break;
-		}
-		if (entry == driver + n_ents)
+		entry = lists_match_compat(index, driver, n_ents, compat, &id);
+		ret = entry ? 0 : -ENOENT;
+		if (!entry)
 			continue;
 
 		pr_debug("   - found match at '%s'\n", entry->name);
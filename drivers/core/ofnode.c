@@ -221,10 +221,140 @@ const char *ofnode_get_name(ofnode node)
 	return fdt_get_name(gd->fdt_blob, ofnode_to_offset(node), NULL);
 }
 
+#if CONFIG_IS_ENABLED(DM_NODE_INDEX)
+/**
+ * struct phandle_index - device tree nodes by phandle
+ *
+ * @tree:	Tree the index was built from, gd->of_root or gd->fdt_blob
+ * @count:	Number of entries in @node, one more than the largest phandle
+ *		indexed
+ * @node:	Node of each phandle, invalid if there is none
+ */
+struct phandle_index {
+	const void *tree;
+	uint count;
+	ofnode node[];
+};
+
+static struct phandle_index *phandle_index;
+
+static const void *phandle_index_tree(void)
+{
+	if (of_live_active())
+		return gd->of_root;
+
+	return gd->fdt_blob;
+}
+
+/*
+ * The index is built on the first lookup once the full malloc() is up, and
+ * again when the tree is replaced. dtc numbers phandles from 1, so the index
+ * is a plain array. Phandles too large for it to stay small are not indexed.
+ */
+static struct phandle_index *phandle_index_get(void)
+{
+	const void *tree = phandle_index_tree();
+	struct phandle_index *idx;
+	struct device_node *np;
+	uint nodes = 0, max = 0;
+	uint phandle, i;
+	int offset;
+
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT) || !tree)
+		return NULL;
+	if (phandle_index && phandle_index->tree == tree)
+		return phandle_index;
+
+	if (of_live_active()) {
+		for_each_of_allnodes(np)
+			nodes++;
+	} else {
+		for (offset = fdt_next_node(tree, -1, NULL); offset >= 0;
+		     offset = fdt_next_node(tree, offset, NULL))
+			nodes++;
+	}
+
+	idx = malloc(sizeof(*idx) + (nodes + 1) * sizeof(ofnode));
+	if (!idx)
+		return NULL;
+
+	idx->tree = tree;
+	for (i = 0; i <= nodes; i++)
+		idx->node[i] = ofnode_null();
+	if (of_live_active()) {
+		for_each_of_allnodes(np) {
+			phandle = np->phandle;
+			if (phandle && phandle <= nodes &&
+			    !ofnode_valid(idx->node[phandle])) {
+				idx->node[phandle] = np_to_ofnode(np);
+				max = max(max, phandle);
+			}
+		}
+	} else {
+		for (offset = fdt_next_node(tree, -1, NULL); offset >= 0;
+		     offset = fdt_next_node(tree, offset, NULL)) {
+			phandle = fdt_get_phandle(tree, offset);
+			if (phandle && phandle <= nodes &&
+			    !ofnode_valid(idx->node[phandle])) {
+				idx->node[phandle] = offset_to_ofnode(offset);
+				max = max(max, phandle);
+			}
+		}
+	}
+	idx->count = max + 1;
+
+	free(phandle_index);
+	phandle_index = idx;
+	pr_debug("phandle index: %u nodes, %u phandles\n", nodes, max);
+
+	return idx;
+}
+
+/*
+ * Look up a phandle in the index. A flat tree may have been changed in place
+ * since the index was built, so each hit is checked against the tree and the
+ * index dropped if it is stale. Misses are left to the caller.
+ */
+static ofnode phandle_index_find(uint phandle)
+{
+	struct phandle_index *idx = phandle_index_get();
+	ofnode node;
+
+	if (!idx || phandle >= idx->count)
+		return ofnode_null();
+
+	node = idx->node[phandle];
+	if (!ofnode_valid(node))
+		return node;
+	if (of_live_active()) {
+		if (ofnode_to_np(node)->phandle == phandle)
+			return node;
+	} else {
+		if (fdt_get_phandle(idx->tree, ofnode_to_offset(node)) ==
+		    phandle)
+			return node;
+	}
+
+	free(phandle_index);
+	phandle_index = NULL;
+
+	return ofnode_null();
+}
+#else
+static inline ofnode phandle_index_find(uint phandle)
+{
+	return ofnode_null();
+}
+#endif
+
 ofnode ofnode_get_by_phandle(uint phandle)
 {
 	ofnode node;
 
+	node = phandle_index_find(phandle);
+	if (ofnode_valid(node))
+		return node;
+
 	if (of_live_active())
 		node = np_to_ofnode(of_find_node_by_phandle(phandle));
 	else
@@ -26,8 +26,44 @@
 
 DECLARE_GLOBAL_DATA_PTR;
 
+#if CONFIG_IS_ENABLED(DM_LAZY_BIND)
+/**
+ * struct dm_pending - a device tree node whose binding is deferred
+ *
+ * @sibling:	Entry in the root's list of pending nodes, in scan order
+ * @parent:	Device the node is bound to, NULL for the place holder of a
+ *		node being bound
+ * @node:	The node
+ * @uclass:	Uclass of the driver the node matches
+ * @container:	true if the node has subnodes with a compatible string, which
+ *		its driver may bind when it is bound
+ * @kernel_dtb:	true if the node was found after GD_FLG_KDTB_READY was set
+ */
+struct dm_pending {
+	struct list_head sibling;
+	struct udevice *parent;
+	ofnode node;
+	enum uclass_id uclass;
+	bool container;
+#ifdef CONFIG_USING_KERNEL_DTB
+	bool kernel_dtb;
+#endif
+};
+#endif
+
 struct root_priv {
 	fdt_addr_t translation_offset;	/* optional translation offset */
+#if CONFIG_IS_ENABLED(DM_LAZY_BIND)
+	struct list_head pending;	/* struct dm_pending, scan order */
+	struct list_head *insert;	/* where new nodes go, NULL for end */
+	uint containers;		/* pending nodes with subnodes */
+	u32 pending_map[DIV_ROUND_UP(UCLASS_COUNT, 32)]; /* uclass bitmap */
+#endif
+#if CONFIG_IS_ENABLED(DM_NODE_INDEX)
+	struct hlist_head *node_hash;	/* devices by node, NULL if none */
+	uint node_hash_bits;		/* log2 of the number of buckets */
+	uint node_count;		/* devices in node_hash */
+#endif
 };
 
 static const struct driver_info root_info = {
@@ -69,6 +105,157 @@ void dm_set_translation_offset(fdt_addr_t offs)
 	priv->translation_offset = offs;
 }
 
+#if CONFIG_IS_ENABLED(DM_NODE_INDEX)
+/* Buckets of a new index, doubled whenever it averages two devices each */
+#define DM_NODE_INDEX_BITS	6
+
+static struct root_priv *dm_node_index_priv(void)
+{
+	struct root_priv *priv;
+
+	if (!gd->dm_root)
+		return NULL;
+	priv = dev_get_priv(gd->dm_root);
+
+	return priv && priv->node_hash ? priv : NULL;
+}
+
+static uint dm_node_hash(ofnode node, uint bits)
+{
+	/* Node pointers and offsets are both multiples of 4 */
+	u32 key = (ulong)node.of_offset >> 2;
+
+	return (key * 0x9e3779b9) >> (32 - bits);
+}
+
+static int dm_node_index_grow(struct root_priv *priv)
+{
+	uint bits = priv->node_hash_bits + 1;
+	struct hlist_node *pos, *n;
+	struct hlist_head *head;
+	struct udevice *dev;
+	uint i;
+
+	head = calloc(1 << bits, sizeof(*head));
+	if (!head)
+		return -ENOMEM;
+
+	for (i = 0; i < 1 << priv->node_hash_bits; i++) {
+		hlist_for_each_entry_safe(dev, pos, n, &priv->node_hash[i],
+					  node_hash)
+			hlist_add_head(&dev->node_hash,
+				       &head[dm_node_hash(dev->node, bits)]);
+	}
+	free(priv->node_hash);
+	priv->node_hash = head;
+	priv->node_hash_bits = bits;
+
+	return 0;
+}
+
+/*
+ * The index is only set up if the full malloc() is up when driver model is
+ * started, so that it holds every device of the tree. Lookups before
+ * relocation scan the uclass instead.
+ */
+static void dm_node_index_init(struct root_priv *priv)
+{
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+		return;
+
+	priv->node_hash = calloc(1 << DM_NODE_INDEX_BITS,
+				 sizeof(*priv->node_hash));
+	priv->node_hash_bits = DM_NODE_INDEX_BITS;
+	priv->node_count = 0;
+}
+
+static void dm_node_index_drop(void)
+{
+	struct root_priv *priv = dm_node_index_priv();
+	struct hlist_node *pos, *n;
+	struct udevice *dev;
+	uint i;
+
+	if (!priv)
+		return;
+
+	for (i = 0; i < 1 << priv->node_hash_bits; i++) {
+		hlist_for_each_entry_safe(dev, pos, n, &priv->node_hash[i],
+					  node_hash)
+			hlist_del_init(&dev->node_hash);
+	}
+	free(priv->node_hash);
+	priv->node_hash = NULL;
+}
+
+void dm_node_index_add(struct udevice *dev)
+{
+	struct root_priv *priv = dm_node_index_priv();
+
+	if (!priv || !ofnode_valid(dev->node))
+		return;
+
+	/* If this fails, the chains just get longer */
+	if (priv->node_count >= 2U << priv->node_hash_bits)
+		dm_node_index_grow(priv);
+
+	hlist_add_head(&dev->node_hash,
+		       &priv->node_hash[dm_node_hash(dev->node,
+						     priv->node_hash_bits)]);
+	priv->node_count++;
+}
+
+void dm_node_index_del(struct udevice *dev)
+{
+	struct root_priv *priv;
+
+	if (hlist_unhashed(&dev->node_hash))
+		return;
+
+	hlist_del_init(&dev->node_hash);
+	priv = dm_node_index_priv();
+	if (priv)
+		priv->node_count--;
+}
+
+int dm_node_index_find(enum uclass_id id, ofnode node, struct udevice **devp)
+{
+	struct root_priv *priv = dm_node_index_priv();
+	struct hlist_node *pos;
+	struct udevice *dev;
+
+	*devp = NULL;
+	if (!priv)
+		return -ENOSYS;
+
+	hlist_for_each_entry(dev, pos,
+			     &priv->node_hash[dm_node_hash(node,
+							   priv->node_hash_bits)],
+			     node_hash) {
+		if (dev->uclass->uc_drv->id != id ||
+		    !ofnode_equal(dev->node, node))
+			continue;
+
+		/* Only the uclass knows which of several comes first */
+		if (*devp) {
+			*devp = NULL;
+			return -ENOSYS;
+		}
+		*devp = dev;
+	}
+
+	return *devp ? 0 : -ENODEV;
+}
+#else
+static inline void dm_node_index_init(struct root_priv *priv)
+{
+}
+
+static inline void dm_node_index_drop(void)
+{
+}
+#endif
+
 #if defined(CONFIG_NEEDS_MANUAL_RELOC)
 void fix_drivers(void)
 {
@@ -180,12 +367,20 @@ int dm_init(bool of_live)
 	ret = device_probe(DM_ROOT_NON_CONST);
 	if (ret)
 		return ret;
+#if CONFIG_IS_ENABLED(DM_LAZY_BIND)
+	INIT_LIST_HEAD(&((struct root_priv *)
+			 dev_get_priv(DM_ROOT_NON_CONST))->pending);
+#endif
+	dm_node_index_init(dev_get_priv(DM_ROOT_NON_CONST));
+	dm_node_index_add(DM_ROOT_NON_CONST);
 
 	return 0;
 }
 
 int dm_uninit(void)
 {
+	dm_lazy_drop(NULL);
+	dm_node_index_drop();
 	device_remove(dm_root(), DM_REMOVE_NORMAL);
 	device_unbind(dm_root());
 
@@ -214,6 +409,213 @@ int dm_scan_platdata(bool pre_reloc_only)
 	return ret;
 }
 
+#if CONFIG_IS_ENABLED(DM_LAZY_BIND)
+static struct root_priv *dm_lazy_priv(void)
+{
+	return gd->dm_root ? dev_get_priv(gd->dm_root) : NULL;
+}
+
+static bool dm_lazy_has_children(ofnode node)
+{
+	ofnode subnode;
+
+	for (subnode = ofnode_first_subnode(node); ofnode_valid(subnode);
+	     subnode = ofnode_next_subnode(subnode)) {
+		if (ofnode_get_property(subnode, "compatible", NULL))
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * dm_lazy_defer() - Record a node to bind when it is first needed
+ *
+ * @parent: Parent device for the node
+ * @node: Node to record
+ * @return true if the node was recorded, false if it must be bound now
+ */
+static bool dm_lazy_defer(struct udevice *parent, ofnode node)
+{
+	struct root_priv *priv = dm_lazy_priv();
+	struct dm_pending *pend;
+	enum uclass_id id;
+
+	if (!priv || !priv->pending.next || lists_fdt_uclass(node, &id))
+		return false;
+	/* A device scanning for its children in probe() needs them now */
+	if (parent != gd->dm_root && (parent->flags & DM_FLAG_ACTIVATED))
+		return false;
+
+	pend = malloc(sizeof(*pend));
+	if (!pend)
+		return false;
+
+	pend->parent = parent;
+	pend->node = node;
+	pend->uclass = id;
+	pend->container = dm_lazy_has_children(node);
+#ifdef CONFIG_USING_KERNEL_DTB
+	pend->kernel_dtb = !!(gd->flags & GD_FLG_KDTB_READY);
+#endif
+	list_add_tail(&pend->sibling, priv->insert ?: &priv->pending);
+	if (pend->container)
+		priv->containers++;
+	priv->pending_map[id / 32] |= BIT(id % 32);
+	parent->flags |= DM_FLAG_LAZY_CHILDREN;
+
+	return true;
+}
+
+/**
+ * dm_lazy_find() - Find the first pending node of a uclass or device
+ *
+ * @priv: Root device private data
+ * @parent: Device whose child node to find, or NULL for any
+ * @id: Uclass to find a node of, or UCLASS_COUNT for any. A node with
+ *	subnodes matches any uclass.
+ * @return pending node, or NULL if there is none
+ */
+static struct dm_pending *dm_lazy_find(struct root_priv *priv,
+				       struct udevice *parent,
+				       enum uclass_id id)
+{
+	struct dm_pending *pend;
+
+	list_for_each_entry(pend, &priv->pending, sibling) {
+		if (!pend->parent || (parent && pend->parent != parent))
+			continue;
+		if (id == UCLASS_COUNT || pend->uclass == id || pend->container)
+			return pend;
+	}
+
+	return NULL;
+}
+
+static void dm_lazy_bind(struct root_priv *priv, struct dm_pending *pend)
+{
+	struct dm_pending mark = { .parent = NULL };
+	struct list_head *insert;
+#ifdef CONFIG_USING_KERNEL_DTB
+	ulong kdtb_ready = gd->flags & GD_FLG_KDTB_READY;
+#endif
+	int ret;
+
+	/*
+	 * Nodes the driver finds below this one take its place in the list,
+	 * so that they bind in the same order as without DM_LAZY_BIND.
+	 */
+	list_replace(&pend->sibling, &mark.sibling);
+	insert = priv->insert;
+	priv->insert = &mark.sibling;
+	if (pend->container)
+		priv->containers--;
+#ifdef CONFIG_USING_KERNEL_DTB
+	/*
+	 * device_bind() merges kernel dtb devices with the U-Boot ones, so
+	 * bind each node as U-Boot or kernel dtb, as it was scanned.
+	 */
+	gd->flags &= ~GD_FLG_KDTB_READY;
+	if (pend->kernel_dtb)
+		gd->flags |= GD_FLG_KDTB_READY;
+#endif
+	ret = lists_bind_fdt(pend->parent, pend->node, NULL);
+	if (ret)
+		dm_warn("%s: failed to bind '%s': %d\n", __func__,
+			ofnode_get_name(pend->node), ret);
+#ifdef CONFIG_USING_KERNEL_DTB
+	gd->flags = (gd->flags & ~GD_FLG_KDTB_READY) | kdtb_ready;
+#endif
+	priv->insert = insert;
+	list_del(&mark.sibling);
+	free(pend);
+}
+
+void dm_lazy_bind_uclass(enum uclass_id id)
+{
+	struct root_priv *priv = dm_lazy_priv();
+	struct dm_pending *pend;
+
+	if (!priv || (!priv->containers &&
+		      !(priv->pending_map[id / 32] & BIT(id % 32))))
+		return;
+
+	/*
+	 * Nodes with subnodes are bound too, since the nodes their drivers
+	 * find below them may be in this uclass. Binding may add and bind
+	 * other pending nodes, so start over each time.
+	 */
+	while ((pend = dm_lazy_find(priv, NULL, id)))
+		dm_lazy_bind(priv, pend);
+	priv->pending_map[id / 32] &= ~BIT(id % 32);
+}
+
+void dm_lazy_bind_children(struct udevice *parent)
+{
+	struct root_priv *priv = dm_lazy_priv();
+	struct dm_pending *pend;
+
+	if (!priv || !(parent->flags & DM_FLAG_LAZY_CHILDREN))
+		return;
+
+	/* Bind whole uclasses, so each keeps its devices in scan order */
+	parent->flags &= ~DM_FLAG_LAZY_CHILDREN;
+	while ((pend = dm_lazy_find(priv, parent, UCLASS_COUNT)))
+		dm_lazy_bind_uclass(pend->uclass);
+}
+
+void dm_lazy_bind_all(void)
+{
+	struct root_priv *priv = dm_lazy_priv();
+	struct dm_pending *pend;
+
+	if (!priv || !priv->pending.next)
+		return;
+
+	while ((pend = dm_lazy_find(priv, NULL, UCLASS_COUNT)))
+		dm_lazy_bind(priv, pend);
+	memset(priv->pending_map, '\0', sizeof(priv->pending_map));
+}
+
+void dm_lazy_drop(struct udevice *parent)
+{
+	struct root_priv *priv = dm_lazy_priv();
+	struct dm_pending *pend, *next;
+
+	if (!priv || !priv->pending.next)
+		return;
+	if (parent && !(parent->flags & DM_FLAG_LAZY_CHILDREN))
+		return;
+
+	list_for_each_entry_safe(pend, next, &priv->pending, sibling) {
+		if (!pend->parent || (parent && pend->parent != parent))
+			continue;
+		list_del(&pend->sibling);
+		if (pend->container)
+			priv->containers--;
+		free(pend);
+	}
+	if (parent)
+		parent->flags &= ~DM_FLAG_LAZY_CHILDREN;
+}
+#else
+static inline bool dm_lazy_defer(struct udevice *parent, ofnode node)
+{
+	return false;
+}
+#endif
+
+#if CONFIG_IS_ENABLED(OF_CONTROL) && !CONFIG_IS_ENABLED(OF_PLATDATA)
+/* Bind a node found by a scan, or leave it for later with DM_LAZY_BIND */
+static int dm_scan_bind(struct udevice *parent, ofnode node)
+{
+	if (dm_lazy_defer(parent, node))
+		return 0;
+
+	return lists_bind_fdt(parent, node, NULL);
+}
+#endif
+
 #if CONFIG_IS_ENABLED(OF_LIVE)
 static int dm_scan_fdt_live(struct udevice *parent,
 			    const struct device_node *node_parent,
@@ -235,7 +637,7 @@ static int dm_scan_fdt_live(struct udevice *parent,
 			pr_debug("   - ignoring disabled device\n");
 			continue;
 		}
-		err = lists_bind_fdt(parent, np_to_ofnode(np), NULL);
+		err = dm_scan_bind(parent, np_to_ofnode(np));
 		if (err && !ret) {
 			ret = err;
 			debug("%s: ret=%d\n", np->name, ret);
@@ -283,7 +685,7 @@ static int dm_scan_fdt_node(struct udevice *parent, const void *blob,
 			pr_debug("   - ignoring disabled device\n");
 			continue;
 		}
-		err = lists_bind_fdt(parent, offset_to_ofnode(offset), NULL);
+		err = dm_scan_bind(parent, offset_to_ofnode(offset));
 		if (err && !ret) {
 			ret = err;
 			debug("%s: ret=%d\n", fdt_get_name(blob, offset, NULL),
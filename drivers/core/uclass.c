@@ -14,6 +14,7 @@
 #include <dm/device.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
+#include <dm/root.h>
 #include <dm/uclass.h>
 #include <dm/uclass-internal.h>
 #include <dm/util.h>
@@ -143,6 +144,13 @@ int uclass_destroy(struct uclass *uc)
 }
 
 int uclass_get(enum uclass_id id, struct uclass **ucp)
+{
+	dm_lazy_bind_uclass(id);
+
+	return uclass_get_nolazy(id, ucp);
+}
+
+int uclass_get_nolazy(enum uclass_id id, struct uclass **ucp)
 {
 	struct uclass *uc;
 
@@ -298,6 +306,12 @@ int uclass_find_device_by_of_offset(enum uclass_id id, int node,
 	if (ret)
 		return ret;
 
+	if (!of_live_active()) {
+		ret = dm_node_index_find(id, offset_to_ofnode(node), devp);
+		if (ret != -ENOSYS)
+			return ret;
+	}
+
 	list_for_each_entry(dev, &uc->dev_head, uclass_node) {
 		if (dev_of_offset(dev) == node) {
 			*devp = dev;
@@ -322,6 +336,10 @@ int uclass_find_device_by_ofnode(enum uclass_id id, ofnode node,
 	if (ret)
 		return ret;
 
+	ret = dm_node_index_find(id, node, devp);
+	if (ret != -ENOSYS)
+		return ret;
+
 	list_for_each_entry(dev, &uc->dev_head, uclass_node) {
 		if (ofnode_equal(dev_ofnode(dev), node)) {
 			*devp = dev;
@@ -338,31 +356,16 @@ static int uclass_find_device_by_phandle(enum uclass_id id,
 					 const char *name,
 					 struct udevice **devp)
 {
-	struct udevice *dev;
-	struct uclass *uc;
 	int find_phandle;
-	int ret;
 
 	*devp = NULL;
 	find_phandle = dev_read_u32_default(parent, name, -1);
 	if (find_phandle <= 0)
 		return -ENOENT;
-	ret = uclass_get(id, &uc);
-	if (ret)
-		return ret;
-
-	list_for_each_entry(dev, &uc->dev_head, uclass_node) {
-		uint phandle;
-
-		phandle = dev_read_phandle(dev);
 
-		if (phandle == find_phandle) {
-			*devp = dev;
-			return 0;
-		}
-	}
-
-	return -ENODEV;
+	return uclass_find_device_by_ofnode(id,
+					   ofnode_get_by_phandle(find_phandle),
+					   devp);
 }
 #endif
 
@@ -467,26 +470,11 @@ int uclass_get_device_by_phandle_id(enum uclass_id id, uint phandle_id,
 				    struct udevice **devp)
 {
 	struct udevice *dev;
-	struct uclass *uc;
 	int ret;
 
 	*devp = NULL;
-	ret = uclass_get(id, &uc);
-	if (ret)
-		return ret;
-
-	ret = -ENODEV;
-	list_for_each_entry(dev, &uc->dev_head, uclass_node) {
-		uint phandle;
-
-		phandle = dev_read_phandle(dev);
-
-		if (phandle == phandle_id) {
-			*devp = dev;
-			ret = 0;
-			break;
-		}
-	}
+	ret = uclass_find_device_by_ofnode(id, ofnode_get_by_phandle(phandle_id),
+					   &dev);
 
 	return uclass_get_device_tail(dev, ret, devp);
 }
@@ -581,6 +569,7 @@ int uclass_bind_device(struct udevice *dev, bool after_u_boot_dev)
 #else
 	list_add_tail(&dev->uclass_node, &uc->dev_head);
 #endif
+	dm_node_index_add(dev);
 	if (dev->parent) {
 		struct uclass_driver *uc_drv = dev->parent->uclass->uc_drv;
 
@@ -595,6 +584,7 @@ int uclass_bind_device(struct udevice *dev, bool after_u_boot_dev)
 err:
 	/* There is no need to undo the parent's post_bind call */
 	list_del(&dev->uclass_node);
+	dm_node_index_del(dev);
 
 	return ret;
 }
@@ -613,6 +603,7 @@ int uclass_unbind_device(struct udevice *dev)
 	}
 
 	list_del(&dev->uclass_node);
+	dm_node_index_del(dev);
 	return 0;
 }
 #endif
@@ -4,6 +4,7 @@
  */
 
 #include <crypto.h>
+#include <malloc.h>
 
 static const u8 null_hash_sha1_value[] = {
 	0xda, 0x39, 0xa3, 0xee, 0x5e, 0x6b, 0x4b, 0x0d,
@@ -106,6 +107,11 @@ struct udevice *crypto_get_device(u32 capability)
 int crypto_sha_init(struct udevice *dev, sha_context *ctx)
 {
 	const struct dm_crypto_ops *ops = device_get_ops(dev);
+	struct crypto_uc_priv *uc_priv = dev_get_uclass_priv(dev);
+
+	/* The engine's only context belongs to a crypto_hash_alloc() user */
+	if (uc_priv && uc_priv->hash_owner)
+		return -EBUSY;
 
 	if (ctx && !ctx->length)
 		return 0;
@@ -251,6 +257,215 @@ int crypto_sha_regions_csum(struct udevice *dev, sha_context *ctx,
 	return crypto_sha_final(dev, ctx, output);
 }
 
+/* Find a device for @algo which no other hash handle is using */
+static struct udevice *crypto_hash_get_device(u32 algo)
+{
+	const struct dm_crypto_ops *ops;
+	struct crypto_uc_priv *uc_priv;
+	struct udevice *dev;
+
+	for (uclass_first_device(UCLASS_CRYPTO, &dev);
+	     dev;
+	     uclass_next_device(&dev)) {
+		ops = device_get_ops(dev);
+		if (!ops || !ops->capability || !ops->sha_init)
+			continue;
+
+		uc_priv = dev_get_uclass_priv(dev);
+		if (uc_priv->hash_owner)
+			continue;
+
+		if ((ops->capability(dev) & algo) == algo)
+			return dev;
+	}
+
+	return NULL;
+}
+
+static int crypto_hash_sw_init(struct crypto_hash *hash)
+{
+	switch (hash->algo) {
+#ifdef CONFIG_MD5
+	case CRYPTO_MD5:
+		MD5Init(&hash->sw.md5);
+		return 0;
+#endif
+#ifdef CONFIG_SHA1
+	case CRYPTO_SHA1:
+		sha1_starts(&hash->sw.sha1);
+		return 0;
+#endif
+#ifdef CONFIG_SHA256
+	case CRYPTO_SHA256:
+		sha256_starts(&hash->sw.sha256);
+		return 0;
+#endif
+#ifdef CONFIG_SHA512
+	case CRYPTO_SHA512:
+		sha512_starts(&hash->sw.sha512);
+		return 0;
+#endif
+	}
+
+	return -EPROTONOSUPPORT;
+}
+
+static void crypto_hash_sw_update(struct crypto_hash *hash,
+				  const void *input, u32 len)
+{
+	switch (hash->algo) {
+#ifdef CONFIG_MD5
+	case CRYPTO_MD5:
+		MD5Update(&hash->sw.md5, input, len);
+		break;
+#endif
+#ifdef CONFIG_SHA1
+	case CRYPTO_SHA1:
+		sha1_update(&hash->sw.sha1, input, len);
+		break;
+#endif
+#ifdef CONFIG_SHA256
+	case CRYPTO_SHA256:
+		sha256_update(&hash->sw.sha256, input, len);
+		break;
+#endif
+#ifdef CONFIG_SHA512
+	case CRYPTO_SHA512:
+		sha512_update(&hash->sw.sha512, input, len);
+		break;
+#endif
+	}
+}
+
+static void crypto_hash_sw_final(struct crypto_hash *hash, u8 *output)
+{
+	switch (hash->algo) {
+#ifdef CONFIG_MD5
+	case CRYPTO_MD5:
+		MD5Final(output, &hash->sw.md5);
+		break;
+#endif
+#ifdef CONFIG_SHA1
+	case CRYPTO_SHA1:
+		sha1_finish(&hash->sw.sha1, output);
+		break;
+#endif
+#ifdef CONFIG_SHA256
+	case CRYPTO_SHA256:
+		sha256_finish(&hash->sw.sha256, output);
+		break;
+#endif
+#ifdef CONFIG_SHA512
+	case CRYPTO_SHA512:
+		sha512_finish(&hash->sw.sha512, output);
+		break;
+#endif
+	}
+}
+
+struct crypto_hash *crypto_hash_alloc(u32 algo, u32 length)
+{
+	struct crypto_uc_priv *uc_priv;
+	struct crypto_hash *hash;
+	sha_context ctx;
+
+	hash = calloc(1, sizeof(*hash));
+	if (!hash)
+		return NULL;
+
+	hash->algo = algo;
+	hash->length = length;
+
+	/* the engine only pays off for real data, and needs a length */
+	if (length)
+		hash->dev = crypto_hash_get_device(algo);
+	if (hash->dev) {
+		ctx.algo = algo;
+		ctx.length = length;
+		if (!crypto_sha_init(hash->dev, &ctx)) {
+			uc_priv = dev_get_uclass_priv(hash->dev);
+			uc_priv->hash_owner = hash;
+			return hash;
+		}
+		hash->dev = NULL;
+	}
+
+	if (crypto_hash_sw_init(hash)) {
+		debug("%s: no hash support for algo 0x%x\n", __func__, algo);
+		free(hash);
+		return NULL;
+	}
+
+	return hash;
+}
+
+int crypto_hash_update(struct crypto_hash *hash, const void *input, u32 len)
+{
+	int ret;
+
+	if (hash->done + len > hash->length)
+		return -EINVAL;
+
+	if (hash->dev) {
+		ret = crypto_sha_update(hash->dev, (u32 *)input, len);
+		if (ret)
+			return ret;
+	} else {
+		crypto_hash_sw_update(hash, input, len);
+	}
+	hash->done += len;
+
+	return 0;
+}
+
+int crypto_hash_final(struct crypto_hash *hash, u8 *output)
+{
+	struct crypto_uc_priv *uc_priv;
+	sha_context ctx;
+	int ret = 0;
+
+	if (hash->done != hash->length) {
+		printf("%s: hashed 0x%08x of 0x%08x bytes\n", __func__,
+		       hash->done, hash->length);
+		ret = -EIO;
+	}
+
+	if (hash->dev) {
+		ctx.algo = hash->algo;
+		ctx.length = hash->length;
+		if (crypto_sha_final(hash->dev, &ctx, output) && !ret)
+			ret = -EIO;
+		uc_priv = dev_get_uclass_priv(hash->dev);
+		uc_priv->hash_owner = NULL;
+	} else if (!ret) {
+		crypto_hash_sw_final(hash, output);
+	}
+
+	free(hash);
+
+	return ret;
+}
+
+void crypto_hash_free(struct crypto_hash *hash)
+{
+	u8 output[BITS2BYTE(512)];
+
+	if (!hash)
+		return;
+
+	/*
+	 * The driver's final() cleans up the engine; for a short hash it
+	 * notices the missing data and does so without waiting for a result.
+	 */
+	if (hash->dev) {
+		hash->done = hash->length;
+		crypto_hash_final(hash, output);
+		return;
+	}
+
+	free(hash);
+}
+
 int crypto_rsa_verify(struct udevice *dev, rsa_key *ctx, u8 *sign, u8 *output)
 {
 	const struct dm_crypto_ops *ops = device_get_ops(dev);
@@ -301,4 +516,5 @@ int crypto_ae(struct udevice *dev, cipher_context *ctx,
 UCLASS_DRIVER(crypto) = {
 	.id	= UCLASS_CRYPTO,
 	.name	= "crypto",
+	.per_device_auto_alloc_size = sizeof(struct crypto_uc_priv),
 };
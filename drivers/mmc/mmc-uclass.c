@@ -157,6 +157,25 @@ int mmc_set_enhanced_strobe(struct mmc *mmc)
 {
 	return dm_mmc_set_enhanced_strobe(mmc->dev);
 }
+
+int mmc_get_tuning(struct mmc *mmc, u32 *phase)
+{
+	struct dm_mmc_ops *ops = mmc_get_ops(mmc->dev);
+
+	if (!ops->get_tuning)
+		return -ENOSYS;
+	return ops->get_tuning(mmc->dev, phase);
+}
+
+int mmc_set_tuning(struct mmc *mmc, u32 phase)
+{
+	struct dm_mmc_ops *ops = mmc_get_ops(mmc->dev);
+
+	if (!ops->set_tuning)
+		return -ENOSYS;
+	return ops->set_tuning(mmc->dev, phase);
+}
+
 struct mmc *mmc_get_mmc_dev(struct udevice *dev)
 {
 	struct mmc_uclass_priv *upriv;
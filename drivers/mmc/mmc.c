@@ -766,7 +766,99 @@ int mmc_switch(struct mmc *mmc, u8 set, u8 index, u8 value)
 	return __mmc_switch(mmc, set, index, value, true);
 }
 
-static int mmc_select_bus_width(struct mmc *mmc)
+#if CONFIG_IS_ENABLED(MMC_TUNING_CACHE)
+/* Tuning block reads that must pass before a cached tuning is used */
+#define MMC_TUNING_CACHE_CHECKS	4
+
+__weak int board_mmc_tuning_cache_load(struct mmc *mmc,
+				       struct mmc_tuning_cache *rec,
+				       bool card_ready)
+{
+	return -ENOENT;
+}
+
+__weak void board_mmc_tuning_cache_save(struct mmc *mmc,
+					const struct mmc_tuning_cache *rec,
+					bool failed)
+{
+}
+
+static void mmc_tuning_cache_load(struct mmc *mmc, bool card_ready)
+{
+	struct mmc_tuning_cache *rec = &mmc->tuning_cache;
+
+	if (board_mmc_tuning_cache_load(mmc, rec, card_ready))
+		return;
+
+	if (rec->magic != MMC_TUNING_CACHE_MAGIC ||
+	    memcmp(rec->cid, mmc->cid, sizeof(rec->cid))) {
+		debug("%s: record is for another card\n", __func__);
+		return;
+	}
+
+	mmc->tuning_cached = 1;
+}
+
+/* Switch to the bus width found by the bus test at an earlier boot */
+static int mmc_tuning_cache_bus_width(struct mmc *mmc)
+{
+	uint bus_width = mmc->tuning_cache.bus_width;
+	u32 ext_csd_bits;
+	int err;
+
+	if (bus_width == MMC_BUS_WIDTH_8BIT &&
+	    (mmc->cfg->host_caps & MMC_MODE_8BIT))
+		ext_csd_bits = EXT_CSD_BUS_WIDTH_8;
+	else if (bus_width == MMC_BUS_WIDTH_4BIT &&
+		 (mmc->cfg->host_caps & (MMC_MODE_4BIT | MMC_MODE_8BIT)))
+		ext_csd_bits = EXT_CSD_BUS_WIDTH_4;
+	else
+		return -EINVAL;
+
+	err = mmc_switch(mmc, EXT_CSD_CMD_SET_NORMAL, EXT_CSD_BUS_WIDTH,
+			 ext_csd_bits);
+	if (err)
+		return err;
+
+	mmc_set_bus_width(mmc, bus_width);
+
+	return bus_width;
+}
+
+/* Sample at the point found at an earlier boot, if it still works */
+static int mmc_tuning_cache_apply(struct mmc *mmc)
+{
+	struct mmc_tuning_cache *rec = &mmc->tuning_cache;
+	int i, err;
+
+	if (rec->clock != mmc->clock || rec->bus_width != mmc->bus_width)
+		return -EINVAL;
+
+	err = mmc_set_tuning(mmc, rec->phase);
+	for (i = 0; !err && i < MMC_TUNING_CACHE_CHECKS; i++)
+		err = mmc_send_tuning(mmc, MMC_SEND_TUNING_BLOCK_HS200);
+
+	return err;
+}
+
+static void mmc_tuning_cache_update(struct mmc *mmc)
+{
+	struct mmc_tuning_cache *rec = &mmc->tuning_cache;
+	u32 phase;
+
+	if (mmc_get_tuning(mmc, &phase))
+		return;
+
+	rec->magic = MMC_TUNING_CACHE_MAGIC;
+	memcpy(rec->cid, mmc->cid, sizeof(rec->cid));
+	rec->clock = mmc->clock;
+	rec->bus_width = mmc->bus_width;
+	rec->phase = phase;
+	mmc->tuning_changed = 1;
+}
+#endif
+
+static int mmc_select_bus_width(struct mmc *mmc, bool tuning)
 {
 	u32 ext_csd_bits[] = {
 		EXT_CSD_BUS_WIDTH_8,
@@ -785,6 +877,21 @@ static int mmc_select_bus_width(struct mmc *mmc)
 	    !(mmc->cfg->host_caps & (MMC_MODE_4BIT | MMC_MODE_8BIT)))
 		return 0;
 
+#if CONFIG_IS_ENABLED(MMC_TUNING_CACHE)
+	/*
+	 * HS200 tuning fails on a wrong bus width, so the cached width can
+	 * skip the bus test when @tuning says that tuning follows. Paths
+	 * without tuning always run the bus test.
+	 */
+	if (tuning && mmc->tuning_cached) {
+		err = mmc_tuning_cache_bus_width(mmc);
+		if (err > 0)
+			return err;
+		mmc->tuning_cached = 0;
+		mmc->tuning_failed = 1;
+	}
+#endif
+
 	err = mmc_send_ext_csd(mmc, ext_csd);
 
 	if (err)
@@ -939,7 +1046,25 @@ static int mmc_execute_tuning(struct mmc *mmc)
 
 static int mmc_hs200_tuning(struct mmc *mmc)
 {
+#if CONFIG_IS_ENABLED(MMC_TUNING_CACHE)
+	int err;
+
+	if (mmc->tuning_cached) {
+		if (!mmc_tuning_cache_apply(mmc))
+			return 0;
+		debug("%s: cached tuning failed, tuning again\n", __func__);
+		mmc->tuning_cached = 0;
+		mmc->tuning_failed = 1;
+	}
+
+	err = mmc_execute_tuning(mmc);
+	if (!err)
+		mmc_tuning_cache_update(mmc);
+
+	return err;
+#else
 	return mmc_execute_tuning(mmc);
+#endif
 }
 
 #else
@@ -991,7 +1116,16 @@ static int mmc_select_hs200(struct mmc *mmc)
 	 * Set the bus width(4 or 8) with host's support and
 	 * switch to HS200 mode if bus width is set successfully.
 	 */
-	ret = mmc_select_bus_width(mmc);
+	ret = mmc_select_bus_width(mmc, true);
+
+#if CONFIG_IS_ENABLED(MMC_TUNING_CACHE)
+	/*
+	 * The card still runs at legacy timing, so a record kept on the card
+	 * itself can be read from it now, before the card is tuned.
+	 */
+	if (ret > 0 && !mmc->tuning_cached && !mmc->tuning_failed)
+		mmc_tuning_cache_load(mmc, true);
+#endif
 
 	if (ret > 0) {
 		ret = __mmc_switch(mmc, EXT_CSD_CMD_SET_NORMAL,
@@ -1191,8 +1325,15 @@ static int mmc_change_freq(struct mmc *mmc)
 
 	avail_type = mmc_select_card_type(mmc, ext_csd);
 
+#if CONFIG_IS_ENABLED(MMC_TUNING_CACHE)
+	mmc->tuning_cached = 0;
+	mmc->tuning_changed = 0;
+	mmc->tuning_failed = 0;
+	mmc_tuning_cache_load(mmc, false);
+#endif
+
 	if (avail_type & EXT_CSD_CARD_TYPE_HS400ES) {
-		err = mmc_select_bus_width(mmc);
+		err = mmc_select_bus_width(mmc, false);
 		if (err > 0 && mmc->bus_width == MMC_BUS_WIDTH_8BIT) {
 			err = mmc_select_hs400es(mmc);
 			mmc_set_bus_speed(mmc, avail_type);
@@ -1221,7 +1362,7 @@ static int mmc_change_freq(struct mmc *mmc)
 			mmc_set_bus_speed(mmc, avail_type);
 		}
 	} else if (!mmc_card_hs400es(mmc)) {
-		err = mmc_select_bus_width(mmc) > 0 ? 0 : err;
+		err = mmc_select_bus_width(mmc, false) > 0 ? 0 : err;
 		if (!err && avail_type & EXT_CSD_CARD_TYPE_DDR_52)
 			err = mmc_select_hs_ddr(mmc);
 	}
@@ -1946,6 +2087,8 @@ static int mmc_startup(struct mmc *mmc)
 			mmc->part_attr = ext_csd[EXT_CSD_PARTITIONS_ATTRIBUTE];
 		if (ext_csd[EXT_CSD_SEC_FEATURE_SUPPORT] & EXT_CSD_SEC_GB_CL_EN)
 			mmc->esr.mmc_can_trim = 1;
+		mmc->esr.erased_byte = ext_csd[EXT_CSD_ERASED_MEM_CONT] ?
+				       0xff : 0x00;
 
 		mmc->capacity_boot = ext_csd[EXT_CSD_BOOT_MULT] << 17;
 
@@ -2317,6 +2460,15 @@ static int mmc_complete_init(struct mmc *mmc)
 		mmc->has_init = 0;
 	else
 		mmc->has_init = 1;
+
+#if CONFIG_IS_ENABLED(MMC_TUNING_CACHE)
+	/* Saving may go through the card, so it has to be up */
+	if (!err && mmc->tuning_changed) {
+		board_mmc_tuning_cache_save(mmc, &mmc->tuning_cache,
+					    mmc->tuning_failed);
+		mmc->tuning_changed = 0;
+	}
+#endif
 	return err;
 }
 
@@ -53,6 +53,9 @@ DECLARE_GLOBAL_DATA_PTR;
 #define DWCMSHC_HOST_CTRL3		0x508
 #define DWCMSHC_EMMC_CONTROL		0x52c
 #define DWCMSHC_EMMC_ATCTRL		0x540
+#define DWCMSHC_EMMC_ATCTRL_SW_TUNE_EN	BIT(4)
+#define DWCMSHC_EMMC_ATSTAT		0x544
+#define DWCMSHC_EMMC_ATSTAT_CENTER_PH	GENMASK(7, 0)
 #define DWCMSHC_EMMC_DLL_CTRL		0x800
 #define DWCMSHC_EMMC_DLL_CTRL_RESET	BIT(1)
 #define DWCMSHC_EMMC_DLL_RXCLK		0x804
@@ -121,6 +124,8 @@ struct sdhci_data {
 	void (*set_ios_post)(struct sdhci_host *host);
 	int (*set_enhanced_strobe)(struct sdhci_host *host);
 	int (*get_phy)(struct udevice *dev);
+	int (*get_tuning)(struct sdhci_host *host, u32 *phase);
+	int (*set_tuning)(struct sdhci_host *host, u32 phase);
 	u32 flags;
 #define RK_DLL_CMD_OUT		BIT(1)
 #define RK_RXCLK_NO_INVERTER	BIT(2)
@@ -453,6 +458,40 @@ static int dwcmshc_sdhci_set_enhanced_strobe(struct sdhci_host *host)
 	return 0;
 }
 
+static int dwcmshc_sdhci_get_tuning(struct sdhci_host *host, u32 *phase)
+{
+	if (!(sdhci_readw(host, SDHCI_HOST_CONTROL2) & SDHCI_CTRL_TUNED_CLK))
+		return -EINVAL;
+
+	*phase = sdhci_readl(host, DWCMSHC_EMMC_ATSTAT) &
+		 DWCMSHC_EMMC_ATSTAT_CENTER_PH;
+
+	return 0;
+}
+
+static int dwcmshc_sdhci_set_tuning(struct sdhci_host *host, u32 phase)
+{
+	u32 extra;
+	u16 ctrl;
+
+	if (phase & ~DWCMSHC_EMMC_ATSTAT_CENTER_PH)
+		return -EINVAL;
+
+	/* The center phase code is only writable in software tuning mode */
+	extra = sdhci_readl(host, DWCMSHC_EMMC_ATCTRL);
+	sdhci_writel(host, extra | DWCMSHC_EMMC_ATCTRL_SW_TUNE_EN,
+		     DWCMSHC_EMMC_ATCTRL);
+	sdhci_writel(host, phase, DWCMSHC_EMMC_ATSTAT);
+	sdhci_writel(host, extra, DWCMSHC_EMMC_ATCTRL);
+
+	ctrl = sdhci_readw(host, SDHCI_HOST_CONTROL2);
+	ctrl &= ~SDHCI_CTRL_EXEC_TUNING;
+	ctrl |= SDHCI_CTRL_TUNED_CLK;
+	sdhci_writew(host, ctrl, SDHCI_HOST_CONTROL2);
+
+	return 0;
+}
+
 static void dwcmshc_sdhci_set_ios_post(struct sdhci_host *host)
 {
 	u16 ctrl;
@@ -508,10 +547,34 @@ static int rockchip_sdhci_set_enhanced_strobe(struct sdhci_host *host)
 	return -ENOTSUPP;
 }
 
+static int rockchip_sdhci_get_tuning(struct sdhci_host *host, u32 *phase)
+{
+	struct rockchip_sdhc *priv = container_of(host, struct rockchip_sdhc, host);
+	struct sdhci_data *data = (struct sdhci_data *)dev_get_driver_data(priv->dev);
+
+	if (data->get_tuning)
+		return data->get_tuning(host, phase);
+
+	return -ENOTSUPP;
+}
+
+static int rockchip_sdhci_set_tuning(struct sdhci_host *host, u32 phase)
+{
+	struct rockchip_sdhc *priv = container_of(host, struct rockchip_sdhc, host);
+	struct sdhci_data *data = (struct sdhci_data *)dev_get_driver_data(priv->dev);
+
+	if (data->set_tuning)
+		return data->set_tuning(host, phase);
+
+	return -ENOTSUPP;
+}
+
 static struct sdhci_ops rockchip_sdhci_ops = {
 	.set_clock	= rockchip_sdhci_set_clock,
 	.set_ios_post	= rockchip_sdhci_set_ios_post,
 	.set_enhanced_strobe = rockchip_sdhci_set_enhanced_strobe,
+	.get_tuning	= rockchip_sdhci_get_tuning,
+	.set_tuning	= rockchip_sdhci_set_tuning,
 };
 
 static int rockchip_sdhci_probe(struct udevice *dev)
@@ -616,6 +679,8 @@ static const struct sdhci_data arasan_data = {
 static const struct sdhci_data rk3568_data = {
 	.emmc_set_clock = dwcmshc_sdhci_emmc_set_clock,
 	.get_phy = dwcmshc_emmc_get_phy,
+	.get_tuning = dwcmshc_sdhci_get_tuning,
+	.set_tuning = dwcmshc_sdhci_set_tuning,
 	.flags = RK_RXCLK_NO_INVERTER,
 	.hs200_tx_tap = 16,
 	.hs400_tx_tap = 8,
@@ -627,6 +692,8 @@ static const struct sdhci_data rk3568_data = {
 static const struct sdhci_data rk3588_data = {
 	.emmc_set_clock = dwcmshc_sdhci_emmc_set_clock,
 	.get_phy = dwcmshc_emmc_get_phy,
+	.get_tuning = dwcmshc_sdhci_get_tuning,
+	.set_tuning = dwcmshc_sdhci_set_tuning,
 	.set_ios_post = dwcmshc_sdhci_set_ios_post,
 	.set_enhanced_strobe = dwcmshc_sdhci_set_enhanced_strobe,
 	.flags = RK_DLL_CMD_OUT,
@@ -640,6 +707,8 @@ static const struct sdhci_data rk3588_data = {
 static const struct sdhci_data rk3528_data = {
 	.emmc_set_clock = dwcmshc_sdhci_emmc_set_clock,
 	.get_phy = dwcmshc_emmc_get_phy,
+	.get_tuning = dwcmshc_sdhci_get_tuning,
+	.set_tuning = dwcmshc_sdhci_set_tuning,
 	.set_ios_post = dwcmshc_sdhci_set_ios_post,
 	.set_enhanced_strobe = dwcmshc_sdhci_set_enhanced_strobe,
 	.flags = RK_DLL_CMD_OUT | RK_TAP_VALUE_SEL,
@@ -653,6 +722,8 @@ static const struct sdhci_data rk3528_data = {
 static const struct sdhci_data rk3562_data = {
 	.emmc_set_clock = dwcmshc_sdhci_emmc_set_clock,
 	.get_phy = dwcmshc_emmc_get_phy,
+	.get_tuning = dwcmshc_sdhci_get_tuning,
+	.set_tuning = dwcmshc_sdhci_set_tuning,
 	.set_ios_post = dwcmshc_sdhci_set_ios_post,
 	.set_enhanced_strobe = dwcmshc_sdhci_set_enhanced_strobe,
 	.flags = RK_DLL_CMD_OUT | RK_TAP_VALUE_SEL,
@@ -701,12 +701,36 @@ static int sdhci_set_enhanced_strobe(struct udevice *dev)
 	return -ENOTSUPP;
 }
 
+static int sdhci_get_tuning(struct udevice *dev, u32 *phase)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev);
+	struct sdhci_host *host = mmc->priv;
+
+	if (host->ops && host->ops->get_tuning)
+		return host->ops->get_tuning(host, phase);
+
+	return -ENOTSUPP;
+}
+
+static int sdhci_set_tuning(struct udevice *dev, u32 phase)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev);
+	struct sdhci_host *host = mmc->priv;
+
+	if (host->ops && host->ops->set_tuning)
+		return host->ops->set_tuning(host, phase);
+
+	return -ENOTSUPP;
+}
+
 const struct dm_mmc_ops sdhci_ops = {
 	.card_busy	= sdhci_card_busy,
 	.send_cmd	= sdhci_send_command,
 	.set_ios	= sdhci_set_ios,
 	.execute_tuning = sdhci_execute_tuning,
 	.set_enhanced_strobe = sdhci_set_enhanced_strobe,
+	.get_tuning	= sdhci_get_tuning,
+	.set_tuning	= sdhci_set_tuning,
 };
 #else
 static const struct mmc_ops sdhci_ops = {
@@ -11,6 +11,7 @@
 #include <dm.h>
 #include <malloc.h>
 #include <net.h>
+#include <asm/eth.h>
 #include <asm/test.h>
 
 DECLARE_GLOBAL_DATA_PTR;
@@ -20,17 +21,22 @@ DECLARE_GLOBAL_DATA_PTR;
  *
  * fake_host_hwaddr: MAC address of mocked machine
  * fake_host_ipaddr: IP address of mocked machine
- * recv_packet_buffer: buffer of the packet returned as received
- * recv_packet_length: length of the packet returned as received
+ * recv_packet_buffer: buffers of the packets returned as received
+ * recv_packet_length: lengths of the packets returned as received
+ * recv_packet_head: index of the next packet returned as received
+ * recv_packets: number of packets waiting to be returned as received
  */
 struct eth_sandbox_priv {
 	uchar fake_host_hwaddr[ARP_HLEN];
 	struct in_addr fake_host_ipaddr;
-	uchar *recv_packet_buffer;
-	int recv_packet_length;
+	uchar *recv_packet_buffer[PKTBUFSRX];
+	int recv_packet_length[PKTBUFSRX];
+	int recv_packet_head;
+	int recv_packets;
 };
 
 static bool disabled[8] = {false};
+static sandbox_eth_tx_hand_f *tx_handler[8];
 static bool skip_timeout;
 
 /*
@@ -47,23 +53,84 @@ void sandbox_eth_disable_response(int index, bool disable)
 /*
  * sandbox_eth_skip_timeout()
  *
- * When the first packet read is attempted, fast-forward time
+ * When a packet read next finds nothing to receive, fast-forward time
  */
 void sandbox_eth_skip_timeout(void)
 {
 	skip_timeout = true;
 }
 
+/*
+ * sandbox_eth_set_tx_handler()
+ *
+ * index - The alias index (also DM seq number)
+ * handler - Called with each sent packet before the mock responses, or NULL
+ */
+void sandbox_eth_set_tx_handler(int index, sandbox_eth_tx_hand_f *handler)
+{
+	tx_handler[index] = handler;
+}
+
+/*
+ * Get the buffer for the next packet to be returned as received, or NULL if
+ * they are all in use. One is kept back for the packet being processed.
+ */
+static uchar *sb_eth_recv_buffer(struct eth_sandbox_priv *priv)
+{
+	int i = priv->recv_packet_head + priv->recv_packets;
+
+	if (priv->recv_packets >= PKTBUFSRX - 1)
+		return NULL;
+
+	return priv->recv_packet_buffer[i % PKTBUFSRX];
+}
+
+/* Queue the packet put in sb_eth_recv_buffer() to be returned as received */
+static void sb_eth_recv_queue(struct eth_sandbox_priv *priv, int length)
+{
+	int i = priv->recv_packet_head + priv->recv_packets;
+
+	priv->recv_packet_length[i % PKTBUFSRX] = length;
+	priv->recv_packets++;
+}
+
+/*
+ * sandbox_eth_recv_packet()
+ *
+ * dev - Device which should receive the packet
+ * packet, length - The packet, starting with the Ethernet header
+ */
+int sandbox_eth_recv_packet(struct udevice *dev, const void *packet,
+			    int length)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	uchar *buffer = sb_eth_recv_buffer(priv);
+
+	if (!buffer)
+		return -ENOSPC;
+	if (length > PKTSIZE_ALIGN)
+		return -EINVAL;
+
+	memcpy(buffer, packet, length);
+	sb_eth_recv_queue(priv, length);
+
+	return 0;
+}
+
 static int sb_eth_start(struct udevice *dev)
 {
 	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	int i;
 
 	debug("eth_sandbox: Start\n");
 
 	fdtdec_get_byte_array(gd->fdt_blob, dev_of_offset(dev),
 			      "fake-host-hwaddr", priv->fake_host_hwaddr,
 			      ARP_HLEN);
-	priv->recv_packet_buffer = net_rx_packets[0];
+	for (i = 0; i < PKTBUFSRX; i++)
+		priv->recv_packet_buffer[i] = net_rx_packets[i];
+	priv->recv_packet_head = 0;
+	priv->recv_packets = 0;
 	return 0;
 }
 
@@ -78,6 +145,10 @@ static int sb_eth_send(struct udevice *dev, void *packet, int length)
 	    disabled[dev->seq])
 		return 0;
 
+	if (dev->seq >= 0 && dev->seq < ARRAY_SIZE(tx_handler) &&
+	    tx_handler[dev->seq] && tx_handler[dev->seq](dev, packet, length))
+		return 0;
+
 	if (ntohs(eth->et_protlen) == PROT_ARP) {
 		struct arp_hdr *arp = packet + ETHER_HDR_SIZE;
 
@@ -85,17 +156,18 @@ static int sb_eth_send(struct udevice *dev, void *packet, int length)
 			struct ethernet_hdr *eth_recv;
 			struct arp_hdr *arp_recv;
 
+			eth_recv = (void *)sb_eth_recv_buffer(priv);
+			if (!eth_recv)
+				return 0;
 			/* store this as the assumed IP of the fake host */
 			priv->fake_host_ipaddr = net_read_ip(&arp->ar_tpa);
 			/* Formulate a fake response */
-			eth_recv = (void *)priv->recv_packet_buffer;
 			memcpy(eth_recv->et_dest, eth->et_src, ARP_HLEN);
 			memcpy(eth_recv->et_src, priv->fake_host_hwaddr,
 			       ARP_HLEN);
 			eth_recv->et_protlen = htons(PROT_ARP);
 
-			arp_recv = (void *)priv->recv_packet_buffer +
-				ETHER_HDR_SIZE;
+			arp_recv = (void *)eth_recv + ETHER_HDR_SIZE;
 			arp_recv->ar_hrd = htons(ARP_ETHER);
 			arp_recv->ar_pro = htons(PROT_IP);
 			arp_recv->ar_hln = ARP_HLEN;
@@ -107,8 +179,7 @@ static int sb_eth_send(struct udevice *dev, void *packet, int length)
 			memcpy(&arp_recv->ar_tha, &arp->ar_sha, ARP_HLEN);
 			net_copy_ip(&arp_recv->ar_tpa, &arp->ar_spa);
 
-			priv->recv_packet_length = ETHER_HDR_SIZE +
-				ARP_HDR_SIZE;
+			sb_eth_recv_queue(priv, ETHER_HDR_SIZE + ARP_HDR_SIZE);
 		}
 	} else if (ntohs(eth->et_protlen) == PROT_IP) {
 		struct ip_udp_hdr *ip = packet + ETHER_HDR_SIZE;
@@ -122,11 +193,11 @@ static int sb_eth_send(struct udevice *dev, void *packet, int length)
 				struct icmp_hdr *icmpr;
 
 				/* reply to the ping */
-				memcpy(priv->recv_packet_buffer, packet,
-				       length);
-				eth_recv = (void *)priv->recv_packet_buffer;
-				ipr = (void *)priv->recv_packet_buffer +
-					ETHER_HDR_SIZE;
+				eth_recv = (void *)sb_eth_recv_buffer(priv);
+				if (!eth_recv)
+					return 0;
+				memcpy(eth_recv, packet, length);
+				ipr = (void *)eth_recv + ETHER_HDR_SIZE;
 				icmpr = (struct icmp_hdr *)&ipr->udp_src;
 				memcpy(eth_recv->et_dest, eth->et_src,
 				       ARP_HLEN);
@@ -145,7 +216,7 @@ static int sb_eth_send(struct udevice *dev, void *packet, int length)
 				icmpr->checksum = compute_ip_checksum(icmpr,
 					ICMP_HDR_SIZE);
 
-				priv->recv_packet_length = length;
+				sb_eth_recv_queue(priv, length);
 			}
 		}
 	}
@@ -157,19 +228,20 @@ static int sb_eth_recv(struct udevice *dev, int flags, uchar **packetp)
 {
 	struct eth_sandbox_priv *priv = dev_get_priv(dev);
 
-	if (skip_timeout) {
+	if (skip_timeout && !priv->recv_packets) {
 		sandbox_timer_add_offset(11000UL);
 		skip_timeout = false;
 	}
 
-	if (priv->recv_packet_length) {
-		int lcl_recv_packet_length = priv->recv_packet_length;
+	if (priv->recv_packets) {
+		int i = priv->recv_packet_head;
 
 		debug("eth_sandbox: received packet %d\n",
-		      priv->recv_packet_length);
-		priv->recv_packet_length = 0;
-		*packetp = priv->recv_packet_buffer;
-		return lcl_recv_packet_length;
+		      priv->recv_packet_length[i]);
+		priv->recv_packet_head = (i + 1) % PKTBUFSRX;
+		priv->recv_packets--;
+		*packetp = priv->recv_packet_buffer[i];
+		return priv->recv_packet_length[i];
 	}
 	return 0;
 }
@@ -176,25 +176,50 @@ static void nvme_submit_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
 	nvmeq->sq_tail = tail;
 }
 
-static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
-				struct nvme_command *cmd,
-				u32 *result, unsigned timeout)
+static void nvme_advance_cq(struct nvme_queue *nvmeq)
 {
-	u16 head = nvmeq->cq_head;
-	u16 phase = nvmeq->cq_phase;
-	u16 status;
+	if (++nvmeq->cq_head == nvmeq->q_depth) {
+		nvmeq->cq_head = 0;
+		nvmeq->cq_phase = !nvmeq->cq_phase;
+	}
+	writel(nvmeq->cq_head, nvmeq->q_db + nvmeq->dev->db_stride);
+}
+
+/**
+ * nvme_complete_cmd() - reap the completion of a command from a queue
+ *
+ * Only one command is in flight on a queue at a time, so completions of
+ * other commands can only be stale ones. They are reported and dropped.
+ *
+ * @nvmeq:	The queue to use
+ * @cid:	Command ID of the command to complete
+ * @result:	Returns the command-specific result, if not NULL
+ * @timeout:	Timeout, in units of 100ms, or 0 to wait forever
+ * @wait:	false to return -EBUSY rather than wait for the command
+ * @return 0 if OK, -EBUSY if not complete yet, other -ve on error
+ */
+static int nvme_complete_cmd(struct nvme_queue *nvmeq, __le16 cid,
+			     u32 *result, unsigned timeout, bool wait)
+{
+	u16 status, id;
 	ulong start_time;
 	ulong timeout_us = timeout * 100000;
 
-	cmd->common.command_id = nvme_get_cmd_id();
-	nvme_submit_cmd(nvmeq, cmd);
-
 	start_time = timer_get_us();
 
 	for (;;) {
-		status = nvme_read_completion_status(nvmeq, head);
-		if ((status & 0x01) == phase)
-			break;
+		status = nvme_read_completion_status(nvmeq, nvmeq->cq_head);
+		if ((status & 0x01) == nvmeq->cq_phase) {
+			id = readw(&nvmeq->cqes[nvmeq->cq_head].command_id);
+			if (id == cid)
+				break;
+			printf("ERROR: unexpected completion of command %d\n",
+			       le16_to_cpu(id));
+			nvme_advance_cq(nvmeq);
+			continue;
+		}
+		if (!wait)
+			return -EBUSY;
 		if (timeout_us > 0 && (timer_get_us() - start_time)
 		    >= timeout_us)
 			return -ETIMEDOUT;
@@ -203,31 +228,28 @@ static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
 	status >>= 1;
 	if (status) {
 		printf("ERROR: status = %x, phase = %d, head = %d\n",
-		       status, phase, head);
-		status = 0;
-		if (++head == nvmeq->q_depth) {
-			head = 0;
-			phase = !phase;
-		}
-		writel(head, nvmeq->q_db + nvmeq->dev->db_stride);
-		nvmeq->cq_head = head;
-		nvmeq->cq_phase = phase;
+		       status, nvmeq->cq_phase, nvmeq->cq_head);
+		nvme_advance_cq(nvmeq);
 
 		return -EIO;
 	}
 
 	if (result)
-		*result = readl(&(nvmeq->cqes[head].result));
+		*result = readl(&(nvmeq->cqes[nvmeq->cq_head].result));
+	nvme_advance_cq(nvmeq);
 
-	if (++head == nvmeq->q_depth) {
-		head = 0;
-		phase = !phase;
-	}
-	writel(head, nvmeq->q_db + nvmeq->dev->db_stride);
-	nvmeq->cq_head = head;
-	nvmeq->cq_phase = phase;
+	return 0;
+}
+
+static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
+				struct nvme_command *cmd,
+				u32 *result, unsigned timeout)
+{
+	cmd->common.command_id = nvme_get_cmd_id();
+	nvme_submit_cmd(nvmeq, cmd);
 
-	return status;
+	return nvme_complete_cmd(nvmeq, cmd->common.command_id, result,
+				 timeout, true);
 }
 
 static int nvme_submit_admin_cmd(struct nvme_dev *dev, struct nvme_command *cmd,
@@ -729,6 +751,108 @@ static int nvme_blk_probe(struct udevice *udev)
 	return 0;
 }
 
+static void nvme_setup_rw_cmd(struct nvme_ns *ns, struct nvme_command *c,
+			      bool read)
+{
+	c->rw.opcode = read ? nvme_cmd_read : nvme_cmd_write;
+	c->rw.flags = 0;
+	c->rw.nsid = cpu_to_le32(ns->ns_id);
+	c->rw.control = 0;
+	c->rw.dsmgmt = 0;
+	c->rw.reftag = 0;
+	c->rw.apptag = 0;
+	c->rw.appmask = 0;
+	c->rw.metadata = 0;
+
+	/* Enable FUA for data integrity if vwc is enabled */
+	if (ns->dev->vwc)
+		c->rw.control |= NVME_RW_FUA;
+}
+
+#if CONFIG_IS_ENABLED(BLK_ASYNC)
+/*
+ * Only one command is kept in flight per controller, as the PRP list pool
+ * and the I/O queues are shared by all its namespaces. Reads larger than
+ * one command are returned to the uclass, which reads them synchronously.
+ */
+static int nvme_blk_read_async(struct udevice *udev, lbaint_t blknr,
+			       lbaint_t blkcnt, void *buffer)
+{
+	struct nvme_ns *ns = dev_get_priv(udev);
+	struct nvme_dev *dev = ns->dev;
+	struct blk_desc *desc = dev_get_uclass_platdata(udev);
+	u64 total_len = blkcnt << desc->log2blksz;
+	struct nvme_command c;
+	u64 prp2;
+
+	if (dev->async_ns)
+		return -EBUSY;
+	if (!blkcnt ||
+	    blkcnt > 1 << (dev->max_transfer_shift - ns->lba_shift))
+		return -E2BIG;
+
+	flush_dcache_range((unsigned long)buffer,
+			   (unsigned long)buffer + total_len);
+
+	nvme_setup_rw_cmd(ns, &c, true);
+	if (nvme_setup_prps(dev, &prp2, total_len, (uintptr_t)buffer))
+		return -EIO;
+	c.rw.slba = cpu_to_le64(blknr);
+	c.rw.length = cpu_to_le16(blkcnt - 1);
+	c.rw.prp1 = cpu_to_le64((uintptr_t)buffer);
+	c.rw.prp2 = cpu_to_le64(prp2);
+	c.common.command_id = nvme_get_cmd_id();
+	nvme_submit_cmd(dev->queues[NVME_IO_Q], &c);
+
+	dev->async_ns = ns;
+	dev->async_cid = c.common.command_id;
+	dev->async_buffer = buffer;
+	dev->async_blkcnt = blkcnt;
+	dev->async_status = -EBUSY;
+
+	return 0;
+}
+
+/* Reap the read in flight on a controller, keeping its status */
+static void nvme_async_reap(struct nvme_dev *dev, bool wait)
+{
+	ulong buffer = (ulong)dev->async_buffer;
+	int status;
+
+	if (!dev->async_ns || dev->async_status != -EBUSY)
+		return;
+
+	status = nvme_complete_cmd(dev->queues[NVME_IO_Q], dev->async_cid,
+				   NULL, IO_TIMEOUT, wait);
+	if (status == -EBUSY)
+		return;
+
+	invalidate_dcache_range(buffer, buffer + (dev->async_blkcnt <<
+						  dev->async_ns->lba_shift));
+	dev->async_status = status;
+}
+
+static long nvme_blk_read_complete(struct udevice *udev, bool wait)
+{
+	struct nvme_ns *ns = dev_get_priv(udev);
+	struct nvme_dev *dev = ns->dev;
+	int status;
+
+	if (dev->async_ns != ns)
+		return -ENOENT;
+
+	nvme_async_reap(dev, wait);
+	status = dev->async_status;
+	if (status == -EBUSY)
+		return status;
+	dev->async_ns = NULL;
+
+	return status ? status : dev->async_blkcnt;
+}
+#else
+static inline void nvme_async_reap(struct nvme_dev *dev, bool wait) {}
+#endif
+
 static ulong nvme_blk_rw(struct udevice *udev, lbaint_t blknr,
 			 lbaint_t blkcnt, void *buffer, bool read)
 {
@@ -746,22 +870,13 @@ static ulong nvme_blk_rw(struct udevice *udev, lbaint_t blknr,
 	u16 lbas = 1 << (dev->max_transfer_shift - ns->lba_shift);
 	u64 total_lbas = blkcnt;
 
+	/* Another namespace may have a read in flight on the I/O queue */
+	nvme_async_reap(dev, true);
+
 	flush_dcache_range((unsigned long)buffer,
 			   (unsigned long)buffer + total_len);
 
-	c.rw.opcode = read ? nvme_cmd_read : nvme_cmd_write;
-	c.rw.flags = 0;
-	c.rw.nsid = cpu_to_le32(ns->ns_id);
-	c.rw.control = 0;
-	c.rw.dsmgmt = 0;
-	c.rw.reftag = 0;
-	c.rw.apptag = 0;
-	c.rw.appmask = 0;
-	c.rw.metadata = 0;
-
-	/* Enable FUA for data integrity if vwc is enabled */
-	if (dev->vwc)
-		c.rw.control |= NVME_RW_FUA;
+	nvme_setup_rw_cmd(ns, &c, read);
 
 	while (total_lbas) {
 		if (total_lbas < lbas) {
@@ -809,6 +924,10 @@ static ulong nvme_blk_write(struct udevice *udev, lbaint_t blknr,
 static const struct blk_ops nvme_blk_ops = {
 	.read	= nvme_blk_read,
 	.write	= nvme_blk_write,
+#if CONFIG_IS_ENABLED(BLK_ASYNC)
+	.read_async	= nvme_blk_read_async,
+	.read_complete	= nvme_blk_read_complete,
+#endif
 };
 
 U_BOOT_DRIVER(nvme_blk) = {
@@ -628,6 +628,13 @@ struct nvme_dev {
 	u64 *prp_pool;
 	u32 prp_entry_num;
 	u32 nn;
+#if CONFIG_IS_ENABLED(BLK_ASYNC)
+	struct nvme_ns *async_ns;	/* owner of the read in flight, or NULL */
+	__le16 async_cid;
+	void *async_buffer;
+	lbaint_t async_blkcnt;
+	int async_status;	/* -EBUSY until the read has completed */
+#endif
 };
 
 /*
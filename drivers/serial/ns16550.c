@@ -444,8 +444,8 @@ static int ns16550_serial_putc(struct udevice *dev, const char ch)
 	 *	0 = Transmit FIFO is full;
 	 *	1 = Transmit FIFO is not full;
 	 */
-	while (!(serial_in(&com_port->rbr + 0x1f) & 0x02))
-		;
+	if (!(serial_in(&com_port->rbr + 0x1f) & 0x02))
+		return -EAGAIN;
 	serial_out(ch, &com_port->thr);
 
 	/*
@@ -467,7 +467,7 @@ static int ns16550_serial_pending(struct udevice *dev, bool input)
 	if (input)
 		return serial_in(&com_port->lsr) & UART_LSR_DR ? 1 : 0;
 	else
-		return serial_in(&com_port->lsr) & UART_LSR_THRE ? 0 : 1;
+		return serial_in(&com_port->lsr) & UART_LSR_TEMT ? 0 : 1;
 }
 
 static int ns16550_serial_getc(struct udevice *dev)
@@ -504,10 +504,12 @@ static int ns16550_serial_clear(struct udevice *dev)
 
 int ns16550_serial_probe(struct udevice *dev)
 {
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
 	struct NS16550 *const com_port = dev_get_priv(dev);
 
 	com_port->plat = dev_get_platdata(dev);
 	NS16550_init(com_port, -1);
+	upriv->tx_buffered = true;
 
 	return 0;
 }
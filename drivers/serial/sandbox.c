@@ -19,6 +19,7 @@
 #include <video.h>
 #include <linux/compiler.h>
 #include <asm/state.h>
+#include <asm/test.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -39,8 +40,22 @@ struct sandbox_serial_platdata {
 	int colour;	/* Text colour to use for output, -1 for none */
 };
 
+/**
+ * struct sandbox_serial_priv - private data for a sandbox UART
+ *
+ * @start_of_line:	true if the next character starts a line
+ * @tx_buf:		Buffer that takes the output in tests, NULL for stdout
+ * @tx_size:		Size of @tx_buf
+ * @tx_len:		Number of characters in @tx_buf
+ * @tx_room:		Characters putc() takes before it returns -EAGAIN, as
+ *			if the TX FIFO were full, -1 for no limit
+ */
 struct sandbox_serial_priv {
 	bool start_of_line;
+	char *tx_buf;
+	int tx_size;
+	int tx_len;
+	int tx_room;
 };
 
 /**
@@ -64,11 +79,14 @@ static void output_ansi_reset(void)
 static int sandbox_serial_probe(struct udevice *dev)
 {
 	struct sandbox_state *state = state_get_current();
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
 	struct sandbox_serial_priv *priv = dev_get_priv(dev);
 
 	if (state->term_raw != STATE_TERM_COOKED)
 		os_tty_raw(0, state->term_raw == STATE_TERM_RAW_WITH_SIGS);
 	priv->start_of_line = 0;
+	priv->tx_room = -1;
+	upriv->tx_buffered = true;
 
 	return 0;
 }
@@ -83,11 +101,40 @@ static int sandbox_serial_remove(struct udevice *dev)
 	return 0;
 }
 
+void sandbox_serial_tx_capture(struct udevice *dev, char *buf, int size)
+{
+	struct sandbox_serial_priv *priv = dev_get_priv(dev);
+
+	priv->tx_buf = buf;
+	priv->tx_size = size;
+	priv->tx_len = 0;
+	priv->tx_room = buf ? 0 : -1;
+}
+
+int sandbox_serial_tx_room(struct udevice *dev, int room)
+{
+	struct sandbox_serial_priv *priv = dev_get_priv(dev);
+
+	priv->tx_room = room;
+
+	return priv->tx_len;
+}
+
 static int sandbox_serial_putc(struct udevice *dev, const char ch)
 {
 	struct sandbox_serial_priv *priv = dev_get_priv(dev);
 	struct sandbox_serial_platdata *plat = dev->platdata;
 
+	if (priv->tx_buf) {
+		if (!priv->tx_room)
+			return -EAGAIN;
+		if (priv->tx_room > 0)
+			priv->tx_room--;
+		if (priv->tx_len < priv->tx_size)
+			priv->tx_buf[priv->tx_len++] = ch;
+		return 0;
+	}
+
 	if (priv->start_of_line && plat->colour != -1) {
 		priv->start_of_line = false;
 		output_ansi_colour(plat->colour);
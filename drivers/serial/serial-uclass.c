@@ -146,6 +146,59 @@ void serial_initialize(void)
 	serial_init();
 }
 
+#if CONFIG_IS_ENABLED(SERIAL_TX_BUFFER)
+/* Move as much of the TX buffer to the UART as it takes now */
+static void serial_tx_drain(struct udevice *dev)
+{
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+	struct dm_serial_ops *ops = serial_get_ops(dev);
+	char *data;
+	int len, i;
+
+	if (!upriv->txbuf.start)
+		return;
+
+	/* The data may wrap around the end of the buffer */
+	do {
+		len = membuff_getraw(&upriv->txbuf, -1, false, &data);
+		for (i = 0; i < len; i++) {
+			if (ops->putc(dev, data[i]) == -EAGAIN)
+				break;
+		}
+		membuff_getraw(&upriv->txbuf, i, true, &data);
+	} while (len && i == len);
+}
+
+/*
+ * Put @ch in the TX buffer, behind what is waiting there. It only waits
+ * for the UART when the buffer is full.
+ */
+static bool serial_tx_put(struct udevice *dev, char ch)
+{
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+	struct dm_serial_ops *ops = serial_get_ops(dev);
+
+	if (!upriv->txbuf.start)
+		return false;
+
+	serial_tx_drain(dev);
+	if (membuff_isempty(&upriv->txbuf) && ops->putc(dev, ch) != -EAGAIN)
+		return true;
+
+	while (!membuff_putbyte(&upriv->txbuf, ch))
+		serial_tx_drain(dev);
+
+	return true;
+}
+#else
+static inline void serial_tx_drain(struct udevice *dev) {}
+
+static inline bool serial_tx_put(struct udevice *dev, char ch)
+{
+	return false;
+}
+#endif
+
 static void _serial_putc(struct udevice *dev, char ch)
 {
 	struct dm_serial_ops *ops = serial_get_ops(dev);
@@ -154,6 +207,9 @@ static void _serial_putc(struct udevice *dev, char ch)
 	if (ch == '\n')
 		_serial_putc(dev, '\r');
 
+	if (serial_tx_put(dev, ch))
+		return;
+
 	do {
 		err = ops->putc(dev, ch);
 	} while (err == -EAGAIN);
@@ -172,8 +228,10 @@ static int __serial_getc(struct udevice *dev)
 
 	do {
 		err = ops->getc(dev);
-		if (err == -EAGAIN)
+		if (err == -EAGAIN) {
 			WATCHDOG_RESET();
+			serial_tx_drain(dev);
+		}
 	} while (err == -EAGAIN);
 
 	return err >= 0 ? err : 0;
@@ -183,6 +241,9 @@ static int __serial_tstc(struct udevice *dev)
 {
 	struct dm_serial_ops *ops = serial_get_ops(dev);
 
+	/* Polling for input, e.g. by ctrlc(), is a chance to send output */
+	serial_tx_drain(dev);
+
 	if (ops->pending)
 		return ops->pending(dev, true);
 
@@ -197,6 +258,26 @@ static void __serial_clear(struct udevice *dev)
 		ops->clear(dev);
 }
 
+static void __serial_flush(struct udevice *dev)
+{
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+	struct dm_serial_ops *ops = serial_get_ops(dev);
+	int err;
+
+	if (!CONFIG_IS_ENABLED(SERIAL_TX_BUFFER) || !upriv->tx_buffered)
+		return;
+
+	while (upriv->txbuf.start && !membuff_isempty(&upriv->txbuf))
+		serial_tx_drain(dev);
+
+	/* Wait for the last of it to leave the UART too */
+	if (ops->pending) {
+		do {
+			err = ops->pending(dev, false);
+		} while (err > 0);
+	}
+}
+
 #if CONFIG_IS_ENABLED(SERIAL_RX_BUFFER)
 static int _serial_tstc(struct udevice *dev)
 {
@@ -277,8 +358,10 @@ void serial_setbrg(void)
 	}
 
 	ops = serial_get_ops(gd->cur_serial_dev);
-	if (ops->setbrg)
+	if (ops->setbrg) {
+		__serial_flush(gd->cur_serial_dev);
 		ops->setbrg(gd->cur_serial_dev, gd->baudrate);
+	}
 }
 
 void serial_clear(void)
@@ -289,6 +372,12 @@ void serial_clear(void)
 		debug_uart_clrc();
 }
 
+void serial_flush(void)
+{
+	if (gd->cur_serial_dev)
+		__serial_flush(gd->cur_serial_dev);
+}
+
 void serial_dev_putc(struct udevice *dev, char ch)
 {
 	if (!dev)
@@ -329,8 +418,10 @@ void serial_dev_setbrg(struct udevice *dev, int baudrate)
 		return;
 
 	ops = serial_get_ops(dev);
-	if (ops->setbrg)
+	if (ops->setbrg) {
+		__serial_flush(dev);
 		ops->setbrg(dev, baudrate);
+	}
 }
 
 void serial_dev_clear(struct udevice *dev)
@@ -483,6 +574,12 @@ static int serial_post_probe(struct udevice *dev)
 	/* Allocate the RX buffer */
 	upriv->buf = malloc(CONFIG_SERIAL_RX_BUFFER_SIZE);
 #endif
+#if CONFIG_IS_ENABLED(SERIAL_TX_BUFFER)
+	/* Without one, output just waits for the UART as before */
+	if (upriv->tx_buffered &&
+	    membuff_new(&upriv->txbuf, CONFIG_SERIAL_TX_BUFFER_SIZE))
+		membuff_uninit(&upriv->txbuf);
+#endif
 
 	stdio_register_dev(&sdev, &upriv->sdev);
 #endif
@@ -491,12 +588,17 @@ static int serial_post_probe(struct udevice *dev)
 
 static int serial_pre_remove(struct udevice *dev)
 {
-#if CONFIG_IS_ENABLED(SYS_STDIO_DEREGISTER)
 	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
 
+#if CONFIG_IS_ENABLED(SYS_STDIO_DEREGISTER)
 	if (stdio_deregister_dev(upriv->sdev, true))
 		return -EPERM;
 #endif
+	if (upriv->txbuf.start) {
+		__serial_flush(dev);
+		free(upriv->txbuf.start);
+		membuff_uninit(&upriv->txbuf);
+	}
 
 	return 0;
 }
@@ -67,6 +67,8 @@ void sysreset_walk_halt(enum sysreset_t type)
 {
 	int ret;
 
+	/* Send what is buffered, e.g. "resetting ...", before it is lost */
+	flushc();
 	ret = sysreset_walk(type);
 
 	/* Wait for the reset to take effect */
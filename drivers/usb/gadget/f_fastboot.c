@@ -21,6 +21,7 @@
 #include <linux/usb/gadget.h>
 #include <linux/usb/composite.h>
 #include <linux/compiler.h>
+#include <linux/sizes.h>
 #include <u-boot/sha256.h>
 #include <version.h>
 #include <g_dnl.h>
@@ -58,6 +59,7 @@
 #define TX_ENDPOINT_MAXIMUM_PACKET_SIZE      (0x0040)
 
 #define EP_BUFFER_SIZE			4096
+#define EP_STREAM_BUFFER_SIZE		SZ_256K
 #define SLEEP_COUNT 20000
 #define MAX_PART_NUM_STR_SIZE 4
 #define PARTITION_TYPE_STRINGS "partition-type"
@@ -87,6 +89,15 @@ static unsigned int download_bytes;
 static unsigned int upload_size;
 static unsigned int upload_bytes;
 static bool start_upload;
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+static char stream_next[32];	/* partition for the next download */
+static char stream_part[32];	/* partition of the streamed download */
+static bool stream_active;	/* download is being written to it */
+static bool stream_failed;	/* writing it failed */
+static void *stream_rx_buf[2];	/* streamed data is received into each in turn */
+static int stream_rx_cur;	/* the one being received into */
+static void *stream_cmd_buf;	/* the OUT request's own buffer meanwhile */
+#endif
 static unsigned intthread_wakeup_needed;
 
 static struct usb_endpoint_descriptor fs_ep_in = {
@@ -387,6 +398,48 @@ static void fastboot_unbind(struct usb_configuration *c, struct usb_function *f)
 	memset(fastboot_func, 0, sizeof(*fastboot_func));
 }
 
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+/*
+ * A streamed download is received into two large buffers in turn: the OUT
+ * request is queued on one before the data in the other is written, so
+ * that the next piece arrives while the eMMC is busy.
+ */
+static int stream_rx_start(struct usb_request *req)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(stream_rx_buf); i++) {
+		if (stream_rx_buf[i])
+			continue;
+		stream_rx_buf[i] = memalign(CONFIG_SYS_CACHELINE_SIZE,
+					    EP_STREAM_BUFFER_SIZE);
+		if (!stream_rx_buf[i])
+			return -ENOMEM;
+	}
+
+	stream_cmd_buf = req->buf;
+	stream_rx_cur = 0;
+	req->buf = stream_rx_buf[0];
+
+	return 0;
+}
+
+/* Give the request its own buffer back and drop the receive buffers */
+static void stream_rx_stop(struct usb_request *req)
+{
+	int i;
+
+	if (stream_cmd_buf) {
+		req->buf = stream_cmd_buf;
+		stream_cmd_buf = NULL;
+	}
+	for (i = 0; i < ARRAY_SIZE(stream_rx_buf); i++) {
+		free(stream_rx_buf[i]);
+		stream_rx_buf[i] = NULL;
+	}
+}
+#endif
+
 static void fastboot_disable(struct usb_function *f)
 {
 	struct f_fastboot *f_fb = func_to_fastboot(f);
@@ -394,6 +447,10 @@ static void fastboot_disable(struct usb_function *f)
 	usb_ep_disable(f_fb->out_ep);
 	usb_ep_disable(f_fb->in_ep);
 
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+	if (f_fb->out_req)
+		stream_rx_stop(f_fb->out_req);
+#endif
 	if (f_fb->out_req) {
 		free(f_fb->out_req->buf);
 		usb_ep_free_request(f_fb->out_ep, f_fb->out_req);
@@ -1539,7 +1596,7 @@ static void cb_getvar(struct usb_ep *ep, struct usb_request *req)
 	return;
 }
 
-static unsigned int rx_bytes_expected(struct usb_ep *ep)
+static unsigned int rx_bytes_expected(struct usb_ep *ep, unsigned int bufsize)
 {
 	int rx_remain = download_size - download_bytes;
 	unsigned int rem;
@@ -1547,8 +1604,8 @@ static unsigned int rx_bytes_expected(struct usb_ep *ep)
 
 	if (rx_remain <= 0)
 		return 0;
-	else if (rx_remain > EP_BUFFER_SIZE)
-		return EP_BUFFER_SIZE;
+	else if (rx_remain > bufsize)
+		return bufsize;
 
 	/*
 	 * Some controllers e.g. DWC3 don't like OUT transfers to be
@@ -1571,6 +1628,8 @@ static void rx_handler_dl_image(struct usb_ep *ep, struct usb_request *req)
 	const unsigned char *buffer = req->buf;
 	unsigned int buffer_size = req->actual;
 	unsigned int pre_dot_num, now_dot_num;
+	unsigned int bufsize = EP_BUFFER_SIZE;
+	bool done;
 
 	if (req->status != 0) {
 		printf("Bad status: %d\n", req->status);
@@ -1580,6 +1639,9 @@ static void rx_handler_dl_image(struct usb_ep *ep, struct usb_request *req)
 	if (buffer_size < transfer_size)
 		transfer_size = buffer_size;
 
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+	if (!stream_active)
+#endif
 	memcpy((void *)CONFIG_FASTBOOT_BUF_ADDR + download_bytes,
 	       buffer, transfer_size);
 
@@ -1594,7 +1656,22 @@ static void rx_handler_dl_image(struct usb_ep *ep, struct usb_request *req)
 	}
 
 	/* Check if transfer is done */
-	if (download_bytes >= download_size) {
+	done = download_bytes >= download_size;
+
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+	/* Receive the next piece, or command, before writing this one */
+	if (stream_active) {
+		if (done) {
+			req->buf = stream_cmd_buf;
+			stream_cmd_buf = NULL;
+		} else {
+			stream_rx_cur = !stream_rx_cur;
+			req->buf = stream_rx_buf[stream_rx_cur];
+			bufsize = EP_STREAM_BUFFER_SIZE;
+		}
+	}
+#endif
+	if (done) {
 		/*
 		 * Reset global transfer variable, keep download_bytes because
 		 * it will be used in the next possible flashing command
@@ -1602,17 +1679,34 @@ static void rx_handler_dl_image(struct usb_ep *ep, struct usb_request *req)
 		download_size = 0;
 		req->complete = rx_handler_command;
 		req->length = EP_BUFFER_SIZE;
+	} else {
+		req->length = rx_bytes_expected(ep, bufsize);
+	}
+
+	req->actual = 0;
+	usb_ep_queue(ep, req, 0);
+
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+	/* the rest is received and dropped, then the download fails */
+	if (stream_active && !stream_failed &&
+	    fb_mmc_stream_write(buffer, transfer_size))
+		stream_failed = true;
+#endif
 
+	if (done) {
 		strcpy(response, "OKAY");
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+		if (stream_active)
+			stream_rx_stop(req);
+		if (stream_failed) {
+			fb_mmc_stream_finish(stream_part, response);
+			stream_active = false;
+		}
+#endif
 		fastboot_tx_write_str(response);
 
 		printf("\ndownloading of %d bytes finished\n", download_bytes);
-	} else {
-		req->length = rx_bytes_expected(ep);
 	}
-
-	req->actual = 0;
-	usb_ep_queue(ep, req, 0);
 }
 
 static void cb_download(struct usb_ep *ep, struct usb_request *req)
@@ -1626,15 +1720,50 @@ static void cb_download(struct usb_ep *ep, struct usb_request *req)
 
 	printf("Starting download of %d bytes\n", download_size);
 
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+	/* A streamed image which was never flashed is dropped */
+	if (stream_active) {
+		fb_mmc_stream_abort();
+		stream_active = false;
+	}
+	stream_failed = false;
+	if (download_size && stream_next[0]) {
+		strcpy(stream_part, stream_next);
+		if (fb_mmc_stream_start(stream_part, response)) {
+			download_size = 0;
+			fastboot_tx_write_str(response);
+			return;
+		}
+		stream_active = true;
+	}
+	/* "oem stream" applies to one download only */
+	stream_next[0] = '\0';
+#endif
+
 	if (0 == download_size) {
 		strcpy(response, "FAILdata invalid size");
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+	} else if (stream_active) {
+		if (stream_rx_start(req)) {
+			stream_rx_stop(req);
+			fb_mmc_stream_abort();
+			stream_active = false;
+			download_size = 0;
+			strcpy(response, "FAILMalloc failed for stream buffers");
+		} else {
+			sprintf(response, "DATA%08x", download_size);
+			req->complete = rx_handler_dl_image;
+			req->length = rx_bytes_expected(ep,
+							EP_STREAM_BUFFER_SIZE);
+		}
+#endif
 	} else if (download_size > CONFIG_FASTBOOT_BUF_SIZE) {
 		download_size = 0;
 		strcpy(response, "FAILdata too large");
 	} else {
 		sprintf(response, "DATA%08x", download_size);
 		req->complete = rx_handler_dl_image;
-		req->length = rx_bytes_expected(ep);
+		req->length = rx_bytes_expected(ep, EP_BUFFER_SIZE);
 	}
 
 	fastboot_tx_write_str(response);
@@ -1783,10 +1912,9 @@ static void cb_set_active(struct usb_ep *ep, struct usb_request *req)
 }
 
 #ifdef CONFIG_FASTBOOT_FLASH
-static void cb_flash(struct usb_ep *ep, struct usb_request *req)
+/* Fail the command and return false if the device may not be flashed */
+static bool fb_flash_unlocked(void)
 {
-	char *cmd = req->buf;
-	char response[FASTBOOT_RESPONSE_LEN] = {0};
 #ifdef CONFIG_RK_AVB_LIBAVB_USER
 	uint8_t flash_lock_state;
 
@@ -1794,36 +1922,73 @@ static void cb_flash(struct usb_ep *ep, struct usb_request *req)
 		/* write the device flashing unlock when first read */
 		if (rk_avb_write_flash_lock_state(1)) {
 			fastboot_tx_write_str("FAILflash lock state write failure");
-			return;
+			return false;
 		}
 		if (rk_avb_read_flash_lock_state(&flash_lock_state)) {
 			fastboot_tx_write_str("FAILflash lock state read failure");
-			return;
+			return false;
 		}
 	}
 
 	if (flash_lock_state == 0) {
 		fastboot_tx_write_str("FAILThe device is locked, can not flash!");
 		printf("The device is locked, can not flash!\n");
-		return;
+		return false;
 	}
 #endif
-	strsep(&cmd, ":");
-	if (!cmd) {
-		pr_err("missing partition name");
-		fastboot_tx_write_str("FAILmissing partition name");
-		return;
-	}
+	return true;
+}
+
+/* Fail the command and return false if @part may not be flashed now */
+static bool fb_flash_part_allowed(const char *part)
+{
 #ifdef CONFIG_ANDROID_AB
-	if ((strcmp(cmd, PART_USERDATA) == 0) || (strcmp(cmd, PART_METADATA) == 0)) {
+	if ((strcmp(part, PART_USERDATA) == 0) || (strcmp(part, PART_METADATA) == 0)) {
 		if (should_prevent_userdata_wipe()) {
 			pr_err("FAILThe virtual A/B merging, can not flash userdata or metadata!\n");
 			fastboot_tx_write_str("FAILvirtual A/B merging,abort flash!");
-			return;
+			return false;
 		}
 	}
 #endif
+	return true;
+}
+
+static void cb_flash(struct usb_ep *ep, struct usb_request *req)
+{
+	char *cmd = req->buf;
+	char response[FASTBOOT_RESPONSE_LEN] = {0};
+
+	if (!fb_flash_unlocked())
+		return;
+
+	strsep(&cmd, ":");
+	if (!cmd) {
+		pr_err("missing partition name");
+		fastboot_tx_write_str("FAILmissing partition name");
+		return;
+	}
+	if (!fb_flash_part_allowed(cmd))
+		return;
+
 	fastboot_fail("no flash device defined", response);
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+	if (stream_active) {
+		char stream_response[FASTBOOT_RESPONSE_LEN];
+
+		/* the image was written while it was downloaded */
+		fb_mmc_stream_finish(stream_part, stream_response);
+		if (strcmp(cmd, stream_part))
+			fastboot_fail("image was streamed to another partition",
+				      response);
+		else
+			strcpy(response, stream_response);
+		stream_active = false;
+		stream_part[0] = '\0';
+		fastboot_tx_write_str(response);
+		return;
+	}
+#endif
 #ifdef CONFIG_FASTBOOT_FLASH_MMC_DEV
 	fb_mmc_flash_write(cmd, (void *)CONFIG_FASTBOOT_BUF_ADDR,
 				download_bytes, response);
@@ -2031,6 +2196,20 @@ static void cb_oem(struct usb_ep *ep, struct usb_request *req)
 		fastboot_tx_write_str("OKAY");
 #endif
 	} else
+#endif
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+	if (strncmp("stream:", cmd + 4, 7) == 0) {
+		stream_next[0] = '\0';
+		if (strlen(cmd + 11) >= sizeof(stream_next)) {
+			fastboot_tx_write_str("FAILpartition name too long");
+			return;
+		}
+		if (!fb_flash_unlocked() || !fb_flash_part_allowed(cmd + 11))
+			return;
+		strcpy(stream_next, cmd + 11);
+		printf("next download is written to '%s'\n", stream_next);
+		fastboot_tx_write_str("OKAY");
+	} else
 #endif
 	if (strncmp("unlock", cmd + 4, 8) == 0) {
 #ifdef CONFIG_FASTBOOT_OEM_UNLOCK
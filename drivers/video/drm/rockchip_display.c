@@ -17,6 +17,8 @@
 #include <linux/compat.h>
 #include <linux/media-bus-format.h>
 #include <malloc.h>
+#include <u-boot/crc.h>
+#include <u-boot/lz4.h>
 #include <video.h>
 #include <video_rockchip.h>
 #include <video_bridge.h>
@@ -57,7 +59,6 @@ static unsigned long memory_start;
 static unsigned long cubic_lut_memory_start;
 static unsigned long memory_end;
 static struct base2_info base_parameter;
-static uint32_t crc32_table[256];
 
 /*
  * the phy types are used by different connectors in public.
@@ -76,39 +77,10 @@ struct public_phy_data {
 	bool phy_init;
 };
 
-void rockchip_display_make_crc32_table(void)
-{
-	uint32_t c;
-	int n, k;
-	unsigned long poly;		/* polynomial exclusive-or pattern */
-	/* terms of polynomial defining this crc (except x^32): */
-	static const char p[] = {0, 1, 2, 4, 5, 7, 8, 10, 11, 12, 16, 22, 23, 26};
-
-	/* make exclusive-or pattern from polynomial (0xedb88320L) */
-	poly = 0L;
-	for (n = 0; n < sizeof(p) / sizeof(char); n++)
-		poly |= 1L << (31 - p[n]);
-
-	for (n = 0; n < 256; n++) {
-		c = (unsigned long)n;
-		for (k = 0; k < 8; k++)
-		c = c & 1 ? poly ^ (c >> 1) : c >> 1;
-		crc32_table[n] = cpu_to_le32(c);
-	}
-}
-
+/* Despite the name, this is the CRC32 of zlib, not CRC32C */
 uint32_t rockchip_display_crc32c_cal(unsigned char *data, int length)
 {
-	int i;
-	uint32_t crc;
-	crc = 0xFFFFFFFF;
-
-	for (i = 0; i < length; i++) {
-		crc = crc32_table[(crc ^ *data) & 0xff] ^ (crc >> 8);
-		data++;
-	}
-
-	return crc ^ 0xffffffff;
+	return crc32(0, data, length);
 }
 
 int rockchip_get_baseparameter(void)
@@ -141,7 +113,6 @@ int rockchip_get_baseparameter(void)
 		printf("warning: bad baseparameter\n");
 		memset(&base_parameter, 0, sizeof(base_parameter));
 	}
-	rockchip_display_make_crc32_table();
 
 	return ret;
 }
@@ -1315,12 +1286,173 @@ static int load_kernel_bmp_logo(struct logo_info *logo, const char *bmp_name)
 	return 0;
 }
 
+#ifdef CONFIG_ROCKCHIP_RESOURCE_IMAGE
+static bool logo_is_compressed(const void *buf)
+{
+	const u8 *p = buf;
+
+	if (IS_ENABLED(CONFIG_GZIP) && p[0] == 0x1f && p[1] == 0x8b)
+		return true;
+	if (IS_ENABLED(CONFIG_LZ4) && lz4_is_valid_header(buf))
+		return true;
+
+	return false;
+}
+
+/*
+ * Decompress a gzip or LZ4 compressed logo file straight into the display
+ * buffer, where it is shown from. The hardware decompressor is used if
+ * there is one.
+ */
+static void *load_compressed_logo(const char *name, int *sizep)
+{
+	ulong dst = roundup(memory_end, PAGE_SIZE);
+	ulong room = memory_start + MEMORY_POOL_SIZE - dst;
+	unsigned long gzip_len;
+	size_t len = room;
+	void *src;
+	int size;
+	int ret = -ENOSYS;
+
+	size = rockchip_get_resource_file_size(name);
+	if (size <= 0)
+		return NULL;
+
+	src = memalign(ARCH_DMA_MINALIGN, ALIGN(size, RK_BLK_SIZE));
+	if (!src)
+		return NULL;
+
+	if (rockchip_read_resource_file(src, name, 0, size) != size) {
+		ret = -EIO;
+	} else if (IS_ENABLED(CONFIG_LZ4) && lz4_is_valid_header(src)) {
+		ret = ulz4fn(src, size, (void *)dst, &len);
+	} else if (IS_ENABLED(CONFIG_GZIP)) {
+		gzip_len = size;
+		ret = gunzip((void *)dst, room, src, &gzip_len);
+		len = gzip_len;
+	}
+	free(src);
+	if (ret) {
+		printf("failed to decompress logo %s, ret=%d\n", name, ret);
+		return NULL;
+	}
+
+	*sizep = len;
+
+	/* Claim what was decompressed in place */
+	return get_display_buffer(len);
+}
+
+static bool logo_fb_valid(const struct rockchip_logo_fb *fb, int size)
+{
+	u32 width = le32_to_cpu(fb->width);
+	u32 height = le32_to_cpu(fb->height);
+	u32 bpp = le32_to_cpu(fb->bpp);
+
+	if (memcmp(fb->magic, ROCKCHIP_LOGO_FB_MAGIC, sizeof(fb->magic)))
+		return false;
+	if (bpp != 16 && bpp != 24 && bpp != 32)
+		return false;
+	if ((u64)le32_to_cpu(fb->data_offset) +
+	    (u64)ALIGN(width * bpp / 8, 4) * height > size)
+		return false;
+
+	return true;
+}
+
+/*
+ * Check that the .fb was made from "<bmp_name>" as it is now. The BMP may
+ * have been updated since, e.g. from the logo partition, even to one of
+ * the same size. Only the size and SHA1 that the resource image records
+ * for it are compared, so nothing more is read. A BMP without a hash, as
+ * from the logo partition, cannot be matched and the .fb is not used.
+ */
+static bool logo_fb_current(const struct rockchip_logo_fb *fb,
+			    const char *bmp_name)
+{
+	int src_size, hash_size;
+	char *hash;
+
+	src_size = rockchip_get_resource_file_size(bmp_name);
+	if (src_size < 0)
+		return true;
+
+	hash_size = rockchip_get_resource_file_hash(bmp_name, &hash);
+	if (src_size != le32_to_cpu(fb->src_size) ||
+	    hash_size != sizeof(fb->src_sha1) ||
+	    memcmp(hash, fb->src_sha1, sizeof(fb->src_sha1))) {
+		printf("%s.fb is out of date, ignored\n", bmp_name);
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Use "<bmp_name>.fb", the logo converted ahead of time, so that it is
+ * read straight to where it is shown from.
+ */
+static int load_fb_logo(struct logo_info *logo, const char *bmp_name)
+{
+	struct rockchip_logo_fb *fb;
+	char name[MAX_FILE_NAME_LEN];
+	bool compressed;
+	int size, len;
+	void *header;
+
+	snprintf(name, sizeof(name), "%s.fb", bmp_name);
+	size = rockchip_get_resource_file_size(name);
+	if (size < (int)sizeof(*fb))
+		return -ENOENT;
+
+	header = malloc(RK_BLK_SIZE);
+	if (!header)
+		return -ENOMEM;
+
+	len = rockchip_read_resource_file(header, name, 0, RK_BLK_SIZE);
+	if (len < (int)sizeof(*fb)) {
+		free(header);
+		return -EIO;
+	}
+
+	compressed = logo_is_compressed(header);
+	if (compressed) {
+		fb = load_compressed_logo(name, &size);
+	} else if (logo_fb_valid(header, size) &&
+		   logo_fb_current(header, bmp_name)) {
+		fb = get_display_buffer(size);
+		if (fb && rockchip_read_resource_file(fb, name, 0, size) != size)
+			fb = NULL;
+	} else {
+		fb = NULL;
+	}
+	free(header);
+
+	if (!fb || !logo_fb_valid(fb, size) ||
+	    (compressed && !logo_fb_current(fb, bmp_name)))
+		return -EINVAL;
+
+	logo->mem = (char *)fb;
+	logo->offset = le32_to_cpu(fb->data_offset);
+	logo->width = le32_to_cpu(fb->width);
+	logo->height = le32_to_cpu(fb->height);
+	logo->bpp = le32_to_cpu(fb->bpp);
+	logo->ymirror = 0;
+
+	flush_dcache_range((ulong)fb, ALIGN((ulong)fb + size,
+					    CONFIG_SYS_CACHELINE_SIZE));
+
+	return 0;
+}
+#endif
+
 static int load_bmp_logo(struct logo_info *logo, const char *bmp_name)
 {
 #ifdef CONFIG_ROCKCHIP_RESOURCE_IMAGE
 	struct rockchip_logo_cache *logo_cache;
 	struct bmp_header *header;
-	void *dst = NULL, *pdst;
+	void *dst = NULL, *pdst = NULL;
+	bool compressed;
 	int size, len;
 	int ret = 0;
 	int reserved = 0;
@@ -1337,6 +1469,11 @@ static int load_bmp_logo(struct logo_info *logo, const char *bmp_name)
 		return 0;
 	}
 
+	if (!load_fb_logo(logo, bmp_name)) {
+		memcpy(&logo_cache->logo, logo, sizeof(*logo));
+		return 0;
+	}
+
 	header = malloc(RK_BLK_SIZE);
 	if (!header)
 		return -ENOMEM;
@@ -1347,6 +1484,16 @@ static int load_bmp_logo(struct logo_info *logo, const char *bmp_name)
 		goto free_header;
 	}
 
+	compressed = logo_is_compressed(header);
+	if (compressed) {
+		pdst = load_compressed_logo(bmp_name, &size);
+		if (!pdst) {
+			ret = -EINVAL;
+			goto free_header;
+		}
+		memcpy(header, pdst, sizeof(*header));
+	}
+
 	logo->bpp = get_unaligned_le16(&header->bit_count);
 	logo->width = get_unaligned_le32(&header->width);
 	logo->height = get_unaligned_le32(&header->height);
@@ -1355,24 +1502,30 @@ static int load_bmp_logo(struct logo_info *logo, const char *bmp_name)
 	if (logo->height < 0)
 	    logo->height = -logo->height;
 	size = get_unaligned_le32(&header->file_size);
-	if (!can_direct_logo(logo->bpp)) {
-		if (size > MEMORY_POOL_SIZE) {
-			printf("failed to use boot buf as temp bmp buffer\n");
-			ret = -ENOMEM;
-			goto free_header;
-		}
-		pdst = get_display_buffer(size);
-
+	if (compressed) {
+		/* Decompressed to the display buffer already */
+		if (can_direct_logo(logo->bpp))
+			dst = pdst;
 	} else {
-		pdst = get_display_buffer(size);
-		dst = pdst;
-	}
+		if (!can_direct_logo(logo->bpp)) {
+			if (size > MEMORY_POOL_SIZE) {
+				printf("failed to use boot buf as temp bmp buffer\n");
+				ret = -ENOMEM;
+				goto free_header;
+			}
+			pdst = get_display_buffer(size);
 
-	len = rockchip_read_resource_file(pdst, bmp_name, 0, size);
-	if (len != size) {
-		printf("failed to load bmp %s\n", bmp_name);
-		ret = -ENOENT;
-		goto free_header;
+		} else {
+			pdst = get_display_buffer(size);
+			dst = pdst;
+		}
+
+		len = rockchip_read_resource_file(pdst, bmp_name, 0, size);
+		if (len != size) {
+			printf("failed to load bmp %s\n", bmp_name);
+			ret = -ENOENT;
+			goto free_header;
+		}
 	}
 
 	if (!can_direct_logo(logo->bpp)) {
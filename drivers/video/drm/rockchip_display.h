@@ -248,6 +248,24 @@ struct logo_info {
 	u32 bpp;
 };
 
+#define ROCKCHIP_LOGO_FB_MAGIC	"RKFB"
+
+/*
+ * Header of "<logo>.fb" in the resource image: "<logo>" converted ahead of
+ * time to a format the VOP scans out, so that showing it needs no decoding.
+ * Rows follow at @data_offset top first, each padded to 4 bytes like in a
+ * BMP. The file may be gzip or LZ4 compressed as a whole.
+ */
+struct rockchip_logo_fb {
+	char magic[4];		/* ROCKCHIP_LOGO_FB_MAGIC */
+	__le32 width;
+	__le32 height;
+	__le32 bpp;		/* 16, 24 or 32 */
+	__le32 src_size;	/* size of "<logo>" it was made from, as stored */
+	u8 src_sha1[20];	/* SHA1 of "<logo>", as stored */
+	__le32 data_offset;	/* from the start of this header */
+} __packed;
+
 struct rockchip_logo_cache {
 	struct list_head head;
 	char name[20];
@@ -1523,45 +1523,6 @@ void ext4fs_allocate_blocks(struct ext2_inode *file_inode,
 
 #endif
 
-static struct ext4_extent_header *ext4fs_get_extent_block
-	(struct ext2_data *data, char *buf,
-		struct ext4_extent_header *ext_block,
-		uint32_t fileblock, int log2_blksz)
-{
-	struct ext4_extent_idx *index;
-	unsigned long long block;
-	int blksz = EXT2_BLOCK_SIZE(data);
-	int i;
-
-	while (1) {
-		index = (struct ext4_extent_idx *)(ext_block + 1);
-
-		if (le16_to_cpu(ext_block->eh_magic) != EXT4_EXT_MAGIC)
-			return NULL;
-
-		if (ext_block->eh_depth == 0)
-			return ext_block;
-		i = -1;
-		do {
-			i++;
-			if (i >= le16_to_cpu(ext_block->eh_entries))
-				break;
-		} while (fileblock >= le32_to_cpu(index[i].ei_block));
-
-		if (--i < 0)
-			return NULL;
-
-		block = le16_to_cpu(index[i].ei_leaf_hi);
-		block = (block << 32) + le32_to_cpu(index[i].ei_leaf_lo);
-
-		if (ext4fs_devread((lbaint_t)block << log2_blksz, 0, blksz,
-				   buf))
-			ext_block = (struct ext4_extent_header *)buf;
-		else
-			return NULL;
-	}
-}
-
 static int ext4fs_blockgroup
 	(struct ext2_data *data, int group, struct ext2_block_group *blkgrp)
 {
@@ -1615,6 +1576,173 @@ int ext4fs_read_inode(struct ext2_data *data, int ino, struct ext2_inode *inode)
 	return 1;
 }
 
+/*
+ * Extent tree index and leaf blocks are kept across reads of the same
+ * filesystem, so mapping a file does not re-read them for every run. Any
+ * write to the device drops them.
+ */
+#define EXT4_EXTENT_CACHE_BLOCKS	8
+
+/* ee_len above this marks an uninitialized extent, which reads as zeroes */
+#define EXT4_EXT_INIT_MAX_LEN		(1 << 15)
+
+static struct {
+	struct blk_desc *dev_desc;
+	unsigned long write_seq;
+	unsigned char hwpart;
+	lbaint_t part_offset;
+	__le32 unique_id[4];
+	int blksz;
+	ulong stamp;
+	struct {
+		unsigned long long block;	/* 0 if unused */
+		ulong stamp;
+		char *buf;
+	} node[EXT4_EXTENT_CACHE_BLOCKS];
+} ext4_extent_cache;
+
+void ext4fs_extent_cache_drop(void)
+{
+	int i;
+
+	for (i = 0; i < EXT4_EXTENT_CACHE_BLOCKS; i++) {
+		free(ext4_extent_cache.node[i].buf);
+		ext4_extent_cache.node[i].buf = NULL;
+		ext4_extent_cache.node[i].block = 0;
+	}
+	ext4_extent_cache.dev_desc = NULL;
+}
+
+/*
+ * Keep the cached blocks only if they belong to the filesystem mounted now
+ * and nothing has written to its device since they were read
+ */
+static void ext4fs_extent_cache_check(struct ext2_sblock *sblock)
+{
+	struct ext_filesystem *fs = get_fs();
+
+	if (ext4_extent_cache.dev_desc == fs->dev_desc &&
+	    ext4_extent_cache.write_seq == fs->dev_desc->write_seq &&
+	    ext4_extent_cache.hwpart == fs->dev_desc->hwpart &&
+	    ext4_extent_cache.part_offset == part_offset &&
+	    ext4_extent_cache.blksz == EXT2_BLOCK_SIZE(ext4fs_root) &&
+	    !memcmp(ext4_extent_cache.unique_id, sblock->unique_id,
+		    sizeof(sblock->unique_id)))
+		return;
+
+	ext4fs_extent_cache_drop();
+	ext4_extent_cache.dev_desc = fs->dev_desc;
+	ext4_extent_cache.write_seq = fs->dev_desc->write_seq;
+	ext4_extent_cache.hwpart = fs->dev_desc->hwpart;
+	ext4_extent_cache.part_offset = part_offset;
+	ext4_extent_cache.blksz = EXT2_BLOCK_SIZE(ext4fs_root);
+	memcpy(ext4_extent_cache.unique_id, sblock->unique_id,
+	       sizeof(sblock->unique_id));
+}
+
+static struct ext4_extent_header *ext4fs_extent_node(unsigned long long block)
+{
+	int blksz = EXT2_BLOCK_SIZE(ext4fs_root);
+	int log2_blksz = LOG2_BLOCK_SIZE(ext4fs_root) -
+			 get_fs()->dev_desc->log2blksz;
+	int i, victim = 0;
+
+	for (i = 0; i < EXT4_EXTENT_CACHE_BLOCKS; i++) {
+		if (ext4_extent_cache.node[i].block == block)
+			goto out;
+		if (ext4_extent_cache.node[i].stamp <
+		    ext4_extent_cache.node[victim].stamp)
+			victim = i;
+	}
+
+	i = victim;
+	if (!ext4_extent_cache.node[i].buf) {
+		ext4_extent_cache.node[i].buf = zalloc(blksz);
+		if (!ext4_extent_cache.node[i].buf)
+			return NULL;
+	}
+
+	ext4_extent_cache.node[i].block = 0;
+	if (!ext4fs_devread((lbaint_t)block << log2_blksz, 0, blksz,
+			    ext4_extent_cache.node[i].buf))
+		return NULL;
+	ext4_extent_cache.node[i].block = block;
+out:
+	ext4_extent_cache.node[i].stamp = ++ext4_extent_cache.stamp;
+
+	return (struct ext4_extent_header *)ext4_extent_cache.node[i].buf;
+}
+
+static long int ext4fs_map_extent(struct ext2_inode *inode, lbaint_t fileblock,
+				  lbaint_t max, long int *blknr)
+{
+	struct ext4_extent_header *eh;
+	struct ext4_extent_idx *index;
+	struct ext4_extent *extent;
+	unsigned long long block;
+	lbaint_t limit = fileblock + max;
+	lbaint_t start, len;
+	int entries, uninit;
+	int i;
+
+	eh = (struct ext4_extent_header *)inode->b.blocks.dir_blocks;
+	while (1) {
+		if (le16_to_cpu(eh->eh_magic) != EXT4_EXT_MAGIC)
+			return -EINVAL;
+
+		entries = le16_to_cpu(eh->eh_entries);
+		if (eh->eh_depth == 0)
+			break;
+
+		index = (struct ext4_extent_idx *)(eh + 1);
+		for (i = 0; i < entries; i++) {
+			if (fileblock < le32_to_cpu(index[i].ei_block))
+				break;
+		}
+		if (--i < 0)
+			return -EINVAL;
+
+		/* Nothing past the next index entry is found below this one */
+		if (i + 1 < entries)
+			limit = min(limit,
+				    (lbaint_t)le32_to_cpu(index[i + 1].ei_block));
+
+		block = le16_to_cpu(index[i].ei_leaf_hi);
+		block = (block << 32) + le32_to_cpu(index[i].ei_leaf_lo);
+		eh = ext4fs_extent_node(block);
+		if (!eh)
+			return -EIO;
+	}
+
+	extent = (struct ext4_extent *)(eh + 1);
+	for (i = 0; i < entries; i++) {
+		start = le32_to_cpu(extent[i].ee_block);
+		len = le16_to_cpu(extent[i].ee_len);
+		uninit = len > EXT4_EXT_INIT_MAX_LEN;
+		if (uninit)
+			len -= EXT4_EXT_INIT_MAX_LEN;
+
+		if (start > fileblock) {
+			/* Sparse file */
+			limit = min(limit, start);
+			break;
+		}
+
+		if (fileblock < start + len) {
+			block = le16_to_cpu(extent[i].ee_start_hi);
+			block = (block << 32) +
+				le32_to_cpu(extent[i].ee_start_lo);
+			*blknr = uninit ? 0 : block + (fileblock - start);
+
+			return min(limit, start + len) - fileblock;
+		}
+	}
+
+	*blknr = 0;
+
+	return limit - fileblock;
+}
+
 long int read_allocated_block(struct ext2_inode *inode, int fileblock)
 {
 	long int blknr;
@@ -1624,53 +1752,18 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock)
 	long int rblock;
 	long int perblock_parent;
 	long int perblock_child;
-	unsigned long long start;
 	/* get the blocksize of the filesystem */
 	blksz = EXT2_BLOCK_SIZE(ext4fs_root);
 	log2_blksz = LOG2_BLOCK_SIZE(ext4fs_root)
 		- get_fs()->dev_desc->log2blksz;
 
 	if (le32_to_cpu(inode->flags) & EXT4_EXTENTS_FL) {
-		long int startblock, endblock;
-		char *buf = zalloc(blksz);
-		if (!buf)
-			return -ENOMEM;
-		struct ext4_extent_header *ext_block;
-		struct ext4_extent *extent;
-		int i;
-		ext_block =
-			ext4fs_get_extent_block(ext4fs_root, buf,
-						(struct ext4_extent_header *)
-						inode->b.blocks.dir_blocks,
-						fileblock, log2_blksz);
-		if (!ext_block) {
+		if (ext4fs_map_extent(inode, fileblock, 1, &blknr) < 0) {
 			printf("invalid extent block\n");
-			free(buf);
 			return -EINVAL;
 		}
 
-		extent = (struct ext4_extent *)(ext_block + 1);
-
-		for (i = 0; i < le16_to_cpu(ext_block->eh_entries); i++) {
-			startblock = le32_to_cpu(extent[i].ee_block);
-			endblock = startblock + le16_to_cpu(extent[i].ee_len);
-
-			if (startblock > fileblock) {
-				/* Sparse file */
-				free(buf);
-				return 0;
-
-			} else if (fileblock < endblock) {
-				start = le16_to_cpu(extent[i].ee_start_hi);
-				start = (start << 32) +
-					le32_to_cpu(extent[i].ee_start_lo);
-				free(buf);
-				return (fileblock - startblock) + start;
-			}
-		}
-
-		free(buf);
-		return 0;
+		return blknr;
 	}
 
 	/* Direct blocks. */
@@ -1958,6 +2051,44 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock)
 	return blknr;
 }
 
+/**
+ * ext4fs_map_blocks() - map a run of file blocks to the disk
+ *
+ * Extent mapped files are resolved a whole extent at a time, indirect
+ * mapped ones block by block from the cached indirect blocks.
+ *
+ * @inode:	Inode of the file
+ * @fileblock:	First file block to map
+ * @max:	Most blocks the caller is interested in, at least 1
+ * @blknr:	Returns the filesystem block holding @fileblock, 0 for a hole
+ * @return number of blocks from @fileblock on that are contiguous on the
+ *	   disk, or all a hole; negative on error
+ */
+long int ext4fs_map_blocks(struct ext2_inode *inode, lbaint_t fileblock,
+			   lbaint_t max, long int *blknr)
+{
+	long int first, next;
+	long int run;
+
+	if (le32_to_cpu(inode->flags) & EXT4_EXTENTS_FL)
+		return ext4fs_map_extent(inode, fileblock, max, blknr);
+
+	first = read_allocated_block(inode, fileblock);
+	if (first < 0)
+		return first;
+
+	for (run = 1; run < max; run++) {
+		next = read_allocated_block(inode, fileblock + run);
+		if (next < 0)
+			return next;
+		if (next != (first ? first + run : 0))
+			break;
+	}
+	*blknr = first;
+
+	return run;
+}
+
 /**
  * ext4fs_reinit_global() - Reinitialize values of ext4 write implementation's
  *			    global pointers
@@ -2375,6 +2506,7 @@ int ext4fs_mount(unsigned part_length)
 		goto fail;
 
 	ext4fs_root = data;
+	ext4fs_extent_cache_check(&data->sblock);
 
 	return 1;
 fail:
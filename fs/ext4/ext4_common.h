@@ -52,6 +52,9 @@ int ext4fs_read_inode(struct ext2_data *data, int ino,
 		      struct ext2_inode *inode);
 int ext4fs_read_file(struct ext2fs_node *node, loff_t pos, loff_t len,
 		     char *buf, loff_t *actread);
+long int ext4fs_map_blocks(struct ext2_inode *inode, lbaint_t fileblock,
+			   lbaint_t max, long int *blknr);
+void ext4fs_extent_cache_drop(void);
 int ext4fs_find_file(const char *path, struct ext2fs_node *rootnode,
 			struct ext2fs_node **foundnode, int expecttype);
 int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
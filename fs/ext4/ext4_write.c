@@ -590,6 +590,9 @@ int ext4fs_init(void)
 	uint32_t real_free_blocks = 0;
 	struct ext_filesystem *fs = get_fs();
 
+	/* Blocks freed or written from now on may have held extent nodes */
+	ext4fs_extent_cache_drop();
+
 	/* populate fs */
 	fs->blksz = EXT2_BLOCK_SIZE(ext4fs_root);
 	fs->sect_perblk = fs->blksz >> fs->dev_desc->log2blksz;
@@ -746,6 +749,8 @@ void ext4fs_deinit(void)
 	fs->first_pass_bbmap = 0;
 	fs->curr_inode_no = 0;
 	fs->curr_blkno = 0;
+
+	ext4fs_extent_cache_drop();
 }
 
 /*
@@ -42,27 +42,27 @@ void ext4fs_free_node(struct ext2fs_node *node, struct ext2fs_node *currroot)
 }
 
 /*
- * Taken from openmoko-kernel mailing list: By Andy green
- * Optimized read file API : collects and defers contiguous sector
- * reads into one potentially more efficient larger sequential read action
+ * Read 'len' bytes from 'pos' in the file. Each run of blocks that is
+ * contiguous on the disk is mapped once and read with a single
+ * ext4fs_devread(); consecutive runs are merged when they line up.
  */
 int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 		loff_t len, char *buf, loff_t *actread)
 {
 	struct ext_filesystem *fs = get_fs();
-	int i;
-	lbaint_t blockcnt;
 	int log2blksz = fs->dev_desc->log2blksz;
 	int log2_fs_blocksize = LOG2_BLOCK_SIZE(node->data) - log2blksz;
 	int blocksize = (1 << (log2_fs_blocksize + log2blksz));
 	unsigned int filesize = le32_to_cpu(node->inode.size);
-	lbaint_t previous_block_number = -1;
+	lbaint_t fileblock, blockcnt;
 	lbaint_t delayed_start = 0;
-	lbaint_t delayed_extent = 0;
-	lbaint_t delayed_skipfirst = 0;
 	lbaint_t delayed_next = 0;
+	int delayed_skipfirst = 0;
+	int delayed_extent = 0;
 	char *delayed_buf = NULL;
-	short status;
+	long int blknr, run;
+	loff_t remain, n;
+	int skipfirst;
 
 	if (blocksize <= 0)
 		return -1;
@@ -72,93 +72,54 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 		len = (filesize - pos);
 
 	blockcnt = lldiv(((len + pos) + blocksize - 1), blocksize);
-
-	for (i = lldiv(pos, blocksize); i < blockcnt; i++) {
-		long int blknr;
-		int blockoff = pos - (blocksize * i);
-		int blockend = blocksize;
-		int skipfirst = 0;
-		blknr = read_allocated_block(&(node->inode), i);
-		if (blknr < 0)
+	fileblock = lldiv(pos, blocksize);
+	skipfirst = pos - (loff_t)blocksize * fileblock;
+
+	for (remain = len; remain > 0; remain -= n) {
+		run = ext4fs_map_blocks(&node->inode, fileblock,
+					min(blockcnt - fileblock,
+					    (lbaint_t)(INT_MAX / blocksize)),
+					&blknr);
+		if (run < 0)
 			return -1;
 
-		blknr = blknr << log2_fs_blocksize;
-
-		/* Last block.  */
-		if (i == blockcnt - 1) {
-			blockend = (len + pos) - (blocksize * i);
-
-			/* The last portion is exactly blocksize. */
-			if (!blockend)
-				blockend = blocksize;
+		n = min((loff_t)run * blocksize - skipfirst, remain);
+		blknr <<= log2_fs_blocksize;
+
+		/* ext4fs_devread() takes an int length, spill before that */
+		if (delayed_extent &&
+		    (!blknr || blknr != delayed_next ||
+		     delayed_extent + n > INT_MAX)) {
+			if (!ext4fs_devread(delayed_start, delayed_skipfirst,
+					    delayed_extent, delayed_buf))
+				return -1;
+			delayed_extent = 0;
 		}
 
-		/* First block. */
-		if (i == lldiv(pos, blocksize)) {
-			skipfirst = blockoff;
-			blockend -= skipfirst;
-		}
-		if (blknr) {
-			int status;
-
-			if (previous_block_number != -1) {
-				if (delayed_next == blknr) {
-					delayed_extent += blockend;
-					delayed_next += blockend >> log2blksz;
-				} else {	/* spill */
-					status = ext4fs_devread(delayed_start,
-							delayed_skipfirst,
-							delayed_extent,
-							delayed_buf);
-					if (status == 0)
-						return -1;
-					previous_block_number = blknr;
-					delayed_start = blknr;
-					delayed_extent = blockend;
-					delayed_skipfirst = skipfirst;
-					delayed_buf = buf;
-					delayed_next = blknr +
-						(blockend >> log2blksz);
-				}
-			} else {
-				previous_block_number = blknr;
-				delayed_start = blknr;
-				delayed_extent = blockend;
-				delayed_skipfirst = skipfirst;
-				delayed_buf = buf;
-				delayed_next = blknr +
-					(blockend >> log2blksz);
-			}
-		} else {
-			int n;
-			if (previous_block_number != -1) {
-				/* spill */
-				status = ext4fs_devread(delayed_start,
-							delayed_skipfirst,
-							delayed_extent,
-							delayed_buf);
-				if (status == 0)
-					return -1;
-				previous_block_number = -1;
-			}
-			/* Zero no more than `len' bytes. */
-			n = blocksize - skipfirst;
-			if (n > len)
-				n = len;
+		if (!blknr) {
 			memset(buf, 0, n);
+		} else if (delayed_extent) {
+			delayed_extent += n;
+			delayed_next += (lbaint_t)run << log2_fs_blocksize;
+		} else {
+			delayed_start = blknr;
+			delayed_skipfirst = skipfirst;
+			delayed_extent = n;
+			delayed_buf = buf;
+			delayed_next = blknr +
+				((lbaint_t)run << log2_fs_blocksize);
 		}
-		buf += blocksize - skipfirst;
-	}
-	if (previous_block_number != -1) {
-		/* spill */
-		status = ext4fs_devread(delayed_start,
-					delayed_skipfirst, delayed_extent,
-					delayed_buf);
-		if (status == 0)
-			return -1;
-		previous_block_number = -1;
+
+		buf += n;
+		fileblock += run;
+		skipfirst = 0;
 	}
 
+	if (delayed_extent &&
+	    !ext4fs_devread(delayed_start, delayed_skipfirst, delayed_extent,
+			    delayed_buf))
+		return -1;
+
 	*actread  = len;
 	return 0;
 }
@@ -21,6 +21,7 @@
 #include <memalign.h>
 #include <linux/compiler.h>
 #include <linux/ctype.h>
+#include <linux/math64.h>
 
 #ifdef CONFIG_SUPPORT_VFAT
 static const int vfat_enabled = 1;
@@ -161,6 +162,211 @@ int flush_dirty_fat_buffer(fsdata *mydata)
 }
 #endif
 
+/*
+ * The cluster chain of a file, as runs of consecutive clusters. It is
+ * extended lazily, as far as reads have needed it.
+ */
+struct fat_extent {
+	__u32 index;		/* index of the first cluster in the file */
+	__u32 clust;		/* first cluster of the run */
+	__u32 count;		/* clusters in the run */
+};
+
+struct fat_chain {
+	__u32 start;		/* first cluster of the file, 0 if unused */
+	__u32 nr_clust;		/* clusters mapped so far */
+	int nr_ext;
+	int max_ext;
+	struct fat_extent *ext;
+	int complete;		/* set once the end of the chain is mapped */
+	ulong stamp;		/* last use, for eviction */
+};
+
+#if CONFIG_IS_ENABLED(FS_FAT_CACHE)
+/*
+ * FAT windows and file cluster chains kept between reads. They are only
+ * valid for the volume they were read from, and only until something
+ * writes to its device; get_fs_info() checks both.
+ */
+struct fat_cache_win {
+	__u32 bufnum;
+	ulong stamp;
+	__u8 *buf;
+};
+
+static struct {
+	int valid;
+	struct blk_desc *dev;
+	unsigned long write_seq;
+	unsigned char hwpart;
+	lbaint_t part_start;
+	__u8 volume_id[4];
+	__u32 fatlength;
+	__u16 sect_size;
+	ulong stamp;
+	struct fat_cache_win win[CONFIG_FS_FAT_CACHE_WINDOWS];
+	struct fat_chain chain[CONFIG_FS_FAT_CACHE_FILES];
+} fat_cache;
+
+static void fat_chain_reset(struct fat_chain *chain, __u32 start)
+{
+	free(chain->ext);
+	memset(chain, 0, sizeof(*chain));
+	chain->start = start;
+}
+
+static __maybe_unused void fat_cache_invalidate(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(fat_cache.win); i++) {
+		free(fat_cache.win[i].buf);
+		fat_cache.win[i].buf = NULL;
+		fat_cache.win[i].bufnum = -1;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(fat_cache.chain); i++)
+		fat_chain_reset(&fat_cache.chain[i], 0);
+
+	fat_cache.valid = 0;
+}
+
+static void fat_cache_check(fsdata *mydata, volume_info *volinfo)
+{
+	if (fat_cache.valid && fat_cache.dev == cur_dev &&
+	    fat_cache.write_seq == cur_dev->write_seq &&
+	    fat_cache.hwpart == cur_dev->hwpart &&
+	    fat_cache.part_start == cur_part_info.start &&
+	    !memcmp(fat_cache.volume_id, volinfo->volume_id, 4) &&
+	    fat_cache.fatlength == mydata->fatlength &&
+	    fat_cache.sect_size == mydata->sect_size)
+		return;
+
+	fat_cache_invalidate();
+	fat_cache.dev = cur_dev;
+	fat_cache.write_seq = cur_dev->write_seq;
+	fat_cache.hwpart = cur_dev->hwpart;
+	fat_cache.part_start = cur_part_info.start;
+	memcpy(fat_cache.volume_id, volinfo->volume_id, 4);
+	fat_cache.fatlength = mydata->fatlength;
+	fat_cache.sect_size = mydata->sect_size;
+	fat_cache.valid = 1;
+}
+
+static int fat_cache_lookup(fsdata *mydata, __u32 bufnum, __u8 *buf)
+{
+	int i;
+
+	if (!fat_cache.valid)
+		return 0;
+
+	for (i = 0; i < ARRAY_SIZE(fat_cache.win); i++) {
+		if (fat_cache.win[i].buf && fat_cache.win[i].bufnum == bufnum) {
+			fat_cache.win[i].stamp = ++fat_cache.stamp;
+			memcpy(buf, fat_cache.win[i].buf, FATBUFSIZE);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static void fat_cache_store(fsdata *mydata, __u32 bufnum, __u8 *buf)
+{
+	struct fat_cache_win *win = &fat_cache.win[0];
+	int i;
+
+	if (!fat_cache.valid)
+		return;
+
+	for (i = 1; i < ARRAY_SIZE(fat_cache.win); i++) {
+		if (fat_cache.win[i].stamp < win->stamp)
+			win = &fat_cache.win[i];
+	}
+
+	if (!win->buf) {
+		win->buf = malloc_cache_aligned(FATBUFSIZE);
+		if (!win->buf)
+			return;
+	}
+
+	memcpy(win->buf, buf, FATBUFSIZE);
+	win->bufnum = bufnum;
+	win->stamp = ++fat_cache.stamp;
+}
+
+static struct fat_chain *fat_chain_get(__u32 start)
+{
+	struct fat_chain *chain = &fat_cache.chain[0];
+	int i;
+
+	for (i = 0; fat_cache.valid && i < ARRAY_SIZE(fat_cache.chain); i++) {
+		if (fat_cache.chain[i].start == start) {
+			chain = &fat_cache.chain[i];
+			goto out;
+		}
+		if (fat_cache.chain[i].stamp < chain->stamp)
+			chain = &fat_cache.chain[i];
+	}
+
+	/* Writers run without a valid cache, so nothing is kept for them */
+	if (!fat_cache.valid) {
+		chain = calloc(1, sizeof(*chain));
+		if (chain)
+			chain->start = start;
+		return chain;
+	}
+
+	fat_chain_reset(chain, start);
+out:
+	chain->stamp = ++fat_cache.stamp;
+
+	return chain;
+}
+
+static void fat_chain_put(struct fat_chain *chain)
+{
+	if (fat_cache.valid)
+		return;
+
+	free(chain->ext);
+	free(chain);
+}
+#else
+static inline void fat_cache_check(fsdata *mydata, volume_info *volinfo)
+{
+}
+
+static inline int fat_cache_lookup(fsdata *mydata, __u32 bufnum, __u8 *buf)
+{
+	return 0;
+}
+
+static inline void fat_cache_store(fsdata *mydata, __u32 bufnum, __u8 *buf)
+{
+}
+
+static inline void fat_cache_invalidate(void)
+{
+}
+
+static struct fat_chain *fat_chain_get(__u32 start)
+{
+	struct fat_chain *chain = calloc(1, sizeof(*chain));
+
+	if (chain)
+		chain->start = start;
+
+	return chain;
+}
+
+static void fat_chain_put(struct fat_chain *chain)
+{
+	free(chain->ext);
+	free(chain);
+}
+#endif
+
 /*
  * Get the entry at index 'entry' in a FAT (12/16/32) table.
  * On failure 0x00 is returned.
@@ -215,9 +421,12 @@ static __u32 get_fatent(fsdata *mydata, __u32 entry)
 		if (flush_dirty_fat_buffer(mydata) < 0)
 			return -1;
 
-		if (disk_read(startblock, getsize, bufptr) < 0) {
-			debug("Error reading FAT blocks\n");
-			return ret;
+		if (!fat_cache_lookup(mydata, bufnum, bufptr)) {
+			if (disk_read(startblock, getsize, bufptr) < 0) {
+				debug("Error reading FAT blocks\n");
+				return ret;
+			}
+			fat_cache_store(mydata, bufnum, bufptr);
 		}
 		mydata->fatbufnum = bufnum;
 	}
@@ -307,6 +516,91 @@ get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
 	return 0;
 }
 
+/*
+ * Map one more cluster of 'chain'. Reaching the end of the chain, or a
+ * broken FAT entry, marks the chain complete.
+ * Return 0 on success, -1 if out of memory.
+ */
+static int fat_chain_step(fsdata *mydata, struct fat_chain *chain)
+{
+	struct fat_extent *ext = NULL;
+	__u32 clust;
+
+	if (chain->nr_ext) {
+		ext = &chain->ext[chain->nr_ext - 1];
+		clust = get_fatent(mydata, ext->clust + ext->count - 1);
+	} else {
+		clust = chain->start;
+	}
+
+	if (CHECK_CLUST(clust, mydata->fatsize)) {
+		debug("curclust: 0x%x\n", clust);
+		chain->complete = 1;
+		return 0;
+	}
+
+	if (ext && clust == ext->clust + ext->count) {
+		ext->count++;
+	} else {
+		if (chain->nr_ext == chain->max_ext) {
+			int max = chain->max_ext ? chain->max_ext * 2 : 8;
+
+			ext = realloc(chain->ext, max * sizeof(*ext));
+			if (!ext)
+				return -1;
+			chain->ext = ext;
+			chain->max_ext = max;
+		}
+		ext = &chain->ext[chain->nr_ext++];
+		ext->index = chain->nr_clust;
+		ext->clust = clust;
+		ext->count = 1;
+	}
+	chain->nr_clust++;
+
+	return 0;
+}
+
+/*
+ * Find the cluster at index 'idx' in the file and how many consecutive
+ * clusters follow it, looking no further than index 'last'.
+ * Return 0 on success, -1 if the chain ends before 'idx' or on error.
+ */
+static int fat_chain_lookup(fsdata *mydata, struct fat_chain *chain,
+			    __u32 idx, __u32 last, __u32 *clust, __u32 *count)
+{
+	struct fat_extent *ext;
+	int lo, hi, mid;
+
+	/* Map up to 'idx', then on to the end of the run holding it */
+	while (!chain->complete &&
+	       (chain->nr_clust <= idx ||
+		(chain->nr_clust <= last &&
+		 chain->ext[chain->nr_ext - 1].index <= idx))) {
+		if (fat_chain_step(mydata, chain))
+			return -1;
+	}
+
+	if (idx >= chain->nr_clust)
+		return -1;
+
+	lo = 0;
+	hi = chain->nr_ext - 1;
+	while (lo < hi) {
+		mid = (lo + hi + 1) / 2;
+		if (chain->ext[mid].index <= idx)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	ext = &chain->ext[lo];
+	*clust = ext->clust + (idx - ext->index);
+	*count = ext->count - (idx - ext->index);
+
+	return 0;
+}
+
 /*
  * Read at most 'maxsize' bytes from 'pos' in the file associated with 'dentptr'
  * into 'buffer'.
@@ -320,9 +614,10 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 {
 	loff_t filesize = FAT2CPU32(dentptr->size);
 	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
-	__u32 curclust = START(dentptr);
-	__u32 endclust, newclust;
-	loff_t actsize;
+	struct fat_chain *chain;
+	__u32 idx, last, clust, count;
+	loff_t actsize, offset;
+	int ret = 0;
 
 	*gotsize = 0;
 	debug("Filesize: %llu bytes\n", filesize);
@@ -337,92 +632,63 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 
 	debug("%llu bytes\n", filesize);
 
-	actsize = bytesperclust;
+	chain = fat_chain_get(START(dentptr));
+	if (!chain) {
+		debug("Error: allocating memory\n");
+		return -1;
+	}
+
+	idx = div_u64(pos, bytesperclust);
+	last = div_u64(filesize - 1, bytesperclust);
+	offset = pos - (loff_t)idx * bytesperclust;
+	filesize -= pos;
 
-	/* go to cluster at pos */
-	while (actsize <= pos) {
-		curclust = get_fatent(mydata, curclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
+	/* Partial first cluster, through the bounce buffer */
+	if (offset) {
+		if (fat_chain_lookup(mydata, chain, idx, last, &clust, &count)) {
 			debug("Invalid FAT entry\n");
-			return 0;
+			goto out;
 		}
-		actsize += bytesperclust;
-	}
 
-	/* actsize > pos */
-	actsize -= bytesperclust;
-	filesize -= actsize;
-	pos -= actsize;
-
-	/* align to beginning of next cluster if any */
-	if (pos) {
-		actsize = min(filesize, (loff_t)bytesperclust);
-		if (get_cluster(mydata, curclust, get_contents_vfatname_block,
+		actsize = min(filesize + offset, (loff_t)bytesperclust);
+		if (get_cluster(mydata, clust, get_contents_vfatname_block,
 				(int)actsize) != 0) {
 			printf("Error reading cluster\n");
-			return -1;
+			ret = -1;
+			goto out;
 		}
-		filesize -= actsize;
-		actsize -= pos;
-		memcpy(buffer, get_contents_vfatname_block + pos, actsize);
+		actsize -= offset;
+		memcpy(buffer, get_contents_vfatname_block + offset, actsize);
 		*gotsize += actsize;
-		if (!filesize)
-			return 0;
+		filesize -= actsize;
 		buffer += actsize;
-
-		curclust = get_fatent(mydata, curclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			debug("Invalid FAT entry\n");
-			return 0;
-		}
+		idx++;
 	}
 
-	actsize = bytesperclust;
-	endclust = curclust;
-
-	do {
-		/* search for consecutive clusters */
-		while (actsize < filesize) {
-			newclust = get_fatent(mydata, endclust);
-			if ((newclust - 1) != endclust)
-				goto getit;
-			if (CHECK_CLUST(newclust, mydata->fatsize)) {
-				debug("curclust: 0x%x\n", newclust);
-				debug("Invalid FAT entry\n");
-				return 0;
-			}
-			endclust = newclust;
-			actsize += bytesperclust;
+	/* Then whole runs of consecutive clusters at a time */
+	while (filesize > 0) {
+		if (fat_chain_lookup(mydata, chain, idx, last, &clust, &count)) {
+			printf("Invalid FAT entry\n");
+			goto out;
 		}
 
-		/* get remaining bytes */
-		actsize = filesize;
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
+		actsize = min(filesize, (loff_t)count * bytesperclust);
+		if (get_cluster(mydata, clust, buffer,
+				(unsigned long)actsize) != 0) {
 			printf("Error reading cluster\n");
-			return -1;
+			ret = -1;
+			goto out;
 		}
 		*gotsize += actsize;
-		return 0;
-getit:
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
-			printf("Error reading cluster\n");
-			return -1;
-		}
-		*gotsize += (int)actsize;
 		filesize -= actsize;
 		buffer += actsize;
+		idx += count;
+	}
 
-		curclust = get_fatent(mydata, endclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			printf("Invalid FAT entry\n");
-			return 0;
-		}
-		actsize = bytesperclust;
-		endclust = curclust;
-	} while (1);
+out:
+	fat_chain_put(chain);
+
+	return ret;
 }
 
 /*
@@ -605,6 +871,8 @@ static int get_fs_info(fsdata *mydata)
 		return -1;
 	}
 
+	fat_cache_check(mydata, &volinfo);
+
 	if (vfat_enabled)
 		debug("VFAT Support enabled\n");
 
@@ -1078,11 +1078,19 @@ exit:
 int file_fat_write(const char *filename, void *buffer, loff_t offset,
 		   loff_t maxsize, loff_t *actwrite)
 {
+	int ret;
+
 	if (offset != 0) {
 		printf("Error: non zero offset is currently not supported.\n");
 		return -1;
 	}
 
 	printf("writing %s\n", filename);
-	return do_fat_write(filename, buffer, maxsize, actwrite);
+
+	/* Nothing read before is trusted once the FAT changes */
+	fat_cache_invalidate();
+	ret = do_fat_write(filename, buffer, maxsize, actwrite);
+	fat_cache_invalidate();
+
+	return ret;
 }
@@ -157,6 +157,30 @@ struct AvbOps {
                                          size_t* out_num_bytes_preloaded,
                                          int allow_verification_error);
 
+  /* Like |get_preloaded_partition| for a partition that is verified, except
+   * that the |num_bytes| are also passed to |hash_update| with |hash_ctx|,
+   * in order and possibly in several pieces. This lets the implementation
+   * read the partition in pieces and hash each piece while the next one is
+   * being read.
+   *
+   * The data need not be in one piece: only what starts at |out_pointer|,
+   * e.g. the image header, has to be readable there, and that is all that
+   * the |data| of the partition in |AvbSlotVerifyData.loaded_partitions|
+   * holds. The caller must know where the rest went.
+   *
+   * When this function pointer is not set (has value NULL), or when
+   * |out_pointer| is set to NULL as a result, |hash_update| must not have
+   * been called, and |get_preloaded_partition| is used as the fallback.
+   */
+  AvbIOResult (*get_preloaded_partition_hashed)(
+      AvbOps* ops,
+      const char* partition,
+      size_t num_bytes,
+      uint8_t** out_pointer,
+      size_t* out_num_bytes_preloaded,
+      void (*hash_update)(void* hash_ctx, const uint8_t* data, size_t len),
+      void* hash_ctx);
+
   /* Writes |num_bytes| from |bffer| at offset |offset| to partition
    * with name |partition| (NUL-terminated UTF-8 string). If |offset|
    * is negative, its absolute value should be interpreted as the
@@ -25,6 +25,7 @@
 #ifndef AVB_OPS_USER_H_
 #define AVB_OPS_USER_H_
 
+#include <image.h>
 #include <android_avb/libavb.h>
 #include <android_avb/avb_ab_flow.h>
 
@@ -64,8 +65,11 @@ AvbOps* avb_ops_user_new(void);
 void avb_ops_user_free(AvbOps* ops);
 
 struct preloaded_partition {
-	uint8_t *addr;
-	size_t size; // 0 means the partition hasn't yet been preloaded
+	uint8_t *addr; // image header, handed to libavb as the image
+#ifdef CONFIG_ANDROID_BOOT_IMAGE
+	struct android_image_seg segs[ANDROID_IMAGE_SEGS]; // where it is read to
+	int num_segs; // 0 means the partition is not read in place
+#endif
 };
 
 struct AvbOpsData {
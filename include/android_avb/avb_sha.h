@@ -61,8 +61,7 @@ typedef struct {
   uint8_t block[2 * AVB_SHA256_BLOCK_SIZE];
   uint8_t buf[AVB_SHA256_DIGEST_SIZE]; /* Used for storing the final digest. */
 #ifdef CONFIG_DM_CRYPTO
-  struct udevice *crypto_dev;
-  sha_context crypto_ctx;
+  struct crypto_hash *crypto_hash;
 #endif
 } AvbSHA256Ctx;
 
@@ -74,8 +73,7 @@ typedef struct {
   uint8_t block[2 * AVB_SHA512_BLOCK_SIZE];
   uint8_t buf[AVB_SHA512_DIGEST_SIZE]; /* Used for storing the final digest. */
 #ifdef CONFIG_DM_CRYPTO
-  struct udevice *crypto_dev;
-  sha_context crypto_ctx;
+  struct crypto_hash *crypto_hash;
 #endif
 } AvbSHA512Ctx;
 
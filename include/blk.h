@@ -9,6 +9,7 @@
 #define BLK_H
 
 #include <efi.h>
+#include <errno.h>
 
 #ifdef CONFIG_SYS_64BIT_LBA
 typedef uint64_t lbaint_t;
@@ -99,6 +100,11 @@ struct blk_desc {
 		uint32_t mbr_sig;	/* MBR integer signature */
 		efi_guid_t guid_sig;	/* GPT GUID Signature */
 	};
+	/*
+	 * Bumped by every blk_dwrite() and blk_derase(), so that filesystems
+	 * can tell whether what they cached from the device is still current
+	 */
+	unsigned long	write_seq;
 #if CONFIG_IS_ENABLED(BLK)
 	/*
 	 * For now we have a few functions which take struct blk_desc as a
@@ -159,6 +165,26 @@ void blkcache_fill(int iftype, int dev,
 		   lbaint_t start, lbaint_t blkcnt,
 		   unsigned long blksz, void const *buffer);
 
+/**
+ * blkcache_read_range() - serve as much of a read as possible from cache
+ *
+ * Blocks at the head and the tail of the range which are held in the cache
+ * are copied out, and the range is trimmed down to the blocks which still
+ * have to be read from the device.
+ *
+ * @param iftype - IF_TYPE_x for type of device
+ * @param dev - device index of particular type
+ * @param start - starting block number, updated to the first uncached block
+ * @param blkcnt - number of blocks to read, updated to the uncached count
+ * @param blksz - size in bytes of each block
+ * @param buf - buffer to contain cached data, updated to match @start
+ *
+ * @return - '1' if the whole range came from cache, '0' otherwise.
+ */
+int blkcache_read_range(int iftype, int dev,
+			lbaint_t *start, lbaint_t *blkcnt,
+			unsigned long blksz, void **buffer);
+
 /**
  * blkcache_invalidate() - discard the cache for a set of blocks
  * because of a write or device (re)initialization.
@@ -168,23 +194,50 @@ void blkcache_fill(int iftype, int dev,
  */
 void blkcache_invalidate(int iftype, int dev);
 
+/**
+ * blkcache_invalidate_range() - discard the cached lines overlapping a
+ * range of blocks because of a write or erase.
+ *
+ * @param iftype - IF_TYPE_x for type of device
+ * @param dev - device index of particular type
+ * @param start - starting block number
+ * @param blkcnt - number of blocks
+ */
+void blkcache_invalidate_range(int iftype, int dev,
+			       lbaint_t start, lbaint_t blkcnt);
+
 /**
  * blkcache_configure() - configure block cache
  *
- * @param blocks - maximum blocks per entry
- * @param entries - maximum entries in cache
+ * @param blocks - largest read, in blocks, which is added to the cache
+ * @param max_bytes - maximum number of bytes held by the cache
  */
-void blkcache_configure(unsigned blocks, unsigned entries);
+void blkcache_configure(unsigned blocks, unsigned long max_bytes);
 
 /*
  * statistics of the block cache
  */
 struct block_cache_stats {
 	unsigned hits;
+	unsigned partial_hits;
 	unsigned misses;
-	unsigned entries; /* current entry count */
+	unsigned evictions;
+	unsigned entries; /* current line count */
+	unsigned long bytes; /* bytes held by cached lines */
+	unsigned long slab_bytes; /* bytes held by free lines */
 	unsigned max_blocks_per_entry;
-	unsigned max_entries;
+	unsigned long max_bytes;
+};
+
+/*
+ * per-device statistics of the block cache
+ */
+struct block_cache_dev_stats {
+	int iftype;
+	int devnum;
+	unsigned hits;
+	unsigned partial_hits;
+	unsigned misses;
 };
 
 /**
@@ -194,6 +247,17 @@ struct block_cache_stats {
  */
 void blkcache_stats(struct block_cache_stats *stats);
 
+/**
+ * blkcache_dev_stats() - return statistics of one device seen by the cache
+ *
+ * Per-device counters are reset by blkcache_stats().
+ *
+ * @param idx - index of the device, starting at 0
+ * @param stats - statistics are copied here
+ * @return 0 if OK, -ENOENT if @idx is past the last device
+ */
+int blkcache_dev_stats(int idx, struct block_cache_dev_stats *stats);
+
 #else
 
 static inline int blkcache_read(int iftype, int dev,
@@ -207,8 +271,19 @@ static inline void blkcache_fill(int iftype, int dev,
 				 lbaint_t start, lbaint_t blkcnt,
 				 unsigned long blksz, void const *buffer) {}
 
+static inline int blkcache_read_range(int iftype, int dev,
+				      lbaint_t *start, lbaint_t *blkcnt,
+				      unsigned long blksz, void **buffer)
+{
+	return 0;
+}
+
 static inline void blkcache_invalidate(int iftype, int dev) {}
 
+static inline void blkcache_invalidate_range(int iftype, int dev,
+					     lbaint_t start,
+					     lbaint_t blkcnt) {}
+
 #endif
 
 #if CONFIG_IS_ENABLED(BLK)
@@ -272,6 +347,37 @@ struct blk_ops {
 	 * @return 0 if OK, -ve on error
 	 */
 	int (*select_hwpart)(struct udevice *dev, int hwpart);
+
+#if CONFIG_IS_ENABLED(BLK_ASYNC)
+	/**
+	 * read_async() - start reading from a block device
+	 *
+	 * This starts the transfer and returns without waiting for it to
+	 * finish. Transfers are completed in the order they were started,
+	 * through read_complete(). Drivers without this operation are read
+	 * synchronously by blk_dread_async().
+	 *
+	 * @dev:	Device to read from
+	 * @start:	Start block number to read (0=first)
+	 * @blkcnt:	Number of blocks to read
+	 * @buffer:	Destination buffer for data read
+	 * @return 0 if started, -EBUSY if the device cannot take another
+	 * transfer until one completes, other -ve error to have this
+	 * request read synchronously instead
+	 */
+	int (*read_async)(struct udevice *dev, lbaint_t start,
+			  lbaint_t blkcnt, void *buffer);
+
+	/**
+	 * read_complete() - complete the oldest transfer from read_async()
+	 *
+	 * @dev:	Device which was read
+	 * @wait:	true to wait for the transfer to finish
+	 * @return number of blocks read, -EBUSY if @wait is false and the
+	 * transfer is still in progress, or other -ve error number
+	 */
+	long (*read_complete)(struct udevice *dev, bool wait);
+#endif
 };
 
 #define blk_get_ops(dev)	((struct blk_ops *)(dev)->driver->ops)
@@ -289,6 +395,42 @@ unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 unsigned long blk_derase(struct blk_desc *block_dev, lbaint_t start,
 			 lbaint_t blkcnt);
 
+#if CONFIG_IS_ENABLED(BLK_ASYNC)
+/**
+ * blk_dread_async() - queue a read from a block device
+ *
+ * The read is handed to the device as soon as it can take it, so that the
+ * caller can work on previously read data while the transfer runs. The
+ * buffer must not be touched until blk_wait() has been called for the
+ * returned tag. Up to CONFIG_BLK_ASYNC_QUEUE_DEPTH reads can be queued on a
+ * device. Synchronous reads, writes and erases on the same device wait for
+ * all queued reads to finish first.
+ *
+ * @block_dev:	Block device to read from
+ * @start:	Start block number to read (0=first)
+ * @blkcnt:	Number of blocks to read
+ * @buffer:	Destination buffer for data read
+ * @return tag (>= 0) to pass to blk_wait(), -EBUSY if the queue is full,
+ * or other -ve error number
+ */
+int blk_dread_async(struct blk_desc *block_dev, lbaint_t start,
+		    lbaint_t blkcnt, void *buffer);
+
+/**
+ * blk_wait() - wait for a queued read to finish
+ *
+ * Reads complete in the order they were queued, so this also retires all
+ * reads queued before @tag. A tag is no longer valid once it has been
+ * waited for.
+ *
+ * @block_dev:	Block device which was read
+ * @tag:	Tag returned by blk_dread_async(), or -1 to wait for all
+ *		queued reads
+ * @return 0 if all retired reads completed in full, else -ve error number
+ */
+int blk_wait(struct blk_desc *block_dev, int tag);
+#endif
+
 /**
  * blk_find_device() - Find a block device
  *
@@ -432,9 +574,12 @@ int blk_get_from_parent(struct udevice *parent, struct udevice **devp);
 static inline ulong blk_dread(struct blk_desc *block_dev, lbaint_t start,
 			      lbaint_t blkcnt, void *buffer)
 {
+	lbaint_t rd_start = start, rd_cnt = blkcnt;
+	void *rd_buf = buffer;
 	ulong blks_read;
-	if (blkcache_read(block_dev->if_type, block_dev->devnum,
-			  start, blkcnt, block_dev->blksz, buffer))
+
+	if (blkcache_read_range(block_dev->if_type, block_dev->devnum,
+				&rd_start, &rd_cnt, block_dev->blksz, &rd_buf))
 		return blkcnt;
 
 	/*
@@ -442,25 +587,31 @@ static inline ulong blk_dread(struct blk_desc *block_dev, lbaint_t start,
 	 * bloats the code slightly (cause some board to fail to build), and
 	 * it would be an error to try an operation that does not exist.
 	 */
-	blks_read = block_dev->block_read(block_dev, start, blkcnt, buffer);
-	if (blks_read == blkcnt)
-		blkcache_fill(block_dev->if_type, block_dev->devnum,
-			      start, blkcnt, block_dev->blksz, buffer);
+	blks_read = block_dev->block_read(block_dev, rd_start, rd_cnt, rd_buf);
+	if (blks_read != rd_cnt)
+		return blks_read;
+
+	blkcache_fill(block_dev->if_type, block_dev->devnum,
+		      rd_start, rd_cnt, block_dev->blksz, rd_buf);
 
-	return blks_read;
+	return blkcnt;
 }
 
 static inline ulong blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 			       lbaint_t blkcnt, const void *buffer)
 {
-	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	blkcache_invalidate_range(block_dev->if_type, block_dev->devnum,
+				  start, blkcnt);
+	block_dev->write_seq++;
 	return block_dev->block_write(block_dev, start, blkcnt, buffer);
 }
 
 static inline ulong blk_derase(struct blk_desc *block_dev, lbaint_t start,
 			       lbaint_t blkcnt)
 {
-	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	blkcache_invalidate_range(block_dev->if_type, block_dev->devnum,
+				  start, blkcnt);
+	block_dev->write_seq++;
 	return block_dev->block_erase(block_dev, start, blkcnt);
 }
 
@@ -530,6 +681,89 @@ struct blk_driver *blk_driver_lookup_type(int if_type);
 
 #endif /* !CONFIG_BLK */
 
+#if !CONFIG_IS_ENABLED(BLK_ASYNC)
+/* Without queueing support, reads complete before they are returned */
+static inline int blk_dread_async(struct blk_desc *block_dev, lbaint_t start,
+				  lbaint_t blkcnt, void *buffer)
+{
+	return blk_dread(block_dev, start, blkcnt, buffer) == blkcnt ?
+		0 : -EIO;
+}
+
+static inline int blk_wait(struct blk_desc *block_dev, int tag)
+{
+	return 0;
+}
+#endif
+
+/**
+ * struct blk_chunk - one read made by blk_read_chunks()
+ *
+ * @start:	Start block number to read
+ * @blkcnt:	Number of blocks the chunk spans, 0 if there is nothing left
+ *		to read
+ * @buf:	Destination buffer for the data
+ * @len:	Number of bytes to read into @buf, at most @blkcnt * blksz.
+ *		A partial block at the end is read through a bounce buffer,
+ *		so nothing past @buf + @len is written.
+ */
+struct blk_chunk {
+	lbaint_t start;
+	lbaint_t blkcnt;
+	void *buf;
+	ulong len;
+};
+
+/**
+ * blk_read_chunks() - read from a block device, working on the data read
+ *
+ * Reads the chunks planned by @plan one after the other and hands each to
+ * @done once it is in memory. The next chunk is queued with
+ * blk_dread_async() before @done is called, so that its transfer overlaps
+ * the work done on the current one. The buffers of two consecutive chunks
+ * must therefore not overlap.
+ *
+ * @block_dev:	Block device to read from
+ * @plan:	Plans the chunk after @prev (NULL for the first one) into
+ *		@next, returning 0 if OK or -ve error number
+ * @done:	Works on a chunk that has been read, returning 0 if OK or -ve
+ *		error number
+ * @priv:	Passed to @plan and @done
+ * @return 0 if OK, or the first error of @plan, @done or the reads
+ */
+int blk_read_chunks(struct blk_desc *block_dev,
+		    int (*plan)(void *priv, const struct blk_chunk *prev,
+				struct blk_chunk *next),
+		    int (*done)(void *priv, const struct blk_chunk *chunk),
+		    void *priv);
+
+/**
+ * struct blk_chunk_range - a contiguous read for blk_chunk_plan_range()
+ *
+ * @desc:	Block device being read
+ * @start:	Start block number of the range
+ * @size:	Size of the range in bytes
+ * @buf:	Destination buffer for the whole range
+ * @chunk:	Bytes to read at a time, a multiple of the block size
+ */
+struct blk_chunk_range {
+	struct blk_desc *desc;
+	lbaint_t start;
+	ulong size;
+	void *buf;
+	ulong chunk;
+};
+
+/**
+ * blk_chunk_plan_range() - plan the reads of a contiguous range
+ *
+ * A @plan for blk_read_chunks() which reads a range into one buffer,
+ * @chunk bytes at a time. @priv must point to a struct blk_chunk_range,
+ * which callers can embed at the start of their own data for @done.
+ */
+int blk_chunk_plan_range(void *priv, const struct blk_chunk *prev,
+			 struct blk_chunk *next);
+
 /**
  * blk_get_devnum_by_typename() - Get a block device by type and number
  *
@@ -234,6 +234,9 @@ void show_boot_progress(int val);
 #if !defined(USE_HOSTCC)
 #if CONFIG_IS_ENABLED(BOOTSTAGE)
 #define ENABLE_BOOTSTAGE
+#if CONFIG_IS_ENABLED(BOOTSTAGE_PROFILE)
+#define ENABLE_BOOTSTAGE_PROFILE
+#endif
 #endif
 #endif
 
@@ -311,6 +314,18 @@ uint32_t bootstage_start(enum bootstage_id id, const char *name);
  */
 uint32_t bootstage_accum(enum bootstage_id id);
 
+/**
+ * Record the time spent in a one-off activity
+ *
+ * This allocates a new accumulator, so that e.g. each image of a FIT can
+ * have its own entry in the report without a bootstage id of its own.
+ *
+ * @param name		Name to display in the report, which is copied
+ * @param start_us	Time the activity started, from timer_get_boot_us()
+ * @return time spent in the activity, in microseconds
+ */
+uint32_t bootstage_accum_name(const char *name, uint32_t start_us);
+
 /* Print a report about boot time */
 void bootstage_report(void);
 
@@ -347,10 +362,24 @@ int bootstage_unstash(const void *base, int size);
 /**
  * bootstage_get_size() - Get the size of the bootstage data
  *
+ * This is the size it has once moved by bootstage_move(), which may be more
+ * than bootstage_init() allocates before relocation.
+ *
  * @return size of boostage data in bytes
  */
 int bootstage_get_size(void);
 
+/**
+ * bootstage_move() - Move the bootstage data to a new place
+ *
+ * The data in use is copied and gd->bootstage updated. With
+ * BOOTSTAGE_PROFILE the profile table grows to fill the new space, so calls
+ * timed after relocation are recorded too.
+ *
+ * @to:	Space of at least bootstage_get_size() bytes
+ */
+void bootstage_move(void *to);
+
 /**
  * bootstage_init() - Prepare bootstage for use
  *
@@ -410,6 +439,12 @@ static inline uint32_t bootstage_accum(enum bootstage_id id)
 	return 0;
 }
 
+static inline uint32_t bootstage_accum_name(const char *name,
+					    uint32_t start_us)
+{
+	return 0;
+}
+
 static inline int bootstage_stash(void *base, int size)
 {
 	return 0;	/* Pretend to succeed */
@@ -425,6 +460,10 @@ static inline int bootstage_get_size(void)
 	return 0;
 }
 
+static inline void bootstage_move(void *to)
+{
+}
+
 static inline int bootstage_init(bool first)
 {
 	return 0;
@@ -432,6 +471,81 @@ static inline int bootstage_init(bool first)
 
 #endif /* ENABLE_BOOTSTAGE */
 
+/* uclass value recorded for an initcall in the boot profile */
+#define BOOTSTAGE_PROF_INITCALL	0xffff
+
+/**
+ * struct bootstage_prof - Time taken by one initcall or device probe
+ *
+ * @start_us:	Time the call started, in microseconds
+ * @time_us:	Time the call took, in microseconds
+ * @uclass:	Uclass ID of the device, BOOTSTAGE_PROF_INITCALL for an initcall
+ * @depth:	Number of enclosing calls that were being timed
+ * @pad:	Unused, zero
+ * @name:	Device name or initcall address, nul-terminated
+ */
+struct bootstage_prof {
+	uint32_t start_us;
+	uint32_t time_us;
+	uint16_t uclass;
+	uint8_t depth;
+	uint8_t pad;
+	char name[20];
+};
+
+#ifdef ENABLE_BOOTSTAGE_PROFILE
+/**
+ * bootstage_prof_start() - Start timing an initcall or device probe
+ *
+ * Calls may nest; the nesting depth is recorded along with the time.
+ *
+ * @name:	Name to record, truncated if it is too long
+ * @uclass:	Uclass ID of the device, or BOOTSTAGE_PROF_INITCALL
+ * @return handle to pass to bootstage_prof_end(), -1 if not recorded
+ */
+int bootstage_prof_start(const char *name, uint uclass);
+
+/**
+ * bootstage_prof_end() - Finish timing an initcall or device probe
+ *
+ * @handle:	Value returned by the matching bootstage_prof_start()
+ */
+void bootstage_prof_end(int handle);
+
+/**
+ * bootstage_prof_get() - Get the record of an initcall or device probe
+ *
+ * @handle:	Value returned by bootstage_prof_start()
+ * @return the record, or NULL if the call was not recorded
+ */
+const struct bootstage_prof *bootstage_prof_get(int handle);
+
+/**
+ * bootstage_prof_report() - Print the initcall and device probe timings
+ *
+ * @min_us:	Omit records that took less than this many microseconds
+ */
+void bootstage_prof_report(uint min_us);
+#else
+static inline int bootstage_prof_start(const char *name, uint uclass)
+{
+	return -1;
+}
+
+static inline void bootstage_prof_end(int handle)
+{
+}
+
+static inline const struct bootstage_prof *bootstage_prof_get(int handle)
+{
+	return NULL;
+}
+
+static inline void bootstage_prof_report(uint min_us)
+{
+}
+#endif
+
 /* Helper macro for adding a bootstage to a line of code */
 #define BOOTSTAGE_MARKER()	\
 		bootstage_mark_code(__FILE__, __func__, __LINE__)
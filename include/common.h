@@ -557,6 +557,7 @@ int	serial_init   (void);
 void	serial_setbrg (void);
 void	serial_putc   (const char);
 void	serial_clear  (void);
+void	serial_flush  (void);
 void	serial_putc_raw(const char);
 void	serial_puts   (const char *);
 int	serial_getc   (void);
@@ -9,7 +9,10 @@
 #include <common.h>
 #include <dm.h>
 #include <image.h>
+#include <u-boot/md5.h>
 #include <u-boot/sha1.h>
+#include <u-boot/sha256.h>
+#include <u-boot/sha512.h>
 
 /* Algorithms/capability of crypto, works together with crypto_algo_nbits() */
 #define CRYPTO_MD5		BIT(0)
@@ -76,6 +79,28 @@ typedef struct {
 	u32		iv_len;
 } cipher_context;
 
+/*
+ * Handle for one hash calculation, see crypto_hash_alloc(). Members are
+ * private to crypto-uclass.c.
+ */
+struct crypto_hash {
+	struct udevice	*dev;		/* device doing the hash, or NULL */
+	u32		algo;
+	u32		length;		/* total length, given up front */
+	u32		done;		/* length hashed so far */
+	union {
+		struct MD5Context	md5;
+		sha1_context		sha1;
+		sha256_context		sha256;
+		sha512_context		sha512;
+	} sw;
+};
+
+/* Per-device uclass data */
+struct crypto_uc_priv {
+	struct crypto_hash	*hash_owner;	/* hash using the engine */
+};
+
 struct dm_crypto_ops {
 	/* Hardware algorithm capability */
 	u32 (*capability)(struct udevice *dev);
@@ -131,7 +156,8 @@ struct udevice *crypto_get_device(u32 capability);
  * @dev: crypto device
  * @ctx: sha context
  *
- * @return 0 on success, otherwise failed
+ * @return 0 on success, -EBUSY if a crypto_hash_alloc() handle is using
+ * @dev, otherwise failed
  */
 int crypto_sha_init(struct udevice *dev, sha_context *ctx);
 
@@ -186,6 +212,56 @@ int crypto_sha_regions_csum(struct udevice *dev, sha_context *ctx,
 			    const struct image_region region[],
 			    int region_count, u8 *output);
 
+/**
+ * crypto_hash_alloc() - Start a hash calculation with its own context
+ *
+ * Any number of hashes can be in progress at once, e.g. to check several
+ * images while they are read. The first one takes a crypto device that
+ * supports @algo; the others, and all hashes when there is no such device,
+ * are done in software. Each handle must be finished by crypto_hash_final()
+ * or dropped by crypto_hash_free().
+ *
+ * The single-context crypto_sha_init/update/final() must not be used on a
+ * device while a handle is using it.
+ *
+ * @algo: hash algorithm, CRYPTO_MD5/SHA1/SHA256/SHA512
+ * @length: total number of bytes which will be hashed
+ *
+ * @return handle on success, NULL if @algo is unsupported or out of memory
+ */
+struct crypto_hash *crypto_hash_alloc(u32 algo, u32 length);
+
+/**
+ * crypto_hash_update() - Add data to a hash
+ *
+ * For hardware engines, all but the last update should be a multiple of 64
+ * bytes long.
+ *
+ * @hash: handle from crypto_hash_alloc()
+ * @input: input data buffer
+ * @len: input data length
+ *
+ * @return 0 on success, otherwise failed
+ */
+int crypto_hash_update(struct crypto_hash *hash, const void *input, u32 len);
+
+/**
+ * crypto_hash_final() - Finish a hash, get the result and free the handle
+ *
+ * @hash: handle from crypto_hash_alloc()
+ * @output: output hash data
+ *
+ * @return 0 on success, otherwise failed
+ */
+int crypto_hash_final(struct crypto_hash *hash, u8 *output);
+
+/**
+ * crypto_hash_free() - Abandon a hash and free the handle
+ *
+ * @hash: handle from crypto_hash_alloc(), may be NULL
+ */
+void crypto_hash_free(struct crypto_hash *hash);
+
 /**
  * crypto_rsa_verify() - Crypto rsa verify
  *
@@ -11,7 +11,9 @@
 #ifndef _DM_DEVICE_INTERNAL_H
 #define _DM_DEVICE_INTERNAL_H
 
+#include <errno.h>
 #include <dm/ofnode.h>
+#include <dm/uclass-id.h>
 
 struct device_node;
 struct udevice;
@@ -175,4 +177,54 @@ static inline void devres_release_all(struct udevice *dev)
 }
 
 #endif /* ! CONFIG_DEVRES */
+
+/* index of devices by device tree node */
+#if CONFIG_IS_ENABLED(DM_NODE_INDEX)
+
+/**
+ * dm_node_index_add() - Add a device to the index of devices by node
+ *
+ * This is called when a device is added to its uclass. It does nothing if
+ * the device has no node or there is no index.
+ *
+ * @dev: Device to add
+ */
+void dm_node_index_add(struct udevice *dev);
+
+/**
+ * dm_node_index_del() - Remove a device from the index of devices by node
+ *
+ * @dev: Device to remove. It does not matter if it is not in the index.
+ */
+void dm_node_index_del(struct udevice *dev);
+
+/**
+ * dm_node_index_find() - Find the device of a uclass bound to a node
+ *
+ * @id: Uclass ID to look up
+ * @node: Device tree node to look up
+ * @devp: Returns the device, or NULL if there is none
+ * @return 0 if OK, -ENODEV if there is no such device, -ENOSYS if there is
+ * no index or several devices of the uclass are bound to the node. In that
+ * case the caller must scan the uclass itself.
+ */
+int dm_node_index_find(enum uclass_id id, ofnode node, struct udevice **devp);
+
+#else
+
+static inline void dm_node_index_add(struct udevice *dev)
+{
+}
+
+static inline void dm_node_index_del(struct udevice *dev)
+{
+}
+
+static inline int dm_node_index_find(enum uclass_id id, ofnode node,
+				     struct udevice **devp)
+{
+	return -ENOSYS;
+}
+
+#endif
 #endif
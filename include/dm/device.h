@@ -62,6 +62,9 @@ struct driver_info;
  */
 #define DM_FLAG_OS_PREPARE		(1 << 10)
 
+/* Device has device tree subnodes whose binding is deferred (DM_LAZY_BIND) */
+#define DM_FLAG_LAZY_CHILDREN		(1 << 11)
+
 /* Device is from kernel dtb */
 #define DM_FLAG_KNRL_DTB		(1 << 31)
 
@@ -127,6 +130,8 @@ enum {
  *		When CONFIG_DEVRES is enabled, devm_kmalloc() and friends will
  *		add to this list. Memory so-allocated will be freed
  *		automatically when the device is removed / unbound
+ * @node_hash: Entry in the hash table of devices by @node, if
+ *		CONFIG_DM_NODE_INDEX is enabled
  */
 struct udevice {
 	const struct driver *driver;
@@ -150,6 +155,9 @@ struct udevice {
 #ifdef CONFIG_DEVRES
 	struct list_head devres_head;
 #endif
+#if CONFIG_IS_ENABLED(DM_NODE_INDEX)
+	struct hlist_node node_hash;
+#endif
 };
 
 /* Maximum sequence number supported */
@@ -166,9 +174,27 @@ static inline int dev_of_offset(const struct udevice *dev)
 	return ofnode_to_offset(dev->node);
 }
 
+#if CONFIG_IS_ENABLED(DM_NODE_INDEX)
+/**
+ * dev_set_ofnode() - change the device tree node of a device
+ *
+ * This keeps the index of devices by node up to date, so use it rather than
+ * setting dev->node once the device is bound.
+ *
+ * @dev:	Device to update
+ * @node:	New node of the device
+ */
+void dev_set_ofnode(struct udevice *dev, ofnode node);
+#else
+static inline void dev_set_ofnode(struct udevice *dev, ofnode node)
+{
+	dev->node = node;
+}
+#endif
+
 static inline void dev_set_of_offset(struct udevice *dev, int of_offset)
 {
-	dev->node = offset_to_ofnode(of_offset);
+	dev_set_ofnode(dev, offset_to_ofnode(of_offset));
 }
 
 static inline bool dev_has_of_node(struct udevice *dev)
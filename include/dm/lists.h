@@ -59,6 +59,18 @@ int lists_bind_drivers(struct udevice *parent, bool pre_reloc_only);
  */
 int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp);
 
+/**
+ * lists_fdt_uclass() - find the uclass a device tree node would bind to
+ *
+ * This looks for the driver lists_bind_fdt() would try first for @node,
+ * without binding anything.
+ *
+ * @node: device tree node to check
+ * @idp: returns the uclass ID of the matching driver
+ * @return 0 if a driver matches, -ENOENT if none does
+ */
+int lists_fdt_uclass(ofnode node, enum uclass_id *idp);
+
 /**
  * device_bind_driver() - bind a device to a driver
  *
@@ -10,6 +10,8 @@
 #ifndef _DM_ROOT_H_
 #define _DM_ROOT_H_
 
+#include <dm/uclass-id.h>
+
 struct udevice;
 
 /**
@@ -114,6 +116,53 @@ int dm_init(bool of_live);
  */
 int dm_uninit(void);
 
+#if CONFIG_IS_ENABLED(DM_LAZY_BIND)
+/**
+ * dm_lazy_bind_uclass() - Bind the pending device tree nodes of a uclass
+ *
+ * With DM_LAZY_BIND, scanning the device tree only records the nodes it
+ * finds. This binds those that match a driver of uclass @id, along with
+ * any pending node that has subnodes, since its driver may find more
+ * nodes of this uclass below it. uclass_get() calls this, so that every
+ * lookup in a uclass sees all of its devices.
+ *
+ * @id:		Uclass ID
+ */
+void dm_lazy_bind_uclass(enum uclass_id id);
+
+/**
+ * dm_lazy_bind_children() - Bind the pending device tree nodes of a device
+ *
+ * This is called when @parent is probed, before its driver can look for
+ * its children, and by the functions which look up the children of
+ * @parent without probing it, such as device_find_first_child().
+ *
+ * @parent:	Device whose child nodes should be bound
+ */
+void dm_lazy_bind_children(struct udevice *parent);
+
+/**
+ * dm_lazy_bind_all() - Bind all pending device tree nodes
+ *
+ * This must be called before the nodes recorded so far become invalid,
+ * e.g. because the control device tree is replaced.
+ */
+void dm_lazy_bind_all(void);
+
+/**
+ * dm_lazy_drop() - Forget pending device tree nodes without binding them
+ *
+ * @parent:	Drop the nodes that would be bound to this device, or all of
+ *		them if NULL
+ */
+void dm_lazy_drop(struct udevice *parent);
+#else
+static inline void dm_lazy_bind_uclass(enum uclass_id id) {}
+static inline void dm_lazy_bind_children(struct udevice *parent) {}
+static inline void dm_lazy_bind_all(void) {}
+static inline void dm_lazy_drop(struct udevice *parent) {}
+#endif
+
 #if CONFIG_IS_ENABLED(DM_DEVICE_REMOVE)
 /**
  * dm_remove_devices_flags - Call remove function of all drivers with
@@ -193,6 +193,18 @@ int uclass_pre_remove_device(struct udevice *dev);
 static inline int uclass_pre_remove_device(struct udevice *dev) { return 0; }
 #endif
 
+/**
+ * uclass_get_nolazy() - Get a uclass, without binding pending nodes
+ *
+ * This is uclass_get() for use while binding a device, so that with
+ * DM_LAZY_BIND the uclass keeps its devices in the order they are bound.
+ *
+ * @id:		ID to look up
+ * @ucp:	Returns pointer to uclass (there is only one per ID)
+ * @return 0 if OK, -ve on error
+ */
+int uclass_get_nolazy(enum uclass_id id, struct uclass **ucp);
+
 /**
  * uclass_find() - Find uclass by its id
  *
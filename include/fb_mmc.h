@@ -12,4 +12,39 @@ void fb_mmc_erase(const char *cmd, char *response);
 
 lbaint_t fb_mmc_get_erase_grp_size(void);
 
+/**
+ * fb_mmc_stream_start() - start writing an image to a partition while it
+ * is still being downloaded
+ *
+ * @cmd:	Partition name
+ * @response:	Fastboot response, set to FAIL on error
+ * @return 0 if OK, -ve on error
+ */
+int fb_mmc_stream_start(const char *cmd, char *response);
+
+/**
+ * fb_mmc_stream_write() - write the next piece of a streamed image
+ *
+ * @data:	Image data
+ * @len:	Number of bytes in @data
+ * @return 0 if OK, -ve on error
+ */
+int fb_mmc_stream_write(const void *data, unsigned int len);
+
+/**
+ * fb_mmc_stream_abort() - drop a streamed image that is not flashed
+ *
+ * Data already written stays on the partition; staged data is dropped.
+ */
+void fb_mmc_stream_abort(void);
+
+/**
+ * fb_mmc_stream_finish() - complete a streamed image write
+ *
+ * @cmd:	Partition name, for messages
+ * @response:	Fastboot response, set to OKAY or FAIL
+ * @return 0 if the whole image was written, -ve on error
+ */
+int fb_mmc_stream_finish(const char *cmd, char *response);
+
 #endif
@@ -23,6 +23,16 @@ struct sparse_storage {
 	lbaint_t	(*reserve)(struct sparse_storage *info,
 				 lbaint_t blk,
 				 lbaint_t blkcnt);
+
+	/*
+	 * Optional: discard blocks so that they read back as zero. Used for
+	 * DONT_CARE chunks and zero FILL chunks instead of writing them out.
+	 * Returns the number of blocks discarded; anything short of @blkcnt
+	 * makes the caller fall back to reserve() or write().
+	 */
+	lbaint_t	(*erase)(struct sparse_storage *info,
+				 lbaint_t blk,
+				 lbaint_t blkcnt);
 };
 
 static inline int is_sparse_image(void *buf)
@@ -36,5 +46,74 @@ static inline int is_sparse_image(void *buf)
 	return 0;
 }
 
+/*
+ * State of an incremental sparse image write, see sparse_stream_init().
+ * Members are private to image-sparse.c.
+ */
+struct sparse_stream {
+	struct sparse_storage	*info;
+	sparse_header_t		sparse_header;
+	chunk_header_t		chunk_header;
+	int			state;
+	int			next;		/* state after a skip */
+	u8			hdr[sizeof(sparse_header_t)];
+	unsigned int		hdr_len;	/* header bytes collected */
+	unsigned int		skip;		/* input bytes to skip */
+	u64			chunk_left;	/* RAW payload left */
+	unsigned int		chunk;		/* chunks completed */
+	lbaint_t		blk;		/* next block to write */
+	char			*buf;		/* staged RAW data */
+	unsigned int		buf_len;
+	unsigned int		buf_size;
+	uint32_t		*fill_buf;
+	uint32_t		fill_val;
+	uint32_t		total_blocks;
+	u64			bytes_written;
+	const char		*error;
+};
+
 void write_sparse_image(struct sparse_storage *info, const char *part_name,
 			void *data, unsigned sz, char *response);
+
+/**
+ * sparse_stream_init() - start writing an image which arrives in pieces
+ *
+ * The image is parsed as it is passed to sparse_stream_write(), so it never
+ * has to be held in memory as a whole. RAW data is staged and written in
+ * large blocks; images which are not sparse are written as-is.
+ *
+ * @ss:		Stream state to set up
+ * @info:	Storage to write to
+ * @return 0 if OK, -ENOMEM if the staging buffer cannot be allocated
+ */
+int sparse_stream_init(struct sparse_stream *ss, struct sparse_storage *info);
+
+/**
+ * sparse_stream_write() - feed the next piece of an image
+ *
+ * @ss:		Stream state
+ * @data:	Image data
+ * @len:	Number of bytes in @data
+ * @return 0 if OK, -ve on error; once an error is seen further data is
+ * ignored and sparse_stream_finish() reports it
+ */
+int sparse_stream_write(struct sparse_stream *ss, const void *data,
+			unsigned int len);
+
+/**
+ * sparse_stream_abort() - free a stream without writing staged data
+ *
+ * @ss:		Stream state
+ */
+void sparse_stream_abort(struct sparse_stream *ss);
+
+/**
+ * sparse_stream_finish() - complete an image write and free the stream
+ *
+ * @ss:		Stream state
+ * @part_name:	Partition name, for messages
+ * @response:	Fastboot response, set to OKAY or FAIL
+ * @return 0 if the whole image was written, -ve on error
+ */
+int sparse_stream_finish(struct sparse_stream *ss, const char *part_name,
+			 char *response);
@@ -55,6 +55,9 @@ struct lmb;
 
 #if IMAGE_ENABLE_FIT
 #include <hash.h>
+#include <u-boot/md5.h>
+#include <u-boot/sha1.h>
+#include <u-boot/sha256.h>
 #include <linux/libfdt.h>
 #include <fdt_support.h>
 # ifdef CONFIG_SPL_BUILD
@@ -1108,6 +1111,101 @@ int fit_check_ramdisk(const void *fit, int os_noffset,
 int calculate_hash(const void *data, int data_len, const char *algo,
 			uint8_t *value, int *value_len);
 
+struct crypto_hash;
+
+/**
+ * struct fit_hash_ctx - a hash calculated piece by piece
+ *
+ * This lets an image be hashed while the rest of it is still being read.
+ * Members are private to image-fit.c.
+ */
+struct fit_hash_ctx {
+	const char	*algo;
+	int		value_len;
+	uint32_t	length;		/* total length, given up front */
+	int		type;		/* software algorithm */
+	struct crypto_hash *hw;		/* crypto uclass hash, if used */
+	union {
+		uint32_t		crc32;
+		sha1_context		sha1;
+		sha256_context		sha256;
+		struct MD5Context	md5;
+	} sw;
+};
+
+/**
+ * fit_hash_init() - start calculating a hash
+ *
+ * With FIT_HW_CRYPTO a crypto device is used when one supports @algo,
+ * otherwise the hash is done in software.
+ *
+ * @hc:		Hash context to set up
+ * @algo:	Hash algorithm name, e.g. "sha256"
+ * @length:	Total number of bytes which will be hashed
+ * @return 0 if OK, -1 if the algorithm is not supported
+ */
+int fit_hash_init(struct fit_hash_ctx *hc, const char *algo, uint32_t length);
+
+/**
+ * fit_hash_update() - hash the next piece of data
+ *
+ * @hc:		Hash context
+ * @data:	Data to hash
+ * @len:	Length of data; all but the last piece should be a multiple
+ *		of 64 bytes for hardware engines
+ * @return 0 if OK, -ve on error
+ */
+int fit_hash_update(struct fit_hash_ctx *hc, const void *data, uint32_t len);
+
+/**
+ * fit_hash_final() - finish a hash and return its value
+ *
+ * @hc:		Hash context
+ * @value:	Returns hash value (FIT_MAX_HASH_LEN bytes at most)
+ * @value_len:	Returns length of the hash value
+ * @return 0 if OK, -ve on error
+ */
+int fit_hash_final(struct fit_hash_ctx *hc, uint8_t *value, int *value_len);
+
+/**
+ * fit_hash_abort() - give up on a hash which will not be finished
+ *
+ * Call this instead of fit_hash_final() on error paths, so that a crypto
+ * device taken by fit_hash_init() is released.
+ *
+ * @hc:		Hash context
+ */
+void fit_hash_abort(struct fit_hash_ctx *hc);
+
+/**
+ * fit_image_hash_init() - start checking a hash node against image data
+ *
+ * Use this instead of fit_image_check_hash() when the image is hashed as
+ * it arrives: pass the data to fit_hash_update(), then finish with
+ * fit_image_hash_check().
+ *
+ * @fit:	FIT to check
+ * @noffset:	Offset of the hash node
+ * @hc:		Hash context to set up
+ * @size:	Size of the image data
+ * @err_msgp:	Returns error message on failure
+ * @return 0 if OK, 1 if the hash node is to be ignored, -1 on error
+ */
+int fit_image_hash_init(const void *fit, int noffset, struct fit_hash_ctx *hc,
+			size_t size, char **err_msgp);
+
+/**
+ * fit_image_hash_check() - finish a hash and compare it with the FIT
+ *
+ * @fit:	FIT to check
+ * @noffset:	Offset of the hash node
+ * @hc:		Hash context set up by fit_image_hash_init()
+ * @err_msgp:	Returns error message on failure
+ * @return 0 if the hash matches, -1 otherwise; @hc is finished either way
+ */
+int fit_image_hash_check(const void *fit, int noffset, struct fit_hash_ctx *hc,
+			 char **err_msgp);
+
 /*
  * At present we only support signing on the host, and verification on the
  * device
@@ -1368,6 +1466,67 @@ void android_image_set_decomp(struct andr_img_hdr *hdr, int comp);
 int android_image_parse_comp(struct andr_img_hdr *hdr, ulong *load_addr);
 int android_image_memcpy_separate(struct andr_img_hdr *hdr, ulong *load_address);
 
+/* Most segments android_image_get_segs() returns for a partition */
+#define ANDROID_IMAGE_SEGS	3
+
+/**
+ * struct android_image_seg - part of an image partition kept for booting
+ *
+ * @offset:	Offset of the part in the partition, in bytes
+ * @size:	Size of the part, in bytes
+ * @dst:	Where the part goes
+ */
+struct android_image_seg {
+	ulong offset;
+	ulong size;
+	void *dst;
+};
+
+/**
+ * android_image_prepare_separate() - get ready to read an image in place
+ *
+ * Picks where the image header goes, as android_image_load() would, and
+ * reserves the memory the kernel and ramdisk are read to.
+ *
+ * @dev_desc:		Device the boot partition is on
+ * @part_info:		Boot partition
+ * @hdr:		Populated header of the image, see populate_andr_img_hdr()
+ * @load_address:	Kernel load address
+ * @return address for the image header, or 0 on error
+ */
+ulong android_image_prepare_separate(struct blk_desc *dev_desc,
+				     const disk_partition_t *part_info,
+				     struct andr_img_hdr *hdr,
+				     ulong load_address);
+
+/**
+ * android_image_get_segs() - find where the parts of a partition go
+ *
+ * The parts are those image_load() would read from the partition, so that
+ * reading them straight to @segs gives the same result.
+ *
+ * @hdr:		Populated header of the image
+ * @load_address:	Address for the image header, from
+ *			android_image_prepare_separate()
+ * @partition:		Partition name, without slot suffix
+ * @hdr_buf:		Where the vendor_boot or init_boot header goes, the
+ *			boot header is kept at @load_address
+ * @segs:		Returns ANDROID_IMAGE_SEGS segments at most, by offset
+ * @return number of segments, or -ve on error
+ */
+int android_image_get_segs(const struct andr_img_hdr *hdr, ulong load_address,
+			   const char *partition, void *hdr_buf,
+			   struct android_image_seg *segs);
+
+/**
+ * android_image_finish_separate() - complete an image read in place
+ *
+ * @hdr:		Populated header of the image
+ * @load_address:	Address of the image header
+ * @return 0 if OK, -ve on error
+ */
+int android_image_finish_separate(struct andr_img_hdr *hdr, ulong load_address);
+
 struct andr_img_hdr *populate_andr_img_hdr(struct blk_desc *dev_desc,
 					   disk_partition_t *part_boot);
 int populate_boot_info(const struct boot_img_hdr_v34 *boot_hdr,
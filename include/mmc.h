@@ -187,6 +187,7 @@
 #define EXT_CSD_ERASE_GROUP_DEF		175	/* R/W */
 #define EXT_CSD_BOOT_BUS_WIDTH		177
 #define EXT_CSD_PART_CONF		179	/* R/W */
+#define EXT_CSD_ERASED_MEM_CONT		181	/* RO */
 #define EXT_CSD_BUS_WIDTH		183	/* R/W */
 #define EXT_CSD_STROBE_SUPPORT		184	/* RO */
 #define EXT_CSD_HS_TIMING		185	/* R/W */
@@ -362,6 +363,7 @@ struct mmc_uclass_priv {
 
 struct emmc_esr {
 	unsigned int mmc_can_trim;
+	unsigned int erased_byte;	/* content of erased/trimmed blocks */
 };
 
 /**
@@ -475,6 +477,25 @@ struct dm_mmc_ops {
 	int (*execute_tuning)(struct udevice *dev, u32 opcode);
 	/* set_enhanced_strobe() - set HS400 enhanced strobe */
 	int (*set_enhanced_strobe)(struct udevice *dev);
+
+	/**
+	 * get_tuning() - Read back the result of execute_tuning()
+	 *
+	 * @dev:	Device to check
+	 * @phase:	Returns the sampling point found, in a host specific
+	 *		encoding that set_tuning() accepts
+	 * @return 0 if OK, -ve on error
+	 */
+	int (*get_tuning)(struct udevice *dev, u32 *phase);
+
+	/**
+	 * set_tuning() - Sample data at a point found by an earlier tuning
+	 *
+	 * @dev:	Device to update
+	 * @phase:	Sampling point, as returned by get_tuning()
+	 * @return 0 if OK, -ve on error
+	 */
+	int (*set_tuning)(struct udevice *dev, u32 phase);
 };
 
 #define mmc_get_ops(dev)        ((struct dm_mmc_ops *)(dev)->driver->ops)
@@ -493,6 +514,8 @@ int mmc_getcd(struct mmc *mmc);
 int mmc_getwp(struct mmc *mmc);
 
 int mmc_set_enhanced_strobe(struct mmc *mmc);
+int mmc_get_tuning(struct mmc *mmc, u32 *phase);
+int mmc_set_tuning(struct mmc *mmc, u32 phase);
 #else
 struct mmc_ops {
 	bool (*card_busy)(struct mmc *mmc);
@@ -526,6 +549,25 @@ struct sd_ssr {
 	unsigned int erase_offset;	/* In milliseconds */
 };
 
+#define MMC_TUNING_CACHE_MAGIC	0x4d545543	/* "MTUC" */
+
+/**
+ * struct mmc_tuning_cache - bus setup found for a card at an earlier boot
+ *
+ * @magic:	MMC_TUNING_CACHE_MAGIC
+ * @cid:	CID of the card
+ * @clock:	Bus clock the card was tuned at
+ * @bus_width:	Bus width that passed the bus test
+ * @phase:	Result of the tuning, from mmc_get_tuning()
+ */
+struct mmc_tuning_cache {
+	u32 magic;
+	u32 cid[4];
+	u32 clock;
+	u32 bus_width;
+	u32 phase;
+};
+
 /*
  * With CONFIG_DM_MMC enabled, struct mmc can be accessed from the MMC device
  * with mmc_get_mmc_dev().
@@ -606,6 +648,12 @@ struct mmc {
 	struct udevice *dev;	/* Device for this MMC controller */
 #endif
 	u8 raw_driver_strength;
+#if CONFIG_IS_ENABLED(MMC_TUNING_CACHE)
+	struct mmc_tuning_cache tuning_cache;
+	char tuning_cached;	/* 1 if tuning_cache is for this card */
+	char tuning_changed;	/* 1 if tuning_cache needs saving */
+	char tuning_failed;	/* 1 if the saved record did not work */
+#endif
 };
 
 struct mmc_hwpart_conf {
@@ -715,6 +763,39 @@ int board_mmc_getwp(struct mmc *mmc);
 #endif
 
 int mmc_set_dsr(struct mmc *mmc, u16 val);
+
+/**
+ * board_mmc_tuning_cache_load() - Get the bus setup saved for a card
+ *
+ * This is called while the card is brought up, first before its bus is set
+ * up, when it must not access the card itself. If that finds no record and
+ * the card is to be tuned for HS200, it is called again once the bus width
+ * is set, with the card still at legacy timing. A record kept on the card
+ * itself can then be read through its block device.
+ *
+ * @mmc:	MMC device being brought up, with its CID read
+ * @rec:	Returns the record saved for the card
+ * @card_ready:	true if the card can be read
+ * @return 0 if OK, -ENOENT if there is none, other -ve on error
+ */
+int board_mmc_tuning_cache_load(struct mmc *mmc, struct mmc_tuning_cache *rec,
+				bool card_ready);
+
+/**
+ * board_mmc_tuning_cache_save() - Save the bus setup found for a card
+ *
+ * This is called once the card is up, after a full tuning, because
+ * board_mmc_tuning_cache_load() returned no record or the record did not
+ * work. Tuning finds a slightly different point from one boot to
+ * the next, so a record that was not tried should be kept as it is.
+ *
+ * @mmc:	MMC device
+ * @rec:	Record to save
+ * @failed:	true if the saved record was tried and did not work
+ */
+void board_mmc_tuning_cache_save(struct mmc *mmc,
+				 const struct mmc_tuning_cache *rec,
+				 bool failed);
 /* Function to change the size of boot partition and rpmb partitions */
 int mmc_boot_partition_size_change(struct mmc *mmc, unsigned long bootsize,
 					unsigned long rpmbsize);
@@ -28,6 +28,9 @@
 
 #ifdef CONFIG_SYS_RX_ETH_BUFFER
 # define PKTBUFSRX	CONFIG_SYS_RX_ETH_BUFFER
+#elif defined(CONFIG_TFTP_WINDOWSIZE) && CONFIG_TFTP_WINDOWSIZE > 4
+/* Room for a whole TFTP window arriving back to back */
+# define PKTBUFSRX	CONFIG_TFTP_WINDOWSIZE
 #else
 # define PKTBUFSRX	4
 #endif
@@ -485,6 +488,14 @@ struct icmp_hdr {
 #define PKTSIZE			1522
 #define PKTSIZE_ALIGN		1536
 
+/*
+ * Largest IP datagram that is reassembled from fragments, with
+ * CONFIG_IP_DEFRAG
+ */
+#ifndef CONFIG_NET_MAXDEFRAG
+#define CONFIG_NET_MAXDEFRAG	16384
+#endif
+
 /*
  * Maximum receive ring size; that is, the number of packets
  * we can buffer before overflow happens. Basically, this just
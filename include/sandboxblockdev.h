@@ -13,6 +13,16 @@ struct host_block_dev {
 #endif
 	char *filename;
 	int fd;
+#if CONFIG_IS_ENABLED(BLK_ASYNC)
+	/* reads started by read_async(), performed on read_complete() */
+	struct host_block_req {
+		lbaint_t start;
+		lbaint_t blkcnt;
+		void *buffer;
+	} req[2];
+	int req_head;
+	int req_count;
+#endif
 };
 
 int host_dev_bind(int dev, char *filename);
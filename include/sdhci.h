@@ -268,6 +268,27 @@ struct sdhci_ops {
 	 * Return: 0 if successful, -ve on error
 	 */
 	int	(*set_enhanced_strobe)(struct sdhci_host *host);
+
+	/**
+	 * get_tuning() - Read back the sampling point found by tuning
+	 *
+	 * @host: SDHCI host structure
+	 * @phase: Returns the sampling point
+	 * Return: 0 if successful, -ve on error
+	 */
+	int	(*get_tuning)(struct sdhci_host *host, u32 *phase);
+
+	/**
+	 * set_tuning() - Sample at a point returned by get_tuning()
+	 *
+	 * This is called instead of tuning, in HS200 mode at the tuning
+	 * clock.
+	 *
+	 * @host: SDHCI host structure
+	 * @phase: Sampling point
+	 * Return: 0 if successful, -ve on error
+	 */
+	int	(*set_tuning)(struct sdhci_host *host, u32 phase);
 };
 
 struct sdhci_host {
@@ -1,6 +1,7 @@
 #ifndef __SERIAL_H__
 #define __SERIAL_H__
 
+#include <membuff.h>
 #include <post.h>
 
 struct serial_device {
@@ -153,6 +154,12 @@ struct dm_serial_ops {
  * @buf:	Pointer to the RX buffer
  * @rd_ptr:	Read pointer in the RX buffer
  * @wr_ptr:	Write pointer in the RX buffer
+ *
+ * @tx_buffered: Set by the driver's probe() method if output can go
+ *		through @txbuf. Its putc() must then return -EAGAIN while the
+ *		TX FIFO is full, and its pending() must report output as
+ *		waiting until the last character has left the UART.
+ * @txbuf:	TX buffer, used when its start is not NULL
  */
 struct serial_dev_priv {
 	struct stdio_dev *sdev;
@@ -160,6 +167,9 @@ struct serial_dev_priv {
 	char *buf;
 	int rd_ptr;
 	int wr_ptr;
+
+	bool tx_buffered;
+	struct membuff txbuf;
 };
 
 /* Access the serial operations for a device */
@@ -8,6 +8,7 @@
 
 #include <memblk.h>
 #include <malloc.h>
+#include <linux/rbtree.h>
 
 /*
  * CONFIG_SYS_FDT_PAD default value is sync with bootm framework in:
@@ -21,8 +22,11 @@ struct sysmem {
 	struct lmb lmb;
 	struct list_head allocated_head;
 	struct list_head kmem_resv_head;
+	struct rb_root free_by_addr;	/* free regions sorted by base */
+	struct rb_root free_by_size;	/* free regions sorted by size */
 	ulong allocated_cnt;
 	ulong kmem_resv_cnt;
+	ulong free_cnt;
 	bool has_initf;
 	bool has_initr;
 };
@@ -17,6 +17,19 @@ uint32_t crc32 (uint32_t, const unsigned char *, uint);
 uint32_t crc32_wd (uint32_t, const unsigned char *, uint, uint);
 uint32_t crc32_no_comp (uint32_t, const unsigned char *, uint);
 
+/**
+ * crc32c() - CRC32C (Castagnoli), as used by iSCSI, ext4 and btrfs
+ *
+ * @crc:	CRC of the data before @p, 0 to start
+ * @p:		Data
+ * @len:	Length of @p in bytes
+ * @return CRC of the data so far
+ */
+uint32_t crc32c(uint32_t crc, const unsigned char *p, uint len);
+
+/* crc32c() without the ones complement before and after */
+uint32_t crc32c_no_comp(uint32_t crc, const unsigned char *p, uint len);
+
 /**
  * crc32_wd_buf - Perform CRC32 on a buffer and return result in buffer
  *
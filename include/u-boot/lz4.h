@@ -62,4 +62,12 @@ bool lz4_is_valid_header(const unsigned char *h);
  */
 int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn);
 
+/**
+ * ulz4fn_sw() - Decompress LZ4 data in software only
+ *
+ * Same as ulz4fn(), without trying a hardware decompressor first. For use
+ * by decompressor drivers themselves.
+ */
+int ulz4fn_sw(const void *src, size_t srcn, void *dst, size_t *dstn);
+
 #endif
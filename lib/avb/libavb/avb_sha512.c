@@ -41,25 +41,23 @@
 /* Crypto-v1 is not support sha512 */
 #ifdef CONFIG_ROCKCHIP_CRYPTO_V2
 void avb_sha512_init(AvbSHA512Ctx* ctx) {
-  ctx->crypto_ctx.algo = CRYPTO_SHA512;
-  ctx->crypto_ctx.length = ctx->tot_len;
   memset(ctx->buf, 0, sizeof(ctx->buf));
 
-  ctx->crypto_dev = crypto_get_device(ctx->crypto_ctx.algo);
-  if (!ctx->crypto_dev)
-    avb_error("Can't get sha512 crypto device\n");
-  else
-    crypto_sha_init(ctx->crypto_dev, &ctx->crypto_ctx);
+  ctx->crypto_hash = crypto_hash_alloc(CRYPTO_SHA512, ctx->tot_len);
+  if (!ctx->crypto_hash)
+    avb_error("Can't start sha512\n");
 }
 
 void avb_sha512_update(AvbSHA512Ctx* ctx, const uint8_t* data, size_t len) {
-  if (ctx->crypto_dev)
-    crypto_sha_update(ctx->crypto_dev, (u32 *)data, len);
+  if (ctx->crypto_hash)
+    crypto_hash_update(ctx->crypto_hash, data, len);
 }
 
 uint8_t* avb_sha512_final(AvbSHA512Ctx* ctx) {
-  if (ctx->crypto_dev)
-    crypto_sha_final(ctx->crypto_dev, &ctx->crypto_ctx, ctx->buf);
+  if (ctx->crypto_hash) {
+    crypto_hash_final(ctx->crypto_hash, ctx->buf);
+    ctx->crypto_hash = NULL;
+  }
 
   return ctx->buf;
 }
@@ -145,6 +145,73 @@ static AvbSlotVerifyResult load_full_partition(AvbOps* ops,
   return AVB_SLOT_VERIFY_RESULT_OK;
 }
 
+/* Hash of an image covered by a hash descriptor. */
+typedef struct {
+  bool is_sha512;
+  AvbSHA256Ctx sha256_ctx;
+  AvbSHA512Ctx sha512_ctx;
+} HashDescCtx;
+
+static void hash_desc_update(void* ctx, const uint8_t* data, size_t len) {
+  HashDescCtx* hash_ctx = (HashDescCtx*)ctx;
+
+  if (hash_ctx->is_sha512) {
+    avb_sha512_update(&hash_ctx->sha512_ctx, data, len);
+  } else {
+    avb_sha256_update(&hash_ctx->sha256_ctx, data, len);
+  }
+}
+
+/* Like load_full_partition(), but feeds the image to |hash_ctx| as it is
+ * loaded. Leaves |out_image_buf| at NULL if the operation is not available
+ * for the partition, in which case |hash_ctx| has not been touched.
+ */
+static AvbSlotVerifyResult load_hashed_partition(AvbOps* ops,
+                                                 const char* part_name,
+                                                 uint64_t image_size,
+                                                 uint8_t** out_image_buf,
+                                                 bool* out_image_preloaded,
+                                                 HashDescCtx* hash_ctx) {
+  size_t part_num_read;
+  AvbIOResult io_ret;
+
+  avb_assert(*out_image_buf == NULL);
+  avb_assert(!*out_image_preloaded);
+
+  if (ops->get_preloaded_partition_hashed == NULL) {
+    return AVB_SLOT_VERIFY_RESULT_OK;
+  }
+
+  if (image_size != (size_t)(image_size)) {
+    avb_errorv(part_name, ": Partition size too large to load.\n", NULL);
+    return AVB_SLOT_VERIFY_RESULT_ERROR_INVALID_METADATA;
+  }
+
+  io_ret = ops->get_preloaded_partition_hashed(ops,
+                                               part_name,
+                                               image_size,
+                                               out_image_buf,
+                                               &part_num_read,
+                                               hash_desc_update,
+                                               hash_ctx);
+  if (io_ret == AVB_IO_RESULT_ERROR_OOM) {
+    return AVB_SLOT_VERIFY_RESULT_ERROR_OOM;
+  } else if (io_ret != AVB_IO_RESULT_OK) {
+    avb_errorv(part_name, ": Error loading data from partition.\n", NULL);
+    return AVB_SLOT_VERIFY_RESULT_ERROR_IO;
+  }
+
+  if (*out_image_buf != NULL) {
+    *out_image_preloaded = true;
+    if (part_num_read != image_size) {
+      avb_errorv(part_name, ": Read incorrect number of bytes.\n", NULL);
+      return AVB_SLOT_VERIFY_RESULT_ERROR_IO;
+    }
+  }
+
+  return AVB_SLOT_VERIFY_RESULT_OK;
+}
+
 /* Reads a persistent digest stored as a named persistent value corresponding to
  * the given |part_name|. The value is returned in |out_digest| which must point
  * to |expected_digest_size| bytes. If there is no digest stored for |part_name|
@@ -382,47 +449,53 @@ static AvbSlotVerifyResult load_and_verify_hash_partition(
       goto out;
     }
     avb_debugv(part_name, ": Loading entire partition.\n", NULL);
-  }
-
-  ret = load_full_partition(
-      ops, part_name, image_size, &image_buf, &image_preloaded,
-      allow_verification_error);
-  if (ret != AVB_SLOT_VERIFY_RESULT_OK) {
-    goto out;
-  } else if (allow_verification_error) {
+    ret = load_full_partition(
+        ops, part_name, image_size, &image_buf, &image_preloaded,
+        allow_verification_error);
     goto out;
   }
 
-  // Although only one of the type might be used, we have to defined the
-  // structure here so that they would live outside the 'if/else' scope to be
-  // used later.
-  AvbSHA256Ctx sha256_ctx;
-  AvbSHA512Ctx sha512_ctx;
-  size_t image_size_to_hash = hash_desc.image_size;
-  // If we allow verification error and the whole partition is smaller than
-  // image size in hash descriptor, we just hash the whole partition.
-  if (image_size_to_hash > image_size) {
-    image_size_to_hash = image_size;
-  }
+  /* Set up the hash first, so that the image can be hashed while it is
+   * being loaded.
+   */
+  HashDescCtx hash_ctx;
   if (avb_strcmp((const char*)hash_desc.hash_algorithm, "sha256") == 0) {
-    sha256_ctx.tot_len = hash_desc.salt_len + image_size_to_hash;
-    avb_sha256_init(&sha256_ctx);
-    avb_sha256_update(&sha256_ctx, desc_salt, hash_desc.salt_len);
-    avb_sha256_update(&sha256_ctx, image_buf, image_size_to_hash);
-    digest = avb_sha256_final(&sha256_ctx);
-    digest_len = AVB_SHA256_DIGEST_SIZE;
+    hash_ctx.is_sha512 = false;
+    hash_ctx.sha256_ctx.tot_len = hash_desc.salt_len + image_size;
+    avb_sha256_init(&hash_ctx.sha256_ctx);
   } else if (avb_strcmp((const char*)hash_desc.hash_algorithm, "sha512") == 0) {
-    sha512_ctx.tot_len = hash_desc.salt_len + image_size_to_hash;
-    avb_sha512_init(&sha512_ctx);
-    avb_sha512_update(&sha512_ctx, desc_salt, hash_desc.salt_len);
-    avb_sha512_update(&sha512_ctx, image_buf, image_size_to_hash);
-    digest = avb_sha512_final(&sha512_ctx);
-    digest_len = AVB_SHA512_DIGEST_SIZE;
+    hash_ctx.is_sha512 = true;
+    hash_ctx.sha512_ctx.tot_len = hash_desc.salt_len + image_size;
+    avb_sha512_init(&hash_ctx.sha512_ctx);
   } else {
     avb_errorv(part_name, ": Unsupported hash algorithm.\n", NULL);
     ret = AVB_SLOT_VERIFY_RESULT_ERROR_INVALID_METADATA;
     goto out;
   }
+  hash_desc_update(&hash_ctx, desc_salt, hash_desc.salt_len);
+
+  ret = load_hashed_partition(
+      ops, part_name, image_size, &image_buf, &image_preloaded, &hash_ctx);
+  if (ret != AVB_SLOT_VERIFY_RESULT_OK) {
+    goto out;
+  }
+
+  if (image_buf == NULL) {
+    ret = load_full_partition(
+        ops, part_name, image_size, &image_buf, &image_preloaded, 0);
+    if (ret != AVB_SLOT_VERIFY_RESULT_OK) {
+      goto out;
+    }
+    hash_desc_update(&hash_ctx, image_buf, image_size);
+  }
+
+  if (hash_ctx.is_sha512) {
+    digest = avb_sha512_final(&hash_ctx.sha512_ctx);
+    digest_len = AVB_SHA512_DIGEST_SIZE;
+  } else {
+    digest = avb_sha256_final(&hash_ctx.sha256_ctx);
+    digest_len = AVB_SHA256_DIGEST_SIZE;
+  }
 
   if (hash_desc.digest_len == 0) {
     /* Expect a match to a persistent digest. */
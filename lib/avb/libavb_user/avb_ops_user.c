@@ -32,6 +32,7 @@
 #include <mmc.h>
 #include <blk.h>
 #include <part.h>
+#include <linux/sizes.h>
 #include <stdio.h>
 #include <android_avb/avb_ops_user.h>
 #include <android_avb/libavb_ab.h>
@@ -421,6 +422,199 @@ AvbIOResult rk_get_random(AvbAtxOps *atx_ops,
 }
 
 #ifdef CONFIG_ANDROID_BOOT_IMAGE
+static struct preloaded_partition *get_preload_info(struct AvbOpsData *data,
+						    const char *partition)
+{
+	if (!strncmp(partition, ANDROID_PARTITION_BOOT, 4) ||
+	    !strncmp(partition, ANDROID_PARTITION_RECOVERY, 8))
+		return &data->boot;
+	else if (!strncmp(partition, ANDROID_PARTITION_VENDOR_BOOT, 11))
+		return &data->vendor_boot;
+	else if (!strncmp(partition, ANDROID_PARTITION_INIT_BOOT, 9))
+		return &data->init_boot;
+
+	return NULL;
+}
+
+/* One read of an image, see plan_seg_read() */
+struct seg_read {
+	size_t pos;	/* offset in the image, block aligned */
+	size_t len;	/* bytes of the image covered */
+	u8 *buf;	/* where the blocks are read to */
+	bool bounce;	/* @buf is a bounce buffer, not a segment */
+};
+
+/*
+ * Plan the read at @pos. Blocks that lie in a single segment whose
+ * destination is DMA aligned are read straight there. The rest, such as
+ * headers, segment tails and the parts of the image that are not kept,
+ * go through @bounce and are copied out.
+ */
+static void plan_seg_read(struct seg_read *r,
+			  const struct preloaded_partition *preload_info,
+			  size_t num_bytes, size_t pos, ulong blksz, u8 *bounce)
+{
+	const struct android_image_seg *seg;
+	size_t len = min(num_bytes - pos, (size_t)SZ_512K);
+	size_t end;
+	u8 *dst;
+	int i;
+
+	r->pos = pos;
+	r->buf = bounce;
+	r->bounce = true;
+
+	for (i = 0; i < preload_info->num_segs; i++) {
+		seg = &preload_info->segs[i];
+		end = min((size_t)(seg->offset + seg->size), num_bytes);
+		if (pos >= end)
+			continue;
+
+		if (pos >= seg->offset) {
+			dst = seg->dst + (pos - seg->offset);
+			if (IS_ALIGNED((ulong)dst, ARCH_DMA_MINALIGN) &&
+			    end - pos >= blksz) {
+				r->buf = dst;
+				r->bounce = false;
+				len = min(len, (size_t)rounddown(end - pos, blksz));
+				break;
+			}
+			continue;
+		}
+
+		/* Stop short of the next segment, so that it can be read straight */
+		if (seg->offset - pos >= blksz)
+			len = min(len, (size_t)rounddown(seg->offset - pos, blksz));
+		break;
+	}
+
+	r->len = len;
+}
+
+static void copy_seg_read(const struct seg_read *r,
+			  const struct preloaded_partition *preload_info)
+{
+	const struct android_image_seg *seg;
+	size_t start, end;
+	int i;
+
+	for (i = 0; i < preload_info->num_segs; i++) {
+		seg = &preload_info->segs[i];
+		start = max((size_t)seg->offset, r->pos);
+		end = min((size_t)(seg->offset + seg->size), r->pos + r->len);
+		if (start < end)
+			memcpy(seg->dst + (start - seg->offset),
+			       r->buf + (start - r->pos), end - start);
+	}
+}
+
+struct seg_reader {
+	const struct preloaded_partition *preload_info;
+	size_t num_bytes;
+	lbaint_t part_start;
+	ulong blksz;
+	u8 *bounce;	/* two halves, one being read while the other is used */
+	void (*hash_update)(void *hash_ctx, const uint8_t *data, size_t len);
+	void *hash_ctx;
+};
+
+static void seg_read_of_chunk(struct seg_read *r, const struct seg_reader *sr,
+			      const struct blk_chunk *chunk)
+{
+	r->pos = (chunk->start - sr->part_start) * sr->blksz;
+	r->len = chunk->len;
+	r->buf = chunk->buf;
+	r->bounce = r->buf == sr->bounce || r->buf == sr->bounce + SZ_512K;
+}
+
+static int plan_seg_chunk(void *priv, const struct blk_chunk *prev,
+			  struct blk_chunk *next)
+{
+	struct seg_reader *sr = priv;
+	struct seg_read r = { 0 };
+	u8 *bounce = sr->bounce;
+
+	if (prev) {
+		seg_read_of_chunk(&r, sr, prev);
+		if (r.buf == sr->bounce)
+			bounce += SZ_512K;
+	}
+	if (r.pos + r.len >= sr->num_bytes) {
+		next->blkcnt = 0;
+		return 0;
+	}
+
+	plan_seg_read(&r, sr->preload_info, sr->num_bytes, r.pos + r.len,
+		      sr->blksz, bounce);
+	next->start = sr->part_start + r.pos / sr->blksz;
+	next->blkcnt = DIV_ROUND_UP(r.len, sr->blksz);
+	next->buf = r.buf;
+	next->len = r.len;
+
+	return 0;
+}
+
+static int use_seg_chunk(void *priv, const struct blk_chunk *chunk)
+{
+	struct seg_reader *sr = priv;
+	struct seg_read r;
+
+	seg_read_of_chunk(&r, sr, chunk);
+	if (sr->hash_update)
+		sr->hash_update(sr->hash_ctx, r.buf, r.len);
+	if (r.bounce)
+		copy_seg_read(&r, sr->preload_info);
+
+	return 0;
+}
+
+/*
+ * Read the image in a partition to where its segments go, feeding it all
+ * to @hash_update on the way if that is not NULL. The next read is queued
+ * while the current one is hashed.
+ */
+static AvbIOResult read_image_segs(const char *partition, size_t num_bytes,
+				   const struct preloaded_partition *preload_info,
+				   void (*hash_update)(void *hash_ctx,
+						       const uint8_t *data,
+						       size_t len),
+				   void *hash_ctx)
+{
+	struct seg_reader sr = {
+		.preload_info = preload_info,
+		.num_bytes = num_bytes,
+		.hash_update = hash_update,
+		.hash_ctx = hash_ctx,
+	};
+	struct blk_desc *dev_desc;
+	disk_partition_t part_info;
+	AvbIOResult ret = AVB_IO_RESULT_OK;
+
+	dev_desc = rockchip_get_bootdev();
+	if (!dev_desc)
+		return AVB_IO_RESULT_ERROR_IO;
+
+	if (part_get_info_by_name(dev_desc, partition, &part_info) < 0) {
+		printf("Could not find \"%s\" partition\n", partition);
+		return AVB_IO_RESULT_ERROR_NO_SUCH_PARTITION;
+	}
+
+	sr.part_start = part_info.start;
+	sr.blksz = dev_desc->blksz;
+	if (DIV_ROUND_UP(num_bytes, sr.blksz) > part_info.size)
+		return AVB_IO_RESULT_ERROR_RANGE_OUTSIDE_PARTITION;
+
+	sr.bounce = memalign(ARCH_DMA_MINALIGN, 2 * SZ_512K);
+	if (!sr.bounce)
+		return AVB_IO_RESULT_ERROR_OOM;
+
+	if (blk_read_chunks(dev_desc, plan_seg_chunk, use_seg_chunk, &sr))
+		ret = AVB_IO_RESULT_ERROR_IO;
+	free(sr.bounce);
+
+	return ret;
+}
+
 static AvbIOResult get_preloaded_partition(AvbOps* ops,
 					   const char* partition,
 					   size_t num_bytes,
@@ -445,34 +639,20 @@ static AvbIOResult get_preloaded_partition(AvbOps* ops,
 	}
 
 	if (!allow_verification_error) {
-		if (!strncmp(partition, ANDROID_PARTITION_BOOT, 4) ||
-		    !strncmp(partition, ANDROID_PARTITION_RECOVERY, 8))
-			preload_info = &data->boot;
-		else if (!strncmp(partition, ANDROID_PARTITION_VENDOR_BOOT, 11))
-			preload_info = &data->vendor_boot;
-		else if (!strncmp(partition, ANDROID_PARTITION_INIT_BOOT, 9))
-			preload_info = &data->init_boot;
-
-		if (!preload_info) {
+		preload_info = get_preload_info(data, partition);
+		if (!preload_info || !preload_info->num_segs) {
 			printf("Error: unknown full load partition '%s'\n", partition);
 			return AVB_IO_RESULT_ERROR_NO_SUCH_PARTITION;
 		}
 
-		printf("preloaded: full image from '%s' at 0x%08lx - 0x%08lx\n",
-		       partition, (ulong)preload_info->addr,
-		       (ulong)preload_info->addr + num_bytes);
-
-		/* If the partition hasn't yet been preloaded, do it now.*/
-		if (preload_info->size == 0) {
-			ret = ops->read_from_partition(ops, partition,
-						       0, num_bytes,
-						       preload_info->addr,
-						       &preload_info->size);
-			if (ret != AVB_IO_RESULT_OK)
-				return ret;
-		}
+		printf("preloaded: distribute image from '%s'\n", partition);
+		ret = read_image_segs(partition, num_bytes, preload_info,
+				      NULL, NULL);
+		if (ret != AVB_IO_RESULT_OK)
+			return ret;
+
 		*out_pointer = preload_info->addr;
-		*out_num_bytes_preloaded = preload_info->size;
+		*out_num_bytes_preloaded = num_bytes;
 		ret = AVB_IO_RESULT_OK;
 	} else {
 		if (!strncmp(partition, ANDROID_PARTITION_INIT_BOOT, 9) ||
@@ -516,6 +696,43 @@ static AvbIOResult get_preloaded_partition(AvbOps* ops,
 
 	return ret;
 }
+
+static AvbIOResult get_preloaded_partition_hashed(AvbOps *ops,
+						  const char *partition,
+						  size_t num_bytes,
+						  uint8_t **out_pointer,
+						  size_t *out_num_bytes_preloaded,
+						  void (*hash_update)(void *hash_ctx,
+								      const uint8_t *data,
+								      size_t len),
+						  void *hash_ctx)
+{
+	struct preloaded_partition *preload_info;
+	AvbIOResult ret;
+
+	preload_info = get_preload_info(ops->user_data, partition);
+	if (!preload_info || !preload_info->num_segs) {
+		/* Let libavb load it the usual way */
+		*out_pointer = NULL;
+		return AVB_IO_RESULT_OK;
+	}
+
+	/* The image is read again on a retry, it is not kept in one piece */
+	printf("preloaded: distribute image from '%s'\n", partition);
+	ret = read_image_segs(partition, num_bytes, preload_info,
+			      hash_update, hash_ctx);
+	if (ret != AVB_IO_RESULT_OK)
+		return ret;
+
+	/*
+	 * Only the header is at preload_info->addr, the rest went to the
+	 * segments. So loaded_partitions[].data is just the header here.
+	 */
+	*out_pointer = preload_info->addr;
+	*out_num_bytes_preloaded = num_bytes;
+
+	return AVB_IO_RESULT_OK;
+}
 #endif
 
 AvbIOResult validate_public_key_for_partition(AvbOps *ops,
@@ -596,6 +813,7 @@ AvbOps *avb_ops_user_new(void)
 	ops->get_size_of_partition = get_size_of_partition;
 #ifdef CONFIG_ANDROID_BOOT_IMAGE
 	ops->get_preloaded_partition = get_preloaded_partition;
+	ops->get_preloaded_partition_hashed = get_preloaded_partition_hashed;
 #endif
 	ops->validate_public_key_for_partition = validate_public_key_for_partition;
 	ops->ab_ops->read_ab_metadata = avb_ab_data_read;
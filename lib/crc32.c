@@ -26,6 +26,18 @@
 
 #define tole(x) cpu_to_le32(x)
 
+#if defined(USE_HOSTCC)
+#define CRC_SLICE_BY_8
+#elif defined(CONFIG_CRC32_ARM64)
+#define CRC_ARM64
+#elif CONFIG_IS_ENABLED(CRC32_SLICE_BY_8)
+#define CRC_SLICE_BY_8
+#endif
+#if defined(CRC_SLICE_BY_8) && __BYTE_ORDER != __LITTLE_ENDIAN
+#undef CRC_SLICE_BY_8
+#endif
+
+#if !defined(CRC_ARM64) && !defined(CRC_SLICE_BY_8)
 #ifdef DYNAMIC_CRC_TABLE
 
 local int crc_table_empty = 1;
@@ -150,6 +162,7 @@ tole(0xb3667a2eL), tole(0xc4614ab8L), tole(0x5d681b02L), tole(0x2a6f2b94L),
 tole(0xb40bbe37L), tole(0xc30c8ea1L), tole(0x5a05df1bL), tole(0x2d02ef8dL)
 };
 #endif
+#endif /* !CRC_ARM64 && !CRC_SLICE_BY_8 */
 
 #if 0
 /* =========================================================================
@@ -164,6 +177,79 @@ const uint32_t * ZEXPORT get_crc_table()
 }
 #endif
 
+#ifndef CRC_ARM64
+
+#ifdef CRC_SLICE_BY_8
+#define CRC_TAB_ROWS	8
+#else
+#define CRC_TAB_ROWS	1
+#endif
+
+/*
+ * With slicing-by-8, eight bytes are folded in at once with eight
+ * independent lookups, instead of eight lookups that each wait for the
+ * one before.
+ */
+#include "crc32_table.h"
+
+static uint32_t crc_tab_calc(const uint32_t (*t)[256], uint32_t crc,
+			     const uint8_t *p, size_t len)
+{
+#ifdef CRC_SLICE_BY_8
+	uint32_t lo, hi;
+
+	while (len && ((uintptr_t)p & 7)) {
+		crc = t[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+		len--;
+	}
+	for (; len >= 8; len -= 8, p += 8) {
+		lo = crc ^ *(const uint32_t *)p;
+		hi = *(const uint32_t *)(p + 4);
+		crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^
+		      t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+		      t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^
+		      t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+	}
+#endif
+	while (len--)
+		crc = t[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+
+	return crc;
+}
+#else
+/* The ARMv8 CRC32 instructions, which need no tables */
+#define CRC_ARM64_INSN(insn, crc, v, w)					\
+	asm(".arch_extension crc\n\t" insn " %w0, %w0, %" w "1"		\
+	    : "+r" (crc) : "r" (v))
+
+#define CRC_ARM64_FUNC(name, x, w, h, b)				\
+static uint32_t name(uint32_t crc, const uint8_t *p, size_t len)	\
+{									\
+	while (len && ((uintptr_t)p & 7)) {				\
+		CRC_ARM64_INSN(b, crc, *p, "w");			\
+		p++;							\
+		len--;							\
+	}								\
+	for (; len >= 8; len -= 8, p += 8)				\
+		CRC_ARM64_INSN(x, crc, *(const uint64_t *)p, "x");	\
+	if (len & 4) {							\
+		CRC_ARM64_INSN(w, crc, *(const uint32_t *)p, "w");	\
+		p += 4;							\
+	}								\
+	if (len & 2) {							\
+		CRC_ARM64_INSN(h, crc, *(const uint16_t *)p, "w");	\
+		p += 2;							\
+	}								\
+	if (len & 1)							\
+		CRC_ARM64_INSN(b, crc, *p, "w");			\
+									\
+	return crc;							\
+}
+
+CRC_ARM64_FUNC(crc32_arm64, "crc32x", "crc32w", "crc32h", "crc32b")
+CRC_ARM64_FUNC(crc32c_arm64, "crc32cx", "crc32cw", "crc32ch", "crc32cb")
+#endif
+
 /* ========================================================================= */
 # if __BYTE_ORDER == __LITTLE_ENDIAN
 #  define DO_CRC(x) crc = tab[(crc ^ (x)) & 255] ^ (crc >> 8)
@@ -178,6 +264,11 @@ const uint32_t * ZEXPORT get_crc_table()
  */
 uint32_t ZEXPORT crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
 {
+#if defined(CRC_ARM64)
+    return crc32_arm64(crc, buf, len);
+#elif defined(CRC_SLICE_BY_8)
+    return crc_tab_calc(crc32_tab, crc, buf, len);
+#else
     const uint32_t *tab = crc_table;
     const uint32_t *b =(const uint32_t *)buf;
     size_t rem_len;
@@ -215,6 +306,7 @@ uint32_t ZEXPORT crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
     }
 
     return le32_to_cpu(crc);
+#endif
 }
 #undef DO_CRC
 
@@ -223,6 +315,20 @@ uint32_t ZEXPORT crc32 (uint32_t crc, const Bytef *p, uInt len)
      return crc32_no_comp(crc ^ 0xffffffffL, p, len) ^ 0xffffffffL;
 }
 
+uint32_t crc32c_no_comp(uint32_t crc, const unsigned char *buf, uint len)
+{
+#ifdef CRC_ARM64
+	return crc32c_arm64(crc, buf, len);
+#else
+	return crc_tab_calc(crc32c_tab, crc, buf, len);
+#endif
+}
+
+uint32_t crc32c(uint32_t crc, const unsigned char *p, uint len)
+{
+	return crc32c_no_comp(crc ^ 0xffffffff, p, len) ^ 0xffffffff;
+}
+
 /*
  * Calculate the crc32 checksum triggering the watchdog every 'chunk_sz' bytes
  * of input.
@@ -12,10 +12,18 @@
 
 #include <common.h>
 #include <compiler.h>
+#include <u-boot/crc.h>
+
+#define CRC32C_POLY	0x82f63b78
 
 uint32_t crc32c_cal(uint32_t crc, const char *data, int length,
 		    uint32_t *crc32c_table)
 {
+	/* Entry 0x80 of a bit-reflected table is its polynomial */
+	if (crc32c_table[0x80] == CRC32C_POLY)
+		return crc32c_no_comp(crc, (const unsigned char *)data,
+				      length);
+
 	while (length--)
 		crc = crc32c_table[(u8)(crc ^ *data++)] ^ (crc >> 8);
 
@@ -32,6 +32,8 @@ void hang(void)
 #ifdef CONFIG_SPL_BUILD
 	spl_hang_reset();
 #endif
+	/* Nothing drains buffered console output from here on */
+	flushc();
 	for (;;)
 		;
 }
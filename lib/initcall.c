@@ -5,6 +5,7 @@
  */
 
 #include <common.h>
+#include <bootstage.h>
 #include <initcall.h>
 #include <efi.h>
 
@@ -20,6 +21,23 @@ static inline void call_get_ticks(ulong *ticks) { *ticks = get_ticks(); }
 static inline void call_get_ticks(ulong *ticks) { }
 #endif
 
+#if CONFIG_IS_ENABLED(BOOTSTAGE_PROFILE)
+/*
+ * Initcalls are recorded by their link-time address, so the name can be
+ * given to 'addr2line -e u-boot' or looked up in System.map as it is.
+ */
+static int initcall_prof_start(void *addr)
+{
+	char name[20];
+
+	snprintf(name, sizeof(name), "0x%lx", (ulong)addr);
+
+	return bootstage_prof_start(name, BOOTSTAGE_PROF_INITCALL);
+}
+#else
+static inline int initcall_prof_start(void *addr) { return -1; }
+#endif
+
 int initcall_run_list(const init_fnc_t init_sequence[])
 {
 	const init_fnc_t *init_fnc_ptr;
@@ -30,6 +48,8 @@ int initcall_run_list(const init_fnc_t init_sequence[])
 
 	for (init_fnc_ptr = init_sequence; *init_fnc_ptr; ++init_fnc_ptr) {
 		unsigned long reloc_ofs = 0;
+		void *addr;
+		int prof;
 		int ret;
 
 		if (gd->flags & GD_FLG_RELOC)
@@ -37,14 +57,17 @@ int initcall_run_list(const init_fnc_t init_sequence[])
 #ifdef CONFIG_EFI_APP
 		reloc_ofs = (unsigned long)image_base;
 #endif
-		debug("initcall: %p", (char *)*init_fnc_ptr - reloc_ofs);
+		addr = (char *)*init_fnc_ptr - reloc_ofs;
+		debug("initcall: %p", addr);
 		if (gd->flags & GD_FLG_RELOC)
 			debug(" (relocated to %p)\n", (char *)*init_fnc_ptr);
 		else
 			debug("\n");
+		prof = initcall_prof_start(addr);
 		call_get_ticks(&start);
 		ret = (*init_fnc_ptr)();
 		call_get_ticks(&end);
+		bootstage_prof_end(prof);
 
 		if (start != end) {
 			sum = TICKS_TO_US(end - gd->sys_start_tick);
@@ -53,8 +76,7 @@ int initcall_run_list(const init_fnc_t init_sequence[])
 		}
 		if (ret) {
 			printf("initcall sequence %p failed at call %p (err=%d)\n",
-			       init_sequence,
-			       (char *)*init_fnc_ptr - reloc_ofs, ret);
+			       init_sequence, addr, ret);
 			return -1;
 		}
 	}
@@ -49,7 +49,7 @@ bool lz4_is_valid_header(const unsigned char *h)
 	return true;
 }
 
-int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
+int ulz4fn_sw(const void *src, size_t srcn, void *dst, size_t *dstn)
 {
 	const void *end = dst + *dstn;
 	const void *in = src;
@@ -58,18 +58,6 @@ int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
 	int ret;
 	*dstn = 0;
 
-#if defined(CONFIG_MISC_DECOMPRESS) && !defined(CONFIG_SPL_BUILD)
-	u64 len;
-
-	ret = misc_decompress_process((ulong)dst, (ulong)src, (ulong)srcn,
-				      DECOM_LZ4, false, &len, 0);
-	if (!ret) {
-		*dstn = len;
-		return 0;
-	}
-
-	printf("hw ulz4fn failed(%d), fallback to soft ulz4fn\n", ret);
-#endif
 	{ /* With in-place decompression the header may become invalid later. */
 		const struct lz4_frame_header *h = in;
 
@@ -135,3 +123,21 @@ int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
 	*dstn = out - dst;
 	return ret;
 }
+
+int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
+{
+#if defined(CONFIG_MISC_DECOMPRESS) && !defined(CONFIG_SPL_BUILD)
+	u64 len;
+	int ret;
+
+	ret = misc_decompress_process((ulong)dst, (ulong)src, (ulong)srcn,
+				      DECOM_LZ4, false, &len, 0);
+	if (!ret) {
+		*dstn = len;
+		return 0;
+	}
+
+	printf("hw ulz4fn failed(%d), fallback to soft ulz4fn\n", ret);
+#endif
+	return ulz4fn_sw(src, srcn, dst, dstn);
+}
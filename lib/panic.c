@@ -19,6 +19,7 @@ static void panic_finish(void) __attribute__ ((noreturn));
 static void panic_finish(void)
 {
 	putc('\n');
+	flushc();
 #if defined(CONFIG_PANIC_HANG)
 	hang();
 #else
@@ -9,12 +9,13 @@
 #include <lmb.h>
 #include <malloc.h>
 #include <asm/io.h>
+#include <linux/math64.h>
+#include <linux/sizes.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
 #define SYSMEM_MAGIC		0x4D454D53	/* "SMEM" */
 
-#define LMB_ALLOC_ANYWHERE	0		/* sync with lmb.c */
 #define SYSMEM_ALLOC_NO_ALIGN	1
 #define SYSMEM_ALLOC_ANYWHERE	2
 
@@ -55,6 +56,212 @@ static inline int sysmem_is_sub_region(struct memblock *sub,
 		(sub->base + sub->size <= main->base + main->size));
 }
 
+/*
+ * Free regions are indexed twice: by base, to find the region holding an
+ * address and its neighbours, and by size, to find the best fit for an
+ * anywhere alloc. Both lookups are O(log n).
+ */
+struct sysmem_hole {
+	phys_addr_t base;
+	phys_size_t size;
+	struct rb_node by_addr;
+	struct rb_node by_size;
+};
+
+static void sysmem_hole_link_size(struct sysmem *sysmem,
+				  struct sysmem_hole *hole)
+{
+	struct rb_node **p = &sysmem->free_by_size.rb_node;
+	struct rb_node *parent = NULL;
+	struct sysmem_hole *h;
+
+	/* Same size: the higher one first, sync with top-down LMB alloc */
+	while (*p) {
+		parent = *p;
+		h = rb_entry(parent, struct sysmem_hole, by_size);
+		if (hole->size < h->size ||
+		    (hole->size == h->size && hole->base > h->base))
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+
+	rb_link_node(&hole->by_size, parent, p);
+	rb_insert_color(&hole->by_size, &sysmem->free_by_size);
+}
+
+static struct sysmem_hole *sysmem_hole_add(struct sysmem *sysmem,
+					   phys_addr_t base, phys_size_t size)
+{
+	struct rb_node **p = &sysmem->free_by_addr.rb_node;
+	struct rb_node *parent = NULL;
+	struct sysmem_hole *hole, *h;
+
+	hole = malloc(sizeof(*hole));
+	if (!hole)
+		return NULL;
+
+	hole->base = base;
+	hole->size = size;
+
+	while (*p) {
+		parent = *p;
+		h = rb_entry(parent, struct sysmem_hole, by_addr);
+		if (base < h->base)
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+
+	rb_link_node(&hole->by_addr, parent, p);
+	rb_insert_color(&hole->by_addr, &sysmem->free_by_addr);
+	sysmem_hole_link_size(sysmem, hole);
+	sysmem->free_cnt++;
+
+	return hole;
+}
+
+static void sysmem_hole_del(struct sysmem *sysmem, struct sysmem_hole *hole)
+{
+	rb_erase(&hole->by_addr, &sysmem->free_by_addr);
+	rb_erase(&hole->by_size, &sysmem->free_by_size);
+	sysmem->free_cnt--;
+	free(hole);
+}
+
+/* The new range must not cross the neighbours, so the base order holds */
+static void sysmem_hole_resize(struct sysmem *sysmem, struct sysmem_hole *hole,
+			       phys_addr_t base, phys_size_t size)
+{
+	rb_erase(&hole->by_size, &sysmem->free_by_size);
+	hole->base = base;
+	hole->size = size;
+	sysmem_hole_link_size(sysmem, hole);
+}
+
+/* Find the free region with the highest base not above @addr */
+static struct sysmem_hole *sysmem_hole_find(struct sysmem *sysmem,
+					    phys_addr_t addr)
+{
+	struct rb_node *node = sysmem->free_by_addr.rb_node;
+	struct sysmem_hole *h, *hole = NULL;
+
+	while (node) {
+		h = rb_entry(node, struct sysmem_hole, by_addr);
+		if (h->base <= addr) {
+			hole = h;
+			node = node->rb_right;
+		} else {
+			node = node->rb_left;
+		}
+	}
+
+	return hole;
+}
+
+/*
+ * Best fit: the smallest free region which still holds @size bytes at an
+ * @align aligned address. The region is placed at the top of it, like LMB
+ * does, so only a small unaligned tail is left above.
+ *
+ * Return the address, or 0 if there is no such region.
+ */
+static phys_addr_t sysmem_hole_best_fit(struct sysmem *sysmem,
+					phys_size_t size, ulong align)
+{
+	struct rb_node *node = sysmem->free_by_size.rb_node;
+	struct rb_node *fit = NULL;
+	struct sysmem_hole *h;
+	phys_addr_t addr;
+
+	while (node) {
+		h = rb_entry(node, struct sysmem_hole, by_size);
+		if (h->size >= size) {
+			fit = node;
+			node = node->rb_left;
+		} else {
+			node = node->rb_right;
+		}
+	}
+
+	for (; fit; fit = rb_next(fit)) {
+		h = rb_entry(fit, struct sysmem_hole, by_size);
+		addr = (h->base + h->size - size) & ~((phys_addr_t)align - 1);
+		/* LMB core doesn't support alloc at 0x0 address, neither do we */
+		if (addr >= h->base && addr)
+			return addr;
+	}
+
+	return 0;
+}
+
+/* Remove @base - @base + @size from the free regions */
+static int sysmem_hole_take(struct sysmem *sysmem,
+			    phys_addr_t base, phys_size_t size)
+{
+	struct sysmem_hole *hole;
+	phys_addr_t end = base + size;
+	phys_addr_t hole_end;
+
+	hole = sysmem_hole_find(sysmem, base);
+	if (!hole || end < base)
+		return -ENOMEM;
+
+	hole_end = hole->base + hole->size;
+	if (end > hole_end)
+		return -ENOMEM;
+
+	if (end < hole_end && base > hole->base &&
+	    !sysmem_hole_add(sysmem, end, hole_end - end))
+		return -ENOMEM;
+
+	if (base > hole->base)
+		sysmem_hole_resize(sysmem, hole, hole->base, base - hole->base);
+	else if (end < hole_end)
+		sysmem_hole_resize(sysmem, hole, end, hole_end - end);
+	else
+		sysmem_hole_del(sysmem, hole);
+
+	return 0;
+}
+
+/* Return @base - @base + @size to the free regions, merging neighbours */
+static int sysmem_hole_give(struct sysmem *sysmem,
+			    phys_addr_t base, phys_size_t size)
+{
+	struct sysmem_hole *prev, *next = NULL;
+	struct rb_node *node;
+
+	prev = sysmem_hole_find(sysmem, base);
+	node = prev ? rb_next(&prev->by_addr) : rb_first(&sysmem->free_by_addr);
+	if (node)
+		next = rb_entry(node, struct sysmem_hole, by_addr);
+
+	if (prev && prev->base + prev->size > base)
+		return -EINVAL;
+	if (next && base + size > next->base)
+		return -EINVAL;
+
+	if (prev && prev->base + prev->size != base)
+		prev = NULL;
+	if (next && base + size != next->base)
+		next = NULL;
+
+	if (prev && next) {
+		sysmem_hole_resize(sysmem, prev, prev->base,
+				   prev->size + size + next->size);
+		sysmem_hole_del(sysmem, next);
+	} else if (prev) {
+		sysmem_hole_resize(sysmem, prev, prev->base, prev->size + size);
+	} else if (next) {
+		sysmem_hole_resize(sysmem, next, base, size + next->size);
+	} else if (!sysmem_hole_add(sysmem, base, size)) {
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
 void sysmem_dump(void)
 {
 	struct sysmem *sysmem = &plat_sysmem;
@@ -62,9 +269,12 @@ void sysmem_dump(void)
 	struct memblock *mem;
 	struct memcheck *check;
 	struct list_head *node;
+	struct sysmem_hole *hole;
+	struct rb_node *node_rb;
 	ulong memory_size = 0;
-	ulong reserved_size = 0;
 	ulong allocated_size = 0;
+	phys_size_t free_size = 0;
+	phys_size_t largest_size = 0;
 	bool overflow = false;
 	ulong i;
 
@@ -142,22 +352,40 @@ void sysmem_dump(void)
 	       SIZE_MB((ulong)allocated_size),
 	       SIZE_KB((ulong)allocated_size));
 
-	/* LMB core reserved */
+	/* Free regions */
 	printf("    --------------------------------------------------------------------\n");
-	reserved_size = 0;
-	for (i = 0; i < lmb->reserved.cnt; i++) {
-		reserved_size += lmb->reserved.region[i].size;
-		printf("    LMB.allocated[%ld].addr  = 0x%08lx - 0x%08lx (size: 0x%08lx)\n", i,
-		       (ulong)lmb->reserved.region[i].base,
-		       (ulong)lmb->reserved.region[i].base +
-		       (ulong)lmb->reserved.region[i].size,
-		       (ulong)lmb->reserved.region[i].size);
-	}
-
-	printf("\n    reserved.core.total	   = 0x%08lx (%ld MiB. %ld KiB)\n",
-	       (ulong)reserved_size,
-	       SIZE_MB((ulong)reserved_size),
-	       SIZE_KB((ulong)reserved_size));
+	i = 0;
+	for (node_rb = rb_first(&sysmem->free_by_addr);
+	     node_rb;
+	     node_rb = rb_next(node_rb)) {
+		hole = rb_entry(node_rb, struct sysmem_hole, by_addr);
+		free_size += hole->size;
+		printf("    free.rgn[%ld].addr       = 0x%08lx - 0x%08lx (size: 0x%08lx)\n", i,
+		       (ulong)hole->base,
+		       (ulong)(hole->base + hole->size),
+		       (ulong)hole->size);
+		i++;
+	}
+
+	node_rb = rb_last(&sysmem->free_by_size);
+	if (node_rb) {
+		hole = rb_entry(node_rb, struct sysmem_hole, by_size);
+		largest_size = hole->size;
+	}
+
+	printf("\n    free.total		   = 0x%08lx (%ld MiB. %ld KiB)\n",
+	       (ulong)free_size,
+	       SIZE_MB((ulong)free_size),
+	       SIZE_KB((ulong)free_size));
+	printf("    free.largest	   = 0x%08lx (%ld MiB. %ld KiB)\n",
+	       (ulong)largest_size,
+	       SIZE_MB((ulong)largest_size),
+	       SIZE_KB((ulong)largest_size));
+	/* How much of the free memory is not in the largest free region */
+	printf("    free.fragmentation	   = %ld%% (%ld regions)\n",
+	       free_size ? (ulong)div64_u64((u64)(free_size - largest_size) * 100,
+					    free_size) : 0,
+	       sysmem->free_cnt);
 	printf("    --------------------------------------------------------------------\n\n");
 }
 
@@ -272,6 +500,8 @@ static int sysmem_add(phys_addr_t base, phys_size_t size)
 		return -EINVAL;
 
 	ret = lmb_add(&sysmem->lmb, base, size);
+	if (ret >= 0)
+		ret = sysmem_hole_give(sysmem, base, size);
 	if (ret < 0)
 		SYSMEM_E("Failed to add sysmem at 0x%08lx for 0x%08lx size\n",
 			 (ulong)base, (ulong)size);
@@ -315,6 +545,35 @@ finish:
 	return name;
 }
 
+static void sysmem_alloc_failed(struct sysmem *sysmem, const char *name,
+				phys_addr_t base, phys_size_t size)
+{
+	struct memblock *mem;
+	struct list_head *node;
+
+	if (base == SYSMEM_ALLOC_ANYWHERE) {
+		SYSMEM_E("Failed to alloc \"%s\" with size 0x%08lx, no fit region\n",
+			 name, (ulong)size);
+		return;
+	}
+
+	list_for_each(node, &sysmem->allocated_head) {
+		mem = list_entry(node, struct memblock, node);
+		if (sysmem_is_overlap(mem->base, mem->size, base, size)) {
+			SYSMEM_E("\"%s\" (0x%08lx - 0x%08lx) alloc is "
+				 "overlap with existence \"%s\" (0x%08lx - "
+				 "0x%08lx)\n",
+				 name, (ulong)base, (ulong)(base + size),
+				 mem->attr.name, (ulong)mem->base,
+				 (ulong)(mem->base + mem->size));
+			return;
+		}
+	}
+
+	SYSMEM_E("Failed to alloc \"%s\" at 0x%08lx - 0x%08lx\n",
+		 name, (ulong)base, (ulong)(base + size));
+}
+
 static void *sysmem_alloc_align_base(enum memblk_id id,
 				     const char *mem_name,
 				     phys_addr_t base,
@@ -328,7 +587,6 @@ static void *sysmem_alloc_align_base(enum memblk_id id,
 	struct list_head *node;
 	const char *name;
 	phys_addr_t paddr;
-	phys_addr_t alloc_base;
 	phys_size_t alloc_size;
 	phys_addr_t orig_base = base;
 
@@ -459,14 +717,6 @@ static void *sysmem_alloc_align_base(enum memblk_id id,
 
 			SYSMEM_E("Failed to double alloc for existence \"%s\"\n", name);
 			goto out;
-		} else if (sysmem_is_overlap(mem->base, mem->size, base, size)) {
-			SYSMEM_E("\"%s\" (0x%08lx - 0x%08lx) alloc is "
-				 "overlap with existence \"%s\" (0x%08lx - "
-				 "0x%08lx)\n",
-				 name, (ulong)base, (ulong)(base + size),
-				 mem->attr.name, (ulong)mem->base,
-				 (ulong)(mem->base + mem->size));
-			goto out;
 		}
 	}
 
@@ -476,58 +726,45 @@ static void *sysmem_alloc_align_base(enum memblk_id id,
 	else
 		alloc_size = size;
 
-	/* Alloc anywhere ? */
+	/* Alloc anywhere ? Take the best fit free region */
 	if (base == SYSMEM_ALLOC_ANYWHERE)
-		alloc_base = LMB_ALLOC_ANYWHERE;
+		paddr = sysmem_hole_best_fit(sysmem, alloc_size, align);
 	else
-		alloc_base = base + alloc_size;	/* LMB is align down alloc mechanism */
+		paddr = base;
 
-	SYSMEM_D("DO alloc... base: 0x%08lx\n", (ulong)alloc_base);
+	SYSMEM_D("DO alloc... base: 0x%08lx\n", (ulong)paddr);
 
-	paddr = lmb_alloc_base(&sysmem->lmb, alloc_size, align, alloc_base);
-	if (paddr) {
-		if ((paddr == base) || (base == SYSMEM_ALLOC_ANYWHERE)) {
-			mem = malloc(sizeof(*mem));
-			if (!mem) {
-				SYSMEM_E("No memory for \"%s\" alloc sysmem\n", name);
-				goto out;
-			}
-			/* Record original base for dump */
-			if (attr.flags & F_HIGHEST_MEM)
-				mem->orig_base = base;
-			else
-				mem->orig_base = orig_base;
-
-			mem->base = paddr;
-			mem->size = alloc_size;
-			mem->attr = attr;
-			sysmem->allocated_cnt++;
-			list_add_tail(&mem->node, &sysmem->allocated_head);
-
-			/* Add overflow check magic */
-			if (mem->attr.flags & F_OFC) {
-				check = (struct memcheck *)(paddr + size);
-				check->magic = SYSMEM_MAGIC;
-			} else if (mem->attr.flags & F_HOFC) {
-				check = (struct memcheck *)(paddr - sizeof(*check));
-				check->magic = SYSMEM_MAGIC;
-			}
-		} else {
-			SYSMEM_E("Failed to alloc \"%s\" expect at 0x%08lx - 0x%08lx "
-				 "but at 0x%08lx - 0x%08lx\n",
-				 name, (ulong)base, (ulong)(base + size),
-				 (ulong)paddr, (ulong)(paddr + size));
-			/* Free what we don't want allocated region */
-			if (lmb_free(&sysmem->lmb, paddr, alloc_size) < 0)
-				SYSMEM_E("Failed to free \"%s\"\n", name);
+	if (!paddr || sysmem_hole_take(sysmem, paddr, alloc_size)) {
+		sysmem_alloc_failed(sysmem, name, base, alloc_size);
+		goto out;
+	}
 
-			goto out;
-		}
-	} else {
-		SYSMEM_E("Failed to alloc \"%s\" at 0x%08lx - 0x%08lx\n",
-			 name, (ulong)base, (ulong)(base + size));
+	mem = malloc(sizeof(*mem));
+	if (!mem) {
+		SYSMEM_E("No memory for \"%s\" alloc sysmem\n", name);
+		sysmem_hole_give(sysmem, paddr, alloc_size);
 		goto out;
 	}
+	/* Record original base for dump */
+	if (attr.flags & F_HIGHEST_MEM)
+		mem->orig_base = base;
+	else
+		mem->orig_base = orig_base;
+
+	mem->base = paddr;
+	mem->size = alloc_size;
+	mem->attr = attr;
+	sysmem->allocated_cnt++;
+	list_add_tail(&mem->node, &sysmem->allocated_head);
+
+	/* Add overflow check magic */
+	if (mem->attr.flags & F_OFC) {
+		check = (struct memcheck *)(paddr + size);
+		check->magic = SYSMEM_MAGIC;
+	} else if (mem->attr.flags & F_HOFC) {
+		check = (struct memcheck *)(paddr - sizeof(*check));
+		check->magic = SYSMEM_MAGIC;
+	}
 
 	SYSMEM_D("Exit alloc: \"%s\", paddr=0x%08lx, size=0x%08lx, align=0x%x, anywhere=%d\n",
 		 name, (ulong)paddr, (ulong)size, (u32)align, !base);
@@ -632,30 +869,31 @@ void *sysmem_fdt_reserve_alloc_base(const char *name,
 ulong sysmem_alloc_temporary_mem(phys_size_t size)
 {
 	struct sysmem *sysmem = &plat_sysmem;
-	phys_addr_t alloc_base;
+	struct sysmem_hole *hole;
+	struct rb_node *node;
+	phys_addr_t max_addr;
 	phys_addr_t paddr;
-	phys_addr_t base;
-	int ret;
+	phys_addr_t top;
 
 	if (!sysmem_has_init())
 		return false;
 
-	base = (gd->start_addr_sp - CONFIG_SYS_STACK_SIZE - 0x2000) - size;
-
-	/* LMB is align down alloc mechanism */
-	alloc_base = base + size;
-	paddr = __lmb_alloc_base(&sysmem->lmb, size, SZ_1K, alloc_base);
-	if (paddr) {
-		/* If free failed, return false */
-		ret = lmb_free(&sysmem->lmb, paddr, size);
-		if (ret < 0) {
-			SYSMEM_E("Can't free at 0x%08lx - 0x%08lx, ret=%d\n",
-				 (ulong)paddr, (ulong)(paddr + size), ret);
-			return 0;
-		}
+	/* The highest free 1KB aligned region below U-Boot stack */
+	max_addr = gd->start_addr_sp - CONFIG_SYS_STACK_SIZE - 0x2000;
+	hole = sysmem_hole_find(sysmem, max_addr);
+	node = hole ? &hole->by_addr : NULL;
+	for (; node; node = rb_prev(node)) {
+		hole = rb_entry(node, struct sysmem_hole, by_addr);
+		top = min(hole->base + hole->size, max_addr);
+		if (top - hole->base < size)
+			continue;
+
+		paddr = (top - size) & ~((phys_addr_t)SZ_1K - 1);
+		if (paddr >= hole->base && paddr)
+			return paddr;
 	}
 
-	return paddr;
+	return 0;
 }
 
 int sysmem_free(phys_addr_t base)
@@ -683,7 +921,7 @@ int sysmem_free(phys_addr_t base)
 		return -EINVAL;
 	}
 
-	ret = lmb_free(&sysmem->lmb, mem->base, mem->size);
+	ret = sysmem_hole_give(sysmem, mem->base, mem->size);
 	if (ret >= 0) {
 		SYSMEM_D("Free: \"%s\" 0x%08lx - 0x%08lx\n",
 			 mem->attr.name, (ulong)mem->base,
@@ -714,8 +952,11 @@ int sysmem_init(void)
 	lmb_init(&sysmem->lmb);
 	INIT_LIST_HEAD(&sysmem->allocated_head);
 	INIT_LIST_HEAD(&sysmem->kmem_resv_head);
+	sysmem->free_by_addr = RB_ROOT;
+	sysmem->free_by_size = RB_ROOT;
 	sysmem->allocated_cnt = 0;
 	sysmem->kmem_resv_cnt = 0;
+	sysmem->free_cnt = 0;
 
 	if (gd->flags & GD_FLG_RELOC) {
 		sysmem->has_initr = true;
@@ -45,12 +45,29 @@
 #define NFS_RPC_ERR	1
 #define NFS_RPC_DROP	124
 
+/* Bytes of a READ reply copied to parse it, the data is stored in place */
+#define NFS_READ_HDR_SIZE	256
+/* Bytes per hash mark */
+#define NFS_HASH_SIZE		(NFS_READ_SIZE / 2 * 10)
+
 static int fs_mounted;
 static unsigned long rpc_id;
-static int nfs_offset = -1;
-static int nfs_len;
 static ulong nfs_timeout = NFS_TIMEOUT;
 
+/* A READ request in flight */
+struct nfs_read_slot {
+	unsigned long id;	/* RPC id of the request, 0 if the slot is free */
+	u32 offset;
+	u32 len;
+};
+
+static struct nfs_read_slot nfs_read_slots[CONFIG_NFS_READ_WINDOW];
+static u32 nfs_rsize;		/* bytes asked for in each READ */
+static u32 nfs_read_next;	/* offset of the next READ to send */
+static u32 nfs_file_size;	/* U32_MAX until known */
+static int nfs_hashes;
+static ulong nfs_read_time;
+
 static char dirfh[NFS_FHSIZE];	/* NFSv2 / NFSv3 file handle of directory */
 static char filefh[NFS3_FHSIZE]; /* NFSv2 / NFSv3 file handle */
 static int filefh3_length;	/* (variable) length of filefh when NFSv3 */
@@ -69,6 +86,7 @@ static int nfs_state;
 #define STATE_LOOKUP_REQ		5
 #define STATE_READ_REQ			6
 #define STATE_READLINK_REQ		7
+#define STATE_FSINFO_REQ		8
 
 static char *nfs_filename;
 static char *nfs_path;
@@ -386,11 +404,141 @@ static void nfs_read_req(int offset, int readlen)
 	rpc_req(PROG_NFS, NFS_READ, data, len);
 }
 
+/**************************************************************************
+NFS_FSINFO - Get the preferred transfer sizes of the NFSv3 server
+**************************************************************************/
+static void nfs_fsinfo_req(void)
+{
+	uint32_t data[1024];
+	uint32_t *p;
+	int len;
+
+	p = &(data[0]);
+	p = rpc_add_credentials(p);
+
+	*p++ = htonl(filefh3_length);
+	memcpy(p, filefh, filefh3_length);
+	p += (filefh3_length / 4);
+
+	len = (uint32_t *)p - (uint32_t *)&(data[0]);
+
+	rpc_req(PROG_NFS, NFS3PROC_FSINFO, data, len);
+}
+
+/**************************************************************************
+READ window - Keep several READ requests in flight
+**************************************************************************/
+/* Largest READ whose reply can be received */
+static u32 nfs_max_read_size(void)
+{
+	u32 size = NFS_READ_SIZE;
+
+#ifdef CONFIG_IP_DEFRAG
+	/* Leave room for the UDP, RPC and NFS headers */
+	while (size * 2 + IP_UDP_HDR_SIZE + NFS_READ_HDR_SIZE <=
+	       CONFIG_NET_MAXDEFRAG)
+		size *= 2;
+#endif
+	size = min(size, (u32)CONFIG_NFS_READ_SIZE);
+	if (supported_nfs_versions & NFSV2_FLAG)
+		size = min(size, (u32)NFS2_MAXDATA);
+
+	return size;
+}
+
+static void nfs_read_send(struct nfs_read_slot *slot)
+{
+	nfs_read_req(slot->offset, slot->len);
+	slot->id = rpc_id;
+}
+
+static struct nfs_read_slot *nfs_read_find(unsigned long id)
+{
+	int i;
+
+	for (i = 0; i < CONFIG_NFS_READ_WINDOW; i++) {
+		if (id && nfs_read_slots[i].id == id)
+			return &nfs_read_slots[i];
+	}
+
+	return NULL;
+}
+
+/* Fill the free slots, return true once the whole file is in */
+static bool nfs_read_fill(void)
+{
+	struct nfs_read_slot *slot;
+	bool busy = false;
+	int i;
+
+	for (i = 0; i < CONFIG_NFS_READ_WINDOW; i++) {
+		slot = &nfs_read_slots[i];
+		if (!slot->id && nfs_read_next < nfs_file_size) {
+			slot->offset = nfs_read_next;
+			slot->len = min(nfs_rsize, nfs_file_size - nfs_read_next);
+			nfs_read_next += slot->len;
+			nfs_read_send(slot);
+		}
+		if (slot->id)
+			busy = true;
+	}
+
+	return !busy;
+}
+
+/* Print hash marks for the data received in order so far */
+static void nfs_read_progress(void)
+{
+	u32 done = min(nfs_read_next, nfs_file_size);
+	int i;
+
+	for (i = 0; i < CONFIG_NFS_READ_WINDOW; i++) {
+		if (nfs_read_slots[i].id)
+			done = min(done, nfs_read_slots[i].offset);
+	}
+
+	while ((u64)nfs_hashes * NFS_HASH_SIZE < done) {
+		if (nfs_hashes && !(nfs_hashes % HASHES_PER_LINE))
+			puts("\n\t ");
+		putc('#');
+		nfs_hashes++;
+	}
+}
+
+static void nfs_read_start(void)
+{
+	memset(nfs_read_slots, '\0', sizeof(nfs_read_slots));
+	nfs_read_next = 0;
+	nfs_file_size = U32_MAX;
+	nfs_hashes = 0;
+	nfs_read_time = get_timer(0);
+	debug("NFS read size %u, %d requests in flight\n", nfs_rsize,
+	      CONFIG_NFS_READ_WINDOW);
+
+	nfs_state = STATE_READ_REQ;
+	nfs_read_fill();
+}
+
+static void nfs_read_done(void)
+{
+	ulong time = get_timer(nfs_read_time);
+
+	nfs_read_progress();
+	if (time > 0) {
+		puts("\n\t ");	/* Line up with "Loading: " */
+		print_size(net_boot_file_size / time * 1000, "/s");
+		printf(" (read size %u, %d in flight)", nfs_rsize,
+		       CONFIG_NFS_READ_WINDOW);
+	}
+}
+
 /**************************************************************************
 RPC request dispatcher
 **************************************************************************/
 static void nfs_send(void)
 {
+	int i;
+
 	debug("%s\n", __func__);
 
 	switch (nfs_state) {
@@ -416,11 +564,18 @@ static void nfs_send(void)
 		nfs_lookup_req(nfs_filename);
 		break;
 	case STATE_READ_REQ:
-		nfs_read_req(nfs_offset, nfs_len);
+		/* Send again all requests in flight */
+		for (i = 0; i < CONFIG_NFS_READ_WINDOW; i++) {
+			if (nfs_read_slots[i].id)
+				nfs_read_send(&nfs_read_slots[i]);
+		}
 		break;
 	case STATE_READLINK_REQ:
 		nfs_readlink_req();
 		break;
+	case STATE_FSINFO_REQ:
+		nfs_fsinfo_req();
+		break;
 	}
 }
 
@@ -652,15 +807,15 @@ static int nfs_readlink_reply(uchar *pkt, unsigned len)
 	return 0;
 }
 
-static int nfs_read_reply(uchar *pkt, unsigned len)
+static int nfs_fsinfo_reply(uchar *pkt, unsigned len)
 {
 	struct rpc_t rpc_pkt;
-	int rlen;
-	uchar *data_ptr;
+	int nfsv3_data_offset;
+	u32 rtmax;
 
 	debug("%s\n", __func__);
 
-	memcpy(&rpc_pkt.u.data[0], pkt, sizeof(rpc_pkt.u.reply));
+	memcpy(&rpc_pkt.u.data[0], pkt, len);
 
 	if (ntohl(rpc_pkt.u.reply.id) > rpc_id)
 		return -NFS_RPC_ERR;
@@ -670,39 +825,86 @@ static int nfs_read_reply(uchar *pkt, unsigned len)
 	if (rpc_pkt.u.reply.rstatus  ||
 	    rpc_pkt.u.reply.verifier ||
 	    rpc_pkt.u.reply.astatus  ||
-	    rpc_pkt.u.reply.data[0]) {
+	    rpc_pkt.u.reply.data[0])
+		return -1;
+
+	nfsv3_data_offset = nfs3_get_attributes_offset(rpc_pkt.u.reply.data);
+	rtmax = ntohl(rpc_pkt.u.reply.data[1 + nfsv3_data_offset]);
+	debug("NFS server rtmax %u\n", rtmax);
+	if (rtmax && rtmax < nfs_rsize)
+		nfs_rsize = rtmax;
+
+	return 0;
+}
+
+static int nfs_read_reply(uchar *pkt, unsigned len)
+{
+	struct rpc_t rpc_pkt;
+	struct nfs_read_slot *slot;
+	uint32_t *data = rpc_pkt.u.reply.data;
+	uchar *data_ptr;
+	bool eof;
+	u32 rlen;
+
+	debug("%s\n", __func__);
+
+	memcpy(&rpc_pkt.u.data[0], pkt, min(len, (unsigned)NFS_READ_HDR_SIZE));
+
+	slot = nfs_read_find(ntohl(rpc_pkt.u.reply.id));
+	if (!slot)
+		return -NFS_RPC_DROP;
+
+	if (rpc_pkt.u.reply.rstatus  ||
+	    rpc_pkt.u.reply.verifier ||
+	    rpc_pkt.u.reply.astatus  ||
+	    data[0]) {
 		if (rpc_pkt.u.reply.rstatus)
 			return -9999;
 		if (rpc_pkt.u.reply.astatus)
 			return -9999;
-		return -ntohl(rpc_pkt.u.reply.data[0]);
+		return -ntohl(data[0]);
 	}
 
-	if ((nfs_offset != 0) && !((nfs_offset) %
-			(NFS_READ_SIZE / 2 * 10 * HASHES_PER_LINE)))
-		puts("\n\t ");
-	if (!(nfs_offset % ((NFS_READ_SIZE / 2) * 10)))
-		putc('#');
-
 	if (supported_nfs_versions & NFSV2_FLAG) {
-		rlen = ntohl(rpc_pkt.u.reply.data[18]);
-		data_ptr = (uchar *)&(rpc_pkt.u.reply.data[19]);
+		/* file size from the attributes */
+		nfs_file_size = ntohl(data[6]);
+		rlen = ntohl(data[18]);
+		data_ptr = (uchar *)&data[19];
+		/* NFSv2 has no EOF flag but only reads short at the end */
+		eof = rlen < slot->len;
 	} else {  /* NFSV3_FLAG */
-		int nfsv3_data_offset =
-			nfs3_get_attributes_offset(rpc_pkt.u.reply.data);
+		int nfsv3_data_offset = nfs3_get_attributes_offset(data);
 
+		/* 64-bit file size, if the attributes are there */
+		if (nfsv3_data_offset > 1 && !data[7])
+			nfs_file_size = ntohl(data[8]);
 		/* count value */
-		rlen = ntohl(rpc_pkt.u.reply.data[1 + nfsv3_data_offset]);
-		/* Skip unused values :
-			EOF:		32 bits value,
-			data_size:	32 bits value,
-		*/
-		data_ptr = (uchar *)
-			&(rpc_pkt.u.reply.data[4 + nfsv3_data_offset]);
+		rlen = ntohl(data[1 + nfsv3_data_offset]);
+		eof = data[2 + nfsv3_data_offset] != 0;
+		/* Skip data_size: 32 bits value */
+		data_ptr = (uchar *)&data[4 + nfsv3_data_offset];
 	}
 
-	if (store_block(data_ptr, nfs_offset, rlen))
-			return -9999;
+	/* Point into the packet rather than the copy of its headers */
+	data_ptr = pkt + (data_ptr - rpc_pkt.u.data);
+	if (rlen > slot->len || data_ptr + rlen > pkt + len)
+		return -NFS_RPC_DROP;
+
+	if (rlen && store_block(data_ptr, slot->offset, rlen))
+		return -9999;
+
+	if (eof || !rlen) {
+		nfs_file_size = min(nfs_file_size, slot->offset + rlen);
+		slot->id = 0;
+	} else if (rlen < slot->len) {
+		/* The server sent less than asked for: ask for the rest */
+		slot->offset += rlen;
+		slot->len -= rlen;
+		nfs_read_send(slot);
+	} else {
+		slot->id = 0;
+	}
+	nfs_read_progress();
 
 	return rlen;
 }
@@ -735,6 +937,10 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 	if (dest != nfs_our_port)
 		return;
 
+	/* Only READ replies may be bigger than struct rpc_t */
+	if (len > sizeof(struct rpc_t) && nfs_state != STATE_READ_REQ)
+		return;
+
 	switch (nfs_state) {
 	case STATE_PRCLOOKUP_PROG_MOUNT_REQ:
 		if (rpc_lookup_reply(PROG_MOUNT, pkt, len) == -NFS_RPC_DROP)
@@ -795,13 +1001,27 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			nfs_state = STATE_PRCLOOKUP_PROG_MOUNT_REQ;
 			nfs_send();
 		} else {
-			nfs_state = STATE_READ_REQ;
-			nfs_offset = 0;
-			nfs_len = NFS_READ_SIZE;
-			nfs_send();
+			nfs_rsize = nfs_max_read_size();
+			if (!(supported_nfs_versions & NFSV2_FLAG) &&
+			    nfs_rsize > NFS_READ_SIZE) {
+				/* Ask the NFSv3 server how much it can send */
+				nfs_state = STATE_FSINFO_REQ;
+				nfs_send();
+			} else {
+				nfs_read_start();
+			}
 		}
 		break;
 
+	case STATE_FSINFO_REQ:
+		reply = nfs_fsinfo_reply(pkt, len);
+		if (reply == -NFS_RPC_DROP)
+			break;
+		else if (reply)
+			nfs_rsize = NFS_READ_SIZE;
+		nfs_read_start();
+		break;
+
 	case STATE_READLINK_REQ:
 		reply = nfs_readlink_reply(pkt, len);
 		if (reply == -NFS_RPC_DROP) {
@@ -822,19 +1042,22 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 
 	case STATE_READ_REQ:
 		rlen = nfs_read_reply(pkt, len);
+		if (rlen == -NFS_RPC_DROP)
+			break;
 		net_set_timeout_handler(nfs_timeout, nfs_timeout_handler);
-		if (rlen > 0) {
-			nfs_offset += rlen;
+		if (rlen >= 0) {
+			if (!nfs_read_fill())
+				break;
+			nfs_read_done();
+			nfs_download_state = NETLOOP_SUCCESS;
+			nfs_state = STATE_UMOUNT_REQ;
 			nfs_send();
 		} else if ((rlen == -NFSERR_ISDIR) || (rlen == -NFSERR_INVAL)) {
 			/* symbolic link */
 			nfs_state = STATE_READLINK_REQ;
 			nfs_send();
 		} else {
-			if (!rlen)
-				nfs_download_state = NETLOOP_SUCCESS;
-			if (rlen < 0)
-				debug("NFS READ error (%d)\n", rlen);
+			debug("NFS READ error (%d)\n", rlen);
 			nfs_state = STATE_UMOUNT_REQ;
 			nfs_send();
 		}
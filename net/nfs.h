@@ -26,6 +26,7 @@
 #define NFS_READ        6
 
 #define NFS3PROC_LOOKUP 3
+#define NFS3PROC_FSINFO 19
 
 #define NFS_FHSIZE      32
 #define NFS3_FHSIZE     64
@@ -44,6 +45,8 @@
  */
 #define NFS_READ_SIZE	1024	/* biggest power of two that fits Ether frame */
 
+#define NFS2_MAXDATA	8192	/* largest NFSv2 READ */
+
 /* Values for Accept State flag on RPC answers (See: rfc1831) */
 enum rpc_accept_stat {
 	NFS_RPC_SUCCESS = 0,	/* RPC executed successfully */
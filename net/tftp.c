@@ -134,6 +134,20 @@ static char tftp_filename[MAX_LEN];
 static unsigned short tftp_block_size = TFTP_BLOCK_SIZE;
 static unsigned short tftp_block_size_option = TFTP_MTU_BLOCKSIZE;
 
+#ifdef CONFIG_TFTP_WINDOWSIZE
+#define TFTP_WINDOWSIZE CONFIG_TFTP_WINDOWSIZE
+#else
+#define TFTP_WINDOWSIZE 1
+#endif
+
+/* RFC 7440: number of blocks the server sends before waiting for an ACK */
+static unsigned short tftp_windowsize = 1;
+static unsigned short tftp_windowsize_option = TFTP_WINDOWSIZE;
+/* block number whose arrival completes the current window */
+static ulong	tftp_next_ack;
+/* block we last re-acknowledged after a gap, so we only do it once */
+static ulong	tftp_last_nack;
+
 #ifdef CONFIG_MCAST_TFTP
 #include <malloc.h>
 #define MTFTP_BITMAPSIZE	0x1000
@@ -211,6 +225,8 @@ static void new_transfer(void)
 	tftp_prev_block = 0;
 	tftp_block_wrap = 0;
 	tftp_block_wrap_offset = 0;
+	tftp_next_ack = tftp_windowsize;
+	tftp_last_nack = TFTP_SEQUENCE_SIZE;
 #ifdef CONFIG_CMD_TFTPPUT
 	tftp_put_final_block_sent = 0;
 #endif
@@ -372,6 +388,10 @@ static void tftp_send(void)
 		/* try for more effic. blk size */
 		pkt += sprintf((char *)pkt, "blksize%c%d%c",
 				0, tftp_block_size_option, 0);
+		/* ask to receive several blocks per ACK; only for reads */
+		if (tftp_state == STATE_SEND_RRQ && tftp_windowsize_option > 1)
+			pkt += sprintf((char *)pkt, "windowsize%c%d%c",
+					0, tftp_windowsize_option, 0);
 #ifdef CONFIG_MCAST_TFTP
 		/* Check all preconditions before even trying the option */
 		if (!tftp_mcast_disabled) {
@@ -457,6 +477,45 @@ static void icmp_handler(unsigned type, unsigned code, unsigned dest,
 }
 #endif
 
+/**
+ * tftp_window_in_order() - Check that a block received in a window is next
+ *
+ * The server sends a whole window of blocks without waiting, so a lost or
+ * reordered block shows up as a gap. The blocks after the gap are dropped
+ * and the last block received in order is acknowledged once, which makes
+ * the server send the window again from the block that is missing.
+ *
+ * Return: true to process the block in tftp_cur_block, false to drop it
+ */
+static bool tftp_window_in_order(void)
+{
+	ulong block = tftp_cur_block;
+
+	/* the first block of the transfer is checked by the caller */
+	if (tftp_state != STATE_DATA) {
+		if (block == 1)
+			return true;
+		tftp_prev_block = 0;
+	} else if (block == (tftp_prev_block + 1) % TFTP_SEQUENCE_SIZE) {
+		return true;
+	} else if (block == tftp_prev_block) {
+		/* a duplicate, ignored as in lockstep mode */
+		return true;
+	}
+
+	debug("Received block %lu, expected %lu\n", block,
+	      (tftp_prev_block + 1) % TFTP_SEQUENCE_SIZE);
+	tftp_cur_block = tftp_prev_block;
+	if (tftp_last_nack != tftp_prev_block) {
+		tftp_last_nack = tftp_prev_block;
+		tftp_next_ack = (tftp_prev_block + tftp_windowsize) %
+				TFTP_SEQUENCE_SIZE;
+		tftp_send();
+	}
+
+	return false;
+}
+
 static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			 unsigned src, unsigned len)
 {
@@ -540,6 +599,19 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 				debug("Blocksize ack: %s, %d\n",
 				      (char *)pkt + i + 8, tftp_block_size);
 			}
+			if (strcmp((char *)pkt + i, "windowsize") == 0) {
+				ulong windowsize;
+
+				windowsize = simple_strtoul((char *)pkt + i + 11,
+							    NULL, 10);
+				/* the server may only lower what we asked for */
+				if (!windowsize ||
+				    windowsize > tftp_windowsize_option)
+					windowsize = 1;
+				tftp_windowsize = windowsize;
+				debug("Windowsize ack: %s, %d\n",
+				      (char *)pkt + i + 11, tftp_windowsize);
+			}
 #ifdef CONFIG_TFTP_TSIZE
 			if (strcmp((char *)pkt+i, "tsize") == 0) {
 				tftp_tsize = simple_strtoul((char *)pkt + i + 6,
@@ -570,6 +642,9 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		len -= 2;
 		tftp_cur_block = ntohs(*(__be16 *)pkt);
 
+		if (tftp_windowsize > 1 && !tftp_window_in_order())
+			break;
+
 		update_block_number();
 
 		if (tftp_state == STATE_SEND_RRQ)
@@ -608,6 +683,17 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 
 		store_block(tftp_cur_block - 1, pkt + 2, len);
 
+		/*
+		 * With a window, stay quiet until its last block arrives.
+		 * The final, short block is always acknowledged.
+		 */
+		if (tftp_windowsize > 1 && len == tftp_block_size &&
+		    tftp_cur_block != tftp_next_ack)
+			break;
+		tftp_next_ack = (tftp_cur_block + tftp_windowsize) %
+				TFTP_SEQUENCE_SIZE;
+		tftp_last_nack = TFTP_SEQUENCE_SIZE;
+
 		/*
 		 *	Acknowledge the block just received, which will prompt
 		 *	the remote for the next one.
@@ -690,6 +776,10 @@ static void tftp_timeout_handler(void)
 	} else {
 		puts("T ");
 		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
+		/* the server sends a new window after the block we ACK */
+		if (tftp_state == STATE_DATA && !tftp_put_active)
+			tftp_next_ack = (tftp_cur_block + tftp_windowsize) %
+					TFTP_SEQUENCE_SIZE;
 		if (tftp_state != STATE_RECV_WRQ)
 			tftp_send();
 	}
@@ -698,6 +788,7 @@ static void tftp_timeout_handler(void)
 
 void tftp_start(enum proto_t protocol)
 {
+	ulong windowsize = TFTP_WINDOWSIZE;
 #if CONFIG_NET_TFTP_VARS
 	char *ep;             /* Environment pointer */
 
@@ -710,6 +801,14 @@ void tftp_start(enum proto_t protocol)
 	if (ep != NULL)
 		tftp_block_size_option = simple_strtol(ep, NULL, 10);
 
+	ep = env_get("tftpwindowsize");
+	if (ep != NULL) {
+		windowsize = simple_strtoul(ep, NULL, 10);
+		if (windowsize < 1 || windowsize > PKTBUFSRX)
+			printf("TFTP windowsize (%lu) out of range 1..%d\n",
+			       windowsize, PKTBUFSRX);
+	}
+
 	ep = env_get("tftptimeout");
 	if (ep != NULL)
 		timeout_ms = simple_strtol(ep, NULL, 10);
@@ -731,8 +830,11 @@ void tftp_start(enum proto_t protocol)
 	}
 #endif
 
-	debug("TFTP blocksize = %i, timeout = %ld ms\n",
-	      tftp_block_size_option, timeout_ms);
+	/* A window must fit in the receive buffers, or blocks are dropped */
+	tftp_windowsize_option = clamp(windowsize, 1UL, (ulong)PKTBUFSRX);
+
+	debug("TFTP blocksize = %i, windowsize = %i, timeout = %ld ms\n",
+	      tftp_block_size_option, tftp_windowsize_option, timeout_ms);
 
 	tftp_remote_ip = net_server_ip;
 	if (net_boot_file_name[0] == '\0') {
@@ -835,8 +937,10 @@ void tftp_start(enum proto_t protocol)
 
 	/* zero out server ether in case the server ip has changed */
 	memset(net_server_ethaddr, 0, 6);
-	/* Revert tftp_block_size to dflt */
+	/* Revert tftp_block_size and tftp_windowsize to dflt */
 	tftp_block_size = TFTP_BLOCK_SIZE;
+	tftp_windowsize = 1;
+	tftp_last_nack = TFTP_SEQUENCE_SIZE;
 #ifdef CONFIG_MCAST_TFTP
 	mcast_cleanup();
 #endif
@@ -864,8 +968,10 @@ void tftp_start_server(void)
 	timeout_ms = TIMEOUT;
 	net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
 
-	/* Revert tftp_block_size to dflt */
+	/* Revert tftp_block_size and tftp_windowsize to dflt */
 	tftp_block_size = TFTP_BLOCK_SIZE;
+	tftp_windowsize = 1;
+	tftp_last_nack = TFTP_SEQUENCE_SIZE;
 	tftp_cur_block = 0;
 	tftp_our_port = WELL_KNOWN_PORT;
 
@@ -0,0 +1,134 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * (C) Copyright 2026 Rockchip Electronics Co., Ltd
+ */
+
+#include <common.h>
+#include <bootstage.h>
+#include <command.h>
+#include <dm.h>
+#include <initcall.h>
+#include <malloc.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+static int bootstage_ut_inner;
+
+/* An initcall which probes a device */
+static int bootstage_ut_initcall(void)
+{
+	bootstage_ut_inner = bootstage_prof_start("inner", UCLASS_TEST);
+	bootstage_prof_end(bootstage_ut_inner);
+
+	return 0;
+}
+
+static int bootstage_ut_check(int handle, const char *name, uint uclass,
+			      uint depth)
+{
+	const struct bootstage_prof *prof = bootstage_prof_get(handle);
+
+	if (!prof || strcmp(prof->name, name) || prof->uclass != uclass ||
+	    prof->depth != depth) {
+		printf("%s: record %d is not '%s', uclass %u, depth %u\n",
+		       __func__, handle, name, uclass, depth);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int bootstage_ut_fill(int count)
+{
+	int i, handle = -1;
+
+	for (i = 0; i < count; i++) {
+		handle = bootstage_prof_start("fill", UCLASS_TEST);
+		bootstage_prof_end(handle);
+	}
+
+	return handle;
+}
+
+static int do_ut_bootstage(cmd_tbl_t *cmdtp, int flag, int argc,
+			   char *const argv[])
+{
+	const init_fnc_t init_sequence[] = { bootstage_ut_initcall, NULL };
+	const int count_f = CONFIG_BOOTSTAGE_PROFILE_COUNT_F;
+	const int count = CONFIG_BOOTSTAGE_PROFILE_COUNT;
+	struct bootstage_data *old = gd->bootstage, *early;
+	ulong reloc_ofs = 0;
+	void *moved = NULL;
+	char name[20];
+	int open, handle, ret = CMD_RET_FAILURE;
+
+	/* A table as board_init_f() sets it up, before relocation */
+	if (bootstage_init(false)) {
+		gd->bootstage = old;
+		return CMD_RET_FAILURE;
+	}
+	early = gd->bootstage;
+	moved = malloc(bootstage_get_size());
+	if (!moved)
+		goto out;
+
+	/* Initcalls are named by link-time address, probes nest inside */
+	if (gd->flags & GD_FLG_RELOC)
+		reloc_ofs = gd->reloc_off;
+	snprintf(name, sizeof(name), "0x%lx",
+		 (ulong)bootstage_ut_initcall - reloc_ofs);
+	if (initcall_run_list(init_sequence) ||
+	    bootstage_ut_check(0, name, BOOTSTAGE_PROF_INITCALL, 0) ||
+	    bootstage_ut_check(bootstage_ut_inner, "inner", UCLASS_TEST, 1))
+		goto out;
+
+	/* Fill the early table, with a call still open when it is moved */
+	bootstage_ut_fill(count_f - 3);
+	open = bootstage_prof_start("open", BOOTSTAGE_PROF_INITCALL);
+	handle = bootstage_ut_fill(1);
+	if (open != count_f - 1 || bootstage_prof_get(handle)) {
+		printf("%s: early table did not fill up\n", __func__);
+		goto out;
+	}
+
+	/* Everything recorded so far survives the move */
+	bootstage_move(moved);
+	bootstage_prof_end(open);
+	if (gd->bootstage != moved ||
+	    bootstage_ut_check(0, name, BOOTSTAGE_PROF_INITCALL, 0) ||
+	    bootstage_ut_check(1, "inner", UCLASS_TEST, 1) ||
+	    bootstage_ut_check(count_f - 2, "fill", UCLASS_TEST, 0) ||
+	    bootstage_ut_check(open, "open", BOOTSTAGE_PROF_INITCALL, 0))
+		goto out;
+
+	/* The lost call stays lost, later ones are recorded up to the end */
+	if (bootstage_prof_get(handle)) {
+		printf("%s: lost record %d reappeared\n", __func__, handle);
+		goto out;
+	}
+	handle = bootstage_ut_fill(count - count_f - 1);
+	if (handle != count - 1 ||
+	    bootstage_ut_check(count_f + 1, "fill", UCLASS_TEST, 0) ||
+	    bootstage_ut_check(handle, "fill", UCLASS_TEST, 0))
+		goto out;
+	handle = bootstage_ut_fill(1);
+	if (bootstage_prof_get(handle)) {
+		printf("%s: record %d is past the table\n", __func__, handle);
+		goto out;
+	}
+
+	printf("%s: Everything went swimmingly\n", __func__);
+	ret = 0;
+out:
+	gd->bootstage = old;
+	free(moved);
+	free(early);
+
+	return ret;
+}
+
+U_BOOT_CMD(
+	ut_bootstage,	1,	1,	do_ut_bootstage,
+	"Check the initcall and device probe profile across relocation",
+	""
+);
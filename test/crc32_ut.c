@@ -0,0 +1,72 @@
+/*
+ * (C) Copyright 2026 Rockchip Electronics Co., Ltd
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <u-boot/crc.h>
+
+#define CRC32_POLY	0xedb88320
+#define CRC32C_POLY	0x82f63b78
+
+/* A bit at a time, to check the faster methods against */
+static uint32_t crc_ref(uint32_t poly, uint32_t crc, const unsigned char *p,
+			uint len)
+{
+	int k;
+
+	crc = ~crc;
+	while (len--) {
+		crc ^= *p++;
+		for (k = 0; k < 8; k++)
+			crc = crc & 1 ? poly ^ (crc >> 1) : crc >> 1;
+	}
+
+	return ~crc;
+}
+
+static int do_ut_crc32(cmd_tbl_t *cmdtp, int flag, int argc,
+		       char *const argv[])
+{
+	const unsigned char check[] = "123456789";
+	unsigned char buf[300];
+	uint32_t seed = 1;
+	int i, off, len;
+
+	/* The check values of both CRCs */
+	if (crc32(0, check, 9) != 0xcbf43926 ||
+	    crc32c(0, check, 9) != 0xe3069283) {
+		printf("%s: wrong check values\n", __func__);
+		return CMD_RET_FAILURE;
+	}
+
+	for (i = 0; i < sizeof(buf); i++) {
+		seed = seed * 1103515245 + 12345;
+		buf[i] = seed >> 16;
+	}
+
+	/* Every alignment, and lengths around the 8-byte steps */
+	for (off = 0; off < 8; off++) {
+		for (len = 0; len < sizeof(buf) - off; len++) {
+			if (crc32(0x1234, buf + off, len) !=
+			    crc_ref(CRC32_POLY, 0x1234, buf + off, len) ||
+			    crc32c(0x1234, buf + off, len) !=
+			    crc_ref(CRC32C_POLY, 0x1234, buf + off, len)) {
+				printf("%s: mismatch at offset %d, length %d\n",
+				       __func__, off, len);
+				return CMD_RET_FAILURE;
+			}
+		}
+	}
+
+	printf("%s: Everything went swimmingly\n", __func__);
+	return 0;
+}
+
+U_BOOT_CMD(
+	ut_crc32,	1,	1,	do_ut_crc32,
+	"Check CRC32 and CRC32C against a bitwise reference",
+	""
+);
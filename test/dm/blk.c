@@ -6,6 +6,8 @@
 
 #include <common.h>
 #include <dm.h>
+#include <os.h>
+#include <sandboxblockdev.h>
 #include <usb.h>
 #include <asm/state.h>
 #include <dm/test.h>
@@ -168,3 +170,158 @@ static int dm_test_blk_get_from_parent(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_blk_get_from_parent, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+#if CONFIG_IS_ENABLED(BLK_ASYNC)
+#define BLK_ASYNC_FILE		"blk_async.img"
+#define BLK_ASYNC_BLOCKS	16
+
+/* Bind a host device to a file whose block n is filled with n + 1 */
+static int blk_async_setup(struct unit_test_state *uts,
+			   struct blk_desc **descp,
+			   struct host_block_dev **host_devp)
+{
+	char block[512];
+	struct udevice *dev;
+	int fd, i;
+
+	fd = os_open(BLK_ASYNC_FILE, OS_O_CREAT | OS_O_RDWR);
+	ut_assert(fd >= 0);
+	for (i = 0; i < BLK_ASYNC_BLOCKS; i++) {
+		memset(block, i + 1, sizeof(block));
+		ut_asserteq(sizeof(block), os_write(fd, block, sizeof(block)));
+	}
+	os_close(fd);
+
+	ut_assertok(host_dev_bind(0, BLK_ASYNC_FILE));
+	ut_assertok(blk_get_device(IF_TYPE_HOST, 0, &dev));
+	*descp = dev_get_uclass_platdata(dev);
+	*host_devp = dev_get_priv(dev);
+
+	return 0;
+}
+
+static void blk_async_cleanup(void)
+{
+	host_dev_bind(0, NULL);
+	os_unlink(BLK_ASYNC_FILE);
+}
+
+/* Test that reads are queued on the device and only land when waited on */
+static int dm_test_blk_async(struct unit_test_state *uts)
+{
+	struct host_block_dev *host_dev;
+	char buf[4][512], sync_buf[512];
+	struct blk_desc *desc;
+	int tag[4];
+	int i;
+
+	ut_assertok(blk_async_setup(uts, &desc, &host_dev));
+
+	memset(buf, '\0', sizeof(buf));
+	for (i = 0; i < 4; i++) {
+		tag[i] = blk_dread_async(desc, i * 3, 1, buf[i]);
+		ut_assert(tag[i] >= 0);
+	}
+
+	/* The device takes two, the uclass holds the rest back */
+	ut_asserteq(2, host_dev->req_count);
+	for (i = 0; i < 4; i++)
+		ut_asserteq(0, buf[i][0]);
+
+	/* Waiting on the second read retires the first one too */
+	ut_assertok(blk_wait(desc, tag[1]));
+	ut_asserteq(-EINVAL, blk_wait(desc, tag[0]));
+	ut_asserteq(1, buf[0][0]);
+	ut_asserteq(4, buf[1][511]);
+	ut_asserteq(2, host_dev->req_count);
+	ut_asserteq(0, buf[2][0]);
+
+	ut_assertok(blk_wait(desc, -1));
+	ut_asserteq(0, host_dev->req_count);
+	ut_asserteq(7, buf[2][0]);
+	ut_asserteq(10, buf[3][0]);
+
+	/* A synchronous read waits for the queued ones first */
+	memset(buf, '\0', sizeof(buf));
+	tag[0] = blk_dread_async(desc, 5, 1, buf[0]);
+	ut_assert(tag[0] >= 0);
+	ut_asserteq(1, blk_dread(desc, 6, 1, sync_buf));
+	ut_asserteq(0, host_dev->req_count);
+	ut_asserteq(6, buf[0][0]);
+	ut_asserteq(7, sync_buf[0]);
+	ut_assertok(blk_wait(desc, tag[0]));
+
+	blk_async_cleanup();
+
+	return 0;
+}
+DM_TEST(dm_test_blk_async, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+#if CONFIG_IS_ENABLED(BLK_CHUNK)
+struct blk_chunk_test {
+	struct blk_chunk_range range;
+	struct host_block_dev *host_dev;
+	int count;
+	int queued[8];
+	int first[8];
+};
+
+static int blk_chunk_test_done(void *priv, const struct blk_chunk *chunk)
+{
+	struct blk_chunk_test *ct = priv;
+
+	ct->queued[ct->count] = ct->host_dev->req_count;
+	ct->first[ct->count] = *(char *)chunk->buf;
+	ct->count++;
+
+	return 0;
+}
+
+/* Test that blk_read_chunks() queues each chunk while the last is used */
+static int dm_test_blk_read_chunks(struct unit_test_state *uts)
+{
+	struct {
+		char buf[10 * 512 - 100];
+		char guard[512];
+	} mem;
+	char *buf = mem.buf;
+	struct blk_chunk_test ct = { 0 };
+	struct blk_desc *desc;
+	int i;
+
+	ut_assertok(blk_async_setup(uts, &desc, &ct.host_dev));
+	memset(mem.guard, 0xa5, sizeof(mem.guard));
+	ct.range.desc = desc;
+	ct.range.start = 2;
+	ct.range.size = sizeof(mem.buf);
+	ct.range.buf = buf;
+	ct.range.chunk = 4 * 512;
+
+	ut_assertok(blk_read_chunks(desc, blk_chunk_plan_range,
+				    blk_chunk_test_done, &ct));
+
+	/*
+	 * Chunks of 4, 4 and 1.8 blocks, each but the last overlapping. The
+	 * whole block of the last one is queued, its partial block is not.
+	 */
+	ut_asserteq(3, ct.count);
+	ut_asserteq(3, ct.first[0]);
+	ut_asserteq(7, ct.first[1]);
+	ut_asserteq(11, ct.first[2]);
+	ut_asserteq(1, ct.queued[0]);
+	ut_asserteq(1, ct.queued[1]);
+	ut_asserteq(0, ct.queued[2]);
+	ut_asserteq(12, buf[sizeof(mem.buf) - 1]);
+	ut_asserteq(0, ct.host_dev->req_count);
+
+	/* The partial last block is not written past the end of the range */
+	for (i = 0; i < sizeof(mem.guard); i++)
+		ut_asserteq(0xa5, (u8)mem.guard[i]);
+
+	blk_async_cleanup();
+
+	return 0;
+}
+DM_TEST(dm_test_blk_read_chunks, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+#endif /* BLK_CHUNK */
+#endif
@@ -11,11 +11,13 @@
 #include <dm.h>
 #include <fdtdec.h>
 #include <malloc.h>
+#include <mapmem.h>
 #include <net.h>
 #include <dm/test.h>
 #include <dm/device-internal.h>
 #include <dm/uclass-internal.h>
 #include <asm/eth.h>
+#include <asm/unaligned.h>
 #include <test/ut.h>
 
 DECLARE_GLOBAL_DATA_PTR;
@@ -259,3 +261,227 @@ static int dm_test_net_retry(struct unit_test_state *uts)
 	return retval;
 }
 DM_TEST(dm_test_net_retry, DM_TESTF_SCAN_FDT);
+
+#define TFTP_UT_BLKSIZE		512
+#define TFTP_UT_BLOCKS		10	/* the last one is short */
+#define TFTP_UT_SIZE		((TFTP_UT_BLOCKS - 1) * TFTP_UT_BLKSIZE + 100)
+#define TFTP_UT_PORT		1234
+#define TFTP_UT_ADDR		0x100000
+
+enum {
+	TFTP_UT_RRQ	= 1,
+	TFTP_UT_DATA	= 3,
+	TFTP_UT_ACK	= 4,
+	TFTP_UT_OACK	= 6,
+};
+
+/**
+ * struct tftp_ut - A TFTP server mocked on eth0
+ *
+ * @max_window:		Largest window size the server accepts
+ * @drop:		Block to lose the first time it is sent, 0 for none
+ * @asked_window:	Window size in the read request, 1 if there was none
+ * @window:		Window size the server sends
+ * @acks:		Block numbers acknowledged, in order
+ * @ack_count:		Number of acknowledgments received
+ */
+struct tftp_ut {
+	uint max_window;
+	uint drop;
+	uint asked_window;
+	uint window;
+	uint acks[TFTP_UT_BLOCKS + 4];
+	uint ack_count;
+};
+
+static struct tftp_ut tftp_ut;
+
+static uchar tftp_ut_byte(uint offset)
+{
+	return offset * 7 + offset / 251;
+}
+
+/* Send a reply to @req from the server port */
+static void tftp_ut_reply(struct udevice *dev, const void *req,
+			  const void *data, int len)
+{
+	const struct ethernet_hdr *eth = req;
+	const struct ip_udp_hdr *ip = req + ETHER_HDR_SIZE;
+	uchar pkt[PKTSIZE_ALIGN];
+	struct ethernet_hdr *ethr = (void *)pkt;
+	struct ip_udp_hdr *ipr = (void *)pkt + ETHER_HDR_SIZE;
+
+	memcpy(ethr->et_dest, eth->et_src, ARP_HLEN);
+	memcpy(ethr->et_src, eth->et_dest, ARP_HLEN);
+	ethr->et_protlen = htons(PROT_IP);
+	net_set_udp_header((uchar *)ipr, net_read_ip((void *)&ip->ip_src),
+			   ntohs(ip->udp_src), TFTP_UT_PORT, len);
+	/* from the server rather than from us */
+	net_copy_ip((void *)&ipr->ip_src, (void *)&ip->ip_dst);
+	ipr->ip_sum = 0;
+	ipr->ip_sum = compute_ip_checksum(ipr, IP_HDR_SIZE);
+	memcpy((uchar *)ipr + IP_UDP_HDR_SIZE, data, len);
+
+	sandbox_eth_recv_packet(dev, pkt,
+				ETHER_HDR_SIZE + IP_UDP_HDR_SIZE + len);
+}
+
+/* Send the window of blocks starting at @first, losing tftp_ut.drop once */
+static void tftp_ut_window(struct udevice *dev, const void *req, uint first)
+{
+	uchar data[4 + TFTP_UT_BLKSIZE];
+	uint block, last, offset, len, i;
+	bool lost = false;
+
+	last = min(first + tftp_ut.window - 1, (uint)TFTP_UT_BLOCKS);
+	for (block = first; block <= last; block++) {
+		if (block == tftp_ut.drop) {
+			tftp_ut.drop = 0;
+			lost = block == last;
+			continue;
+		}
+		offset = (block - 1) * TFTP_UT_BLKSIZE;
+		len = min((uint)TFTP_UT_BLKSIZE, TFTP_UT_SIZE - offset);
+		put_unaligned_be16(TFTP_UT_DATA, data);
+		put_unaligned_be16(block, data + 2);
+		for (i = 0; i < len; i++)
+			data[4 + i] = tftp_ut_byte(offset + i);
+		tftp_ut_reply(dev, req, data, 4 + len);
+	}
+
+	/* Nothing more is coming, so let the client time out at once */
+	if (lost)
+		sandbox_eth_skip_timeout();
+}
+
+static bool tftp_ut_handler(struct udevice *dev, void *packet, int length)
+{
+	struct ethernet_hdr *eth = packet;
+	struct ip_udp_hdr *ip = packet + ETHER_HDR_SIZE;
+	char *req = (char *)ip + IP_UDP_HDR_SIZE;
+	char *end, *name, oack[64];
+	uint block;
+	int len;
+
+	if (ntohs(eth->et_protlen) != PROT_IP || ip->ip_p != IPPROTO_UDP)
+		return false;
+	end = req + ntohs(ip->udp_len) - UDP_HDR_SIZE;
+
+	switch (get_unaligned_be16(req)) {
+	case TFTP_UT_RRQ:
+		/* skip the file name and mode, then look at the options */
+		req += 2;
+		req += strlen(req) + 1;
+		req += strlen(req) + 1;
+		tftp_ut.asked_window = 1;
+		while (req < end) {
+			name = req;
+			req += strlen(req) + 1;
+			if (!strcmp(name, "windowsize"))
+				tftp_ut.asked_window = simple_strtoul(req,
+								      NULL, 10);
+			req += strlen(req) + 1;
+		}
+		tftp_ut.window = min(tftp_ut.asked_window, tftp_ut.max_window);
+
+		put_unaligned_be16(TFTP_UT_OACK, oack);
+		len = 2;
+		len += sprintf(oack + len, "blksize") + 1;
+		len += sprintf(oack + len, "%d", TFTP_UT_BLKSIZE) + 1;
+		if (tftp_ut.window > 1) {
+			len += sprintf(oack + len, "windowsize") + 1;
+			len += sprintf(oack + len, "%u", tftp_ut.window) + 1;
+		}
+		tftp_ut_reply(dev, packet, oack, len);
+		break;
+	case TFTP_UT_ACK:
+		block = get_unaligned_be16(req + 2);
+		if (tftp_ut.ack_count < ARRAY_SIZE(tftp_ut.acks))
+			tftp_ut.acks[tftp_ut.ack_count] = block;
+		tftp_ut.ack_count++;
+		if (block < TFTP_UT_BLOCKS)
+			tftp_ut_window(dev, packet, block + 1);
+		break;
+	}
+
+	return true;
+}
+
+/* Fetch the file, checking its contents and the blocks acknowledged */
+static int tftp_ut_get(struct unit_test_state *uts, uint asked_window,
+		       const uint *acks, uint ack_count)
+{
+	uchar *buf = map_sysmem(TFTP_UT_ADDR, TFTP_UT_SIZE);
+	int i;
+
+	tftp_ut.asked_window = 0;
+	tftp_ut.ack_count = 0;
+	memset(buf, '\0', TFTP_UT_SIZE);
+	ut_asserteq(TFTP_UT_SIZE, net_loop(TFTPGET));
+	for (i = 0; i < TFTP_UT_SIZE; i++)
+		ut_asserteq(tftp_ut_byte(i), buf[i]);
+
+	ut_asserteq(asked_window, tftp_ut.asked_window);
+	ut_asserteq(ack_count, tftp_ut.ack_count);
+	for (i = 0; i < ack_count; i++)
+		ut_asserteq(acks[i], tftp_ut.acks[i]);
+
+	return 0;
+}
+
+/* The asserts include a return on fail; cleanup in the caller */
+static int _dm_test_eth_tftp_window(struct unit_test_state *uts)
+{
+	static const uint lockstep[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+	static const uint windowed[] = { 0, 4, 8, 10 };
+	static const uint gap[] = { 0, 4, 5, 9, 10 };
+	static const uint tail[] = { 0, 4, 7, 10 };
+
+	/* Only the last block of each window, and the short one, is ACKed */
+	env_set("tftpwindowsize", "4");
+	tftp_ut.max_window = 8;
+	ut_assertok(tftp_ut_get(uts, 4, windowed, ARRAY_SIZE(windowed)));
+
+	/* A lost block is ACKed once from the gap, which restarts the window */
+	tftp_ut.drop = 6;
+	ut_assertok(tftp_ut_get(uts, 4, gap, ARRAY_SIZE(gap)));
+
+	/* Losing the end of a window is put right by the timeout */
+	tftp_ut.drop = 8;
+	ut_assertok(tftp_ut_get(uts, 4, tail, ARRAY_SIZE(tail)));
+
+	/* Too big a window is limited to the receive buffers... */
+	env_set("tftpwindowsize", "100000");
+	tftp_ut.max_window = 4;
+	ut_assertok(tftp_ut_get(uts, PKTBUFSRX, windowed,
+				ARRAY_SIZE(windowed)));
+
+	/* ...and 1 does not ask for one at all */
+	env_set("tftpwindowsize", "1");
+	ut_assertok(tftp_ut_get(uts, 1, lockstep, ARRAY_SIZE(lockstep)));
+
+	return 0;
+}
+
+static int dm_test_eth_tftp_window(struct unit_test_state *uts)
+{
+	ulong old_load_addr = load_addr;
+	int retval;
+
+	env_set("ethact", "eth@10002000");
+	env_set("serverip", "1.1.2.2");
+	copy_filename(net_boot_file_name, "file", sizeof(net_boot_file_name));
+	load_addr = TFTP_UT_ADDR;
+	sandbox_eth_set_tx_handler(0, tftp_ut_handler);
+
+	retval = _dm_test_eth_tftp_window(uts);
+
+	/* Restore the env */
+	sandbox_eth_set_tx_handler(0, NULL);
+	load_addr = old_load_addr;
+	env_set("tftpwindowsize", NULL);
+	env_set("serverip", NULL);
+
+	return retval;
+}
+DM_TEST(dm_test_eth_tftp_window, DM_TESTF_SCAN_FDT);
@@ -0,0 +1,269 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests that filesystem caches notice writes to their block device
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <dm.h>
+#include <ext4fs.h>
+#include <fat.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <os.h>
+#include <part.h>
+#include <sandboxblockdev.h>
+#include <dm/test.h>
+#include <test/ut.h>
+#include <asm/unaligned.h>
+#include <linux/sizes.h>
+
+#define FS_CACHE_FILE	"fs_cache.img"
+
+/* Bind host device 0 to a file holding @len bytes of @image */
+static int fs_cache_setup(struct unit_test_state *uts, const void *image,
+			  ulong len, struct blk_desc **descp)
+{
+	struct udevice *dev;
+	int fd;
+
+	os_unlink(FS_CACHE_FILE);
+	fd = os_open(FS_CACHE_FILE, OS_O_CREAT | OS_O_RDWR);
+	ut_assert(fd >= 0);
+	ut_asserteq(len, os_write(fd, image, len));
+	os_close(fd);
+
+	ut_assertok(host_dev_bind(0, FS_CACHE_FILE));
+	ut_assertok(blk_get_device(IF_TYPE_HOST, 0, &dev));
+	*descp = dev_get_uclass_platdata(dev);
+
+	return 0;
+}
+
+static void fs_cache_cleanup(void)
+{
+	host_dev_bind(0, NULL);
+	os_unlink(FS_CACHE_FILE);
+}
+
+#ifdef CONFIG_FS_FAT
+/*
+ * A FAT16 volume of 64 sectors: boot sector, two one-sector FATs, one
+ * sector of root directory, then one sector per cluster from cluster 2.
+ * The only file, A.BIN, is two clusters long.
+ */
+#define FAT_UT_SECTORS		64
+#define FAT_UT_FAT1		1
+#define FAT_UT_FAT2		2
+#define FAT_UT_ROOT		3
+#define FAT_UT_CLUSTER(n)	(FAT_UT_ROOT + 1 + (n) - 2)
+
+static void fat_ut_set_fat(u8 *fat, u16 clust2_next, u16 clust3,
+			   u16 clust4)
+{
+	memset(fat, '\0', 512);
+	put_unaligned_le16(0xfff8, fat);
+	put_unaligned_le16(0xffff, fat + 2);
+	put_unaligned_le16(clust2_next, fat + 4);
+	put_unaligned_le16(clust3, fat + 6);
+	put_unaligned_le16(clust4, fat + 8);
+}
+
+static void fat_ut_image(u8 *img)
+{
+	u8 *bs = img;
+	dir_entry *dent = (dir_entry *)(img + FAT_UT_ROOT * 512);
+
+	memset(img, '\0', FAT_UT_SECTORS * 512);
+	memcpy(bs, "\xeb\x3c\x90" "MSWIN4.1", 11);
+	put_unaligned_le16(512, bs + 11);		/* bytes per sector */
+	bs[13] = 1;					/* sectors per cluster */
+	put_unaligned_le16(1, bs + 14);			/* reserved sectors */
+	bs[16] = 2;					/* FATs */
+	put_unaligned_le16(16, bs + 17);		/* root entries */
+	put_unaligned_le16(FAT_UT_SECTORS, bs + 19);
+	bs[21] = 0xf8;					/* media */
+	put_unaligned_le16(1, bs + 22);			/* sectors per FAT */
+	bs[38] = 0x29;
+	memcpy(bs + 39, "\x12\x34\x56\x78", 4);		/* volume id */
+	memcpy(bs + 43, "NO NAME    FAT16   ", 19);
+	bs[510] = 0x55;
+	bs[511] = 0xaa;
+
+	/* A.BIN is cluster 2 then 3; cluster 4 is free */
+	fat_ut_set_fat(img + FAT_UT_FAT1 * 512, 3, 0xffff, 0);
+	fat_ut_set_fat(img + FAT_UT_FAT2 * 512, 3, 0xffff, 0);
+
+	memcpy(dent->name, "A       BIN", 11);
+	dent->attr = ATTR_ARCH;
+	dent->start = cpu_to_le16(2);
+	dent->size = cpu_to_le32(1024);
+
+	memset(img + FAT_UT_CLUSTER(2) * 512, 'a', 512);
+	memset(img + FAT_UT_CLUSTER(3) * 512, 'b', 512);
+	memset(img + FAT_UT_CLUSTER(4) * 512, 'c', 512);
+}
+
+/* Test that the FAT cache is dropped when the device is written to */
+static int dm_test_fs_cache_fat(struct unit_test_state *uts)
+{
+	static u8 img[FAT_UT_SECTORS * 512];
+	ALLOC_CACHE_ALIGN_BUFFER(u8, fat, 512);
+	ALLOC_CACHE_ALIGN_BUFFER(char, buf, 1024);
+	disk_partition_t info = { .start = 0 };
+	struct blk_desc *desc;
+	loff_t actread;
+
+	fat_ut_image(img);
+	ut_assertok(fs_cache_setup(uts, img, sizeof(img), &desc));
+	info.size = desc->lba;
+	info.blksz = desc->blksz;
+
+	ut_assertok(fat_set_blk_dev(desc, &info));
+	ut_assertok(file_fat_read_at("a.bin", 0, buf, 0, &actread));
+	ut_asserteq(1024, actread);
+	ut_asserteq('a', buf[0]);
+	ut_asserteq('b', buf[512]);
+
+	/* Move the second half of A.BIN to cluster 4 behind the cache */
+	fat_ut_set_fat(fat, 4, 0, 0xffff);
+	ut_asserteq(1, blk_dwrite(desc, FAT_UT_FAT1, 1, fat));
+	ut_asserteq(1, blk_dwrite(desc, FAT_UT_FAT2, 1, fat));
+
+	ut_assertok(file_fat_read_at("a.bin", 0, buf, 0, &actread));
+	ut_asserteq(1024, actread);
+	ut_asserteq('a', buf[0]);
+	ut_asserteq('c', buf[512]);
+
+	fs_cache_cleanup();
+
+	return 0;
+}
+DM_TEST(dm_test_fs_cache_fat, 0);
+#endif
+
+#ifdef CONFIG_FS_EXT4
+/*
+ * gzip of a 128KiB ext4 volume with 1KiB blocks, made by
+ *   mke2fs -t ext4 -b 1024 -N 16 -O ^has_journal,^resize_inode,
+ *	^metadata_csum,^64bit,^dir_index,^huge_file,^flex_bg,^dir_nlink,
+ *	^extra_isize -m 0 -d dir img 128
+ * where dir holds the sparse file "f": file blocks 0, 2, 4, 6 and 8 are
+ * filled with 'a' to 'e'. Five extents do not fit in the inode, so they
+ * are in a leaf block of their own.
+ */
+static const unsigned char ext4_ut_image[] = {
+	0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xed, 0xdc,
+	0x4b, 0x6e, 0xd3, 0x40, 0x00, 0x06, 0xe0, 0xb1, 0x9d, 0xb6, 0x21, 0xad,
+	0x44, 0x17, 0x88, 0xe7, 0x26, 0x52, 0xd9, 0x15, 0x45, 0x5c, 0x81, 0x4a,
+	0x3d, 0x41, 0xb9, 0x00, 0x25, 0x2d, 0x12, 0x42, 0x64, 0x01, 0xec, 0xd3,
+	0x25, 0xf7, 0xe8, 0xae, 0x97, 0xe0, 0x02, 0xec, 0x7a, 0x0d, 0x54, 0xa1,
+	0xb0, 0x37, 0x7e, 0x36, 0x26, 0xa9, 0x2a, 0x16, 0x55, 0x5f, 0xf3, 0x7d,
+	0xd1, 0xd8, 0x9e, 0xc8, 0x91, 0x3c, 0xa3, 0xfc, 0xd6, 0x8c, 0x47, 0x72,
+	0x08, 0x40, 0xac, 0x36, 0x8b, 0x32, 0x6d, 0x8e, 0xc7, 0x45, 0xe9, 0x15,
+	0x25, 0xe9, 0x9e, 0x30, 0xac, 0xcb, 0x66, 0x5b, 0xff, 0xbd, 0x77, 0x10,
+	0x42, 0x9e, 0xef, 0x9d, 0x25, 0xf5, 0x79, 0x55, 0xbd, 0xd6, 0xfe, 0x6e,
+	0xbd, 0xa9, 0xf4, 0x8b, 0xdd, 0x4e, 0x51, 0xb2, 0xb2, 0xba, 0xb5, 0xfb,
+	0xe1, 0xfb, 0xc9, 0xcf, 0xb3, 0x76, 0x7f, 0x13, 0x6d, 0x5d, 0xbc, 0x86,
+	0xf2, 0x7a, 0x37, 0xfe, 0x69, 0xd7, 0xd5, 0x1a, 0x16, 0x9f, 0x24, 0x92,
+	0xff, 0xd1, 0x03, 0x51, 0xba, 0x93, 0xb2, 0x26, 0xf3, 0x2b, 0x55, 0xfe,
+	0x7b, 0x21, 0xd5, 0x25, 0x10, 0x8d, 0x3c, 0xcf, 0xd7, 0x3a, 0xd5, 0x69,
+	0x0e, 0xc4, 0xe3, 0xa1, 0x2e, 0x80, 0x58, 0x85, 0xee, 0xfc, 0xb7, 0x2d,
+	0x11, 0xf9, 0xf5, 0xa6, 0x99, 0x00, 0x2d, 0xb5, 0x3f, 0x6b, 0xe6, 0x42,
+	0xfd, 0x6a, 0x3b, 0x98, 0x25, 0xd5, 0x69, 0xdd, 0x67, 0x1d, 0x57, 0x31,
+	0xe7, 0x1d, 0x2e, 0x7e, 0x11, 0x59, 0xff, 0x03, 0x00, 0xd7, 0xef, 0x47,
+	0x39, 0xfe, 0x79, 0x7d, 0xd1, 0xf8, 0x27, 0x0d, 0x4f, 0x2f, 0x19, 0xff,
+	0x94, 0xeb, 0x26, 0x83, 0x7b, 0x30, 0xfe, 0x39, 0x3e, 0x2a, 0x36, 0x2f,
+	0x43, 0x98, 0xbd, 0x3a, 0xfd, 0xd8, 0x96, 0x76, 0x84, 0xb7, 0xb1, 0xd4,
+	0xfe, 0xf9, 0x6a, 0xce, 0x8b, 0xd0, 0xf6, 0x52, 0x3d, 0x16, 0x7c, 0x12,
+	0xe6, 0x6b, 0x67, 0x65, 0xbf, 0xad, 0x36, 0xc7, 0xcf, 0x8c, 0xff, 0x80,
+	0x5b, 0x2a, 0xad, 0xee, 0xe5, 0x49, 0x3a, 0x3a, 0x3f, 0x4e, 0xd3, 0xd1,
+	0xa8, 0x5e, 0xc3, 0x7f, 0x14, 0x06, 0xe9, 0xa7, 0xc9, 0x97, 0xaf, 0xdb,
+	0x87, 0x93, 0x6f, 0x9f, 0xc7, 0xf5, 0x3d, 0xff, 0x34, 0x4b, 0x92, 0x43,
+	0xdd, 0x06, 0xf7, 0xc2, 0xfa, 0x42, 0xfe, 0xff, 0x64, 0x75, 0xfe, 0x81,
+	0x48, 0xf4, 0x74, 0x01, 0xc8, 0x3f, 0x20, 0xff, 0x80, 0xfc, 0x03, 0xf2,
+	0x0f, 0xc8, 0x3f, 0x20, 0xff, 0x80, 0xfc, 0x03, 0xf2, 0x0f, 0xc8, 0x3f,
+	0x20, 0xff, 0xc0, 0x5d, 0xf0, 0x0e, 0x88, 0xd6, 0x3e, 0x10, 0xad, 0xf7,
+	0x40, 0xb4, 0xc6, 0x40, 0xb4, 0x0e, 0x80, 0x68, 0x0d, 0x66, 0x2b, 0xe1,
+	0x6d, 0xe7, 0x79, 0x60, 0xf9, 0xce, 0xb2, 0xc7, 0xe1, 0xff, 0xde, 0x6b,
+	0xd6, 0x6f, 0x8e, 0x9f, 0x7b, 0x8c, 0x0a, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xdc, 0x62,
+	0x7f, 0x01, 0xcd, 0xf7, 0xde, 0x4b, 0x00, 0x00, 0x02, 0x00,
+};
+
+#define EXT4_UT_SIZE		SZ_128K
+#define EXT4_UT_LEAF		27	/* filesystem block of the leaf */
+#define EXT4_UT_BLKSZ		1024
+
+static int ext4_ut_read(struct unit_test_state *uts, struct blk_desc *desc,
+			char *buf)
+{
+	disk_partition_t info = { .start = 0 };
+	loff_t len, actread;
+
+	info.size = desc->lba;
+	info.blksz = desc->blksz;
+	ext4fs_set_blk_dev(desc, &info);
+	ut_assert(ext4fs_mount(0));
+	ut_assertok(ext4fs_open("/f", &len));
+	ut_asserteq(9 * EXT4_UT_BLKSZ, len);
+	ut_assertok(ext4fs_read(buf, 0, len, &actread));
+	ut_asserteq(len, actread);
+	ext4fs_close();
+
+	return 0;
+}
+
+/* Test that cached extent tree blocks are dropped when the device is written */
+static int dm_test_fs_cache_ext4(struct unit_test_state *uts)
+{
+	const lbaint_t leaf = EXT4_UT_LEAF * EXT4_UT_BLKSZ / 512;
+	ALLOC_CACHE_ALIGN_BUFFER(u8, node, EXT4_UT_BLKSZ);
+	struct ext4_extent_header *eh = (void *)node;
+	struct ext4_extent *ext = (void *)(eh + 1);
+	unsigned long len = sizeof(ext4_ut_image);
+	struct blk_desc *desc;
+	__le32 start;
+	char *img, *buf;
+
+	img = malloc(EXT4_UT_SIZE);
+	buf = malloc(9 * EXT4_UT_BLKSZ);
+	ut_assert(img && buf);
+	ut_assertok(gunzip(img, EXT4_UT_SIZE, (uchar *)ext4_ut_image, &len));
+	ut_asserteq(EXT4_UT_SIZE, len);
+	ut_assertok(fs_cache_setup(uts, img, len, &desc));
+
+	ut_assertok(ext4_ut_read(uts, desc, buf));
+	ut_asserteq('a', buf[0]);
+	ut_asserteq(0, buf[EXT4_UT_BLKSZ]);
+	ut_asserteq('b', buf[2 * EXT4_UT_BLKSZ]);
+
+	/* Swap where the first two extents point, behind the cache */
+	ut_asserteq(2, blk_dread(desc, leaf, 2, node));
+	ut_asserteq(EXT4_EXT_MAGIC, le16_to_cpu(eh->eh_magic));
+	ut_asserteq(5, le16_to_cpu(eh->eh_entries));
+	start = ext[0].ee_start_lo;
+	ext[0].ee_start_lo = ext[1].ee_start_lo;
+	ext[1].ee_start_lo = start;
+	ut_asserteq(2, blk_dwrite(desc, leaf, 2, node));
+
+	ut_assertok(ext4_ut_read(uts, desc, buf));
+	ut_asserteq('b', buf[0]);
+	ut_asserteq('a', buf[2 * EXT4_UT_BLKSZ]);
+	ut_asserteq('c', buf[4 * EXT4_UT_BLKSZ]);
+
+	fs_cache_cleanup();
+	free(buf);
+	free(img);
+
+	return 0;
+}
+DM_TEST(dm_test_fs_cache_ext4, 0);
+#endif
@@ -0,0 +1,69 @@
+/*
+ * (C) Copyright 2026 Rockchip Electronics Co., Ltd
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <serial.h>
+#include <asm/test.h>
+#include <dm/test.h>
+#include <test/ut.h>
+
+/* Sizes chosen so that the second batch wraps around the TX buffer */
+#define SERIAL_UT_SIZE		CONFIG_SERIAL_TX_BUFFER_SIZE
+#define SERIAL_UT_FIRST		(SERIAL_UT_SIZE * 3 / 4)
+#define SERIAL_UT_TAKEN		(SERIAL_UT_SIZE / 2)
+#define SERIAL_UT_SECOND	(SERIAL_UT_SIZE / 2)
+#define SERIAL_UT_TOTAL		(SERIAL_UT_FIRST + SERIAL_UT_SECOND + 2)
+
+/* No '\n', which would add a '\r' */
+static char serial_ut_char(int i)
+{
+	return 'a' + i % 26;
+}
+
+/* Test that buffered output keeps its order while the UART is busy */
+static int dm_test_serial_tx_buffer(struct unit_test_state *uts)
+{
+	static char out[SERIAL_UT_TOTAL + 1];
+	struct serial_dev_priv *upriv;
+	int queued, taken, len, i;
+	struct udevice *dev;
+	int sent = 0;
+
+	ut_assertok(uclass_get_device(UCLASS_SERIAL, 0, &dev));
+	upriv = dev_get_uclass_priv(dev);
+	ut_assertnonnull(upriv->txbuf.start);
+
+	/* The TX FIFO is full, so it all waits in the buffer */
+	sandbox_serial_tx_capture(dev, out, sizeof(out));
+	for (i = 0; i < SERIAL_UT_FIRST; i++)
+		serial_dev_putc(dev, serial_ut_char(sent++));
+	queued = sandbox_serial_tx_room(dev, SERIAL_UT_TAKEN);
+
+	/* The next one sends what the FIFO takes, then waits behind the rest */
+	serial_dev_putc(dev, serial_ut_char(sent++));
+	taken = sandbox_serial_tx_room(dev, 0);
+
+	/* These wrap around the end of the buffer */
+	for (i = 0; i < SERIAL_UT_SECOND; i++)
+		serial_dev_putc(dev, serial_ut_char(sent++));
+
+	/* Once the FIFO is free, the buffer empties before the next one */
+	sandbox_serial_tx_room(dev, -1);
+	serial_dev_putc(dev, serial_ut_char(sent++));
+	len = sandbox_serial_tx_room(dev, -1);
+	sandbox_serial_tx_capture(dev, NULL, 0);
+
+	ut_asserteq(0, queued);
+	ut_asserteq(SERIAL_UT_TAKEN, taken);
+	ut_asserteq(SERIAL_UT_TOTAL, len);
+	for (i = 0; i < len; i++)
+		ut_asserteq(serial_ut_char(i), out[i]);
+	ut_assert(membuff_isempty(&upriv->txbuf));
+
+	return 0;
+}
+DM_TEST(dm_test_serial_tx_buffer, DM_TESTF_SCAN_FDT);
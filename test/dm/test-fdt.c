@@ -214,6 +214,62 @@ static int dm_test_fdt_pre_reloc(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_fdt_pre_reloc, 0);
 
+#if CONFIG_IS_ENABLED(DM_LAZY_BIND)
+/* Test that nodes bind on first use, in device tree order */
+static int dm_test_fdt_lazy_bind(struct unit_test_state *uts)
+{
+	static const char *const names[] = {
+		"a-test", "b-test", "d-test", "e-test", "f-test", "g-test",
+	};
+	struct udevice *bus, *dev;
+	struct uclass *uc;
+	int node, i;
+
+	ut_assertok(dm_scan_fdt(gd->fdt_blob, false));
+
+	/* The scan only records the nodes */
+	ut_assertok(uclass_get_nolazy(UCLASS_TEST_FDT, &uc));
+	ut_assert(list_empty(&uc->dev_head));
+	ut_assertok(uclass_get_nolazy(UCLASS_PHY, &uc));
+	ut_assert(list_empty(&uc->dev_head));
+
+	/* Looking up a uclass binds its nodes, and only those */
+	ut_assertok(uclass_get(UCLASS_TEST_FDT, &uc));
+	ut_asserteq(ARRAY_SIZE(names), list_count_items(&uc->dev_head));
+	ut_assertok(uclass_get_nolazy(UCLASS_PHY, &uc));
+	ut_assert(list_empty(&uc->dev_head));
+
+	i = 0;
+	for (uclass_find_first_device(UCLASS_TEST_FDT, &dev); dev;
+	     uclass_find_next_device(&dev))
+		ut_asserteq_str(names[i++], dev->name);
+	ut_asserteq(ARRAY_SIZE(names), i);
+
+	ut_assertok(uclass_get(UCLASS_PHY, &uc));
+	ut_assert(!list_empty(&uc->dev_head));
+
+	/* Looking for children binds them, without probing their parent */
+	node = fdt_path_offset(gd->fdt_blob, "/probing");
+	ut_assert(node > 0);
+	ut_assertok(device_find_child_by_of_offset(gd->dm_root, node, &bus));
+	ut_assertnonnull(bus);
+	ut_assertok(device_find_first_child(bus, &dev));
+	ut_assertnonnull(dev);
+	ut_asserteq_str("test1", dev->name);
+	ut_assert(!device_active(bus));
+
+	/* Children bind when their parent probes, in device tree order */
+	ut_assertok(uclass_get_device(UCLASS_TEST_BUS, 0, &bus));
+	ut_assertok(device_get_child(bus, 0, &dev));
+	ut_asserteq_str("c-test@5", dev->name);
+	ut_assertok(device_get_child(bus, 2, &dev));
+	ut_asserteq_str("c-test@1", dev->name);
+
+	return 0;
+}
+DM_TEST(dm_test_fdt_lazy_bind, 0);
+#endif
+
 /* Test that sequence numbers are allocated properly */
 static int dm_test_fdt_uclass_seq(struct unit_test_state *uts)
 {
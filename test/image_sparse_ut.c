@@ -0,0 +1,203 @@
+/*
+ * (C) Copyright 2026 Rockchip Electronics Co., Ltd
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <fastboot.h>
+#include <image-sparse.h>
+#include <malloc.h>
+
+#define SPARSE_UT_BLKSZ		512
+#define SPARSE_UT_START		8
+#define SPARSE_UT_BLOCKS	64
+#define SPARSE_UT_IMG_BLKSZ	4096
+#define SPARSE_UT_FILL		0x12345678
+
+struct sparse_ut {
+	struct sparse_storage info;
+	u8 disk[(SPARSE_UT_START + SPARSE_UT_BLOCKS) * SPARSE_UT_BLKSZ];
+	u8 image[8 * SPARSE_UT_IMG_BLKSZ];
+	uint image_len;
+	int writes;
+};
+
+static lbaint_t sparse_ut_write(struct sparse_storage *info, lbaint_t blk,
+				lbaint_t blkcnt, const void *buffer)
+{
+	struct sparse_ut *ut = info->priv;
+
+	memcpy(ut->disk + blk * info->blksz, buffer, blkcnt * info->blksz);
+	ut->writes++;
+
+	return blkcnt;
+}
+
+static lbaint_t sparse_ut_reserve(struct sparse_storage *info, lbaint_t blk,
+				  lbaint_t blkcnt)
+{
+	return blkcnt;
+}
+
+static void sparse_ut_chunk(struct sparse_ut *ut, u16 type, u32 blks,
+			    const void *data, uint len)
+{
+	chunk_header_t *ch = (chunk_header_t *)(ut->image + ut->image_len);
+
+	ch->chunk_type = type;
+	ch->reserved1 = 0;
+	ch->chunk_sz = blks;
+	ch->total_sz = sizeof(*ch) + len;
+	ut->image_len += sizeof(*ch);
+	memcpy(ut->image + ut->image_len, data, len);
+	ut->image_len += len;
+}
+
+/*
+ * Build a sparse image of a RAW, a FILL, a DONT_CARE and a two block RAW
+ * chunk, and fill @ut->disk with what flashing it should leave there.
+ */
+static void sparse_ut_image(struct sparse_ut *ut, u8 *expect)
+{
+	sparse_header_t *sh = (sparse_header_t *)ut->image;
+	u8 raw[2 * SPARSE_UT_IMG_BLKSZ];
+	u32 fill = SPARSE_UT_FILL;
+	u8 *p = expect + SPARSE_UT_START * SPARSE_UT_BLKSZ;
+	int i;
+
+	for (i = 0; i < sizeof(raw); i++)
+		raw[i] = i * 7 + i / 256;
+
+	memset(sh, 0, sizeof(*sh));
+	sh->magic = SPARSE_HEADER_MAGIC;
+	sh->major_version = 1;
+	sh->file_hdr_sz = sizeof(*sh);
+	sh->chunk_hdr_sz = sizeof(chunk_header_t);
+	sh->blk_sz = SPARSE_UT_IMG_BLKSZ;
+	sh->total_blks = 5;
+	sh->total_chunks = 4;
+	ut->image_len = sizeof(*sh);
+
+	sparse_ut_chunk(ut, CHUNK_TYPE_RAW, 1, raw, SPARSE_UT_IMG_BLKSZ);
+	sparse_ut_chunk(ut, CHUNK_TYPE_FILL, 1, &fill, sizeof(fill));
+	sparse_ut_chunk(ut, CHUNK_TYPE_DONT_CARE, 1, NULL, 0);
+	sparse_ut_chunk(ut, CHUNK_TYPE_RAW, 2, raw, sizeof(raw));
+
+	memset(expect, 0xee, sizeof(ut->disk));
+	memcpy(p, raw, SPARSE_UT_IMG_BLKSZ);
+	p += SPARSE_UT_IMG_BLKSZ;
+	for (i = 0; i < SPARSE_UT_IMG_BLKSZ; i += sizeof(fill))
+		memcpy(p + i, &fill, sizeof(fill));
+	p += 2 * SPARSE_UT_IMG_BLKSZ;
+	memcpy(p, raw, sizeof(raw));
+}
+
+/* Flash @ut->image in pieces of @piece bytes */
+static int sparse_ut_flash(struct sparse_ut *ut, uint piece, char *response)
+{
+	struct sparse_stream ss;
+	uint pos, n;
+	int ret = 0;
+
+	memset(ut->disk, 0xee, sizeof(ut->disk));
+	ut->writes = 0;
+	if (sparse_stream_init(&ss, &ut->info))
+		return -ENOMEM;
+
+	for (pos = 0; pos < ut->image_len && !ret; pos += n) {
+		n = min(piece, ut->image_len - pos);
+		ret = sparse_stream_write(&ss, ut->image + pos, n);
+	}
+
+	return sparse_stream_finish(&ss, "test", response) ?: ret;
+}
+
+static int do_ut_sparse(cmd_tbl_t *cmdtp, int flag, int argc,
+			char *const argv[])
+{
+	static const uint pieces[] = { 1, 3, 12, 511, 4096, 5000, 1 << 20 };
+	char response[FASTBOOT_RESPONSE_LEN];
+	struct sparse_stream ss;
+	struct sparse_ut *ut;
+	u8 *expect;
+	int i, writes, ret = CMD_RET_FAILURE;
+
+	ut = calloc(1, sizeof(*ut));
+	expect = malloc(sizeof(ut->disk));
+	if (!ut || !expect)
+		goto out;
+
+	ut->info.blksz = SPARSE_UT_BLKSZ;
+	ut->info.start = SPARSE_UT_START;
+	ut->info.size = SPARSE_UT_BLOCKS;
+	ut->info.write = sparse_ut_write;
+	ut->info.reserve = sparse_ut_reserve;
+	ut->info.priv = ut;
+	sparse_ut_image(ut, expect);
+
+	/* Headers and data split anywhere give the same result */
+	for (i = 0; i < ARRAY_SIZE(pieces); i++) {
+		if (sparse_ut_flash(ut, pieces[i], response) ||
+		    strcmp(response, "OKAY") ||
+		    memcmp(ut->disk, expect, sizeof(ut->disk))) {
+			printf("%s: wrong result with %u byte pieces: %s\n",
+			       __func__, pieces[i], response);
+			goto out;
+		}
+		/* RAW data is staged, not written a packet at a time */
+		if (ut->writes > 4) {
+			printf("%s: %d writes with %u byte pieces\n",
+			       __func__, ut->writes, pieces[i]);
+			goto out;
+		}
+	}
+
+	/* An image not in sparse format is written as-is, padded */
+	memset(ut->disk, 0xee, sizeof(ut->disk));
+	if (sparse_stream_init(&ss, &ut->info) ||
+	    sparse_stream_write(&ss, "plain", 5) ||
+	    sparse_stream_finish(&ss, "test", response) ||
+	    memcmp(ut->disk + SPARSE_UT_START * SPARSE_UT_BLKSZ, "plain\0", 6)) {
+		printf("%s: plain image not written\n", __func__);
+		goto out;
+	}
+
+	/*
+	 * The FILL chunk runs past the end of a smaller partition: the error
+	 * must stick, with no further writes and no chunk counted after it.
+	 */
+	ut->info.size = SPARSE_UT_IMG_BLKSZ / SPARSE_UT_BLKSZ + 1;
+	ut->writes = 0;
+	if (sparse_stream_init(&ss, &ut->info))
+		goto out;
+	if (!sparse_stream_write(&ss, ut->image, ut->image_len) ||
+	    ss.chunk != 1) {
+		printf("%s: write past the partition not caught\n", __func__);
+		sparse_stream_abort(&ss);
+		goto out;
+	}
+	writes = ut->writes;
+	if (!sparse_stream_write(&ss, ut->image, ut->image_len) ||
+	    ut->writes != writes || ss.chunk != 1 ||
+	    !sparse_stream_finish(&ss, "test", response) ||
+	    strncmp(response, "FAIL", 4)) {
+		printf("%s: error did not stick: %s\n", __func__, response);
+		goto out;
+	}
+
+	printf("%s: Everything went swimmingly\n", __func__);
+	ret = 0;
+out:
+	free(expect);
+	free(ut);
+
+	return ret;
+}
+
+U_BOOT_CMD(
+	ut_sparse,	1,	1,	do_ut_sparse,
+	"Check writing sparse images which arrive in pieces",
+	""
+);
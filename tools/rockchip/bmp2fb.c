@@ -0,0 +1,210 @@
+/*
+ * (C) Copyright 2026 Rockchip Electronics Co., Ltd
+ *
+ * SPDX-License-Identifier:     GPL-2.0+
+ *
+ * Convert a 16, 24 or 32 bpp BMP logo to "<logo>.fb", which U-Boot shows
+ * without decoding: the pixels are kept, the rows are put top first.
+ * The layout must match struct rockchip_logo_fb in
+ * drivers/video/drm/rockchip_display.h. Both files are little-endian,
+ * whatever the host is.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "compiler.h"
+#include <u-boot/sha1.h>
+
+struct bmp_header {
+	/* Header */
+	char signature[2];
+	uint32_t	file_size;
+	uint32_t	reserved;
+	uint32_t	data_offset;
+	/* InfoHeader */
+	uint32_t	size;
+	int32_t		width;
+	int32_t		height;
+	uint16_t	planes;
+	uint16_t	bit_count;
+	uint32_t	compression;
+	uint32_t	image_size;
+	uint32_t	x_pixels_per_m;
+	uint32_t	y_pixels_per_m;
+	uint32_t	colors_used;
+	uint32_t	colors_important;
+	/* ColorTable */
+} __attribute__((packed));
+
+struct rockchip_logo_fb {
+	char magic[4];
+	uint32_t width;
+	uint32_t height;
+	uint32_t bpp;
+	uint32_t src_size;
+	uint8_t src_sha1[SHA1_SUM_LEN];
+	uint32_t data_offset;
+} __attribute__((packed));
+
+#define LOGO_FB_MAGIC		"RKFB"
+/* Keeps the pixels cache line aligned when the file is */
+#define LOGO_FB_DATA_OFFSET	64
+#define ALIGN(x, y)		(((x) + (y) - 1) & ~((y) - 1))
+
+#define BMP_GET16(bmp, field) \
+	get_le16((uint8_t *)(bmp) + offsetof(struct bmp_header, field))
+#define BMP_GET32(bmp, field) \
+	get_le32((uint8_t *)(bmp) + offsetof(struct bmp_header, field))
+#define FB_PUT32(buf, field, val) \
+	put_le32((buf) + offsetof(struct rockchip_logo_fb, field), val)
+
+static const char *PROG;
+
+static void usage(void)
+{
+	printf("Usage: %s [--src stored] <logo.bmp> <logo.bmp.fb>\n\n", PROG);
+	printf("\t --src stored");
+	printf("\t\t The file stored in resource.img, if it is\n");
+	printf("\t\t\t\t <logo.bmp> compressed with gzip or lz4\n");
+}
+
+static uint16_t get_le16(const uint8_t *p)
+{
+	return p[0] | p[1] << 8;
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+	return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void put_le32(uint8_t *p, uint32_t val)
+{
+	p[0] = val;
+	p[1] = val >> 8;
+	p[2] = val >> 16;
+	p[3] = val >> 24;
+}
+
+static void *read_file(const char *path, long *size)
+{
+	FILE *file;
+	void *buf;
+
+	file = fopen(path, "rb");
+	if (!file) {
+		fprintf(stderr, "failed to open %s\n", path);
+		return NULL;
+	}
+	fseek(file, 0, SEEK_END);
+	*size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	buf = malloc(*size);
+	if (buf && fread(buf, 1, *size, file) != *size) {
+		fprintf(stderr, "failed to read %s\n", path);
+		free(buf);
+		buf = NULL;
+	}
+	fclose(file);
+
+	return buf;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *src = NULL;
+	uint8_t *in, *out, *s, *d, *stored = NULL;
+	uint32_t width, height, data_offset, src_stride, y;
+	int32_t bmp_height;
+	int top_down, bpp;
+	long size, src_size, out_size;
+	FILE *file;
+	int ret = -1;
+
+	PROG = argv[0];
+	argc--, argv++;
+	if (argc > 1 && !strcmp(argv[0], "--src")) {
+		src = argv[1];
+		argc -= 2, argv += 2;
+	}
+	if (argc != 2) {
+		usage();
+		return -1;
+	}
+
+	in = read_file(argv[0], &size);
+	if (!in)
+		return -1;
+	if (size < sizeof(struct bmp_header) || memcmp(in, "BM", 2) ||
+	    BMP_GET32(in, compression)) {
+		fprintf(stderr, "%s is not an uncompressed BMP\n", argv[0]);
+		goto out;
+	}
+
+	bpp = BMP_GET16(in, bit_count);
+	if (bpp != 16 && bpp != 24 && bpp != 32) {
+		fprintf(stderr, "%d bpp is not supported\n", bpp);
+		goto out;
+	}
+	width = BMP_GET32(in, width);
+	bmp_height = BMP_GET32(in, height);
+	top_down = bmp_height < 0;
+	height = top_down ? -bmp_height : bmp_height;
+	data_offset = BMP_GET32(in, data_offset);
+	src_stride = ALIGN(width * bpp / 8, 4);
+	if (data_offset + (uint64_t)src_stride * height > size) {
+		fprintf(stderr, "%s is truncated\n", argv[0]);
+		goto out;
+	}
+
+	/*
+	 * U-Boot compares these with the size and SHA1 that resource_tool
+	 * records for the file as stored
+	 */
+	src_size = size;
+	if (src) {
+		stored = read_file(src, &src_size);
+		if (!stored)
+			goto out;
+	}
+
+	out_size = LOGO_FB_DATA_OFFSET + src_stride * height;
+	out = calloc(1, out_size);
+	if (!out)
+		goto out;
+	memcpy(out, LOGO_FB_MAGIC, 4);
+	FB_PUT32(out, width, width);
+	FB_PUT32(out, height, height);
+	FB_PUT32(out, bpp, bpp);
+	FB_PUT32(out, src_size, src_size);
+	sha1_csum(stored ? stored : in, src_size,
+		  out + offsetof(struct rockchip_logo_fb, src_sha1));
+	FB_PUT32(out, data_offset, LOGO_FB_DATA_OFFSET);
+
+	for (y = 0; y < height; y++) {
+		s = in + data_offset + (top_down ? y : height - 1 - y) * src_stride;
+		d = out + LOGO_FB_DATA_OFFSET + y * src_stride;
+		memcpy(d, s, src_stride);
+	}
+
+	file = fopen(argv[1], "wb");
+	if (!file) {
+		fprintf(stderr, "failed to open %s\n", argv[1]);
+	} else {
+		if (fwrite(out, 1, out_size, file) == out_size)
+			ret = 0;
+		else
+			fprintf(stderr, "failed to write %s\n", argv[1]);
+		fclose(file);
+	}
+	free(out);
+out:
+	free(stored);
+	free(in);
+
+	return ret;
+}